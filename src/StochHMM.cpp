@@ -30,13 +30,12 @@
 #include <iomanip>
 #include <time.h>
 #include <fstream>
+#include <sstream>
 #include "StochHMMlib.h"
 
 #include "StochHMM_usage.h"
 using namespace StochHMM;
 
-#define STATE_MAX 1024
-
 
 void import_model(model&);
 void import_sequence(model&);
@@ -45,12 +44,23 @@ void perform_viterbi_decoding(model* hmm, sequences* seqs);
 void perform_nbest_decoding(model* hmm, sequences* seqs);
 void perform_posterior(model* hmm, sequences* seqs);
 void perform_stochastic_decoding(model* hmm, sequences* seqs);
+void perform_training(model& hmm);
+void perform_stream_decoding(model* hmm);
+struct streamPosteriorTable;
+void start_stream_posterior(outputBuffer& out, streamPosteriorTable& table, model* hmm, std::string& header);
+void end_stream_posterior(outputBuffer& out, trellis& trell);
+void print_stream_posterior(size_t position, std::vector<double>& posteriors, bool block_end, void* data);
 
-void print_output(multiTraceback*, std::string&);
+void print_output(multiTraceback*, sequences*);
 void print_output(std::vector<traceback_path>&, std::string&);
-void print_output(traceback_path*, std::string&);
+void print_output(traceback_path*, sequences*);
 void print_posterior(trellis&);
 void print_limited_posterior(trellis& trell);
+void export_table(trellis&, tableType);
+void start_stats(trellis& trell);
+void start_emission_threads(trellis& trell);
+void start_concurrent_posterior(trellis& trell);
+void print_stats(trellis& trell);
 
 
 //Sets the command-line options for the program
@@ -59,24 +69,48 @@ opt_parameters commandline[]={
     {"-help:-h"     ,OPT_NONE       ,false  ,"",    {}},
 	//Required
     {"-model:-m"    ,OPT_STRING     ,true   ,"",    {}},
-    {"-seq:-s:-track",OPT_STRING    ,true   ,"",    {}},
+    {"-seq:-s:-track",OPT_STRING    ,false  ,"",    {}},
+	{"-compile-model",OPT_STRING	,false	,"",	{}},
 	{"-fastq"		,OPT_NONE		,false	,"",	{}},
+	{"-region"		,OPT_STRING		,false	,"",	{}},
+	{"-cache"		,OPT_STRING		,false	,"",	{}},
+	{"-stream"		,OPT_INT		,false	,"1000000",	{}},
+	{"-real-format"	,OPT_FLAG		,false	,"",	{"text","f32","f64"}},
+	{"-real-float"	,OPT_NONE		,false	,"",	{}},
+	{"-pack"		,OPT_NONE		,false	,"",	{}},
 	//Debug
     {"-debug:-d"    ,OPT_FLAG		,false  ,"",    {"model","seq","paths"}},
 	//Non-Stochastic Decoding
     {"-viterbi"     ,OPT_NONE       ,false  ,"",    {}},
 	{"-nbest"       ,OPT_INT        ,false  ,"3",   {}},
+	{"-beam"		,OPT_DOUBLE		,false	,"",	{}},
+	{"-beam-width"	,OPT_INT		,false	,"",	{}},
+	{"-memory"		,OPT_STRING		,false	,"",	{}},
     {"-posterior"   ,OPT_STRING		,false  ,"",    {}},
 	{"-threshold"	,OPT_DOUBLE		,false	,"",	{}},
+	{"-posterior-window",OPT_INT	,false	,"",	{}},
+	{"-overlap"		,OPT_INT		,false	,"",	{}},
+	{"-lag"			,OPT_INT		,false	,"",	{}},
 	//Stochastic Decoding
     {"-stochastic"  ,OPT_FLAG       ,false  ,"",    {"viterbi","forward","posterior"}},
     {"-repetitions:-rep",OPT_INT    ,false  ,"1000",{}},
+	//Training
+	{"-train"		,OPT_FLAG		,false	,"",	{"baum-welch","viterbi"}},
+	{"-iterations"	,OPT_INT		,false	,"100",	{}},
+	{"-tolerance"	,OPT_DOUBLE		,false	,"0.001",{}},
+	{"-train-out"	,OPT_STRING		,false	,"",	{}},
+	{"-threads"		,OPT_INT		,false	,"1",	{}},
+	{"-emission-tile",OPT_INT		,false	,"",	{}},
 	//Output Files and Formats
     {"-gff:-g"      ,OPT_STRING     ,false  ,"",    {}},
     {"-path:-p"     ,OPT_STRING     ,false  ,"",    {}},
     {"-label:-l"    ,OPT_STRING     ,false  ,"",    {}},
 	{"-hits"        ,OPT_STRING     ,false  ,"",    {}},
     {"-trellis"     ,OPT_STRING     ,false  ,"",    {}},
+	{"-trellis-format",OPT_FLAG		,false	,"",	{"f32","f16"}},
+	{"-trellis-layout",OPT_FLAG		,false	,"",	{"position","state"}},
+	{"-trellis-compress",OPT_NONE	,false	,"",	{}},
+	{"-stats"		,OPT_NONE		,false	,"",	{}},
 };
 
 //Stores the number of options in opt
@@ -88,6 +122,16 @@ options opt;
 //seqTracks stores multiple jobs(model and multiple sequences)
 seqTracks jobs;
 
+//Decoding output is written to stdout or the file given with the output option
+outputWriter output;
+
+//Trellis tables are written to the -trellis file
+trellisWriter table_output;
+
+//Statistics of the job being decoded (-stats)
+trellisStats job_stats;
+double job_start;
+
 //Create and initialize StateFuncs
 //This will automatically initialize all the Univariate and Multivariate
 //PDFs
@@ -109,6 +153,26 @@ int main(int argc, const char * argv[])
 	
     //import the model
     import_model(hmm);
+	
+	//Write the compiled model.  Sequences are only required to decode.
+	if (opt.isSet("-compile-model")){
+		if (!hmm.compile(opt.sopt("-compile-model"))){
+			exit(1);
+		}
+		
+		if (!opt.isSet("-seq")){
+			return 0;
+		}
+	}
+	
+	//A sequence cache that has been written can be used without the sequence
+	//file, except when streaming, which reads the sequence file itself
+	bool cached = opt.isSet("-cache") && !opt.isSet("-stream") && seqCache::isCache(opt.sopt("-cache"));
+	if (!opt.isSet("-seq") && !cached){
+		std::cout << "Required option:\t-seq not set on command-line\n";
+		std::cout << usage << std::endl;
+		exit(1);
+	}
     
 	
 //	if (opt.isFlagSet("-debug", "paths")){
@@ -118,14 +182,23 @@ int main(int argc, const char * argv[])
     
     //Check and import sequence(s)
 	//These will be imported into seqTracks jobs
-    import_sequence(hmm);
+	//Windowed decoding reads the sequences itself
+	if (!opt.isSet("-stream")){
+		import_sequence(hmm);
+	}
+	
+	//Train the model using all of the sequences and output the model
+	if (opt.isSet("-train")){
+		perform_training(hmm);
+		return 0;
+	}
     
 	//Get the job (model and associated sequences)
-    seqJob *job=jobs.getJob();
+    seqJob *job = (opt.isSet("-stream")) ? NULL : jobs.getJob();
 	
 	
 	//If filename is set for any of the following
-	//options we need to re-direct the stdout to the file
+	//options we need to write the output to the file
 	std::string filename;
 	if (opt.isSet("-posterior")){
 		opt.getopt("-posterior",filename);
@@ -141,36 +214,45 @@ int main(int argc, const char * argv[])
 	}
 	
 	
-	//Create file handle
-	std::ofstream file;
-	
-	//Create ptr to store STDOUT if we redirect 
-	std::streambuf* oldCoutStream(NULL);
-	bool file_open(false);
-
-	
-	//If we defined a filename then redirect stdout
+	//If we defined a filename then write the output to it
 	if (!filename.empty()){
-		oldCoutStream = std::cout.rdbuf();
-		
-		file.open(filename.c_str());
-		std::cout << std::setprecision(3);
-		std::cout << std::fixed;
-		if (!file.is_open()){
+		if (!output.open(filename)){
 			std::cerr << "Couldn't open file for posterior" << std::endl;
 			exit(1);
 		}
-		file_open = true;
-		std::cout.rdbuf(file.rdbuf());
+		output.setPrecision(3, true);
+	}
+	
+	//Open the binary file for the trellis tables
+	if (opt.isSet("-trellis")){
+		if (opt.isSet("-stream")){
+			std::cerr << "Trellis tables (-trellis) can't be exported with -stream" << std::endl;
+			exit(1);
+		}
+		
+		table_output.setValueType((opt.isFlagSet("-trellis-format", "f16")) ? TABLE_FLOAT16 : TABLE_FLOAT32);
+		table_output.setLayout((opt.isFlagSet("-trellis-layout", "state")) ? STATE_MAJOR : POSITION_MAJOR);
+		if (opt.isSet("-trellis-compress")){
+			table_output.setCompression(1 << 20);
+		}
+		
+		if (!table_output.open(opt.sopt("-trellis"))){
+			exit(1);
+		}
 	}
 	
 	
+	//Decode the sequences a window at a time
+	if (opt.isSet("-stream")){
+		perform_stream_decoding(&hmm);
+	}
+	
 	// Fore each job(sequence) perform the analysis
 	while (job != NULL){
 		
 		//Print sequences if -debug seq option defined
 		if (opt.isFlagSet("-debug","seq")){
-			job->getSeqs()->print();
+			output.write(job->getSeqs()->stringify() + "\n");
 		}
 		
 		//Perform posterior analysis
@@ -198,10 +280,12 @@ int main(int argc, const char * argv[])
 	}
 	
 	
-	//Close file and redirect stdout to original place
-	if (file_open){
-		std::cout.rdbuf(oldCoutStream);
-		file.close();
+	//Write the remaining output and close the file
+	output.close();
+	
+	if (!table_output.close()){
+		std::cerr << "Couldn't write the trellis table file" << std::endl;
+		exit(1);
 	}
     
     return 0;
@@ -219,6 +303,8 @@ void import_model(model& hmm){
 		//Import the model using string supplied from commandline
 		//Pass StateFuncs.   This will allow the user to define
 		//the functions within the model.
+		//The model text is only kept to write the compiled model
+		hmm.keepSource(opt.isSet("-compile-model"));
 		hmm.import(opt.sopt("-model"),&default_functions);
     }
     
@@ -231,6 +317,58 @@ void import_model(model& hmm){
 //Load sequences from file (Default FASTA)
 void import_sequence(model& hmm){
     
+	//Gzip and BGZF sequence files are decompressed by background threads
+	if (opt.isSet("-threads")){
+		jobs.setReaderThreads(opt.iopt("-threads"));
+	}
+	
+	//Binary real number files (otherwise chosen by .f32/.f64 extension)
+	if (opt.isFlagSet("-real-format", "f32")){
+		jobs.setRealFormat(REAL_FLOAT32);
+	}
+	else if (opt.isFlagSet("-real-format", "f64")){
+		jobs.setRealFormat(REAL_FLOAT64);
+	}
+	else if (opt.isFlagSet("-real-format", "text")){
+		jobs.setRealFormat(REAL_TEXT);
+	}
+	
+	if (opt.isSet("-real-float")){
+		jobs.setSingleReal(true);
+	}
+	
+	//Digitized sequences are packed into 2 or 4 bits per symbol
+	if (opt.isSet("-pack")){
+		jobs.setPacking(true);
+	}
+	
+	//Only decode the given regions, read using the FASTA index
+	if (opt.isSet("-region")){
+		std::vector<seqRegion> regions;
+		if (!loadRegions(opt.sopt("-region"), regions)){
+			exit(1);
+		}
+		jobs.setRegions(regions);
+	}
+	
+	std::vector<std::string> sources;
+	if (opt.isSet("-seq")){
+		sources.push_back(opt.sopt("-seq"));
+	}
+	
+	//Read sequences from the cache if it was written from the same sequence
+	//file and regions.  Otherwise it is written again from the sequence file.
+	if (opt.isSet("-cache") && seqCache::isCache(opt.sopt("-cache"))){
+		if (jobs.loadCache(hmm, opt.sopt("-cache"), sources)){
+			return;
+		}
+		
+		if (sources.empty()){
+			exit(1);
+		}
+		std::cerr << "Writing sequence cache again: " << opt.sopt("-cache") << std::endl;
+	}
+	
     if (!opt.isSet("-seq")){
         std::cerr << "No sequence file provided.\n" << usage << std::endl;
     }
@@ -243,43 +381,239 @@ void import_sequence(model& hmm){
 		//Import the sequence form fasta file
         jobs.loadSeqs(hmm, opt.sopt("-seq"), FASTA);
     }
+	
+	//Write the digitized sequences to the cache, then decode from the cache
+	if (opt.isSet("-cache")){
+		if (!jobs.writeCache(opt.sopt("-cache"), sources) || !jobs.loadCache(hmm, opt.sopt("-cache"), sources)){
+			exit(1);
+		}
+	}
 }
 
 //Perform Viterbi decoding and print the output
 void perform_viterbi_decoding(model* hmm, sequences* seqs){
 	//Setup the trellis with the model and sequence
     trellis trell(hmm,seqs);
+	start_stats(trell);
+	start_emission_threads(trell);
+	size_t threads = (opt.isSet("-threads")) ? opt.iopt("-threads") : 1;
 	
-	//Perform viterbi decoding
-	trell.viterbi();
+	//Perform viterbi decoding (beam pruned if a beam is given)
+	if (opt.isSet("-beam") || opt.isSet("-beam-width")){
+		double threshold = (opt.isSet("-beam")) ? opt.dopt("-beam") : INFINITY;
+		size_t width = (opt.isSet("-beam-width")) ? opt.iopt("-beam-width") : 0;
+		trell.setBeam(threshold, width);
+		trell.beam_viterbi();
+		std::cerr << "Beam pruned cells: " << trell.getPrunedCells() << std::endl;
+	}
+	
+	//Choose the fastest algorithm that fits the memory budget
+	else if (opt.isSet("-memory")){
+		double budget = decodingPlanner::parseBytes(opt.sopt("-memory"));
+		if (budget < 0){
+			std::cerr << "Can't parse -memory: " << opt.sopt("-memory") << std::endl;
+			exit(1);
+		}
+		
+		size_t window = (opt.isSet("-stream")) ? opt.iopt("-stream") : 1000000;
+		decodingPlanner planner(hmm);
+		planner.plan(seqs->getLength(), opt.isSet("-trellis"), window);
+		planner.choose(budget);
+		std::cerr << planner.stringify();
+		
+		trell.store(opt.isSet("-trellis"));
+		if (planner.getChoice() == CHECKPOINT_ENGINE){
+			traceback_path path(hmm);
+			trell.checkpoint_viterbi(path);
+			print_output(&path, seqs);
+			print_stats(trell);
+			return;
+		}
+		else if (planner.getChoice() == SPARSE_COMPLEX_ENGINE){
+			trell.sparse_complex_viterbi();
+		}
+		else{
+			trell.viterbi();
+		}
+	}
+	else{
+		trell.store(opt.isSet("-trellis"));
+		if (threads > 1){
+			trell.parallel_viterbi(threads);
+		}
+		else{
+			trell.viterbi();
+		}
+	}
+	
+	if (opt.isSet("-trellis")){
+		export_table(trell, VITERBI_TABLE);
+	}
 	
 	//Create a traceback path ptr to store traceback from perform_traceback
 	//function
 	traceback_path path(hmm);
-	trell.traceback(path);
+	if (threads > 1){
+		trell.parallel_traceback(path, threads);
+	}
+	else{
+		trell.traceback(path);
+	}
 		
 	//Call print_output (below) to print the traceback in the required format
-	print_output(&path, seqs->getHeader());
+	print_output(&path, seqs);
+	print_stats(trell);
 	
     return;
 }
 
+//Posterior table printed as its rows are finished (perform_stream_decoding,
+//or perform_posterior with -posterior-window)
+struct streamPosteriorTable{
+	outputBuffer* out;
+	std::vector<size_t> states;		//Columns of the table
+	bool limited;					//Only print rows above the threshold (-threshold)
+	double threshold;
+	size_t offset;					//Added to the positions
+};
+
+
+//Decode each sequence in windows of -stream symbols, so only a window of the
+//sequence is in memory.  Performs Viterbi decoding if -viterbi is set,
+//fixed-lag posterior decoding if -posterior is set (-lag positions),
+//otherwise prints the forward probability of each sequence.
+//Multiple track models require a comma separated list of files (one per track)
+void perform_stream_decoding(model* hmm){
+	std::vector<std::string> filenames;
+	std::string files = opt.sopt("-seq");
+	size_t start(0);
+	for(size_t comma = files.find(','); comma != std::string::npos; comma = files.find(',', start)){
+		filenames.push_back(files.substr(start, comma - start));
+		start = comma + 1;
+	}
+	filenames.push_back(files.substr(start));
+	
+	size_t threads = (opt.isSet("-threads")) ? opt.iopt("-threads") : 1;
+	
+	if (!hmm->isBasic()){
+		std::cerr << "Windowed decoding (-stream) requires a basic model" << std::endl;
+		exit(1);
+	}
+	
+	//The smoother keeps the forward scores of 2 * lag positions
+	size_t lag = (opt.isSet("-lag")) ? opt.iopt("-lag") : 1000;
+	if (lag == 0){
+		lag = 1;
+	}
+	bool posterior = opt.isSet("-posterior") && !opt.isSet("-viterbi");
+	
+	if (posterior && (opt.isSet("-gff") || opt.isSet("-path") || opt.isSet("-label") || opt.isSet("-trellis"))){
+		std::cerr << "Windowed posterior decoding (-stream) only prints the posterior table" << std::endl;
+		exit(1);
+	}
+	
+	seqWindow window(opt.iopt("-stream"), (posterior) ? 2 * lag : 0);
+	if (!window.open(hmm, filenames, threads)){
+		exit(1);
+	}
+	
+	if (opt.isSet("-viterbi") && !window.seekable()){
+		std::cerr << "Windowed Viterbi requires uncompressed sequence files" << std::endl;
+		exit(1);
+	}
+	
+	while(window.next()){
+		trellis trell;
+		start_stats(trell);
+		
+		if (opt.isSet("-viterbi")){
+			traceback_path path(hmm);
+			trell.stream_viterbi(hmm, &window, path);
+			print_output(&path, window.getSeqs());
+		}
+		else if (posterior){
+			outputBuffer out(output);
+			streamPosteriorTable table;
+			start_stream_posterior(out, table, hmm, window.getSeqs()->getHeader());
+			trell.stream_posterior(hmm, &window, lag, print_stream_posterior, &table);
+			end_stream_posterior(out, trell);
+		}
+		else{
+			trell.stream_forward(hmm, &window);
+			outputBuffer out(output);
+			out.append('>');
+			out.append(window.getSeqs()->getHeader());
+			out.append("\tForward: ");
+			out.appendDouble(trell.getForwardProbability());
+			out.append('\n');
+		}
+		print_stats(trell);
+	}
+}
+
+
 //Perform nth-best decoding and print the output
 void perform_nbest_decoding(model* hmm, sequences* seqs){
 	//Setup the trellis with the model and sequence
 	trellis trell(hmm,seqs);
+	start_stats(trell);
+	start_emission_threads(trell);
 	
 	//Get the number of paths to get
 	size_t nth = opt.iopt("-nbest");
 	
 	//Perform nth viterbi
-	trell.naive_nth_viterbi(nth);
+	trell.nth_viterbi(nth);
 	
 	//Get the N tracebacks and output them
 	for(size_t i=0;i<nth;i++){
 		traceback_path path(hmm);
 		trell.traceback_nth(path, i); //ith path
-		print_output(&path, seqs->getHeader());
+		if (path.size() == 0){
+			break;
+		}
+		print_output(&path, seqs);
+	}
+	print_stats(trell);
+}
+
+
+//Train the model on the sequences using Baum-Welch or Viterbi training
+//The model is written to -train-out after each iteration, otherwise only the
+//final model is printed to stdout.  If the log-likelihood decreases, the
+//trainer keeps the model of the previous iteration.
+void perform_training(model& hmm){
+	trainer train(&hmm, &default_functions);
+	
+	if (opt.isFlagSet("-train", "viterbi")){
+		train.setType(VITERBI_TRAINING);
+	}
+	else if (!hmm.isBasic()){
+		std::cerr << "Baum-Welch training (-train baum-welch) requires a basic model" << std::endl;
+		exit(1);
+	}
+	
+	if (opt.isSet("-iterations")){
+		train.setMaxIterations(opt.iopt("-iterations"));
+	}
+	
+	if (opt.isSet("-tolerance")){
+		train.setTolerance(opt.dopt("-tolerance"));
+	}
+	
+	if (opt.isSet("-threads")){
+		train.setThreads(opt.iopt("-threads"));
+	}
+	
+	if (opt.isSet("-train-out")){
+		train.setOutputFile(opt.sopt("-train-out"));
+	}
+	
+	train.loadSequences(jobs);
+	train.train();
+	
+	if (!opt.isSet("-train-out")){
+		std::cout << hmm.stringify();
 	}
 }
 
@@ -294,6 +628,8 @@ void perform_stochastic_decoding(model* hmm, sequences* seqs){
 	
 	//Setup the trellis with the model and sequence
     trellis trell(hmm,seqs);
+	start_stats(trell);
+	start_emission_threads(trell);
 	
 	//Number of times to traceback over path
 	int repetitions = opt.iopt("-rep");
@@ -332,25 +668,27 @@ void perform_stochastic_decoding(model* hmm, sequences* seqs){
 //		//print_output(&simple_paths, seqs->getHeader());
 //		//create multiple paths object to stor
 //		multiTraceback paths;
-		print_output(&paths, seqs->getHeader());
+		print_output(&paths, seqs);
     }
     else if (forward){
 		trell.stochastic_forward();
 		multiTraceback paths;
 		trell.stochastic_traceback(paths, repetitions);
-		print_output(&paths, seqs->getHeader());
+		print_output(&paths, seqs);
     }
 	else if (posterior){
+		start_concurrent_posterior(trell);
 		trell.posterior();
 		multiTraceback paths;
 		trell.traceback_stoch_posterior(paths, repetitions);
-		print_output(&paths, seqs->getHeader());
+		print_output(&paths, seqs);
 	}
     else{
         std::cerr << usage << "\nNo Stochastic decoding option set\n";
         return;
     }
 	
+	print_stats(trell);
     return;
 }
 
@@ -358,15 +696,65 @@ void perform_stochastic_decoding(model* hmm, sequences* seqs){
 //Perform posterior decoding and print the output
 void perform_posterior(model* hmm, sequences* seqs){
 	trellis trell(hmm,seqs);
+	start_stats(trell);
+	start_emission_threads(trell);
+	start_concurrent_posterior(trell);
 	
 	//TODO: posterior should check model and choose the appropriate algorithm
-	trell.posterior();
+	//Windowed posteriors are printed as each window finishes, unless the
+	//whole table is needed by the traceback or -trellis
+	bool streamed = opt.isSet("-posterior-window") && !(opt.isSet("-gff") || opt.isSet("-path") || opt.isSet("-label") || opt.isSet("-trellis"));
+	
+	if (opt.isSet("-posterior-window")){
+		size_t window = opt.iopt("-posterior-window");
+		size_t overlap = (opt.isSet("-overlap")) ? opt.iopt("-overlap") : window / 10;
+		size_t threads = (opt.isSet("-threads")) ? opt.iopt("-threads") : 1;
+		double difference;
+		
+		if (streamed){
+			outputBuffer out(output);
+			streamPosteriorTable table;
+			start_stream_posterior(out, table, hmm, seqs->getHeader());
+			table.offset = seqs->getOffset();
+			difference = trell.window_posterior(window, overlap, threads, print_stream_posterior, &table);
+			end_stream_posterior(out, trell);
+		}
+		else{
+			difference = trell.window_posterior(window, overlap, threads);
+		}
+		
+		if (difference >= 0){
+			std::cerr << "Posterior windows of " << window << " positions, overlap " << ((overlap < window) ? overlap : window);
+			if (overlap == 0){
+				std::cerr << ": no overlaps to compare" << std::endl;
+			}
+			else{
+				std::cerr << ": largest difference in the inner half of the overlaps " << difference << std::endl;
+			}
+		}
+		
+		if (streamed){
+			print_stats(trell);
+			return;
+		}
+	}
+	else{
+		trell.posterior();
+	}
+	
+	//The binary table replaces the text posterior table
+	if (opt.isSet("-trellis")){
+		export_table(trell, POSTERIOR_TABLE);
+	}
 	
 	//If we need a posterior traceback b/c path,label,or GFF is defined
 	if (opt.isSet("-gff") || opt.isSet("-path") || opt.isSet("-label")){
 		traceback_path path(hmm);
 		trell.traceback_posterior(path);
-		print_output(&path, seqs->getHeader());
+		print_output(&path, seqs);
+	}
+	else if (opt.isSet("-trellis")){
+		//The table was written above
 	}
 	else if (opt.isSet("-threshold")){
 		print_limited_posterior(trell);
@@ -375,66 +763,243 @@ void perform_posterior(model* hmm, sequences* seqs){
 		print_posterior(trell);
 	}
 	
+	print_stats(trell);
 	return;
 }
 
 
 
-void print_output(multiTraceback* tb, std::string& header){
+void print_output(multiTraceback* tb, sequences* seqs){
     
     tb->finalize();
     
+    outputBuffer out(output);
     bool previous(true);
     
     if (opt.isSet("-hits")){
-        tb->print_hits();
+        tb->print_hits(out, seqs->getOffset());
         previous=false;
     }
     
     if (opt.isSet("-gff")){
-        tb->print_gff(header);
+        tb->print_gff(out, seqs->getSourceName(), seqs->getOffset());
         previous=false;
     }
     
     if (opt.isSet("-label")){
-        tb->print_label();
+        tb->print_label(out);
         previous=false;
     }
     
     //Print path by default if nothing else is set
     if (opt.isSet("-path") || previous){
-        tb->print_path();
+        tb->print_path(out);
     }
 }
 
 
-void print_output(traceback_path* tb, std::string& header){
+void print_output(traceback_path* tb, sequences* seqs){
+    
+    std::string& header = seqs->getHeader();
     
+    outputBuffer out(output);
     bool previous(true);
     
     if (opt.isSet("-gff")){
-        std::cout << "#Score: " << tb->getScore() << std::endl;
-        tb->print_gff(header);
+        out.append("#Score: ");
+        out.appendDouble(tb->getScore());
+        out.append('\n');
+        tb->print_gff(out, seqs->getSourceName(), seqs->getOffset());
         previous=false;
     }
     
     if (opt.isSet("-label")){
-		std::cout << ">" << header ;
-        std::cout << "\tScore: " << tb->getScore() << std::endl;
-        tb->print_label();
+		out.append('>');
+		out.append(header);
+        out.append("\tScore: ");
+        out.appendDouble(tb->getScore());
+        out.append('\n');
+        tb->print_label(out);
         previous=false;
     }
     
     if (opt.isSet("-path") || previous){
-		std::cout << ">" << header ;
-        std::cout << "\tScore: " << tb->getScore() << std::endl;
-        tb->print_path();
+		out.append('>');
+		out.append(header);
+        out.append("\tScore: ");
+        out.appendDouble(tb->getScore());
+        out.append('\n');
+        tb->print_path(out);
     }
     
     return;
 }
 
 
+//Write a table of the trellis to the -trellis file
+void export_table(trellis& trell, tableType type){
+	if (!table_output.add(trell, type)){
+		std::cerr << "Couldn't export the trellis table of " << trell.getSeq()->getHeader() << std::endl;
+		exit(1);
+	}
+}
+
+
+//Collect the statistics of the trellis if -stats is set
+void start_stats(trellis& trell){
+	if (!opt.isSet("-stats")){
+		return;
+	}
+	
+	job_stats.clear();
+	trell.setStats(&job_stats);
+	job_start = trellisStats::now();
+}
+
+
+//Calculate the emissions with -threads - 1 worker threads
+void start_emission_threads(trellis& trell){
+	if (!opt.isSet("-threads") || opt.iopt("-threads") < 2){
+		return;
+	}
+	
+	size_t tile = (opt.isSet("-emission-tile") && opt.iopt("-emission-tile") > 0) ? opt.iopt("-emission-tile") : 4096;
+	trell.setEmissionThreads(opt.iopt("-threads") - 1, tile);
+}
+
+
+//Calculate the forward and backward scores of posterior decoding at once with -threads
+void start_concurrent_posterior(trellis& trell){
+	if (opt.isSet("-threads") && opt.iopt("-threads") >= 2){
+		trell.setConcurrentPosterior(true);
+	}
+}
+
+
+//Print the statistics of the job to stderr as one line of JSON
+void print_stats(trellis& trell){
+	if (!opt.isSet("-stats")){
+		return;
+	}
+	
+	std::string header = trell.getSeq()->getHeader();
+	std::string name;
+	for(size_t i = (header[0] == '>') ? 1 : 0; i < header.size(); ++i){
+		unsigned char c = header[i];
+		if (c == '"' || c == '\\'){
+			name += '\\';
+			name += c;
+		}
+		else if (c >= 0x20){
+			name += c;
+		}
+	}
+	
+	std::stringstream line;
+	line << "{\"sequence\":\"" << name << "\",\"length\":" << trell.getSeqLength();
+	line << ",\"seconds\":" << trellisStats::now() - job_start;
+	line << ",\"stats\":" << job_stats.stringify() << "}\n";
+	std::cerr << line.str();
+}
+
+
+//Print the lines before a posterior table printed as its rows are finished,
+//and choose its columns (states with a GFF description with -threshold)
+//Unlike _print_posterior_header there are no Forward and Backward lines: the
+//probability of the sequence is only known after the rows, so it's printed
+//after the table by end_stream_posterior (see -lag in the usage)
+void start_stream_posterior(outputBuffer& out, streamPosteriorTable& table, model* hmm, std::string& header){
+	table.out = &out;
+	table.limited = opt.isSet("-threshold");
+	table.threshold = (table.limited) ? opt.dopt("-threshold") : 0;
+	table.offset = 0;
+	
+	out.append("Posterior Probabilities Table\n");
+	out.append("Model:\t");
+	out.append(hmm->getName());
+	out.append("\nSequence:\t");
+	out.append(header);
+	out.append("\nPosition");
+	for(size_t i = 0; i < hmm->state_size(); ++i){
+		if (table.limited && hmm->getStateGFF(i).empty()){
+			continue;
+		}
+		out.append('\t');
+		out.append((table.limited) ? hmm->getStateGFF(i) : hmm->getStateName(i));
+		table.states.push_back(i);
+	}
+	out.append('\n');
+}
+
+
+//Print the probability of the sequence after a table printed by
+//print_stream_posterior
+void end_stream_posterior(outputBuffer& out, trellis& trell){
+	out.append("Probability of Sequence from Forward: Natural Log'd\t");
+	out.appendFixed(trell.getForwardProbability(), 6);
+	out.append("\n\n");
+}
+
+
+//Print a row of the posterior table from trellis::stream_posterior or
+//window_posterior
+//Rows are formatted as print_posterior or print_limited_posterior
+void print_stream_posterior(size_t position, std::vector<double>& posteriors, bool block_end, void* data){
+	streamPosteriorTable* table = static_cast<streamPosteriorTable*>(data);
+	outputBuffer& out = *table->out;
+	
+	bool valid_line(!table->limited);
+	for(size_t i = 0; i < table->states.size() && !valid_line; ++i){
+		valid_line = exp(posteriors[table->states[i]]) >= table->threshold;
+	}
+	
+	if (valid_line){
+		out.appendInt((uint64_t) (position + 1 + table->offset));
+		for(size_t i = 0; i < table->states.size(); ++i){
+			double prob = exp(posteriors[table->states[i]]);
+			float val = prob;
+			if (table->limited){
+				out.append('\t');
+				if (prob >= table->threshold){
+					out.appendFixed(prob, 3);
+				}
+			}
+			else if (val <= 0.001){
+				out.append("\t0", 2);
+			}
+			else if (val == 1.0){
+				out.append("\t1", 2);
+			}
+			else{
+				out.append('\t');
+				out.appendFixed(prob, 3);
+			}
+		}
+		out.append('\n');
+	}
+	
+	//Finished rows are written as soon as they're available
+	if (block_end){
+		out.flush();
+	}
+}
+
+
+//Print the lines before the posterior table, up to "Position"
+void _print_posterior_header(outputBuffer& out, trellis& trell){
+	out.append("Posterior Probabilities Table\n");
+	out.append("Model:\t");
+	out.append(trell.getModel()->getName());
+	out.append("\nSequence:\t");
+	out.append(trell.getSeq()->getHeader());
+	out.append("\nProbability of Sequence from Forward: Natural Log'd\t");
+	out.appendFixed(trell.getForwardProbability(), 6);
+	out.append("\nProbability of Sequence from Backward:Natural Log'd\t");
+	out.appendFixed(trell.getBackwardProbability(), 6);
+	out.append("\nPosition");
+}
+
+
 //Print the posterior probabilities for each state at each position
 //Each state is in separate column
 //Each row is on different row
@@ -442,47 +1007,38 @@ void print_posterior(trellis& trell){
 	model* hmm = trell.getModel();
 	double_2D* table = trell.getPosteriorTable();
 	size_t state_size = hmm->state_size();
-	char cstr[200];
-	
-	std::string output;
-	output+="Posterior Probabilities Table\n";
-	output+="Model:\t" + hmm->getName() + "\n";
-	output+="Sequence:\t" + trell.getSeq()->getHeader() + "\n";
-	sprintf(cstr, "Probability of Sequence from Forward: Natural Log'd\t%f\n",trell.getForwardProbability());
-	output+= cstr;
-	sprintf(cstr, "Probability of Sequence from Backward:Natural Log'd\t%f\n",trell.getBackwardProbability());
-	output+= cstr;
-	output+= "Position";
+	size_t offset = trell.getSeq()->getOffset();
+	
+	outputBuffer out(output);
+	_print_posterior_header(out, trell);
 	for(size_t i=0;i< state_size; ++i){
-		output+= "\t" + hmm->getStateName(i);
+		out.append('\t');
+		out.append(hmm->getStateName(i));
 	}
-	output+="\n";
-	
-	std::cout <<  output;
+	out.append('\n');
 	
 
 	for(size_t position = 0; position < table->size(); ++position){
-		sprintf(cstr, "%ld", position+1);
-		output= cstr;
+		out.appendInt((uint64_t) (position+1+offset));
 		for (size_t st = 0 ; st < state_size ; st++){
-			float val  = exp((*table)[position][st]);
+			double prob = exp((*table)[position][st]);
+			float val  = prob;
 			if (val<= 0.001){
-				output+="\t0";
+				out.append("\t0", 2);
 			}
 			else if (val == 1.0){
-				output+="\t1";
+				out.append("\t1", 2);
 			}
 			else{
-				sprintf(cstr,"\t%.3f", exp((*table)[position][st]));
-				output+= cstr;
+				out.append('\t');
+				out.appendFixed(prob, 3);
 			}
 
 		}
-		output+="\n";
-		std::cout << output;
+		out.append('\n');
 	}
 
-	std::cout << std::endl;
+	out.append('\n');
 	
 	return;
 	
@@ -492,18 +1048,11 @@ void print_limited_posterior(trellis& trell){
 	model* hmm = trell.getModel();
 	double_2D* table = trell.getPosteriorTable();
 	size_t state_size = hmm->state_size();
-	char cstr[200];
+	size_t offset = trell.getSeq()->getOffset();
 	double threshold = opt.dopt("-threshold");
 	
-	std::string output;
-	output+="Posterior Probabilities Table\n";
-	output+="Model:\t" + hmm->getName() + "\n";
-	output+="Sequence:\t" + trell.getSeq()->getHeader() + "\n";
-	sprintf(cstr, "Probability of Sequence from Forward: Natural Log'd\t%f\n",trell.getForwardProbability());
-	output+= cstr;
-	sprintf(cstr, "Probability of Sequence from Backward:Natural Log'd\t%f\n",trell.getBackwardProbability());
-	output+= cstr;
-	output+= "Position";
+	outputBuffer out(output);
+	_print_posterior_header(out, trell);
 	
 	
 	//Determine states with GFF_DESC
@@ -511,40 +1060,40 @@ void print_limited_posterior(trellis& trell){
 	std::vector<size_t>::iterator st;
 	for(size_t i=0;i< state_size; ++i){
 		if (!hmm->getStateGFF(i).empty()){
-			output+= "\t" + hmm->getStateGFF(i);
+			out.append('\t');
+			out.append(hmm->getStateGFF(i));
 			states_with_gff.push_back(i);
 		}
 	}
-	output+="\n";
-	
-	//Print Header
-	std::cout <<  output;
+	out.append('\n');
 	
 	
 	//Print lines in table with values greater than threshold value
 	for(size_t position = 0; position < table->size(); ++position){
 		bool valid_line(false);
-		output="";
 		for (st = states_with_gff.begin() ; st != states_with_gff.end() ; st++){
 			if (exp((*table)[position][(*st)]) >= threshold){
-				sprintf(cstr,"\t%.3f", exp((*table)[position][(*st)]));
-				output+= cstr;
 				valid_line=true;
-			}
-			else{
-				output+="\t";
+				break;
 			}
 		}
 		
-		if (valid_line){
-			sprintf(cstr, "%ld", position+1);
-			output = cstr + output + "\n";
-			std::cout << output;
+		if (!valid_line){
+			continue;
 		}
 		
+		out.appendInt((uint64_t) (position+1+offset));
+		for (st = states_with_gff.begin() ; st != states_with_gff.end() ; st++){
+			double prob = exp((*table)[position][(*st)]);
+			out.append('\t');
+			if (prob >= threshold){
+				out.appendFixed(prob, 3);
+			}
+		}
+		out.append('\n');
 	}
 	
-	std::cout << std::endl;
+	out.append('\n');
 	
 	return;
 }
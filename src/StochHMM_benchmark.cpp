@@ -0,0 +1,491 @@
+//
+//  StochHMM_benchmark.cpp
+//  StochHMM
+//
+//  Copyright (c) 2013 Korf Lab, Genome Center, UC Davis, Davis, CA. All rights reserved.
+//
+//  Measures the speed and memory use of the decoding algorithms on the
+//  example models and on synthetic models.  Each run is written as one
+//  line of JSON so results from different builds can be compared.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "StochHMMlib.h"
+
+using namespace StochHMM;
+
+const char usage[]  = "\n\
+StochHMM benchmark - Speed and memory of the decoding algorithms\n\
+\n\
+Usage: stochhmm_benchmark [options]\n\
+\n\
+Each model and sequence length is decoded with each algorithm and the result\n\
+is written as one line of JSON: seconds (fastest repeat), bases and cells\n\
+(positions x states) per second, and the peak resident memory of the run.\n\
+\n\
+Models:\n\
+\t-examples <directory>\t\tdirectory containing Dice.hmm, 3_16Eddy.hmm and\n\
+\t\t\t\t\tGC_SKEW.hmm (default: examples, none to skip)\n\
+\t-model <files>\t\t\tadditional model files (comma separated)\n\
+\t-states <list>\t\t\tstates of the synthetic models (default: 2,8,32; 0 to skip)\n\
+\t-connectivity <list>\t\ttransitions from each synthetic state, 0 for all\n\
+\t\t\t\t\tstates (default: 0)\n\
+\t-order <list>\t\t\temission order of the synthetic models (default: 0,3)\n\
+\n\
+Runs:\n\
+\t-length <list>\t\t\tlengths of the random sequences (default: 100000)\n\
+\t-algorithms <list>\t\talgorithms to run (default: all)\n\
+\t\t\t\t\tviterbi,forward,backward,posterior,stochastic_viterbi,\n\
+\t\t\t\t\tstochastic_forward,nth_viterbi,baum_welch\n\
+\t-nbest <n>\t\t\tpaths for nth_viterbi (default: 3)\n\
+\t-repetitions <n>\t\ttracebacks for the stochastic algorithms (default: 100)\n\
+\t-repeat <n>\t\t\ttimes each run is repeated (default: 3)\n\
+\t-seed <n>\t\t\trandom seed for the models and sequences (default: 1)\n\
+\t-out <file>\t\t\twrite results to file instead of stdout\n\
+\n";
+
+opt_parameters commandline[]={
+	{"-help:-h"			,OPT_NONE	,false	,"",	{}},
+	{"-examples"		,OPT_STRING	,false	,"",	{}},
+	{"-model:-m"		,OPT_STRING	,false	,"",	{}},
+	{"-states"			,OPT_STRING	,false	,"",	{}},
+	{"-connectivity"	,OPT_STRING	,false	,"",	{}},
+	{"-order"			,OPT_STRING	,false	,"",	{}},
+	{"-length"			,OPT_STRING	,false	,"",	{}},
+	{"-algorithms"		,OPT_STRING	,false	,"",	{}},
+	{"-nbest"			,OPT_INT	,false	,"",	{}},
+	{"-repetitions"		,OPT_INT	,false	,"",	{}},
+	{"-repeat"			,OPT_INT	,false	,"",	{}},
+	{"-seed"			,OPT_INT	,false	,"",	{}},
+	{"-out"				,OPT_STRING	,false	,"",	{}},
+};
+
+int opt_size=sizeof(commandline)/sizeof(commandline[0]);
+
+options opt;
+
+StateFuncs default_functions;
+
+//Description of the model used in a run
+struct benchmarkModel{
+	std::string name;
+	std::string file;		//Empty for synthetic models
+	size_t states;
+	size_t connectivity;
+	size_t order;
+};
+
+std::string string_option(const char* name, const char* preset);
+int int_option(const char* name, int preset);
+std::vector<std::string> split_list(const std::string& list);
+sequences* random_sequences(model& hmm, size_t length);
+void benchmark(model& hmm, benchmarkModel& info, std::vector<std::string>& algorithms, std::vector<std::string>& lengths, outputBuffer& out);
+bool run_algorithm(const std::string& algorithm, model& hmm, sequences& seqs, double& score);
+double seconds();
+bool reset_peak_memory();
+size_t memory_kb(const char* field);
+std::string json_string(const std::string& str);
+
+
+int main(int argc, const char * argv[]){
+	opt.set_parameters(commandline,opt_size,usage);
+	opt.parse_commandline(argc,argv);
+
+	srand(int_option("-seed", 1));
+
+	outputWriter writer;
+	if (opt.isSet("-out") && !writer.open(opt.sopt("-out"))){
+		std::cerr << "Can't open output file: " << opt.sopt("-out") << std::endl;
+		return 1;
+	}
+	writer.setPrecision(6, false);
+	outputBuffer out(writer);
+
+	std::vector<std::string> algorithms = split_list(string_option("-algorithms", "viterbi,forward,backward,posterior,stochastic_viterbi,stochastic_forward,nth_viterbi,baum_welch"));
+	std::vector<std::string> lengths = split_list(string_option("-length", "100000"));
+
+	//Model files
+	std::vector<std::string> files;
+	std::string examples_directory = string_option("-examples", "examples");
+	if (examples_directory != "none"){
+		const char* examples[] = {"Dice.hmm", "3_16Eddy.hmm", "GC_SKEW.hmm"};
+		for(size_t i = 0; i < 3; ++i){
+			files.push_back(examples_directory + "/" + examples[i]);
+		}
+	}
+	if (opt.isSet("-model")){
+		std::vector<std::string> models = split_list(opt.sopt("-model"));
+		files.insert(files.end(), models.begin(), models.end());
+	}
+
+	for(size_t i = 0; i < files.size(); ++i){
+		model hmm;
+		if (!hmm.import(files[i], &default_functions)){
+			std::cerr << "Can't import model: " << files[i] << std::endl;
+			continue;
+		}
+
+		benchmarkModel info;
+		info.name = hmm.getName();
+		info.file = files[i];
+		info.states = hmm.state_size();
+		info.connectivity = 0;
+		info.order = 0;
+		benchmark(hmm, info, algorithms, lengths, out);
+	}
+
+	//Synthetic models
+	std::vector<std::string> states = split_list(string_option("-states", "2,8,32"));
+	std::vector<std::string> connectivity = split_list(string_option("-connectivity", "0"));
+	std::vector<std::string> orders = split_list(string_option("-order", "0,3"));
+
+	for(size_t i = 0; i < states.size(); ++i){
+		for(size_t j = 0; j < connectivity.size(); ++j){
+			for(size_t k = 0; k < orders.size(); ++k){
+				benchmarkModel info;
+				info.states = atoi(states[i].c_str());
+				info.connectivity = atoi(connectivity[j].c_str());
+				info.order = atoi(orders[k].c_str());
+
+				if (info.states == 0){
+					continue;
+				}
+
+				if (info.connectivity > info.states){
+					info.connectivity = 0;
+				}
+
+				modelGenerator generator;
+				generator.setStates(info.states);
+				generator.setOutDegree(info.connectivity);
+				generator.setOrder(info.order);
+
+				std::string text = generator.generate();
+				model hmm;
+				if (!hmm.importFromString(text, &default_functions)){
+					std::cerr << "Can't create synthetic model" << std::endl;
+					continue;
+				}
+
+				info.name = hmm.getName();
+				benchmark(hmm, info, algorithms, lengths, out);
+			}
+		}
+	}
+
+	out.flush();
+	writer.close();
+	return 0;
+}
+
+
+//!Get the value of a string option or the preset if it isn't set
+std::string string_option(const char* name, const char* preset){
+	return (opt.isSet(name)) ? opt.sopt(name) : preset;
+}
+
+
+//!Get the value of an integer option or the preset if it isn't set
+int int_option(const char* name, int preset){
+	return (opt.isSet(name)) ? opt.iopt(name) : preset;
+}
+
+
+//!Split a comma separated list
+std::vector<std::string> split_list(const std::string& list){
+	std::vector<std::string> values;
+	std::istringstream stream(list);
+	std::string value;
+	while (std::getline(stream, value, ',')){
+		if (!value.empty()){
+			values.push_back(value);
+		}
+	}
+	return values;
+}
+
+
+//!Create random sequences for every track of the model
+//!Symbols are uniformly distributed and real values are between 0 and 1.
+sequences* random_sequences(model& hmm, size_t length){
+	tracks* model_tracks = hmm.getTracks();
+	sequences* seqs = new(std::nothrow) sequences(model_tracks);
+
+	if (seqs == NULL){
+		std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+		exit(1);
+	}
+
+	for(size_t i = 0; i < model_tracks->size(); ++i){
+		track* trk = (*model_tracks)[i];
+		sequence* sq;
+
+		if (trk->getAlphaType() == REAL){
+			std::vector<double>* values = new(std::nothrow) std::vector<double>(length);
+			if (values == NULL){
+				std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+				exit(1);
+			}
+
+			for(size_t j = 0; j < length; ++j){
+				(*values)[j] = (double) rand() / ((double) RAND_MAX + 1.0);
+			}
+			sq = new(std::nothrow) sequence(values, trk);
+		}
+		else{
+			std::vector<double> frequencies(trk->getAlphaSize(), 1.0 / trk->getAlphaSize());
+			sq = new(std::nothrow) sequence(random_sequence(frequencies, length, trk));
+		}
+
+		if (sq == NULL){
+			std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+			exit(1);
+		}
+
+		std::string header = ">random";
+		sq->setHeader(header);
+		seqs->addSeq(sq);
+	}
+
+	return seqs;
+}
+
+
+//!Run each algorithm on random sequences of each length and write the results
+void benchmark(model& hmm, benchmarkModel& info, std::vector<std::string>& algorithms, std::vector<std::string>& lengths, outputBuffer& out){
+	int repeat_option = int_option("-repeat", 3);
+	size_t repeat = (repeat_option > 0) ? repeat_option : 1;
+
+	for(size_t i = 0; i < lengths.size(); ++i){
+		size_t length = atol(lengths[i].c_str());
+		sequences* seqs = random_sequences(hmm, length);
+
+		for(size_t j = 0; j < algorithms.size(); ++j){
+			double fastest = -1;
+			double total = 0;
+			double score = 0;
+			size_t peak = 0;
+			size_t table = 0;
+			bool measured = true;		//Peak of each run could be measured
+
+			for(size_t k = 0; k < repeat; ++k){
+				bool reset = reset_peak_memory();
+				measured = measured && reset;
+				size_t before = memory_kb("VmRSS:");
+
+				double start = seconds();
+				if (!run_algorithm(algorithms[j], hmm, *seqs, score)){
+					break;
+				}
+				double elapsed = seconds() - start;
+
+				//Without a reset the peak is the peak of the whole process
+				size_t run_peak = memory_kb("VmHWM:");
+				if (run_peak == 0){
+					struct rusage usage;
+					getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+					run_peak = usage.ru_maxrss / 1024;
+#else
+					run_peak = usage.ru_maxrss;
+#endif
+				}
+
+				if (run_peak > peak){
+					peak = run_peak;
+				}
+
+				if (measured && run_peak > before && run_peak - before > table){
+					table = run_peak - before;
+				}
+
+				total += elapsed;
+				if (fastest < 0 || elapsed < fastest){
+					fastest = elapsed;
+				}
+			}
+
+			if (fastest < 0){
+				continue;
+			}
+
+			double cells = (double) length * info.states;
+
+			out.append("{\"model\":");
+			out.append(json_string(info.name));
+			out.append(",\"file\":");
+			out.append(json_string(info.file));
+			out.append(",\"synthetic\":");
+			out.append((info.file.empty()) ? "true" : "false");
+			out.append(",\"states\":");
+			out.appendInt((uint64_t) info.states);
+			out.append(",\"connectivity\":");
+			out.appendInt((uint64_t) info.connectivity);
+			out.append(",\"order\":");
+			out.appendInt((uint64_t) info.order);
+			out.append(",\"length\":");
+			out.appendInt((uint64_t) length);
+			out.append(",\"algorithm\":");
+			out.append(json_string(algorithms[j]));
+			out.append(",\"repeat\":");
+			out.appendInt((uint64_t) repeat);
+			out.append(",\"seconds\":");
+			out.appendDouble(fastest);
+			out.append(",\"mean_seconds\":");
+			out.appendDouble(total / repeat);
+			out.append(",\"bases_per_second\":");
+			out.appendDouble((fastest > 0) ? length / fastest : 0);
+			out.append(",\"cells_per_second\":");
+			out.appendDouble((fastest > 0) ? cells / fastest : 0);
+			out.append(",\"peak_rss_kb\":");
+			out.appendInt((uint64_t) peak);
+			out.append(",\"run_rss_kb\":");
+			if (measured){
+				out.appendInt((uint64_t) table);
+			}
+			else{
+				out.append("null");
+			}
+			out.append(",\"score\":");
+			if (score > -INFINITY && score < INFINITY){
+				out.appendDouble(score);
+			}
+			else{
+				out.append("null");
+			}
+			out.append("}\n");
+			out.flush();
+		}
+
+		delete seqs;
+	}
+}
+
+
+//!Run an algorithm with a new trellis, including the tracebacks
+//!\param[out] score Score of the run (viterbi score or forward probability)
+//!\return false if the algorithm isn't known
+bool run_algorithm(const std::string& algorithm, model& hmm, sequences& seqs, double& score){
+	trellis trell(&hmm, &seqs);
+
+	if (algorithm == "viterbi"){
+		trell.viterbi();
+		traceback_path path(&hmm);
+		trell.traceback(path);
+		score = trell.getViterbiScore();
+	}
+	else if (algorithm == "forward"){
+		trell.forward();
+		score = trell.getForwardProbability();
+	}
+	else if (algorithm == "backward"){
+		trell.backward();
+		score = trell.getBackwardProbability();
+	}
+	else if (algorithm == "posterior"){
+		trell.posterior();
+		score = trell.getForwardProbability();
+	}
+	else if (algorithm == "stochastic_viterbi"){
+		trell.stochastic_viterbi();
+		multiTraceback paths;
+		trell.stochastic_traceback(paths, int_option("-repetitions", 100));
+		score = trell.getViterbiScore();
+	}
+	else if (algorithm == "stochastic_forward"){
+		trell.stochastic_forward();
+		multiTraceback paths;
+		trell.stochastic_traceback(paths, int_option("-repetitions", 100));
+		score = trell.getForwardProbability();
+	}
+	else if (algorithm == "nth_viterbi"){
+		int nbest = int_option("-nbest", 3);
+		size_t nth = (nbest > 0) ? nbest : 1;
+		trell.nth_viterbi(nth);
+		for(size_t i = 0; i < nth; ++i){
+			traceback_path path(&hmm);
+			trell.traceback_nth(path, i);
+		}
+		score = trell.getViterbiScore();
+	}
+	else if (algorithm == "baum_welch"){
+		//Expectation step only, the counts aren't used to update the model
+		trell.baum_welch();
+		score = trell.getForwardProbability();
+	}
+	else{
+		std::cerr << "Unknown algorithm: " << algorithm << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+//!Wall clock time in seconds
+double seconds(){
+	struct timeval time;
+	gettimeofday(&time, NULL);
+	return time.tv_sec + time.tv_usec / 1e6;
+}
+
+
+//!Reset the peak resident memory (VmHWM) of the process
+//!\return false if the peak can't be reset (requires Linux 4.0)
+bool reset_peak_memory(){
+	std::ofstream clear("/proc/self/clear_refs");
+	if (!clear.is_open()){
+		return false;
+	}
+	clear << "5";
+	clear.close();
+
+	//Some kernels accept the write without resetting the peak
+	size_t peak = memory_kb("VmHWM:");
+	return !clear.fail() && peak > 0 && peak <= memory_kb("VmRSS:");
+}
+
+
+//!Get a memory field from /proc/self/status in kilobytes
+//!\return 0 if the field isn't available
+size_t memory_kb(const char* field){
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	size_t length = strlen(field);
+	while (std::getline(status, line)){
+		if (line.compare(0, length, field) == 0){
+			return atol(line.c_str() + length);
+		}
+	}
+	return 0;
+}
+
+
+//!Quote a string for JSON
+std::string json_string(const std::string& str){
+	std::string quoted = "\"";
+	for(size_t i = 0; i < str.size(); ++i){
+		char c = str[i];
+		if (c == '"' || c == '\\'){
+			quoted += '\\';
+			quoted += c;
+		}
+		else if ((unsigned char) c < 0x20){
+			char escaped[8];
+			snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+			quoted += escaped;
+		}
+		else{
+			quoted += c;
+		}
+	}
+	quoted += "\"";
+	return quoted;
+}
@@ -0,0 +1,233 @@
+//
+//  StochHMM_generate.cpp
+//  StochHMM
+//
+//  Copyright (c) 2013 Korf Lab, Genome Center, UC Davis, Davis, CA. All rights reserved.
+//
+//  Writes synthetic models of a given size and samples sequences and their
+//  state paths from synthetic or existing models, to test how decoding
+//  scales with the number of states, connectivity, emission order,
+//  explicit durations and real number tracks.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include "StochHMMlib.h"
+
+using namespace StochHMM;
+
+const char usage[]  = "\n\
+StochHMM generate - Synthetic models and sequences\n\
+\n\
+Usage: stochhmm_generate [options]\n\
+\n\
+Writes a synthetic model and samples sequences from it, or samples sequences\n\
+from an existing model.  Sequences of every track are written to one file,\n\
+one record per track for each sequence, which can be decoded with StochHMM.\n\
+\n\
+Synthetic model:\n\
+\t-states <n>\t\t\tnumber of states (default: 4)\n\
+\t-degree <n>\t\t\ttransitions from each state, 0 for all states (default: 0)\n\
+\t-self <p>\t\t\tprobability of a state transitioning to itself (default: 0.9)\n\
+\t-duration <n>\t\t\tstates with explicit duration transitions (default: 0)\n\
+\t-max-duration <n>\t\tlongest duration of the duration states (default: 10)\n\
+\t-order <n>\t\t\temission order (default: 0)\n\
+\t-real <n>\t\t\treal number tracks with NORMAL emissions (default: 0)\n\
+\t-template\t\t\twrite states with standard transitions using a template\n\
+\t-name <name>\t\t\tmodel name (default: SYNTHETIC_states_degree_order)\n\
+\t-model-out <file>\t\twrite the model to file\n\
+\n\
+Sampling:\n\
+\t-model <file>\t\t\tsample from model file instead of a synthetic model\n\
+\t-length <n>\t\t\tlength of each sequence (default: 10000)\n\
+\t-count <n>\t\t\tnumber of sequences (default: 1, 0 to only write the model)\n\
+\t-seq-out <file>\t\t\twrite sequences to file instead of stdout\n\
+\t-path-out <file>\t\twrite the sampled state paths as GFF\n\
+\t-seed <n>\t\t\trandom seed (default: 1)\n\
+\n";
+
+opt_parameters commandline[]={
+	{"-help:-h"			,OPT_NONE	,false	,"",	{}},
+	{"-states"			,OPT_INT	,false	,"",	{}},
+	{"-degree"			,OPT_INT	,false	,"",	{}},
+	{"-self"			,OPT_DOUBLE	,false	,"",	{}},
+	{"-duration"		,OPT_INT	,false	,"",	{}},
+	{"-max-duration"	,OPT_INT	,false	,"",	{}},
+	{"-order"			,OPT_INT	,false	,"",	{}},
+	{"-real"			,OPT_INT	,false	,"",	{}},
+	{"-template"		,OPT_NONE	,false	,"",	{}},
+	{"-name"			,OPT_STRING	,false	,"",	{}},
+	{"-model-out"		,OPT_STRING	,false	,"",	{}},
+	{"-model:-m"		,OPT_STRING	,false	,"",	{}},
+	{"-length"			,OPT_INT	,false	,"",	{}},
+	{"-count"			,OPT_INT	,false	,"",	{}},
+	{"-seq-out"			,OPT_STRING	,false	,"",	{}},
+	{"-path-out"		,OPT_STRING	,false	,"",	{}},
+	{"-seed"			,OPT_INT	,false	,"",	{}},
+};
+
+int opt_size=sizeof(commandline)/sizeof(commandline[0]);
+
+options opt;
+
+StateFuncs default_functions;
+
+int int_option(const char* name, int preset);
+void write_sequences(sequences& seqs, outputBuffer& out);
+
+
+int main(int argc, const char * argv[]){
+	opt.set_parameters(commandline,opt_size,usage);
+	opt.parse_commandline(argc,argv);
+
+	srand(int_option("-seed", 1));
+
+	model hmm;
+	if (opt.isSet("-model")){
+		if (!hmm.import(opt.sopt("-model"), &default_functions)){
+			std::cerr << "Can't import model: " << opt.sopt("-model") << std::endl;
+			return 1;
+		}
+	}
+	else{
+		int states = int_option("-states", 4);
+		if (states <= 0){
+			std::cerr << "Synthetic models need at least one state" << std::endl;
+			return 1;
+		}
+
+		modelGenerator generator;
+		generator.setStates(states);
+		generator.setOutDegree(int_option("-degree", 0));
+		generator.setDurationStates(int_option("-duration", 0));
+		generator.setMaxDuration(int_option("-max-duration", 10));
+		generator.setOrder(int_option("-order", 0));
+		generator.setRealTracks(int_option("-real", 0));
+		generator.setTemplates(opt.isSet("-template"));
+		if (opt.isSet("-self")){
+			generator.setSelfTransition(opt.dopt("-self"));
+		}
+		if (opt.isSet("-name")){
+			generator.setName(opt.sopt("-name"));
+		}
+
+		std::string text = generator.generate();
+
+		if (opt.isSet("-model-out")){
+			std::ofstream file(opt.sopt("-model-out").c_str());
+			file << text;
+			if (!file.good()){
+				std::cerr << "Can't write model file: " << opt.sopt("-model-out") << std::endl;
+				return 1;
+			}
+		}
+
+		if (!hmm.importFromString(text, &default_functions)){
+			std::cerr << "Can't import synthetic model" << std::endl;
+			return 1;
+		}
+	}
+
+	int count = int_option("-count", 1);
+	int length = int_option("-length", 10000);
+	if (count <= 0){
+		return 0;
+	}
+
+	if (length <= 0){
+		std::cerr << "Sequence length must be greater than zero" << std::endl;
+		return 1;
+	}
+
+	sequenceSampler sampler(&hmm);
+	if (!sampler.check()){
+		std::cerr << "Can't sample sequences from model: " << hmm.getName() << std::endl;
+		return 1;
+	}
+
+	outputWriter seq_writer;
+	if (opt.isSet("-seq-out") && !seq_writer.open(opt.sopt("-seq-out"))){
+		std::cerr << "Can't open sequence file: " << opt.sopt("-seq-out") << std::endl;
+		return 1;
+	}
+	seq_writer.setPrecision(6, false);
+
+	outputWriter path_writer;
+	if (opt.isSet("-path-out") && !path_writer.open(opt.sopt("-path-out"))){
+		std::cerr << "Can't open path file: " << opt.sopt("-path-out") << std::endl;
+		return 1;
+	}
+
+	outputBuffer seq_out(seq_writer);
+	outputBuffer path_out(path_writer);
+
+	for(int i = 0; i < count; ++i){
+		traceback_path path(&hmm);
+		sequences* seqs = sampler.sample(length, &path);
+		if (seqs == NULL){
+			return 1;
+		}
+
+		std::stringstream header;
+		header << ">sample" << i + 1;
+		std::string name = header.str();
+		for(size_t j = 0; j < seqs->size(); ++j){
+			seqs->getSeq(j)->setHeader(name);
+		}
+
+		write_sequences(*seqs, seq_out);
+		if (opt.isSet("-path-out")){
+			path.print_gff(path_out, name, 0);
+		}
+		delete seqs;
+	}
+
+	seq_out.flush();
+	path_out.flush();
+	seq_writer.close();
+	path_writer.close();
+	return (seq_writer.failed() || path_writer.failed()) ? 1 : 0;
+}
+
+
+//!Get the value of an integer option or the preset if it isn't set
+int int_option(const char* name, int preset){
+	return (opt.isSet(name)) ? opt.iopt(name) : preset;
+}
+
+
+//!Write a record for each track of the sequences
+//!Symbols are written 60 per line (separated by spaces if the alphabet has
+//!words), and real numbers 10 per line.
+void write_sequences(sequences& seqs, outputBuffer& out){
+	for(size_t i = 0; i < seqs.size(); ++i){
+		sequence* sq = seqs.getSeq(i);
+		track* trk = sq->getTrack();
+		size_t length = sq->getLength();
+
+		out.append(sq->getHeader());
+		out.append('\n');
+
+		if (sq->isRealSeq()){
+			for(size_t j = 0; j < length; ++j){
+				out.appendDouble(sq->realValue(j));
+				out.append((j % 10 == 9 || j + 1 == length) ? '\n' : ' ');
+			}
+			continue;
+		}
+
+		bool words = trk->getAlphaMax() > 1;
+		for(size_t j = 0; j < length; ++j){
+			out.append(trk->getAlpha((*sq)[j]));
+			if (j % 60 == 59 || j + 1 == length){
+				out.append('\n');
+			}
+			else if (words){
+				out.append(' ');
+			}
+		}
+	}
+}
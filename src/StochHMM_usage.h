@@ -18,16 +18,56 @@ Command Line options:\n\
 \t-help or -h		print usage statement\n\
 \n\
 Files: reqires a sequence file and a model file\n\
-\t-model <model file>\t\timport model file\n\
-\t-seq <sequence file>\t\t\timport sequence file in fasta format\n\
+\t-model <model file>\t\timport model file (text or compiled)\n\
+\t-compile-model <file>\t\twrite a compiled model, which imports without\n\
+\t\t\t\t\tcomputing the ambiguous character emission scores.\n\
+\t\t\t\t\tThe model text is still stored and re-parsed on import;\n\
+\t\t\t\t\tonly the emission tables are read from the file.\n\
+\t\t\t\t\t-seq is optional with this option\n\
+\t-seq <sequence file>\t\t\timport sequence file in fasta format (gzip or BGZF allowed)\n\
+\t-region <region|file>\t\tonly decode region (name:start-end) or regions listed in file\n\
+\t\t\t\t\t(one per line or BED). Uses or creates <sequence file>.fai\n\
+\t-cache <cache file>\t\tread digitized sequences from binary cache file.  If it\n\
+\t\t\t\t\tdoesn't exist, or was written from a different or modified\n\
+\t\t\t\t\tsequence file or other regions, it is written from the\n\
+\t\t\t\t\tsequence file first.  -seq isn't needed to read an existing cache\n\
+\t-stream <size>\t\t\tread each sequence in windows of <size> symbols (basic models,\n\
+\t\t\t\t\tViterbi, posterior table or forward only).  Multiple track\n\
+\t\t\t\t\tmodels need a comma separated list of files, one per track\n\
+\t-real-format <text|f32|f64>\tformat of real number track files.  f32 and f64 are\n\
+\t\t\t\t\tlittle-endian binary floats or doubles, one sequence per\n\
+\t\t\t\t\tfile (default: by .f32/.f64 extension, otherwise text)\n\
+\t-real-float\t\t\tstore real number tracks as floats to halve their memory\n\
+\t-pack\t\t\t\tstore digitized sequences in 2 or 4 bits per symbol when\n\
+\t\t\t\t\ttheir alphabet allows it, to reduce their memory\n\
 \n\
 Non-stochastic Decoding:  Different algorithms available for decoding\n\
 \t-viterbi\t\t\tperforms viterbi traceback\n\
+\t\t-beam <score>: prune states scoring more than <score> (log) below the\n\
+\t\t\tbest state at each position (basic models only)\n\
+\t\t-beam-width <number>: keep only the <number> best states at each position\n\
+\t\t-memory <size>: choose the fastest Viterbi algorithm estimated to fit in\n\
+\t\t\t<size> bytes (K, M, G or T suffix) and print the estimates\n\n\
 \t-posterior\t\tCalculates posterior probabilities\n\
 \t\t\tIf no output options are supplied, this will return the posterior scores\n\
 \t\t\tfor all of the states.\n\n\
 \t\t-threshold <score>: Return only the States with a GFF_DESC, if they are\n\
-\t\t\tgreater than or equal to the threshold amount.\n\n\
+\t\t\tgreater than or equal to the threshold amount.\n\
+\t\t-posterior-window <number>: approximate the posteriors on windows of\n\
+\t\t\t<number> positions calculated independently (on -threads threads),\n\
+\t\t\tand print the largest difference of two windows in the inner half\n\
+\t\t\tof their overlap (the outer half is still converging) to stderr.\n\
+\t\t\tRows are printed as each window finishes, followed by the forward\n\
+\t\t\tprobability, unless -gff, -path, -label or -trellis need the table\n\
+\t\t\t(basic models only)\n\
+\t\t-overlap <number>: positions calculated on each side of a window to\n\
+\t\t\tconverge from unknown scores (default window/10, at most window)\n\
+\t\t-lag <number>: with -stream, print the posteriors of each position from\n\
+\t\t\tthe sequence up to at least <number> positions ahead, so memory\n\
+\t\t\tand delay are bounded by 2 * <number> positions (default 1000).\n\
+\t\t\tRows are printed as they are finished, so unlike the -posterior\n\
+\t\t\ttable the header has no Forward and Backward probabilities; the\n\
+\t\t\tforward probability is printed after the rows\n\n\
 \t-nbest <number of paths> \t\tperforms n-best viterbi algorithm\n\
 \n\
 Stochastic Decoding:\n\
@@ -37,11 +77,41 @@ Stochastic Decoding:\n\
 \t\tviterbi\t\t\tperforms stochastic traceback using modified-viterbi algorithm\n\
 \t\tposterior\t\t\tperforms stochastic traceback using posterior algorithm\n\
 \n\
+Training:\n\
+\t-train <Type of training> \t\tre-estimate the model from all sequences in the sequence file\n\
+\t\tTypes:\n\
+\t\tbaum-welch\t\texpected counts from forward/backward\n\
+\t\tviterbi\t\t\tcounts from viterbi path\n\
+\t\t-iterations <number>\tmaximum number of iterations (default 100)\n\
+\t\t-tolerance <value>\tstop when increase in log-likelihood is less than value (default 0.001)\n\
+\t\t\t\t\tif the log-likelihood decreases, a warning is printed and\n\
+\t\t\t\t\tthe model of the previous iteration is kept\n\
+\t\t-train-out <file>\twrite model to file after each iteration (default prints only\n\
+\t\t\t\t\tthe final model, to stdout)\n\
+\t\t-threads <number>\tnumber of threads to use (default 1)\n\
+\t\t\t\t\talso used to decompress BGZF sequence files, and when\n\
+\t\t\t\t\tdecoding, <number>-1 threads calculate the emissions\n\
+\t\t\t\t\tahead of the algorithm (not with -stream or -beam)\n\
+\t\t\t\t\tand posterior decoding calculates the forward and\n\
+\t\t\t\t\tbackward scores at once.  Viterbi decoding of long\n\
+\t\t\t\t\tsequences calculates <number> chunks at once\n\
+\t\t-emission-tile <number>\tpositions calculated at once by each emission\n\
+\t\t\t\t\tthread (default 4096)\n\
+\n\
 Output options:\n\
 \t-gff\t\t\tprints path in GFF format\n\
 \t-path\t\t\tprints state path according to state number\n\
 \t-label\t\t\tprints state path as labels\n\
 \t-hits\t\tprints hit table from stochastic sampling for each position and state\n\
+\t-trellis <file>\t\twrite the posterior (-posterior) or Viterbi (-viterbi)\n\
+\t\t\t\t\ttable of each sequence to a binary file.  With\n\
+\t\t\t\t\t-posterior it replaces the text posterior table\n\
+\t\t-trellis-format <f32|f16>: store values as floats (default) or half floats\n\
+\t\t\t(posterior only)\n\
+\t\t-trellis-layout <position|state>: store values by position (default) or state\n\
+\t\t-trellis-compress: compress the values in blocks\n\
+\t-stats\t\t\tprint counters and timers of the decoding of each sequence\n\
+\t\t\t\t\tto stderr, one line of JSON per sequence\n\
 \n\
 Written by Paul Lott at University of California, Davis\n\
 Please direct any questions, suggestions or bugs reports to Paul Lott at plott@ucdavis.edu\n\
@@ -11,6 +11,7 @@
 
 #include "sequences.h"
 #include "sequence.h"
+#include "sequenceStream.h"
 #include "seqTracks.h"
 #include "externDefinitions.h"
 #include "options.h"
@@ -31,8 +32,16 @@
 #include "PDF.h"
 #include "pwm.h"
 #include "trellis.h"
+#include "trellisExport.h"
+#include "trellisStats.h"
+#include "emissionTiles.h"
+#include "decodingPlanner.h"
+#include "trainer.h"
 #include "stochTable.h"
 #include "traceback_path.h"
+#include "outputWriter.h"
+#include "modelGenerator.h"
+#include "sequenceSampler.h"
 
 #define VERSION 0.37
 
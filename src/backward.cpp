@@ -33,6 +33,8 @@ namespace StochHMM{
 	//! Implements the backward algorithm (simple coded, little or no optimizations)
 	//! Stores the scores as doubles in table. Scoring table accessible from trellis -> getNaiveBackward();
 	void trellis::naive_backward(){
+		TRELLIS_PHASE("naive_backward");
+		trellisTiles tile_scope(this, false);
 		dbl_backward_score = new double_2D(seq_size, std::vector<double>(state_size,-INFINITY));
 		
 		double emission(-INFINITY);
@@ -67,7 +69,7 @@ namespace StochHMM{
 					}
 					
 					trans = getTransition(hmm->getState(st_current), st_previous, position+1);
-					emission = (*hmm)[st_previous]->get_emission_prob(*seqs, position+1);
+					emission = _emission(st_previous, position+1);
 					
 					
 					if (trans == -INFINITY || emission == -INFINITY){
@@ -99,7 +101,7 @@ namespace StochHMM{
 			
 			trans = getTransition(init, st_current, 0);
 			
-			emission = (*hmm)[st_current]->get_emission_prob(*seqs, 0);
+			emission = _emission(st_current, 0);
 			
 			if (trans == -INFINITY || emission == -INFINITY){
 				continue;
@@ -129,6 +131,8 @@ namespace StochHMM{
 	
 	//Performs the backward algorithm using the model
 	void trellis::simple_backward(){
+		TRELLIS_PHASE("simple_backward");
+		trellisTiles tile_scope(this, false);
 		
 //		if (!hmm->isBasic()){
 //			std::cerr << "Model isn't a simple/basic HMM.  Use complex algorithms\n";
@@ -147,89 +151,17 @@ namespace StochHMM{
 			exit(2);
 		}
 		
-		std::bitset<STATE_MAX> next_states;
-		std::bitset<STATE_MAX> current_states;
+		dynamic_bitset next_states(state_size);
+		dynamic_bitset current_states(state_size);
 		
 		double  backward_temp(-INFINITY);
-		double  emission(-INFINITY);
-		bool	exDef_position(false);
-		
-		std::bitset<STATE_MAX>* ending_from = hmm->getEndingFrom();
-		std::bitset<STATE_MAX>* from_trans(NULL);
-		
 		
-		//Calculate initial Backward from ending state
-		for(size_t st_current = 0; st_current < state_size; ++st_current){
-			if ((*ending_from)[st_current]){  //if the bitset is set (meaning there is a transition to this state)
-				
-				backward_temp = (*hmm)[st_current]->getEndTrans();
-				
-				if (backward_temp > -INFINITY){
-					(*backward_score)[seq_size-1][st_current] = backward_temp;
-					(*scoring_current)[st_current] = backward_temp;
-					next_states[st_current] = 1;
-				}
-			}
-		}
-		
-		
-		for(size_t position = seq_size-2; position != SIZE_MAX ; --position ){
-			
-			//Swap current_states and next states sets
-			current_states.reset();
-			current_states |= next_states;
-			next_states.reset();
-			
-			//Swap current and previous viterbi scores
-            scoring_previous->assign(state_size,-INFINITY);
-            swap_ptr = scoring_previous;
-			scoring_previous = scoring_current;
-			scoring_current = swap_ptr;
-			
+		for(size_t position = seq_size-1; position != SIZE_MAX ; --position ){
+			_backward_position(position, current_states, next_states);
+			_count_cells(scoring_current);
 			
-			if (exDef_defined){
-				exDef_position = seqs->exDefDefined(position);
-			}
-						
-			for (size_t st_previous = 0; st_previous < state_size; ++st_previous){ //i is previous state that emits value
-				if (!current_states[st_previous]){
-					continue;
-				}
-				
-				emission = (*hmm)[st_previous]->get_emission_prob(*seqs, position+1);
-				
-				if (exDef_defined && exDef_position){
-					emission += seqs->getWeight(position+1, st_previous);
-				}
-				
-				if (emission == -INFINITY){
-					continue;
-				}
-				
-				from_trans = (*hmm)[st_previous]->getFrom();
-				
-				for (size_t st_current = 0; st_current < state_size ; ++st_current) {  //j is current state
-					if (!(*from_trans)[st_current]){
-						continue;
-					}
-					
-					
-					if ((*scoring_previous)[st_previous] != -INFINITY){
-						
-						backward_temp = (*scoring_previous)[st_previous] + emission +  getTransition((*hmm)[st_current], st_previous , position);
-						
-						if ((*scoring_current)[st_current] == -INFINITY){
-							(*scoring_current)[st_current] = backward_temp;
-							(*backward_score)[position][st_current] = backward_temp;
-						}
-						else{
-							(*scoring_current)[st_current] = addLog(backward_temp, (*scoring_current)[st_current]);
-							(*backward_score)[position][st_current] = (*scoring_current)[st_current];
-						}
-						
-						next_states[st_current] = 1;
-					}
-				}
+			for(size_t st = 0; st < state_size; ++st){
+				(*backward_score)[position][st] = (*scoring_current)[st];
 			}
 		}
 		
@@ -237,7 +169,7 @@ namespace StochHMM{
 		state* init = hmm->getInitial();
 		for(size_t i = 0; i < state_size ;++i){
 			if ((*scoring_current)[i] != -INFINITY){
-				backward_temp = (*scoring_current)[i] + (*hmm)[i]->get_emission_prob(*seqs,0) + getTransition(init, i, 0);
+				backward_temp = (*scoring_current)[i] + _emission(i, 0) + getTransition(init, i, 0);
 				if (backward_temp > -INFINITY){
 					if (ending_backward_prob == -INFINITY){
 						ending_backward_prob = backward_temp;
@@ -258,6 +190,74 @@ namespace StochHMM{
 	}
 	
 	
+	//!Calculate the backward scores of one position into scoring_current from
+	//!the backward scores of the next position, or from the ending
+	//!transitions at the last position of the sequence
+	//! \param position Position in the sequence
+	//! \param current_states States with a backward score at the next position
+	//! \param next_states States with a backward score at the position
+	void trellis::_backward_position(size_t position, dynamic_bitset& current_states, dynamic_bitset& next_states){
+		double  backward_temp(-INFINITY);
+		double  emission(-INFINITY);
+		
+		if (position + 1 == seq_size){
+			dynamic_bitset* ending_from = hmm->getEndingFrom();
+			
+			for(size_t st_current = ending_from->find_first(); st_current != SIZE_MAX; st_current = ending_from->find_next(st_current)){
+				backward_temp = (*hmm)[st_current]->getEndTrans();
+				
+				if (backward_temp > -INFINITY){
+					(*scoring_current)[st_current] = backward_temp;
+					next_states[st_current] = 1;
+				}
+			}
+			return;
+		}
+		
+		//Swap current and previous scores
+		scoring_previous->assign(state_size,-INFINITY);
+		swap_ptr = scoring_previous;
+		scoring_previous = scoring_current;
+		scoring_current = swap_ptr;
+		
+		current_states.reset();
+		current_states |= next_states;
+		next_states.reset();
+		
+		bool exDef_position = exDef_defined && seqs->exDefDefined(position+1);
+		dynamic_bitset* from_trans(NULL);
+		
+		for (size_t st_previous = current_states.find_first(); st_previous != SIZE_MAX; st_previous = current_states.find_next(st_previous)){ //i is previous state that emits value
+			
+			emission = _emission(st_previous, position+1);
+			
+			if (exDef_position){
+				emission += seqs->getWeight(position+1, st_previous);
+			}
+			
+			if (emission == -INFINITY || (*scoring_previous)[st_previous] == -INFINITY){
+				continue;
+			}
+			
+			from_trans = (*hmm)[st_previous]->getFrom();
+			
+			for (size_t st_current = from_trans->find_first(); st_current != SIZE_MAX; st_current = from_trans->find_next(st_current)){  //j is current state
+				
+				backward_temp = (*scoring_previous)[st_previous] + emission + getTransition((*hmm)[st_current], st_previous , position+1);
+				
+				if ((*scoring_current)[st_current] == -INFINITY){
+					(*scoring_current)[st_current] = backward_temp;
+				}
+				else{
+					(*scoring_current)[st_current] = addLog(backward_temp, (*scoring_current)[st_current]);
+				}
+				
+				next_states[st_current] = 1;
+			}
+		}
+	}
+	
+	
 	
 	
 	
@@ -270,15 +270,15 @@ namespace StochHMM{
 //			exit(2);
 //		}
 //		
-//        std::bitset<STATE_MAX> next_states;
-//        std::bitset<STATE_MAX> current_states;
+//        dynamic_bitset next_states(state_size);
+//        dynamic_bitset current_states(state_size);
 //		
 //        double  backward_temp(-INFINITY);
 //        double  emission(-INFINITY);
 //        bool	exDef_position(false);
 //		
-//		std::bitset<STATE_MAX>* ending_from = hmm->getEndingFrom();
-//		std::bitset<STATE_MAX>* from_trans(NULL);
+//		dynamic_bitset* ending_from = hmm->getEndingFrom();
+//		dynamic_bitset* from_trans(NULL);
 //		
 //		
 //		//		std::cout << "Position: 3" << std::endl;
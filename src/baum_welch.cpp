@@ -19,6 +19,7 @@ namespace StochHMM {
 	
 	
 	void trellis::naive_baum_welch(){
+		TRELLIS_PHASE("naive_baum_welch");
 		if (dbl_forward_score == NULL){
 			naive_forward();
 		}
@@ -41,7 +42,7 @@ namespace StochHMM {
 			sum = (-INFINITY);
 			for (size_t previous = 0; previous < state_size ; previous++){ // state(i)
 				for (size_t current = 0; current < state_size; current++){ // state(j)
-					(*dbl_baum_welch_score)[position][previous][current] = (*dbl_forward_score)[position][previous] + getTransition(hmm->getState(previous), current, position) + (*hmm)[current]->get_emission_prob(*seqs, position+1) + (*dbl_backward_score)[position+1][current];
+					(*dbl_baum_welch_score)[position][previous][current] = (*dbl_forward_score)[position][previous] + getTransition(hmm->getState(previous), current, position) + _emission(current, position+1) + (*dbl_backward_score)[position+1][current];
 					sum = addLog((*dbl_baum_welch_score)[position][previous][current], sum);
 				}
 			}
@@ -56,40 +57,460 @@ namespace StochHMM {
 	
 	
 	
-	void trellis::update_transitions(){
+	//!Perform Baum-Welch expectation step on the sequence
+	//!Expected counts are added to the trellis transition counts and the
+	//!lexicalTable emission counts of the model
+	void trellis::baum_welch(){
+		simple_baum_welch();
+	}
+	
+	
+	void trellis::simple_baum_welch(model* h, sequences* sqs){
+		hmm = h;
+		seqs = sqs;
+		seq_size		= seqs->getLength();
+		state_size		= hmm->state_size();
+		exDef_defined	= seqs->exDefDefined();
+		
+		simple_baum_welch();
+	}
+	
+	
+	//!Baum-Welch expectation step without storing the transition posteriors
+	//!The forward table is computed first, then the backward pass is performed
+	//!column by column.  At each position the expected transitions
+	//!(forward[t][i] + trans(i,j) + emission[t+1][j] + backward[t+1][j] - P(x))
+	//!are accumulated for the transitions defined in the model and the expected
+	//!emissions (forward[t][i] + backward[t][i] - P(x)) are added to the emission
+	//!counts tables using lexicalTable::incrementCountsDouble.
+	//!Memory is O(N*S) for the forward table, instead of O(N*S^2), and the
+	//!transition counts are only kept for the transitions of each state.
+	//!Counts accumulate across calls so multiple sequences can be combined before
+	//!calling update_transitions() and update_emissions().
+	void trellis::simple_baum_welch(){
+		if (!hmm->isBasic()){
+			std::cerr << "Model isn't a simple/basic HMM.  Baum-Welch training requires a basic model\n";
+			return;
+		}
+		
+		if (seq_size == 0){
+			return;
+		}
+		
+		TRELLIS_PHASE("simple_baum_welch");
+		
+		if (forward_score != NULL){delete forward_score; forward_score = NULL;}
+		simple_forward();
+		
+		double prob = ending_forward_prob;
+		if (prob == -INFINITY){
+			std::cerr << "Sequence has zero probability given the model. Skipping Baum-Welch for sequence" << std::endl;
+			delete forward_score;
+			forward_score = NULL;
+			return;
+		}
+		
+		//Allocate the counts tables and clear the emission counts if this is the first sequence
+		if (transition_counts == NULL){
+			clear_counts();
+			_allocate_counts();
+		}
 		
-		std::cout << "Transitions to Start:\n";
-		double updated(-INFINITY);
-		for(size_t st = 0 ; st < state_size ; st++){
-			updated = ((*dbl_backward_score)[0][st] + (*dbl_forward_score)[0][st])-ending_forward_prob;
-			std::cout << hmm->getStateName(st) << "\t" << exp(updated) << std::endl;
+		//Allocate scoring vectors
+		scoring_previous = new (std::nothrow) std::vector<double> (state_size,-INFINITY);
+		scoring_current  = new (std::nothrow) std::vector<double> (state_size,-INFINITY);
+		
+		if (scoring_previous == NULL || scoring_current == NULL || transition_counts == NULL || initial_counts == NULL || ending_counts == NULL){
+			std::cerr << "Can't allocate Baum-Welch tables. OUT OF MEMORY" << std::endl;
+			exit(2);
 		}
 		
-		float_2D numerator(state_size, std::vector<float>(state_size,-INFINITY));
-		float_2D denominator(state_size, std::vector<float>(state_size,-INFINITY));
+		dynamic_bitset next_states(state_size);
+		dynamic_bitset current_states(state_size);
+		
+		double  backward_temp(-INFINITY);
+		double  emission(-INFINITY);
+		double	trans(-INFINITY);
+		bool	exDef_position(false);
+		
+		dynamic_bitset* ending_from = hmm->getEndingFrom();
+		dynamic_bitset* from_trans(NULL);
+		
 		
-		for (size_t position = 0; position < seq_size-1; position++){
-			for (size_t i = 0; i < state_size; i++){
-				for (size_t j = 0; j < state_size; j++){
-					numerator[i][j]= addLog((double)numerator[i][j], (*dbl_baum_welch_score)[position][i][j]);
-					denominator[i][j] = addLog((double)denominator[i][j], ((*dbl_forward_score)[position][i] + (*dbl_backward_score)[position][i])-ending_forward_prob);
+		//Calculate initial Backward from ending state
+		for(size_t st_current = ending_from->find_first(); st_current != SIZE_MAX; st_current = ending_from->find_next(st_current)){
+			
+			backward_temp = (*hmm)[st_current]->getEndTrans();
+			
+			if (backward_temp > -INFINITY){
+				(*scoring_current)[st_current] = backward_temp;
+				next_states[st_current] = 1;
+				
+				if ((*forward_score)[seq_size-1][st_current] != -INFINITY){
+					(*ending_counts)[st_current] += exp((*forward_score)[seq_size-1][st_current] + backward_temp - prob);
 				}
 			}
 		}
 		
-		for (size_t i = 0; i < state_size; i++){
-			std::cout << hmm->getStateName(i) << "\t";
-			for (size_t j = 0; j < state_size; j++){
-				std::cout << exp((numerator[i][j]-denominator[i][j])) << "\t";
+		_accumulate_emissions(seq_size-1, prob);
+		
+		for(size_t position = seq_size-2; position != SIZE_MAX ; --position ){
+			
+			//Swap current_states and next states sets
+			current_states.reset();
+			current_states |= next_states;
+			next_states.reset();
+			
+			_count_cells(scoring_current);
+			//Swap current and previous backward scores
+			scoring_previous->assign(state_size,-INFINITY);
+			swap_ptr = scoring_previous;
+			scoring_previous = scoring_current;
+			scoring_current = swap_ptr;
+			
+			if (exDef_defined){
+				exDef_position = seqs->exDefDefined(position+1);
+			}
+			
+			for (size_t st_previous = current_states.find_first(); st_previous != SIZE_MAX; st_previous = current_states.find_next(st_previous)){ //State at position+1
+				if ((*scoring_previous)[st_previous] == -INFINITY){
+					continue;
+				}
+				
+				emission = _emission(st_previous, position+1);
+				
+				if (exDef_defined && exDef_position){
+					emission += seqs->getWeight(position+1, st_previous);
+				}
+				
+				if (emission == -INFINITY){
+					continue;
+				}
+				
+				from_trans = (*hmm)[st_previous]->getFrom();
+				
+				for (size_t st_current = from_trans->find_first(); st_current != SIZE_MAX; st_current = from_trans->find_next(st_current)){  //State at position
+					
+					trans = getTransition((*hmm)[st_current], st_previous , position+1);
+					if (trans == -INFINITY){
+						continue;
+					}
+					
+					backward_temp = (*scoring_previous)[st_previous] + emission + trans;
+					
+					if ((*scoring_current)[st_current] == -INFINITY){
+						(*scoring_current)[st_current] = backward_temp;
+					}
+					else{
+						(*scoring_current)[st_current] = addLog(backward_temp, (*scoring_current)[st_current]);
+					}
+					
+					//Expected transition count from st_current to st_previous
+					if ((*forward_score)[position][st_current] != -INFINITY){
+						(*transition_counts)[st_current][(*transition_slots)[st_current][st_previous]] += exp((*forward_score)[position][st_current] + backward_temp - prob);
+					}
+					
+					next_states[st_current] = 1;
+				}
+			}
+			
+			_accumulate_emissions(position, prob);
+		}
+		_count_cells(scoring_current);
+		
+		//Expected transitions from the initial state
+		for(size_t st = 0; st < state_size ;++st){
+			if ((*scoring_current)[st] != -INFINITY && (*forward_score)[0][st] != -INFINITY){
+				(*initial_counts)[st] += exp((*forward_score)[0][st] + (*scoring_current)[st] - prob);
 			}
-			std::cout << std::endl;
 		}
+		
+		delete scoring_previous;
+		delete scoring_current;
+		scoring_previous = NULL;
+		scoring_current = NULL;
+		
+		delete forward_score;
+		forward_score = NULL;
 	}
 	
-	void trellis::update_emissions(){
+	
+	//!Add the expected emission counts for a position to the model emission count tables
+	//!Uses the forward table and the backward scores in scoring_current
+	void trellis::_accumulate_emissions(size_t position, double prob){
+		for(size_t st = 0; st < state_size; ++st){
+			if ((*scoring_current)[st] == -INFINITY || (*forward_score)[position][st] == -INFINITY){
+				continue;
+			}
+			
+			_accumulate_state_emissions(position, st, exp((*forward_score)[position][st] + (*scoring_current)[st] - prob));
+		}
+	}
+	
+	
+	//!Add weight to the emission counts of the state for the letters at the position
+	void trellis::_accumulate_state_emissions(size_t position, size_t st, double weight){
+		state* current = (*hmm)[st];
+		for(size_t i = 0; i < current->getEmissionSize(); ++i){
+			emm* emission = current->getEmission(i);
+			if (!emission->isLexical()){
+				continue;
+			}
+			
+			lexicalTable* table = emission->getTables();
+			size_t word_index(0);
+			size_t char_index(0);
+			if (table->getCountIndex(*seqs, position, word_index, char_index)){
+				table->incrementCountsDouble(word_index, char_index, weight);
+			}
+		}
+	}
+	
+	
+	void trellis::viterbi_training(model* h, sequences* sqs){
+		hmm = h;
+		seqs = sqs;
+		seq_size		= seqs->getLength();
+		state_size		= hmm->state_size();
+		exDef_defined	= seqs->exDefDefined();
 		
+		viterbi_training();
 	}
-
 	
 	
+	//!Viterbi (hard EM) training step
+	//!Performs viterbi decoding and adds the transitions and emissions along
+	//!the viterbi path to the counts used by update_transitions() and update_emissions()
+	void trellis::viterbi_training(){
+		if (seq_size == 0){
+			return;
+		}
+		
+		TRELLIS_PHASE("viterbi_training");
+		
+		if (traceback_table != NULL){delete traceback_table; traceback_table = NULL;}
+		viterbi();
+		
+		traceback_path path(hmm);
+		traceback(path);
+		
+		if (path.size() != seq_size){
+			std::cerr << "Sequence has no valid viterbi path given the model. Skipping Viterbi training for sequence" << std::endl;
+			return;
+		}
+		
+		if (transition_counts == NULL){
+			clear_counts();
+			_allocate_counts();
+		}
+		
+		//Traceback path is stored from the end of the sequence to the beginning
+		size_t previous = path.val(seq_size-1);
+		(*initial_counts)[previous] += 1;
+		_accumulate_state_emissions(0, previous, 1);
+		
+		for(size_t position = 1; position < seq_size; ++position){
+			size_t current = path.val(seq_size-1-position);
+			(*transition_counts)[previous][(*transition_slots)[previous][current]] += 1;
+			_accumulate_state_emissions(position, current, 1);
+			previous = current;
+		}
+		
+		(*ending_counts)[previous] += 1;
+	}
+	
+	
+	//!Allocate the transition counts of the model, with a count for each of
+	//!the states a state transitions to (in the order of state::getTo())
+	//!The table of count slots is built the first time and kept until the
+	//!trellis is reset, so it is only computed once when training reuses the trellis.
+	void trellis::_allocate_counts(){
+		transition_counts	= new (std::nothrow) double_2D(state_size);
+		initial_counts		= new (std::nothrow) std::vector<double>(state_size,0.0);
+		ending_counts		= new (std::nothrow) std::vector<double>(state_size,0.0);
+		
+		if (transition_counts == NULL || initial_counts == NULL || ending_counts == NULL){
+			std::cerr << "Can't allocate transition counts. OUT OF MEMORY" << std::endl;
+			exit(2);
+		}
+		
+		for(size_t st = 0; st < state_size; ++st){
+			(*transition_counts)[st].assign((*hmm)[st]->getTo()->count(), 0.0);
+		}
+		
+		if (transition_slots != NULL && transition_slots->size() == state_size){
+			return;
+		}
+		
+		delete transition_slots;
+		transition_slots = new (std::nothrow) std::vector<std::vector<size_t> >(state_size, std::vector<size_t>(state_size, SIZE_MAX));
+		
+		if (transition_slots == NULL){
+			std::cerr << "Can't allocate transition counts. OUT OF MEMORY" << std::endl;
+			exit(2);
+		}
+		
+		for(size_t st = 0; st < state_size; ++st){
+			dynamic_bitset* to_trans = (*hmm)[st]->getTo();
+			size_t slot(0);
+			for (size_t j = to_trans->find_first(); j != SIZE_MAX; j = to_trans->find_next(j), ++slot){
+				(*transition_slots)[st][j] = slot;
+			}
+		}
+	}
+	
+	
+	//!Clear the expected counts in the trellis and the model emission counts tables
+	void trellis::clear_counts(){
+		delete transition_counts;
+		delete initial_counts;
+		delete ending_counts;
+		transition_counts	= NULL;
+		initial_counts		= NULL;
+		ending_counts		= NULL;
+		
+		if (hmm == NULL){
+			return;
+		}
+		
+		for(size_t st = 0; st < hmm->state_size(); ++st){
+			state* current = hmm->getState(st);
+			for(size_t i = 0; i < current->getEmissionSize(); ++i){
+				emm* emission = current->getEmission(i);
+				if (!emission->isLexical()){
+					continue;
+				}
+				
+				lexicalTable* table = emission->getTables();
+				std::vector<std::vector<double> >* log_prob = table->getLogProbabilityTable();
+				if (log_prob->size() > 0){
+					table->createTable(log_prob->size(), (*log_prob)[0].size(), 0, COUNTS);
+				}
+			}
+		}
+	}
+	
+	
+	//!Add the transition counts from another trellis to this trellis
+	void trellis::add_counts(trellis& other){
+		if (other.transition_counts == NULL){
+			return;
+		}
+		
+		if (transition_counts == NULL){
+			_allocate_counts();
+		}
+		
+		for(size_t i = 0; i < state_size; ++i){
+			(*initial_counts)[i] += (*other.initial_counts)[i];
+			(*ending_counts)[i]  += (*other.ending_counts)[i];
+			for(size_t j = 0; j < (*transition_counts)[i].size(); ++j){
+				(*transition_counts)[i][j] += (*other.transition_counts)[i][j];
+			}
+		}
+	}
+	
+	
+	//!Check whether the ending transition of a state is part of its distribution
+	//!\return true if the state's transitions are all STANDARD and their
+	//!probabilities, including the ending transition, sum to 1
+	bool trellis::_ending_normalized(state* st){
+		transition* ending = st->getEnding();
+		if (ending == NULL || ending->getTransitionType() != STANDARD){
+			return false;
+		}
+		
+		double sum = exp(ending->getTransition(0,NULL));
+		dynamic_bitset* to_trans = st->getTo();
+		for (size_t j = to_trans->find_first(); j != SIZE_MAX; j = to_trans->find_next(j)){
+			transition* trans = st->getTrans(j);
+			if (trans == NULL || trans->getTransitionType() != STANDARD){
+				return false;
+			}
+			sum += exp(trans->getTransition(0,NULL));
+		}
+		
+		return fabs(sum - 1) < 1e-6;
+	}
+	
+	
+	//!Update the standard transitions of the model using the expected counts
+	//!accumulated by simple_baum_welch().  Transitions that are not STANDARD are not changed.
+	//!The ending transition is only re-estimated if the state's transitions,
+	//!including END, sum to 1 (see _ending_normalized).
+	void trellis::update_transitions(){
+		if (transition_counts == NULL){
+			return;
+		}
+		
+		//Transitions from the initial state
+		state* init = hmm->getInitial();
+		double total(0);
+		for(size_t st = 0; st < state_size; ++st){
+			total += (*initial_counts)[st];
+		}
+		
+		if (total > 0){
+			for(size_t st = 0; st < state_size; ++st){
+				transition* trans = init->getTrans(st);
+				if (trans != NULL && trans->getTransitionType() == STANDARD){
+					trans->setTransProb(log((*initial_counts)[st]/total));
+				}
+			}
+		}
+		
+		//Transitions between states and to the ending state
+		for(size_t i = 0; i < state_size; ++i){
+			state* current = (*hmm)[i];
+			
+			//The ending transition is only re-estimated when it is part of the
+			//state's distribution.  Models using the "END: 1" convention leave
+			//it out, so it isn't counted or changed.
+			bool estimate_ending = _ending_normalized(current);
+			
+			std::vector<double>& counts = (*transition_counts)[i];
+			total = (estimate_ending) ? (*ending_counts)[i] : 0;
+			for (size_t j = 0; j < counts.size(); ++j){
+				total += counts[j];
+			}
+			
+			if (total <= 0){
+				continue;
+			}
+			
+			dynamic_bitset* to_trans = current->getTo();
+			
+			size_t count(0);
+			for (size_t j = to_trans->find_first(); j != SIZE_MAX; j = to_trans->find_next(j), ++count){
+				
+				transition* trans = current->getTrans(j);
+				if (trans != NULL && trans->getTransitionType() == STANDARD){
+					trans->setTransProb(log(counts[count]/total));
+				}
+			}
+			
+			if (estimate_ending){
+				current->getEnding()->setTransProb(log((*ending_counts)[i]/total));
+			}
+		}
+		
+		return;
+	}
+	
+	
+	//!Update the lexical emissions of the model using the expected counts
+	//!in the lexicalTable counts tables
+	void trellis::update_emissions(){
+		for(size_t st = 0; st < hmm->state_size(); ++st){
+			state* current = hmm->getState(st);
+			for(size_t i = 0; i < current->getEmissionSize(); ++i){
+				emm* emission = current->getEmission(i);
+				if (emission->isLexical()){
+					emission->getTables()->estimateFromCounts();
+				}
+			}
+		}
+		return;
+	}
+	
 }
\ No newline at end of file
@@ -0,0 +1,316 @@
+//
+//  decodingPlanner.cpp
+//  StochHMM
+//
+//  Copyright (c) 2013 Korf Lab, Genome Center, UC Davis, Davis, CA. All rights reserved.
+//
+
+#include "decodingPlanner.h"
+#include "trellis.h"
+
+namespace StochHMM{
+
+	static const char* ENGINE_NAMES[] = {"dense","sparse_complex","checkpoint","stream"};
+
+	//Rough costs of the calculations, measured with simple_viterbi on a
+	//20 state model.  Duration transitions trace back the duration,
+	//function transitions also call the external function.
+	static const double TRANSITION_SECONDS = 13e-9;
+	static const double DURATION_FACTOR = 4;
+	static const double FUNCTION_FACTOR = 50;
+	static const double EMISSION_SECONDS = 10e-9;
+	static const double CONTINUOUS_EMISSION_SECONDS = 40e-9;
+	static const double FUNCTION_EMISSION_SECONDS = 500e-9;
+	static const double MAP_INSERT_SECONDS = 100e-9;
+
+	//Memory of a std::vector and its allocation besides the elements
+	static const double VECTOR_BYTES = 40;
+	//Memory of a std::map and of each of its nodes
+	static const double MAP_BYTES = 48;
+	static const double MAP_NODE_BYTES = 48;
+
+
+	decodingPlanner::decodingPlanner(model* h):hmm(h),states(0),tracks(0),real_tracks(0),duration_states(0),complex_emissions(0),edges(0),duration_edges(0),function_edges(0),emission_cost(0),length(0),budget(0),choice(DENSE_ENGINE),fits(true){
+		states = hmm->state_size();
+		tracks = hmm->track_size();
+		for(size_t i = 0; i < tracks; ++i){
+			if (!hmm->getTrack(i)->isAlpha()){
+				real_tracks++;
+			}
+		}
+
+		std::vector<bool>* duration = hmm->get_explicit();
+
+		for(size_t i = 0; i < states; ++i){
+			state* st = hmm->getState(i);
+			bool is_duration = (duration != NULL && (*duration)[i]);
+			if (is_duration){
+				duration_states++;
+			}
+
+			//Transitions are evaluated from each previous state
+			double from = st->getFrom()->count();
+			edges += from;
+
+			std::vector<transition*>* trans = st->getTransitions();
+			for(size_t j = 0; j < trans->size(); ++j){
+				transition* tr = (*trans)[j];
+				if (tr == NULL){
+					continue;
+				}
+
+				if (is_duration){
+					duration_edges++;
+				}
+
+				if (tr->FunctionDefined()){
+					function_edges++;
+				}
+			}
+
+			for(size_t j = 0; j < st->getEmissionSize(); ++j){
+				emm* emission = st->getEmission(j);
+				if (emission->isFunction()){
+					emission_cost += FUNCTION_EMISSION_SECONDS;
+					complex_emissions++;
+				}
+				else if (emission->isContinuous() || emission->isMultiContinuous()){
+					emission_cost += CONTINUOUS_EMISSION_SECONDS;
+					complex_emissions++;
+				}
+				else{
+					emission_cost += EMISSION_SECONDS;
+				}
+			}
+		}
+	}
+
+
+	//!Estimate the memory and time of each algorithm
+	//! \param len Length of the sequence
+	//! \param store_table Whether the Viterbi scores are stored (-trellis)
+	//! \param window Window size of streaming decoding
+	void decodingPlanner::plan(size_t len, bool store_table, size_t window){
+		length = len;
+		estimates.clear();
+		estimates.push_back(_estimate(DENSE_ENGINE, store_table, window));
+		estimates.push_back(_estimate(SPARSE_COMPLEX_ENGINE, store_table, window));
+		estimates.push_back(_estimate(CHECKPOINT_ENGINE, store_table, window));
+		estimates.push_back(_estimate(STREAM_ENGINE, store_table, window));
+	}
+
+
+	decodingPlanner::estimate decodingPlanner::_estimate(decodingEngine engine, bool store_table, size_t window){
+		estimate est;
+		est.engine = engine;
+		est.available = true;
+
+		double L = length;
+		double S = states;
+
+		//Sequences keep the symbols and their digitized values
+		double sequence_bytes = L * ((tracks - real_tracks) * 2 + real_tracks * sizeof(double));
+		double bitset_bytes = VECTOR_BYTES + S / 8;
+		double scores_bytes = 2 * (VECTOR_BYTES + S * sizeof(double));
+		double traceback_bytes = L * (VECTOR_BYTES + S * sizeof(int16_t));
+		double table_bytes = (store_table) ? L * (VECTOR_BYTES + S * sizeof(float)) : 0;
+		double duration_bytes = (hmm->isBasic()) ? 0 : 2 * (VECTOR_BYTES + S * sizeof(size_t));
+
+		double position_seconds = edges * TRANSITION_SECONDS;
+		position_seconds += duration_edges * (DURATION_FACTOR - 1) * TRANSITION_SECONDS;
+		position_seconds += function_edges * (FUNCTION_FACTOR - 1) * TRANSITION_SECONDS;
+		position_seconds += emission_cost;
+
+		switch (engine){
+			case DENSE_ENGINE:
+				est.bytes = sequence_bytes + scores_bytes + traceback_bytes + table_bytes + duration_bytes;
+				est.seconds = L * position_seconds;
+				break;
+
+			case SPARSE_COMPLEX_ENGINE:
+				if (duration_states == 0){
+					est.available = false;
+					est.reason = "no explicit duration states";
+				}
+				else if (store_table){
+					est.available = false;
+					est.reason = "doesn't store the table for -trellis";
+				}
+				est.bytes = sequence_bytes + scores_bytes + traceback_bytes + duration_bytes;
+				est.bytes += duration_states * (VECTOR_BYTES + L * sizeof(void*));
+				est.bytes += L * (duration_states * MAP_BYTES + duration_edges * MAP_NODE_BYTES);
+				est.seconds = L * (position_seconds + duration_edges * MAP_INSERT_SECONDS);
+				break;
+
+			case CHECKPOINT_ENGINE:{
+				if (!hmm->isBasic()){
+					est.available = false;
+					est.reason = "requires a basic model";
+				}
+				else if (store_table){
+					est.available = false;
+					est.reason = "doesn't store the table for -trellis";
+				}
+				double interval = trellis::checkpointInterval(length);
+				double intervals = (interval > 0) ? ceil(L / interval) : 0;
+				est.bytes = sequence_bytes + scores_bytes;
+				est.bytes += intervals * (VECTOR_BYTES + S * sizeof(double) + bitset_bytes);
+				est.bytes += interval * S * sizeof(int16_t);
+				est.seconds = 2 * L * position_seconds;
+				break;
+			}
+
+			case STREAM_ENGINE:{
+				if (!hmm->isBasic()){
+					est.available = false;
+					est.reason = "requires a basic model";
+				}
+				else if (store_table){
+					est.available = false;
+					est.reason = "doesn't store the table for -trellis";
+				}
+				else{
+					est.available = false;
+					est.reason = "requires -stream";
+				}
+				double W = (window > 0 && window < length) ? window : L;
+				double windows = ceil(L / W);
+				est.bytes = W * ((tracks - real_tracks) * 2 + real_tracks * sizeof(double)) + scores_bytes;
+				est.bytes += windows * (VECTOR_BYTES + S * sizeof(double) + bitset_bytes + VECTOR_BYTES * tracks);
+				est.bytes += W * S * sizeof(int16_t);
+				est.seconds = 2 * L * position_seconds;
+				break;
+			}
+		}
+
+		return est;
+	}
+
+
+	//!Choose the fastest available algorithm that fits the memory budget
+	//!If none fit, chooses the available algorithm using the least memory
+	//! \param mem Memory budget in bytes
+	//! \return true if the chosen algorithm fits the budget
+	bool decodingPlanner::choose(double mem){
+		budget = mem;
+		fits = false;
+		choice = DENSE_ENGINE;
+
+		double best = INFINITY;
+		for(size_t i = 0; i < estimates.size(); ++i){
+			if (estimates[i].available && estimates[i].bytes <= budget && estimates[i].seconds < best){
+				best = estimates[i].seconds;
+				choice = estimates[i].engine;
+				fits = true;
+			}
+		}
+
+		if (fits){
+			return true;
+		}
+
+		best = INFINITY;
+		for(size_t i = 0; i < estimates.size(); ++i){
+			if (estimates[i].available && estimates[i].bytes < best){
+				best = estimates[i].bytes;
+				choice = estimates[i].engine;
+			}
+		}
+
+		return false;
+	}
+
+
+	//!Get the estimates and the decision as text
+	std::string decodingPlanner::stringify(){
+		std::stringstream text;
+		text << "Decoding plan: " << hmm->getName() << " length " << length;
+		text << ", " << states << " states, " << edges << " transitions";
+		if (duration_states > 0){
+			text << ", " << duration_states << " duration states";
+		}
+		if (complex_emissions > 0){
+			text << ", " << complex_emissions << " continuous or function emissions";
+		}
+		text << "\n";
+
+		for(size_t i = 0; i < estimates.size(); ++i){
+			estimate& est = estimates[i];
+			text << "\t" << engineName(est.engine);
+			text << "\t" << _formatBytes(est.bytes);
+			text << "\t" << est.seconds << " s";
+			if (!est.available){
+				text << "\t(" << est.reason << ")";
+			}
+			text << "\n";
+		}
+
+		text << "Chose " << engineName(choice);
+		if (!fits){
+			text << ": nothing fits the budget of " << _formatBytes(budget);
+			if (hmm->isBasic()){
+				text << ", try -stream";
+			}
+		}
+		text << "\n";
+
+		return text.str();
+	}
+
+
+	//!Get the name of an algorithm
+	const char* decodingPlanner::engineName(decodingEngine engine){
+		return ENGINE_NAMES[engine];
+	}
+
+
+	//!Get a memory size as text with a K, M or G suffix
+	std::string decodingPlanner::_formatBytes(double bytes){
+		static const char* suffixes[] = {"B","K","M","G","T"};
+		size_t i = 0;
+		while (bytes >= 1024 && i < 4){
+			bytes /= 1024;
+			i++;
+		}
+		
+		std::stringstream text;
+		text.precision((bytes < 10 && i > 0) ? 2 : 3);
+		text << bytes << suffixes[i];
+		return text.str();
+	}
+
+
+	//!Parse a memory size with an optional K, M, G or T suffix (powers of 1024)
+	//! \return Bytes, or -1 if the size can't be parsed
+	double decodingPlanner::parseBytes(const std::string& text){
+		char* end = NULL;
+		double value = strtod(text.c_str(), &end);
+		if (end == text.c_str() || value < 0){
+			return -1;
+		}
+
+		std::string suffix(end);
+		if (suffix.size() == 2 && (suffix[1] == 'B' || suffix[1] == 'b')){
+			suffix.erase(1);
+		}
+
+		if (suffix.empty() || suffix == "B" || suffix == "b"){
+			return value;
+		}
+		else if (suffix == "K" || suffix == "k"){
+			return value * 1024;
+		}
+		else if (suffix == "M" || suffix == "m"){
+			return value * 1048576;
+		}
+		else if (suffix == "G" || suffix == "g"){
+			return value * 1073741824.0;
+		}
+		else if (suffix == "T" || suffix == "t"){
+			return value * 1099511627776.0;
+		}
+
+		return -1;
+	}
+
+}
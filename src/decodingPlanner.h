@@ -0,0 +1,97 @@
+//
+//  decodingPlanner.h
+//  StochHMM
+//
+//  Copyright (c) 2013 Korf Lab, Genome Center, UC Davis, Davis, CA. All rights reserved.
+//
+
+#ifndef __StochHMM__decodingPlanner__
+#define __StochHMM__decodingPlanner__
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <math.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "hmm.h"
+
+namespace StochHMM{
+
+	//!Viterbi decoding algorithms compared by decodingPlanner
+	//! DENSE_ENGINE			trellis::viterbi() (simple_viterbi or fast_complex_viterbi)
+	//! SPARSE_COMPLEX_ENGINE	trellis::sparse_complex_viterbi()
+	//! CHECKPOINT_ENGINE		trellis::checkpoint_viterbi()
+	//! STREAM_ENGINE			trellis::stream_viterbi() (-stream)
+	enum decodingEngine {DENSE_ENGINE, SPARSE_COMPLEX_ENGINE, CHECKPOINT_ENGINE, STREAM_ENGINE};
+
+	/*! \class decodingPlanner
+	 *	\brief Estimates the memory and time of the Viterbi algorithms for a
+	 *	model and sequence length, and chooses one that fits a memory budget
+	 *
+	 *	Memory is estimated from the tables each algorithm allocates (including
+	 *	the sequence itself, except for streaming).  Time is estimated from the
+	 *	number of transitions and emissions calculated, using constant costs
+	 *	per call, so it is only good for comparing algorithms, not for
+	 *	predicting the run time.
+	 *
+	 *	- Dense decoding stores a traceback pointer for every cell
+	 *	- Sparse complex decoding also stores the transitions into duration states
+	 *	- Checkpointed decoding stores the scores every square root of the length
+	 *	  positions and calculates the Viterbi scores twice (basic models only)
+	 *	- Streaming stores a window of the sequence and the scores at each
+	 *	  window (basic models only), but the sequence has to be read with -stream
+	 */
+	class decodingPlanner{
+	public:
+		decodingPlanner(model* h);
+
+		//!Estimate of one algorithm
+		struct estimate{
+			decodingEngine engine;
+			bool available;
+			std::string reason;		//Why the algorithm isn't available
+			double bytes;
+			double seconds;
+		};
+
+		void plan(size_t length, bool store_table = false, size_t window = 1000000);
+		bool choose(double budget);
+
+		//!Get the algorithm chosen by choose()
+		inline decodingEngine getChoice(){return choice;}
+
+		//!Get the estimates of the last plan()
+		inline std::vector<estimate>& getEstimates(){return estimates;}
+
+		std::string stringify();
+
+		static const char* engineName(decodingEngine engine);
+		static double parseBytes(const std::string& text);
+
+	private:
+		model* hmm;
+		size_t states;
+		size_t tracks;
+		size_t real_tracks;
+		size_t duration_states;
+		size_t complex_emissions;	//Continuous and function emissions
+		double edges;				//Transitions between states
+		double duration_edges;		//Transitions from duration states
+		double function_edges;		//Transitions with external functions
+		double emission_cost;		//Time of the emissions of all states at a position
+
+		size_t length;
+		double budget;
+		decodingEngine choice;
+		bool fits;
+		std::vector<estimate> estimates;
+
+		estimate _estimate(decodingEngine engine, bool store_table, size_t window);
+		static std::string _formatBytes(double bytes);
+	};
+
+}
+
+#endif /* defined(__StochHMM__decodingPlanner__) */
@@ -9,8 +9,97 @@
 #include "dynamic_bitset.h"
 
 namespace StochHMM {
+	
+	bitset_storage::bitset_storage(const bitset_storage& rhs):data(local),sz(0),cap(BITSET_INLINE_INTS){
+		*this = rhs;
+	}
+	
+	bitset_storage& bitset_storage::operator=(const bitset_storage& rhs){
+		if (this == &rhs){
+			return *this;
+		}
+		
+		sz = 0;
+		reserve(rhs.sz);
+		memcpy(data, rhs.data, rhs.sz * sizeof(uint32_t));
+		sz = rhs.sz;
+		return *this;
+	}
+	
+	//!Reserve memory for n integers.  Moves the integers to the heap if n is larger
+	//!than the inline storage.
+	void bitset_storage::reserve(size_t n){
+		if (n <= cap){
+			return;
+		}
+		
+		size_t new_cap = (cap*2 > n) ? cap*2 : n;
+		uint32_t* temp = new (std::nothrow) uint32_t[new_cap];
+		if (temp == NULL){
+			std::cerr << "Can't allocate dynamic_bitset. OUT OF MEMORY" << std::endl;
+			exit(2);
+		}
+		
+		memcpy(temp, data, sz * sizeof(uint32_t));
+		if (data != local){
+			delete[] data;
+		}
+		data = temp;
+		cap = new_cap;
+		return;
+	}
+	
+	//!Resize to n integers.  New integers are set to zero.
+	void bitset_storage::resize(size_t n){
+		reserve(n);
+		for(size_t i = sz; i < n; ++i){
+			data[i] = 0;
+		}
+		sz = n;
+		return;
+	}
+	
+	void bitset_storage::assign(size_t n, uint32_t val){
+		reserve(n);
+		for(size_t i = 0; i < n; ++i){
+			data[i] = val;
+		}
+		sz = n;
+		return;
+	}
+	
+	void bitset_storage::push_back(uint32_t val){
+		reserve(sz+1);
+		data[sz++] = val;
+		return;
+	}
+	
+	//!Insert n integers with value val before pos
+	void bitset_storage::insert(uint32_t* pos, size_t n, uint32_t val){
+		size_t offset = pos - data;
+		reserve(sz+n);
+		memmove(data + offset + n, data + offset, (sz - offset) * sizeof(uint32_t));
+		for(size_t i = offset; i < offset + n; ++i){
+			data[i] = val;
+		}
+		sz += n;
+		return;
+	}
+	
+	//!Erase integers in range [first,last)
+	void bitset_storage::erase(uint32_t* first, uint32_t* last){
+		memmove(first, last, (data + sz - last) * sizeof(uint32_t));
+		sz -= last - first;
+		return;
+	}
+	
 		
 	dynamic_bitset::dynamic_bitset(size_t sz): current_size(sz){
+		if (sz == 0){
+			num_ints = 0;
+			buffer = 0;
+			return;
+		}
 		num_ints = ((sz-1)/32)+1;
 		buffer = (num_ints*32) - sz;
 		array.resize(num_ints);
@@ -107,6 +196,11 @@ namespace StochHMM {
 	//! If size is smaller than bitset, those values will get deleted
 	//! If size is larger than bitset, it will get extended.
 	void dynamic_bitset::resize(size_t sz){
+		if (sz == 0){
+			clear();
+			return;
+		}
+		
 		size_t new_num_ints = ((sz-1)/32)+1;
 		
 		if (num_ints == new_num_ints){
@@ -123,8 +217,7 @@ namespace StochHMM {
 		
 		//Clear bit in buffer
 		//Clear those bits that are outside of the current scope
-		uint32_t mask = (1 << 32 - buffer) - 1;
-		array[num_ints-1] &= mask;
+		_clear_buffer();
 		return;
 	}
 
@@ -187,8 +280,7 @@ namespace StochHMM {
 		}
 		
 		//Clear those bits that are outside of the current scope
-		uint32_t mask = (1 << 32-output.buffer) - 1;
-		output.array[num_ints-1] &= mask;
+		output._clear_buffer();
 		
 		return output;
 	}
@@ -208,8 +300,7 @@ namespace StochHMM {
 	dynamic_bitset& dynamic_bitset::operator&=	(const dynamic_bitset& rhs){
 		
 		if (rhs.current_size != this->current_size){
-			std::cerr << __FUNCTION__ << " called on dynamic_bitsets of different sizes." <<std::endl;
-			exit(2);
+			_size_error(__FUNCTION__);
 		}
 		
 		for(size_t i = 0; i < num_ints; ++i){
@@ -217,29 +308,7 @@ namespace StochHMM {
 		}
 		
 		//Clear those bits that are outside of the current scope
-		uint32_t mask = (1 << 32-buffer) - 1;
-		array[num_ints-1] &= mask;
-		
-		return *this;
-	}
-
-	//! Bitwise OR all the bits with all the bits in the rhs
-	dynamic_bitset& dynamic_bitset::operator|=	(const dynamic_bitset& rhs){
-		
-		if (rhs.current_size != this->current_size){
-			std::cerr << __FUNCTION__ << " called on dynamic_bitsets of different sizes." <<std::endl;
-			exit(2);
-		}
-		
-		
-		for(size_t i = 0; i < num_ints; ++i){
-			array[i] |= rhs.array[i];
-		}
-		
-		
-		//Clear those bits that are outside of the current scope
-		uint32_t mask = (1 << 32-buffer) - 1;
-		array[num_ints-1] &= mask;
+		_clear_buffer();
 		
 		return *this;
 	}
@@ -248,8 +317,7 @@ namespace StochHMM {
 	dynamic_bitset& dynamic_bitset::operator^=	(const dynamic_bitset& rhs){
 		
 		if (rhs.current_size != this->current_size){
-			std::cerr << __FUNCTION__ << " called on dynamic_bitsets of different sizes." <<std::endl;
-			exit(2);
+			_size_error(__FUNCTION__);
 		}
 		
 		for(size_t i = 0; i < num_ints; ++i){
@@ -258,8 +326,7 @@ namespace StochHMM {
 		
 		
 		//Clear those bits that are outside of the current scope
-		uint32_t mask = (1 << 32-buffer) - 1;
-		array[num_ints-1] &= mask;
+		_clear_buffer();
 		
 		return *this;
 	}
@@ -323,8 +390,7 @@ namespace StochHMM {
 			}
 			
 			//Clear those bits that are outside of the current scope (bits in buffer region)
-			uint32_t mask = (1 << 32-buffer) - 1;
-			array[num_ints-1] &= mask;
+			_clear_buffer();
 		}
 		
 		return *this;
@@ -568,16 +634,6 @@ namespace StochHMM {
 
 
 
-	//!Get state of bit at position
-	//!No initial range check
-	//!\returns true if set 1
-	//!\returns false if not set 0
-	bool dynamic_bitset::operator[](size_t pos)const{
-		size_t intIter = pos/32;
-		size_t bitIter = pos - (intIter*32);
-		return array[intIter] & (1 << bitIter);
-	}
-
 	dynamic_bitset::bit_ref dynamic_bitset::operator[](size_t pos){
 		size_t intIter = pos/32;
 		size_t bitIter = pos - (intIter*32);
@@ -680,11 +736,6 @@ namespace StochHMM {
 		return;
 	}
 
-	//!Resets all the bits to zero
-	void dynamic_bitset::reset(){
-		array.assign(num_ints, 0);
-	}
-
 	//!Clears the bit as position
 	void dynamic_bitset::reset(size_t pos){
 		unset(pos);
@@ -790,63 +841,11 @@ namespace StochHMM {
 	//!\return Returns the position within the bitset with first set bit
 	//\ref http://bits.stephan-brumme.com/lowestBitSet.html
 	size_t dynamic_bitset::find_first(size_t pos) const {
-		
-		static const size_t MultiplyDeBruijnBitPosition[32] =
-		{
-			// precomputed lookup table
-			0,  1, 28,  2, 29, 14, 24,  3, 30, 22, 20, 15, 25, 17,  4,  8,
-			31, 27, 13, 23, 21, 19, 16,  7, 26, 12, 18,  6, 11,  5, 10,  9
-		};
-		
-		if (pos > current_size){
-			return SIZE_MAX;
-		}
-		
-		//Deal with partial integer upto next integer boundary
-		//Find Current interger
-		size_t iter = pos/32;
-		
-		//Position within the integer to start
-		size_t int_pos = pos%32;
-		
-		int32_t val = array[iter];
-		
-		//Mask bits before the position
-		val = val & ~((1 << int_pos) - 1);
-		
-		if (val !=0){
-			// leave only lowest bit
-			val  &= -int(val);
-			// DeBruijn constant
-			val  *= 0x077CB531;
-			// get upper 5 bits
-			val >>= 27;
-			// convert to actual position
-			
-			return iter * 32 +  MultiplyDeBruijnBitPosition[val];
+		if (pos == 0){
+			return find_first();
 		}
 		
-		//Deal with everything from integer boundary onward
-		//http://bits.stephan-brumme.com/lowestBitSet.html
-		for(size_t i = iter+1; i < num_ints ; ++i){
-			if (array[i] == 0){
-				continue;
-			}
-			else{
-				uint32_t val = array[i];
-				
-				// leave only lowest bit
-				val  &= -int(val);
-				// DeBruijn constant
-				val  *= 0x077CB531;
-				// get upper 5 bits
-				val >>= 27;
-				// convert to actual position
-				
-				return i * 32 + MultiplyDeBruijnBitPosition[val];
-			}
-		}
-		return SIZE_MAX;
+		return find_next(pos-1);
 	}
 
 
@@ -1087,6 +1086,13 @@ namespace StochHMM {
 	}
 
 
+	//!Reports that a bitwise operation was called on bitsets of different sizes
+	void dynamic_bitset::_size_error(const char* function) const{
+		std::cerr << function << " called on dynamic_bitsets of different sizes." <<std::endl;
+		exit(2);
+	}
+
+
 	dynamic_bitset::bit_ref& dynamic_bitset::bit_ref::operator=(bool value){
 		//if true then set the bit at position
 		if (value){
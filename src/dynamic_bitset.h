@@ -14,9 +14,51 @@
 #include <math.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include "bitwise_ops.h"
 
+//Number of 32 bit integers stored inside the bitset before it allocates memory
+//on the heap.  If not set in makefile then will use default 4 (128 bits).
+#ifndef BITSET_INLINE_INTS
+#define BITSET_INLINE_INTS 4
+#endif
+
 namespace StochHMM {
+	
+	//!\class bitset_storage
+	//! Storage of the 32 bit integers used by the dynamic_bitset
+	//! Small bitsets (up to BITSET_INLINE_INTS integers) are stored inline without
+	//! allocating any memory.  Larger bitsets are stored on the heap.
+	//! Provides the subset of std::vector<uint32_t> used by dynamic_bitset
+	class bitset_storage{
+	public:
+		bitset_storage():data(local),sz(0),cap(BITSET_INLINE_INTS){}
+		bitset_storage(const bitset_storage&);
+		~bitset_storage(){if (data != local){delete[] data;}}
+		
+		bitset_storage& operator=(const bitset_storage&);
+		
+		inline uint32_t& operator[](size_t iter){return data[iter];}
+		inline const uint32_t& operator[](size_t iter) const {return data[iter];}
+		
+		inline uint32_t* begin(){return data;}
+		inline size_t size() const {return sz;}
+		
+		void reserve(size_t);
+		void resize(size_t);
+		void assign(size_t, uint32_t);
+		void push_back(uint32_t);
+		void insert(uint32_t* pos, size_t n, uint32_t val);
+		void erase(uint32_t* first, uint32_t* last);
+		inline void clear(){sz=0;}
+		
+	private:
+		uint32_t* data;
+		size_t sz;
+		size_t cap;
+		uint32_t local[BITSET_INLINE_INTS];
+	};
+	
 
 	//!\class dynamic_bitset
 	//! A dynamic bitset class
@@ -67,7 +109,9 @@ namespace StochHMM {
 			size_t pos;
 		};
 		
-		bool operator[](size_t pos) const;
+		//!Get state of bit at position
+		//!No initial range check
+		inline bool operator[](size_t pos) const {return (array[pos >> 5] >> (pos & 31)) & 1;}
 		bit_ref operator[](size_t pos);
 		
 		dynamic_bitset  operator&	(const dynamic_bitset& rhs);
@@ -77,7 +121,18 @@ namespace StochHMM {
 		
 		dynamic_bitset& operator=	(const dynamic_bitset& rhs);
 		dynamic_bitset& operator&=	(const dynamic_bitset& rhs);
-		dynamic_bitset& operator|=	(const dynamic_bitset& rhs);
+		
+		//! Bitwise OR all the bits with all the bits in the rhs
+		inline dynamic_bitset& operator|=	(const dynamic_bitset& rhs){
+			if (rhs.current_size != current_size){
+				_size_error(__FUNCTION__);
+			}
+			for(size_t i = 0; i < num_ints; ++i){
+				array[i] |= rhs.array[i];
+			}
+			return *this;
+		}
+		
 		dynamic_bitset& operator^=	(const dynamic_bitset& rhs);
 		dynamic_bitset& operator-=	(const dynamic_bitset& rhs);
 		dynamic_bitset& operator<<=	(size_t n);
@@ -110,7 +165,12 @@ namespace StochHMM {
 		void flip();
 		void flip(size_t pos);
 		
-		void reset();
+		//!Resets all the bits to zero
+		inline void reset(){
+			for(size_t i = 0; i < num_ints; ++i){
+				array[i] = 0;
+			}
+		}
 		void reset(size_t pos);
 		
 		bool any();
@@ -123,6 +183,27 @@ namespace StochHMM {
 		size_t find_first() const;
 		size_t find_first(size_t pos) const;
 		
+		//!Find the next set bit after position pos
+		//!Used to iterate over the set bits:
+		//! for(size_t i = bs.find_first(); i != SIZE_MAX; i = bs.find_next(i))
+		//!\return position of next set bit or SIZE_MAX if there are none
+		inline size_t find_next(size_t pos) const{
+			++pos;
+			if (pos >= current_size){
+				return SIZE_MAX;
+			}
+			
+			size_t iter = pos >> 5;
+			uint32_t val = array[iter] & (0xFFFFFFFFu << (pos & 31));
+			while (val == 0){
+				if (++iter >= num_ints){
+					return SIZE_MAX;
+				}
+				val = array[iter];
+			}
+			return (iter << 5) + _lowest_bit(val);
+		}
+		
 		size_t find_last() const;
 		size_t find_last(size_t pos) const;
 		
@@ -138,7 +219,25 @@ namespace StochHMM {
 		size_t current_size;
 		size_t num_ints;
 		//uint32_t* array;
-		std::vector<uint32_t> array;
+		bitset_storage array;
+		
+		//!Clear those bits that are outside of the current scope (bits in buffer region)
+		inline void _clear_buffer(){
+			if (buffer != 0 && num_ints != 0){
+				array[num_ints-1] &= (1u << (32 - buffer)) - 1;
+			}
+		}
+		
+		//!Position of the lowest set bit in a non-zero integer
+		static inline size_t _lowest_bit(uint32_t val){
+#if defined(__GNUC__)
+			return __builtin_ctz(val);
+#else
+			return lowestBitSet(val);
+#endif
+		}
+		
+		void _size_error(const char* function) const;
 		
 	};
 
@@ -0,0 +1,306 @@
+//
+//  emissionTiles.cpp
+//  StochHMM
+//
+//  Copyright (c) 2013 Korf Lab, Genome Center, UC Davis, Davis, CA. All rights reserved.
+//
+
+#include "emissionTiles.h"
+#include "trellis.h"
+
+namespace StochHMM{
+
+	//!Create tiles filled by worker threads
+	//!\param threads Number of worker threads
+	//!\param tile Number of positions in a tile
+	emissionTiles::emissionTiles(size_t threads, size_t tile){
+		hmm = NULL;
+		seqs = NULL;
+		states = 0;
+		length = 0;
+		tile_size = (tile == 0) ? 1 : tile;
+		tile_count = 0;
+		this->threads = (threads == 0) ? 1 : threads;
+		first = 0;
+		tile_length = 0;
+		values = NULL;
+		current = 0;
+		backward = false;
+		running = false;
+		has_serial = false;
+		stats = NULL;
+
+		//Workers fill up to two tiles each ahead of the algorithm, and the
+		//last tile read is kept for algorithms that read the previous position
+		slots.resize(2 * this->threads + 2);
+
+		pthread_mutex_init(&lock, NULL);
+		pthread_mutex_init(&serial_lock, NULL);
+		pthread_cond_init(&produced, NULL);
+		pthread_cond_init(&wanted, NULL);
+	}
+
+
+	emissionTiles::~emissionTiles(){
+		stop();
+		pthread_cond_destroy(&wanted);
+		pthread_cond_destroy(&produced);
+		pthread_mutex_destroy(&serial_lock);
+		pthread_mutex_destroy(&lock);
+	}
+
+
+	//!Start filling the tiles of a sequence
+	//!\param h Model
+	//!\param sqs Sequences
+	//!\param len Length of the sequences
+	//!\param forward Whether the algorithm starts at the first position (otherwise the last)
+	//!\param st Statistics the emissions are counted in (NULL if not collected)
+	void emissionTiles::start(model* h, sequences* sqs, size_t len, bool forward, trellisStats* st){
+		stop();
+
+		hmm = h;
+		seqs = sqs;
+		states = hmm->state_size();
+		length = len;
+		tile_count = (length + tile_size - 1) / tile_size;
+		stats = st;
+
+		first = 0;
+		tile_length = 0;
+		values = NULL;
+		current = (forward || tile_count == 0) ? 0 : tile_count - 1;
+		backward = !forward;
+
+		for(size_t i = 0; i < slots.size(); ++i){
+			slots[i].tile = SIZE_MAX;
+			slots[i].ready = false;
+			slots[i].busy = false;
+			slots[i].values.resize(tile_size * states);
+		}
+
+		serial.assign(states, false);
+		has_serial = false;
+		for(size_t i = 0; i < states; ++i){
+			if (!threadSafe(hmm->getState(i))){
+				serial[i] = true;
+				has_serial = true;
+			}
+		}
+
+		//Emission and transition functions are passed the undigitized
+		//sequences, which are created the first time they are requested.
+		//Create them before the workers start, so a worker and the algorithm
+		//never both create one.
+		bool functions = has_serial || hmm->getInitial()->hasComplexTransition();
+		for(size_t i = 0; !functions && i < states; ++i){
+			functions = hmm->getState(i)->hasComplexTransition();
+		}
+
+		if (functions){
+			for(size_t i = 0; i < seqs->size(); ++i){
+				sequence* sq = seqs->getSeq(i);
+				if (sq != NULL){
+					sq->getUndigitized();
+				}
+			}
+		}
+
+		worker_stats.assign(threads, trellisStats());
+		params.resize(threads);
+		workers.resize(threads);
+		running = true;
+
+		for(size_t i = 0; i < threads; ++i){
+			params[i].tiles = this;
+			params[i].worker = i;
+			if (pthread_create(&workers[i], NULL, _thread_start, &params[i]) != 0){
+				std::cerr << "Unable to create emission thread" << std::endl;
+				exit(2);
+			}
+		}
+	}
+
+
+	//!Stop the workers and add their statistics
+	void emissionTiles::stop(){
+		if (!running){
+			return;
+		}
+
+		pthread_mutex_lock(&lock);
+		running = false;
+		pthread_cond_broadcast(&wanted);
+		pthread_mutex_unlock(&lock);
+
+		for(size_t i = 0; i < workers.size(); ++i){
+			pthread_join(workers[i], NULL);
+		}
+
+		if (stats != NULL){
+			for(size_t i = 0; i < worker_stats.size(); ++i){
+				stats->add(worker_stats[i]);
+			}
+		}
+
+		tile_length = 0;
+		values = NULL;
+	}
+
+
+	//!Can the emissions of a state be calculated by several threads at once
+	//!Multivariate continuous emissions share a buffer and user functions may
+	//!not be thread-safe.
+	bool emissionTiles::threadSafe(state* st){
+		for(size_t j = 0; j < st->getEmissionSize(); ++j){
+			emm* em = st->getEmission(j);
+			if (em->isFunction() || em->isMultiContinuous() || em->getExtFunction() != NULL){
+				return false;
+			}
+		}
+		return true;
+	}
+
+
+	void* emissionTiles::_thread_start(void* ptr){
+		workerParam* param = static_cast<workerParam*>(ptr);
+		param->tiles->_work(param->worker);
+		return NULL;
+	}
+
+
+	//!Fill tiles until the tiles are stopped
+	void emissionTiles::_work(size_t worker){
+		trellisStats* st = (stats != NULL) ? &worker_stats[worker] : NULL;
+		size_t tile(0);
+		size_t index(0);
+
+		pthread_mutex_lock(&lock);
+		while(true){
+			while(running && !_claim(tile, index)){
+				pthread_cond_wait(&wanted, &lock);
+			}
+
+			if (!running){
+				break;
+			}
+			pthread_mutex_unlock(&lock);
+
+			//Slot can't be claimed by other workers while it's busy
+			_fill(tile, slots[index].values, st);
+
+			pthread_mutex_lock(&lock);
+			slots[index].busy = false;
+			slots[index].ready = true;
+			pthread_cond_broadcast(&produced);
+			pthread_cond_broadcast(&wanted);
+		}
+		pthread_mutex_unlock(&lock);
+	}
+
+
+	//!Claim the next tile ahead of the algorithm that isn't filled
+	//!Must be called with the lock held
+	//!\param[out] tile Tile to fill
+	//!\param[out] index Slot to fill it in
+	//!\return false if all the tiles ahead are filled or being filled
+	bool emissionTiles::_claim(size_t& tile, size_t& index){
+		for(size_t k = 0; k + 1 < slots.size(); ++k){
+			if (backward && k > current){
+				return false;
+			}
+
+			size_t next = (backward) ? current - k : current + k;
+			if (next >= tile_count){
+				return false;
+			}
+
+			slot& sl = slots[next % slots.size()];
+			if (sl.tile == next || sl.busy){
+				continue;
+			}
+
+			sl.tile = next;
+			sl.ready = false;
+			sl.busy = true;
+			tile = next;
+			index = next % slots.size();
+			return true;
+		}
+		return false;
+	}
+
+
+	//!Calculate the emissions of every state at the positions of a tile
+	void emissionTiles::_fill(size_t tile, std::vector<double>& buffer, trellisStats* st){
+		size_t begin = tile * tile_size;
+		size_t end = (begin + tile_size < length) ? begin + tile_size : length;
+
+		for(size_t position = begin; position < end; ++position){
+			double* column = &buffer[(position - begin) * states];
+			for(size_t i = 0; i < states; ++i){
+				if (serial[i]){
+					continue;
+				}
+#ifndef STOCHHMM_NO_STATS
+				if (st != NULL){
+					column[i] = trellis::_counted_emission(hmm->getState(i), *seqs, position, st);
+					continue;
+				}
+#endif
+				column[i] = hmm->getState(i)->get_emission_prob(*seqs, position);
+			}
+		}
+
+		if (!has_serial){
+			return;
+		}
+
+		pthread_mutex_lock(&serial_lock);
+		for(size_t position = begin; position < end; ++position){
+			double* column = &buffer[(position - begin) * states];
+			for(size_t i = 0; i < states; ++i){
+				if (!serial[i]){
+					continue;
+				}
+#ifndef STOCHHMM_NO_STATS
+				if (st != NULL){
+					column[i] = trellis::_counted_emission(hmm->getState(i), *seqs, position, st);
+					continue;
+				}
+#endif
+				column[i] = hmm->getState(i)->get_emission_prob(*seqs, position);
+			}
+		}
+		pthread_mutex_unlock(&serial_lock);
+	}
+
+
+	//!Move to the tile of a position, waiting for the workers to fill it
+	void emissionTiles::_advance(size_t position){
+		if (position >= length){
+			std::cerr << "Emission position " << position << " is past the end of the sequence" << std::endl;
+			exit(2);
+		}
+
+		size_t tile = position / tile_size;
+		slot& sl = slots[tile % slots.size()];
+
+		pthread_mutex_lock(&lock);
+		if (tile != current){
+			backward = tile < current;
+			current = tile;
+			pthread_cond_broadcast(&wanted);
+		}
+
+		while(!(sl.tile == tile && sl.ready)){
+			pthread_cond_wait(&produced, &lock);
+		}
+		pthread_mutex_unlock(&lock);
+
+		first = tile * tile_size;
+		tile_length = (first + tile_size < length) ? tile_size : length - first;
+		values = &sl.values[0];
+	}
+
+}
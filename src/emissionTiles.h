@@ -0,0 +1,122 @@
+//
+//  emissionTiles.h
+//  StochHMM
+//
+//  Copyright (c) 2013 Korf Lab, Genome Center, UC Davis, Davis, CA. All rights reserved.
+//
+
+#ifndef __StochHMM__emissionTiles__
+#define __StochHMM__emissionTiles__
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "hmm.h"
+#include "sequences.h"
+#include "trellisStats.h"
+
+namespace StochHMM{
+
+	/*! \class emissionTiles
+	 *	\brief Calculates the emissions of every state ahead of a trellis
+	 *	algorithm in tiles of positions, using worker threads
+	 *
+	 *	Emissions don't depend on the other positions, so worker threads fill
+	 *	tiles of positions (position by state) while the algorithm calculates the
+	 *	recurrence from the tiles that are ready.  Workers fill the tiles ahead
+	 *	of the tile the algorithm is reading in the direction it's moving, so
+	 *	forward and backward algorithms are both prefetched.  The algorithm only
+	 *	waits when it reaches a tile that isn't filled yet.
+	 *
+	 *	Multivariate continuous, function and external emissions may not be
+	 *	thread-safe, so those states are calculated by one worker at a time.
+	 *	Lexical, real number and continuous emissions are calculated by all
+	 *	the workers at once.
+	 */
+	class emissionTiles{
+	public:
+		emissionTiles(size_t threads, size_t tile);
+		~emissionTiles();
+
+		void start(model* h, sequences* sqs, size_t length, bool forward, trellisStats* st);
+		void stop();
+
+		//!Get the emission of a state at a position
+		//!Waits for the tile of the position if it isn't filled yet
+		inline double get(size_t st, size_t position){
+			if (position - first >= tile_length){
+				_advance(position);
+			}
+			return values[(position - first) * states + st];
+		}
+
+		//!Get the number of worker threads
+		inline size_t getThreads(){return threads;}
+
+		//!Get the number of positions in a tile
+		inline size_t getTileSize(){return tile_size;}
+
+		static bool threadSafe(state* st);
+
+		//!Memory used by the tiles
+		inline size_t bytes(){return slots.size() * tile_size * states * sizeof(double);}
+
+	private:
+		model* hmm;
+		sequences* seqs;
+		size_t states;
+		size_t length;
+		size_t tile_size;
+		size_t tile_count;
+		size_t threads;
+
+		//Tile read by the algorithm
+		size_t first;			//First position of the tile
+		size_t tile_length;		//Positions in the tile (0 if none)
+		double* values;
+
+		//Shared with the workers (guarded by lock)
+		size_t current;			//Tile read by the algorithm
+		bool backward;			//Algorithm is moving towards the start
+		bool running;
+
+		//!Tile buffer.  Tile i is always filled in slot i % slots.size().
+		struct slot{
+			size_t tile;		//Tile that is filled or being filled (SIZE_MAX if none)
+			bool ready;
+			bool busy;			//A worker is filling the slot
+			std::vector<double> values;
+		};
+		std::vector<slot> slots;
+
+		std::vector<bool> serial;	//States calculated by one worker at a time
+		bool has_serial;
+
+		trellisStats* stats;
+		std::vector<trellisStats> worker_stats;
+
+		pthread_mutex_t lock;
+		pthread_mutex_t serial_lock;
+		pthread_cond_t produced;
+		pthread_cond_t wanted;
+		std::vector<pthread_t> workers;
+
+		struct workerParam{
+			emissionTiles* tiles;
+			size_t worker;
+		};
+		std::vector<workerParam> params;
+
+		static void* _thread_start(void*);
+		void _work(size_t worker);
+		bool _claim(size_t& tile, size_t& index);
+		void _fill(size_t tile, std::vector<double>& buffer, trellisStats* st);
+		void _advance(size_t position);
+	};
+
+}
+
+#endif /* defined(__StochHMM__emissionTiles__) */
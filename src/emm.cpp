@@ -66,7 +66,8 @@ namespace StochHMM{
     //!\param trks Tracks used by the model
     //!\param wts Weights used by the model
     //!\param funcs State functions used by the model
-    bool emm::parse(std::string& txt,tracks& trks, weights* wts, StateFuncs* funcs){
+    //!\param defer_tables Leave the emission table to be set from a compiled model
+    bool emm::parse(std::string& txt,tracks& trks, weights* wts, StateFuncs* funcs, bool defer_tables){
         if (!_processTags(txt,trks, wts, funcs)){
             return false;
         }
@@ -412,7 +413,7 @@ namespace StochHMM{
                 return false;
             }
 			
-			scores.initialize_emission_table();
+			scores.initialize_emission_table(defer_tables);
 			
         }
         
@@ -66,7 +66,7 @@ namespace StochHMM{
 		friend class model;
 		
 		//MUTATORS
-		bool parse(std::string&, tracks&, weights*, StateFuncs* );
+		bool parse(std::string&, tracks&, weights*, StateFuncs*, bool defer_tables = false);
 		bool parse(std::string& txt,track* trk);
 		
 		//!Set the emission to a Real Number
@@ -107,6 +107,30 @@ namespace StochHMM{
 			return false;
 		}
 		
+		//!Check to see if emission is scored by a continuous univariate distribution
+		inline bool isContinuous(){return continuous;}
+		
+		//!Check to see if emission is scored by a multivariate distribution
+		inline bool isMultiContinuous(){return multi_continuous;}
+		
+		//!Check to see if emission is scored by a lexical function
+		inline bool isFunction(){return function;}
+		
+		//!Get the track of a real number or continuous emission
+		inline track* getRealTrack(){return realTrack;}
+		
+		//!Get the name of the continuous distribution
+		inline std::string& getPDFName(){return pdfName;}
+		
+		//!Get the parameters of the continuous distribution
+		inline std::vector<double>* getPDFParameters(){return dist_parameters;}
+		
+		//!Check to see if emission is scored from the lexical table
+		inline bool isLexical(){
+			if (!real_number && !continuous && !multi_continuous && !function){return true;}
+			return false;
+		}
+		
 	private:
 		
 		//size_t track_size;
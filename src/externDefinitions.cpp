@@ -179,7 +179,7 @@ namespace StochHMM{
     //! Parses the ExDefSequence from a file stream
     //! \param file File stream to be used to parse the External definitions from
     //! \return true if parsing was successful
-    bool ExDefSequence::parse(std::ifstream& file,stateInfo& info){
+    bool ExDefSequence::parse(std::istream& file,stateInfo& info){
         //use getDefs to parse the lines
         //and create external definition
         
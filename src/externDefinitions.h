@@ -72,7 +72,7 @@ namespace StochHMM{
         
         friend class sequences;
         
-        bool parse(std::ifstream&,stateInfo&);
+        bool parse(std::istream&,stateInfo&);
         
         //bool getExDef(std::ifstream&,model*);
         
@@ -0,0 +1,330 @@
+//
+//  fastaIndex.cpp
+//  StochHMM
+//
+//  Copyright (c) 2013 Korf Lab, Genome Center, UC Davis, Davis, CA. All rights reserved.
+//
+
+#include "fastaIndex.h"
+
+namespace StochHMM{
+
+	//!Parse a number with optional commas (1,000,000)
+	//!\return false if the string isn't a number
+	static bool _parseCoordinate(const std::string& str, size_t& value){
+		std::string digits;
+		for(size_t i = 0; i < str.size(); ++i){
+			if (str[i] == ','){
+				continue;
+			}
+			else if (str[i] < '0' || str[i] > '9'){
+				return false;
+			}
+			digits += str[i];
+		}
+
+		if (digits.empty()){
+			return false;
+		}
+
+		value = strtoull(digits.c_str(), NULL, 10);
+		return true;
+	}
+
+
+	//!Parse a region in samtools format (name, name:start or name:start-end)
+	//!Start and end are one-based and inclusive; they are converted to
+	//!zero-based half-open coordinates
+	//!\param str Region string
+	//!\param[out] region Parsed region
+	//!\return true if the region was valid
+	bool parseRegion(const std::string& str, seqRegion& region){
+		region.name = str;
+		region.start = 0;
+		region.end = SIZE_MAX;
+
+		if (str.empty()){
+			return false;
+		}
+
+		//Names may contain ':' so only use it if followed by coordinates
+		size_t colon = str.rfind(':');
+		if (colon == std::string::npos || colon == 0){
+			return true;
+		}
+
+		std::string coords = str.substr(colon + 1);
+		size_t dash = coords.find('-');
+		size_t start;
+		size_t end = SIZE_MAX;
+
+		if (!_parseCoordinate(coords.substr(0, dash), start)){
+			return true;
+		}
+
+		if (dash != std::string::npos && !_parseCoordinate(coords.substr(dash + 1), end)){
+			return true;
+		}
+
+		if (start == 0 || end < start){
+			std::cerr << "Invalid region: " << str << std::endl;
+			return false;
+		}
+
+		region.name = str.substr(0, colon);
+		region.start = start - 1;
+		region.end = end;
+		return true;
+	}
+
+
+	//!Get the regions to decode
+	//!If regions is a file, each line is a region in samtools format or a
+	//!tab-delimited BED line (zero-based, half-open).  Otherwise it is parsed
+	//!as a single region.
+	//!\param regions Region or filename of region list
+	//!\param[out] list Regions
+	//!\return true if all the regions were valid
+	bool loadRegions(const std::string& regions, std::vector<seqRegion>& list){
+		std::ifstream file(regions.c_str());
+
+		if (!file.is_open()){
+			seqRegion region;
+			if (!parseRegion(regions, region)){
+				return false;
+			}
+			list.push_back(region);
+			return true;
+		}
+
+		std::string line;
+		while(getline(file, line)){
+			if (!line.empty() && line[line.size()-1] == '\r'){
+				line.erase(line.size()-1);
+			}
+
+			if (line.empty() || line[0] == '#'){
+				continue;
+			}
+
+			seqRegion region;
+			size_t tab = line.find('\t');
+
+			if (tab != std::string::npos){
+				size_t tab2 = line.find('\t', tab + 1);
+				region.name = line.substr(0, tab);
+				if (tab2 == std::string::npos ||
+					!_parseCoordinate(line.substr(tab + 1, tab2 - tab - 1), region.start) ||
+					!_parseCoordinate(line.substr(tab2 + 1, line.find('\t', tab2 + 1) - tab2 - 1), region.end) ||
+					region.end <= region.start){
+					std::cerr << "Invalid BED region: " << line << std::endl;
+					return false;
+				}
+			}
+			else if (!parseRegion(line, region)){
+				return false;
+			}
+
+			list.push_back(region);
+		}
+
+		return true;
+	}
+
+
+	//!Load the index for a FASTA file
+	//!Reads fasta_file.fai if it exists, otherwise the index is built and
+	//!written to fasta_file.fai
+	//!\param fasta_file Name of the FASTA file
+	//!\param file Opened FASTA file
+	//!\return true if the index was loaded or built
+	bool fastaIndex::load(const std::string& fasta_file, seqReader& file){
+		if (file.is_compressed()){
+			std::cerr << "Indexed access requires an uncompressed FASTA file: " << fasta_file << std::endl;
+			return false;
+		}
+
+		std::string index_file = fasta_file + ".fai";
+
+		//Rebuild the index if it doesn't match the file
+		if (read(index_file) && (records.empty() || records.back().length == 0 ||
+			file.getRange(position(records.back(), records.back().length - 1), 1) != NULL)){
+			return true;
+		}
+
+		if (!build(file)){
+			return false;
+		}
+
+		//Index is still usable if it can't be written
+		write(index_file);
+		return true;
+	}
+
+
+	//!Build the index by scanning the FASTA file
+	//!Every line of a sequence except the last must have the same length
+	//!\param file Opened FASTA file
+	//!\return true if the file could be indexed
+	bool fastaIndex::build(seqReader& file){
+		records.clear();
+		names.clear();
+
+		const char* line(NULL);
+		size_t length(0);
+		bool short_line(false);
+		file.seek(0);
+
+		while(file.peek() != EOF){
+			size_t start = file.tell();
+			if (!file.getLine(line, length)){
+				std::cerr << "Unable to read the FASTA file to index it" << std::endl;
+				return false;
+			}
+			size_t width = file.tell() - start;
+
+			if (length > 0 && line[0] == '>'){
+				faiRecord rec;
+				size_t name_end = 1;
+				while(name_end < length && line[name_end] != ' ' && line[name_end] != '\t'){
+					++name_end;
+				}
+				rec.name.assign(line + 1, name_end - 1);
+				rec.length = 0;
+				rec.offset = file.tell();
+				rec.line_bases = 0;
+				rec.line_width = 0;
+				records.push_back(rec);
+				short_line = false;
+				continue;
+			}
+
+			if (length == 0){
+				short_line = true;
+				continue;
+			}
+
+			if (records.empty()){
+				std::cerr << "Can't index file without a FASTA header \">\"" << std::endl;
+				return false;
+			}
+
+			faiRecord& rec = records.back();
+			bool last_line = (file.peek() == EOF);
+
+			if (rec.line_bases == 0){
+				rec.line_bases = length;
+				rec.line_width = width;
+			}
+			else if (short_line || length > rec.line_bases ||
+					 (!last_line && width - length != rec.line_width - rec.line_bases)){
+				std::cerr << "Can't index sequence with different line lengths: " << rec.name << std::endl;
+				return false;
+			}
+
+			if (length < rec.line_bases){
+				short_line = true;
+			}
+
+			rec.length += length;
+		}
+
+		file.seek(0);
+		_index();
+		return true;
+	}
+
+
+	//!Read a .fai index file
+	//!\return true if the index file was read
+	bool fastaIndex::read(const std::string& filename){
+		records.clear();
+		names.clear();
+
+		std::ifstream file(filename.c_str());
+		if (!file.is_open()){
+			return false;
+		}
+
+		std::string line;
+		while(getline(file, line)){
+			if (line.empty()){
+				continue;
+			}
+
+			faiRecord rec;
+			size_t tab = line.find('\t');
+			if (tab == std::string::npos){
+				std::cerr << "Index file " << filename << " is truncated or invalid" << std::endl;
+				records.clear();
+				return false;
+			}
+			rec.name = line.substr(0, tab);
+
+			//All four fields must be present
+			const char* fields = line.c_str() + tab;
+			size_t* values[] = {&rec.length, &rec.offset, &rec.line_bases, &rec.line_width};
+			bool valid(true);
+			for(size_t i = 0; i < 4 && valid; ++i){
+				char* end(NULL);
+				*values[i] = strtoull(fields, &end, 10);
+				valid = (end != fields);
+				fields = end;
+			}
+
+			if (!valid || (rec.line_bases == 0 && rec.length > 0) || rec.line_width < rec.line_bases){
+				std::cerr << "Index file " << filename << " is truncated or invalid" << std::endl;
+				records.clear();
+				return false;
+			}
+			records.push_back(rec);
+		}
+
+		_index();
+		return true;
+	}
+
+
+	//!Write the index in .fai format
+	//!\return true if the index file was written
+	bool fastaIndex::write(const std::string& filename){
+		std::ofstream file(filename.c_str());
+		if (!file.is_open()){
+			return false;
+		}
+
+		for(size_t i = 0; i < records.size(); ++i){
+			file << records[i].name << "\t" << records[i].length << "\t" << records[i].offset << "\t"
+			<< records[i].line_bases << "\t" << records[i].line_width << "\n";
+		}
+
+		return file.good();
+	}
+
+
+	//!Find a record by name
+	//!\param name Name of the sequence
+	//!\param occurrence Which record to return if the name is used more than once
+	//!\return NULL if the record doesn't exist
+	const faiRecord* fastaIndex::find(const std::string& name, size_t occurrence){
+		std::pair<std::multimap<std::string, size_t>::iterator, std::multimap<std::string, size_t>::iterator> range = names.equal_range(name);
+
+		for(std::multimap<std::string, size_t>::iterator it = range.first; it != range.second; ++it){
+			if (occurrence == 0){
+				return &records[it->second];
+			}
+			--occurrence;
+		}
+
+		return NULL;
+	}
+
+
+	void fastaIndex::_index(){
+		names.clear();
+		for(size_t i = 0; i < records.size(); ++i){
+			names.insert(std::make_pair(records[i].name, i));
+		}
+	}
+
+}
@@ -0,0 +1,88 @@
+//
+//  fastaIndex.h
+//  StochHMM
+//
+//  Copyright (c) 2013 Korf Lab, Genome Center, UC Davis, Davis, CA. All rights reserved.
+//
+
+#ifndef __StochHMM__fastaIndex__
+#define __StochHMM__fastaIndex__
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <stdlib.h>
+#include <stdint.h>
+#include "seqReader.h"
+
+namespace StochHMM{
+
+	//!\struct faiRecord
+	//!Entry of a FASTA index (.fai) file
+	struct faiRecord{
+		std::string name;	//Sequence name (header up to first whitespace)
+		size_t length;		//Number of symbols in the sequence
+		size_t offset;		//Byte offset of the first symbol
+		size_t line_bases;	//Symbols per line
+		size_t line_width;	//Bytes per line (including newline)
+	};
+
+
+	//!\struct seqRegion
+	//!Interval of a named sequence.  Coordinates are zero-based and half-open.
+	struct seqRegion{
+		std::string name;
+		size_t start;
+		size_t end;		//SIZE_MAX for the end of the sequence
+	};
+
+	bool parseRegion(const std::string&, seqRegion&);
+	bool loadRegions(const std::string&, std::vector<seqRegion>&);
+
+
+	/*! \class fastaIndex
+	 *	\brief Random access index of a FASTA file
+	 *
+	 *	Uses the samtools .fai format.  If the index file doesn't exist it is
+	 *	built by scanning the FASTA file and written next to it.  The index
+	 *	gives the byte offset of any position, so a region can be read without
+	 *	reading the rest of the file.
+	 *
+	 *	The same name may occur more than once (multiple tracks per file), so
+	 *	records are found by name and occurrence.
+	 */
+	class fastaIndex{
+	public:
+		bool load(const std::string& fasta_file, seqReader& file);
+		bool build(seqReader& file);
+		bool read(const std::string& filename);
+		bool write(const std::string& filename);
+
+		const faiRecord* find(const std::string& name, size_t occurrence);
+
+		//!Number of records in the index
+		inline size_t size(){return records.size();}
+
+		//!Get the record at index
+		inline faiRecord& operator[](size_t index){return records[index];}
+
+		//!Byte offset of the symbol at position in a record
+		inline static size_t position(const faiRecord& rec, size_t pos){
+			if (rec.line_bases == 0){
+				return rec.offset;
+			}
+			return rec.offset + (pos / rec.line_bases) * rec.line_width + pos % rec.line_bases;
+		}
+
+	private:
+		std::vector<faiRecord> records;
+		std::multimap<std::string, size_t> names;
+
+		void _index();
+	};
+
+}
+
+#endif /* defined(__StochHMM__fastaIndex__) */
@@ -42,6 +42,8 @@ namespace StochHMM {
 	}
 	
 	void trellis::simple_forward(){
+		TRELLIS_PHASE("simple_forward");
+		trellisTiles tile_scope(this, true);
 		
 //		if (!hmm->isBasic()){
 //			std::cerr << "Model isn't a simple/basic HMM.  Use complex algorithms\n";
@@ -57,114 +59,35 @@ namespace StochHMM {
 			exit(2);
 		}
 		
-        std::bitset<STATE_MAX> next_states;
-        std::bitset<STATE_MAX> current_states;
+		dynamic_bitset next_states(state_size);
+		dynamic_bitset current_states(state_size);
 		
-        double  forward_temp(-INFINITY);
-        double  emission(-INFINITY);
-        bool	exDef_position(false);
-        
-        state* init = hmm->getInitial();
+		double  forward_temp(-INFINITY);
 		
-		std::bitset<STATE_MAX>* initial_to = hmm->getInitialTo();
-		std::bitset<STATE_MAX>* from_trans(NULL);
-		
-		
-		//		std::cout << "Position: 0" << std::endl;
-        //Calculate Viterbi from transitions from INIT (initial) state
-        for(size_t st = 0; st < state_size; ++st){
-            if ((*initial_to)[st]){  //if the bitset is set (meaning there is a transition to this state), calculate the viterbi
-				
-				forward_temp = (*hmm)[st]->get_emission_prob(*seqs,0) + getTransition(init, st, 0);
-                
-				if (forward_temp > -INFINITY){
-                    
-					(*forward_score)[0][st] = forward_temp;
-					(*scoring_current)[st] = forward_temp;
-					next_states |= (*(*hmm)[st]->getTo());
-                }
-            }
-        }
-        
-        
-        for(size_t position = 1; position < seq_size ; ++position ){
-            
-            
-			//Swap current and previous viterbi scores
-            scoring_previous->assign(state_size,-INFINITY);
-            swap_ptr = scoring_previous;
-			scoring_previous = scoring_current;
-			scoring_current = swap_ptr;
-			
+		for(size_t position = 0; position < seq_size ; ++position ){
+			_stream_forward_position(position, position, current_states, next_states);
+			_count_cells(scoring_current);
 			
-			//Swap current_states and next states sets
-			current_states.reset();
-            current_states |= next_states;
-            next_states.reset();
-            
-            if (exDef_defined){
-                exDef_position = seqs->exDefDefined(position);
-            }
-			
-			//			std::cout << "\nPosition: " << position << std::endl;
-            
-            for (size_t st_current = 0; st_current < state_size; ++st_current){ //i is current state that emits value
-                if (!current_states[st_current]){
-                    continue;
-                }
-                
-                emission = (*hmm)[st_current]->get_emission_prob(*seqs, position);
-				
-				if (exDef_defined && exDef_position){
-                    emission += seqs->getWeight(position, st_current);
-                }
-                
-				from_trans = (*hmm)[st_current]->getFrom();
-				
-                for (size_t previous = 0; previous < state_size ; ++previous) {  //j is previous state
-                    if (!(*from_trans)[previous]){
-                        continue;
-                    }
-					
-					if ((*scoring_previous)[previous] != -INFINITY){
-                        forward_temp = (*scoring_previous)[previous] + emission + getTransition((*hmm)[previous], st_current , position);
-						
-						if ((*scoring_current)[st_current] == -INFINITY){
-							(*scoring_current)[st_current] = forward_temp;
-							(*forward_score)[position][st_current] = forward_temp;
-						}
-						else{
-							(*scoring_current)[st_current] = addLog(forward_temp, (*scoring_current)[st_current]);
-							(*forward_score)[position][st_current] = (*scoring_current)[st_current];						}
-						
-						next_states |= (*(*hmm)[st_current]->getTo());
-                    }
-                }
-				//				std::cout << "State: " << current <<"\t" << exp((*forward_score)[position][current]) << std::endl;
-            }
+			for(size_t st = 0; st < state_size; ++st){
+				(*forward_score)[position][st] = (*scoring_current)[st];
+			}
 		}
 		
-        //Swap current and previous scores
-        scoring_previous->assign(state_size,-INFINITY);
-        swap_ptr = scoring_previous;
-        scoring_previous = scoring_current;
-        scoring_current = swap_ptr;
-		
-        ending_forward_prob = -INFINITY;
-        for(size_t st_previous = 0; st_previous < state_size ;++st_previous){
-            if ((*scoring_previous)[st_previous] != -INFINITY){
-                forward_temp = (*scoring_previous)[st_previous] + (*hmm)[st_previous]->getEndTrans();
-                
-                if (forward_temp > -INFINITY){
+		ending_forward_prob = -INFINITY;
+		for(size_t st_previous = 0; st_previous < state_size ;++st_previous){
+			if ((*scoring_current)[st_previous] != -INFINITY){
+				forward_temp = (*scoring_current)[st_previous] + (*hmm)[st_previous]->getEndTrans();
+				
+				if (forward_temp > -INFINITY){
 					if (ending_forward_prob == -INFINITY){
 						ending_forward_prob = forward_temp;
 					}
 					else{
 						ending_forward_prob = addLog(ending_forward_prob,forward_temp);
 					}
-                }
-            }
-        }
+				}
+			}
+		}
 		
 		delete scoring_previous;
 		delete scoring_current;
@@ -175,6 +98,8 @@ namespace StochHMM {
 	
 	
 	void trellis::naive_forward(){
+		TRELLIS_PHASE("naive_forward");
+		trellisTiles tile_scope(this, true);
 		dbl_forward_score = new (std::nothrow) double_2D(seq_size, std::vector<double>(state_size,-INFINITY));
 		
 		if (dbl_forward_score == NULL){
@@ -193,7 +118,7 @@ namespace StochHMM {
 		
 		//Calculate from Initial states
 		for(size_t st = 0; st < state_size; ++st){
-			forward_temp = (*hmm)[st]->get_emission_prob(*seqs,0) +  getTransition(init, st, 0);
+			forward_temp = _emission(st, 0) +  getTransition(init, st, 0);
 			(*dbl_forward_score)[0][st]=forward_temp;
 		}
 		
@@ -201,7 +126,7 @@ namespace StochHMM {
 		for (size_t position = 1 ; position < seq_size ; ++position){
 			for (size_t st_current = 0; st_current < state_size; ++st_current){
 				//Calc emissions
-				emission = (*hmm)[st_current]->get_emission_prob(*seqs, position);
+				emission = _emission(st_current, position);
 				
 				if (exDef_defined && exDef_position){
 					emission += seqs->getWeight(position, st_current);
@@ -260,8 +185,8 @@ namespace StochHMM {
 //			exit(2);
 //		}
 //		
-//        std::bitset<STATE_MAX> next_states;
-//        std::bitset<STATE_MAX> current_states;
+//        dynamic_bitset next_states(state_size);
+//        dynamic_bitset current_states(state_size);
 //		
 //        double  forward_temp(-INFINITY);
 //        double  emission(-INFINITY);
@@ -269,8 +194,8 @@ namespace StochHMM {
 //        
 //        state* init = hmm->getInitial();
 //		
-//		std::bitset<STATE_MAX>* initial_to = hmm->getInitialTo();
-//		std::bitset<STATE_MAX>* from_trans(NULL);
+//		dynamic_bitset* initial_to = hmm->getInitialTo();
+//		dynamic_bitset* from_trans(NULL);
 //		
 //		
 //		//		std::cout << "Position: 0" << std::endl;
@@ -360,5 +285,303 @@ namespace StochHMM {
 	
 	
 
+	void trellis::beam_forward(model* h, sequences* sqs){
+		hmm = h;
+		seqs = sqs;
+		seq_size		= seqs->getLength();
+		state_size		= hmm->state_size();
+		exDef_defined	= seqs->exDefDefined();
+		
+		beam_forward();
+	}
+	
+	
+	//!Forward algorithm with beam pruning
+	//!Only the states that are active (within the beam) in the previous column
+	//!are extended.  Pruned cells are left as -INFINITY in the forward table, so
+	//!the forward probability is a lower bound of the full forward probability.
+	//!The number of pruned cells is stored in pruned_cells.
+	void trellis::beam_forward(){
+		if (!hmm->isBasic()){
+			std::cerr << "Model isn't a simple/basic HMM.  Use complex algorithms\n";
+			return;
+		}
+		
+		TRELLIS_PHASE("beam_forward");
+		
+		if (forward_score != NULL){
+			delete forward_score;
+		}
+		
+		forward_score	= new (std::nothrow) float_2D(seq_size, std::vector<float>(state_size,-INFINITY));
+		scoring_current = new (std::nothrow) std::vector<double> (state_size,-INFINITY);
+		scoring_previous= new (std::nothrow) std::vector<double> (state_size,-INFINITY);
+		
+		if (scoring_current == NULL || scoring_previous == NULL || forward_score == NULL){
+			std::cerr << "Can't allocate forward score table. OUT OF MEMORY" << std::endl;
+			exit(2);
+		}
+		
+		std::vector<std::vector<size_t> > to_states;
+		_get_to_states(to_states);
+		
+		std::vector<size_t> active_previous;
+		std::vector<size_t> active_current;
+		std::vector<size_t> reached;
+		std::vector<double> emissions(state_size,-INFINITY);
+		std::vector<bool>	touched(state_size,false);
+		
+		double  forward_temp(-INFINITY);
+		double  emission(-INFINITY);
+		bool	exDef_position(false);
+		pruned_cells = 0;
+		
+		state* init = hmm->getInitial();
+		dynamic_bitset* initial_to = hmm->getInitialTo();
+		
+		//Calculate Forward from transitions from INIT (initial) state
+		for(size_t st = initial_to->find_first(); st != SIZE_MAX; st = initial_to->find_next(st)){
+			forward_temp = _emission(st, 0) + getTransition(init, st, 0);
+			
+			if (forward_temp > -INFINITY){
+				(*scoring_current)[st] = forward_temp;
+				active_current.push_back(st);
+			}
+		}
+		
+		_beam_prune(active_current, *scoring_current);
+		_count_cells(scoring_current);
+		for(size_t i = 0; i < active_current.size(); ++i){
+			(*forward_score)[0][active_current[i]] = (*scoring_current)[active_current[i]];
+		}
+		
+		for(size_t position = 1; position < seq_size ; ++position ){
+			
+			//Swap current and previous forward scores
+			scoring_previous->assign(state_size,-INFINITY);
+			swap_ptr = scoring_previous;
+			scoring_previous = scoring_current;
+			scoring_current = swap_ptr;
+			
+			active_previous.swap(active_current);
+			active_current.clear();
+			
+			if (exDef_defined){
+				exDef_position = seqs->exDefDefined(position);
+			}
+			
+			//Extend each active state to the states it transitions to
+			for(size_t i = 0; i < active_previous.size(); ++i){
+				size_t st_previous = active_previous[i];
+				std::vector<size_t>& to = to_states[st_previous];
+				
+				for(size_t j = 0; j < to.size(); ++j){
+					size_t st_current = to[j];
+					
+					//Get emission of current state the first time it is reached
+					if (!touched[st_current]){
+						touched[st_current] = true;
+						reached.push_back(st_current);
+						emission = _emission(st_current, position);
+						
+						if (exDef_defined && exDef_position){
+							emission += seqs->getWeight(position, st_current);
+						}
+						
+						emissions[st_current] = emission;
+					}
+					
+					if (emissions[st_current] == -INFINITY){
+						continue;
+					}
+					
+					forward_temp = (*scoring_previous)[st_previous] + emissions[st_current] + getTransition((*hmm)[st_previous], st_current , position);
+					
+					if ((*scoring_current)[st_current] == -INFINITY){
+						(*scoring_current)[st_current] = forward_temp;
+					}
+					else{
+						(*scoring_current)[st_current] = addLog(forward_temp, (*scoring_current)[st_current]);
+					}
+				}
+			}
+			
+			//Reset reached states and keep the states with a valid score
+			for(size_t i = 0; i < reached.size(); ++i){
+				touched[reached[i]] = false;
+				if ((*scoring_current)[reached[i]] != -INFINITY){
+					active_current.push_back(reached[i]);
+				}
+			}
+			reached.clear();
+			
+			_beam_prune(active_current, *scoring_current);
+			_count_cells(scoring_current);
+			
+			for(size_t i = 0; i < active_current.size(); ++i){
+				(*forward_score)[position][active_current[i]] = (*scoring_current)[active_current[i]];
+			}
+		}
+		
+		ending_forward_prob = -INFINITY;
+		for(size_t i = 0; i < active_current.size(); ++i){
+			size_t st_previous = active_current[i];
+			forward_temp = (*scoring_current)[st_previous] + (*hmm)[st_previous]->getEndTrans();
+			
+			if (forward_temp > -INFINITY){
+				if (ending_forward_prob == -INFINITY){
+					ending_forward_prob = forward_temp;
+				}
+				else{
+					ending_forward_prob = addLog(ending_forward_prob,forward_temp);
+				}
+			}
+		}
+		
+		delete scoring_previous;
+		delete scoring_current;
+		scoring_previous = NULL;
+		scoring_current = NULL;
+	}
+	
+	
+	//!Forward algorithm on a windowed sequence source
+	//!Only the forward probability of the sequence is calculated
+	//!(getForwardProbability), so the memory used doesn't depend on the
+	//!length of the sequence.
+	//! \param h Model (basic models only)
+	//! \param window Window of the next sequence (opened with seqWindow::next)
+	void trellis::stream_forward(model* h, seqWindow* window){
+		hmm = h;
+		seqs = window->getSeqs();
+		state_size		= hmm->state_size();
+		exDef_defined	= false;
+		seq_size		= 0;
+		ending_forward_prob = -INFINITY;
+		
+		if (!hmm->isBasic()){
+			std::cerr << "Model isn't a simple/basic HMM.  Windowed decoding requires a basic model\n";
+			return;
+		}
+		
+		TRELLIS_PHASE("stream_forward");
+		
+		scoring_current = new (std::nothrow) std::vector<double> (state_size,-INFINITY);
+		scoring_previous= new (std::nothrow) std::vector<double> (state_size,-INFINITY);
+		
+		if (scoring_current == NULL || scoring_previous == NULL){
+			std::cerr << "Can't allocate forward scores. OUT OF MEMORY" << std::endl;
+			exit(2);
+		}
+		
+		dynamic_bitset next_states(state_size);
+		dynamic_bitset current_states(state_size);
+		
+		size_t position(0);
+		while(window->fill()){
+			size_t start = window->getStart();
+			size_t end = start + window->size();
+			
+			for(; position < end; ++position){
+				_stream_forward_position(position, position - start, current_states, next_states);
+				_count_cells(scoring_current);
+			}
+		}
+		seq_size = position;
+		
+		double forward_temp;
+		for(size_t st_previous = 0; seq_size > 0 && st_previous < state_size ;++st_previous){
+			if ((*scoring_current)[st_previous] != -INFINITY){
+				forward_temp = (*scoring_current)[st_previous] + (*hmm)[st_previous]->getEndTrans();
+				
+				if (forward_temp > -INFINITY){
+					if (ending_forward_prob == -INFINITY){
+						ending_forward_prob = forward_temp;
+					}
+					else{
+						ending_forward_prob = addLog(ending_forward_prob,forward_temp);
+					}
+				}
+			}
+		}
+		
+		delete scoring_previous;
+		delete scoring_current;
+		scoring_previous = NULL;
+		scoring_current = NULL;
+	}
+	
+	
+	//!Calculate the forward scores of one position into scoring_current from
+	//!the scores of the previous position.  Used by the forward algorithms of
+	//!whole sequences (relative == position) and of windows.
+	//! \param position Position in the sequence
+	//! \param relative Position in the window
+	//! \param current_states States that can emit at the position
+	//! \param next_states States that can emit at the next position
+	void trellis::_stream_forward_position(size_t position, size_t relative, dynamic_bitset& current_states, dynamic_bitset& next_states){
+		double  forward_temp(-INFINITY);
+		double  emission(-INFINITY);
+		
+		if (position == 0){
+			state* init = hmm->getInitial();
+			dynamic_bitset* initial_to = hmm->getInitialTo();
+			
+			for(size_t st = initial_to->find_first(); st != SIZE_MAX; st = initial_to->find_next(st)){
+				forward_temp = _emission(st, relative) + getTransition(init, st, relative);
+				
+				if (forward_temp > -INFINITY){
+					(*scoring_current)[st] = forward_temp;
+					next_states |= (*(*hmm)[st]->getTo());
+				}
+			}
+			return;
+		}
+		
+		//Swap current and previous scores
+		scoring_previous->assign(state_size,-INFINITY);
+		swap_ptr = scoring_previous;
+		scoring_previous = scoring_current;
+		scoring_current = swap_ptr;
+		
+		current_states.reset();
+		current_states |= next_states;
+		next_states.reset();
+		
+		bool exDef_position = exDef_defined && seqs->exDefDefined(position);
+		dynamic_bitset* from_trans(NULL);
+		
+		for (size_t st_current = current_states.find_first(); st_current != SIZE_MAX; st_current = current_states.find_next(st_current)){
+			
+			emission = _emission(st_current, relative);
+			
+			if (exDef_position){
+				emission += seqs->getWeight(position, st_current);
+			}
+			
+			if (emission == -INFINITY){
+				continue;
+			}
+			
+			from_trans = (*hmm)[st_current]->getFrom();
+			
+			for (size_t previous = from_trans->find_first(); previous != SIZE_MAX; previous = from_trans->find_next(previous)){
+				
+				if ((*scoring_previous)[previous] != -INFINITY){
+					forward_temp = (*scoring_previous)[previous] + emission + getTransition((*hmm)[previous], st_current , relative);
+					
+					if ((*scoring_current)[st_current] == -INFINITY){
+						(*scoring_current)[st_current] = forward_temp;
+					}
+					else{
+						(*scoring_current)[st_current] = addLog(forward_temp, (*scoring_current)[st_current]);
+					}
+					
+					next_states |= (*(*hmm)[st_current]->getTo());
+				}
+			}
+		}
+	}
+	
 }
 
@@ -62,8 +62,8 @@ namespace StochHMM {
 //			exit(2);
 //		}
 //		
-//        std::bitset<STATE_MAX> next_states;
-//        std::bitset<STATE_MAX> current_states;
+//        dynamic_bitset next_states(state_size);
+//        dynamic_bitset current_states(state_size);
 //		
 //        double  forward_temp(-INFINITY);
 //		double  viterbi_temp(-INFINITY);
@@ -72,8 +72,8 @@ namespace StochHMM {
 //        
 //        state* init = hmm->getInitial();
 //		
-//		std::bitset<STATE_MAX>* initial_to = hmm->getInitialTo();
-//		std::bitset<STATE_MAX>* from_trans(NULL);
+//		dynamic_bitset* initial_to = hmm->getInitialTo();
+//		dynamic_bitset* from_trans(NULL);
 //		
 //		
 //        //Calculate Viterbi and Forward from transitions from INIT (initial) state
@@ -242,8 +242,8 @@ namespace StochHMM {
 	//			exit(2);
 	//		}
 	//
-	//        std::bitset<STATE_MAX> next_states;
-	//        std::bitset<STATE_MAX> current_states;
+	//        dynamic_bitset next_states(state_size);
+	//        dynamic_bitset current_states(state_size);
 	//
 	//
 	//
@@ -252,8 +252,8 @@ namespace StochHMM {
 	//        bool	exDef_position(false);
 	//
 	//		state* init = hmm->getInitial();
-	//		std::bitset<STATE_MAX>* initial_to = hmm->getInitialTo();
-	//		std::bitset<STATE_MAX>* from_trans(NULL);
+	//		dynamic_bitset* initial_to = hmm->getInitialTo();
+	//		dynamic_bitset* from_trans(NULL);
 	//
 	//
 	//		//		std::cout << "Position: 0" << std::endl;
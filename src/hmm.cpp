@@ -24,8 +24,16 @@
 //IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
 //CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "hmm.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 namespace StochHMM{
 	
+	static const char COMPILED_MAGIC[8] = {'S','T','O','C','H','M','D','L'};
+	static const uint32_t COMPILED_VERSION = 1;
+	static const size_t COMPILED_HEADER_SIZE = 32;
+	
     
     //! Import multiple models
     //! \param modelFile Path to multiple model file
@@ -164,6 +172,8 @@ namespace StochHMM{
         finalized=false;
         basicModel=true;
 		attribTwo=false;
+		external_definitions=false;
+		keep_source=false;
 
         initial						= NULL;
         scaling						= NULL;
@@ -198,7 +208,11 @@ namespace StochHMM{
     //!Import the model file and parse it
     //! \param modelFile Model filename
     //! \param funcs  Pointer to State functions defined by programmer
+    //! Compiled models (see compile()) are detected and imported with importCompiled()
     bool model::import(std::string& modelFile, StateFuncs* funcs){
+        if (isCompiled(modelFile)){
+            return importCompiled(modelFile, funcs);
+        }
         std::string modelString=slurpFile(modelFile);
         return parse(modelString,funcs,NULL,NULL);
     }
@@ -210,6 +224,9 @@ namespace StochHMM{
     }
     
     bool model::import(std::string& modelFile){
+        if (isCompiled(modelFile)){
+            return importCompiled(modelFile, NULL);
+        }
         std::string modelString=slurpFile(modelFile);
         return parse(modelString,NULL,NULL,NULL);
     }
@@ -229,14 +246,202 @@ namespace StochHMM{
         return parse(modelString,NULL,NULL,NULL);
     }
 	
+	
+	//!Write the model to a compiled model file
+	//!The compiled model stores the model text and the final emission tables
+	//!of the lexical emissions, which include the scores of words with
+	//!ambiguous characters.  Importing a compiled model doesn't need to compute
+	//!these scores, which is most of the import time of high order models with
+	//!ambiguous characters.
+	//!
+	//!Layout (native byte order, sections 8-byte aligned):
+	//! - Header: magic "STOCHMDL", uint32 version, uint32 number of tables,
+	//!   uint64 length of the model text, uint64 reserved
+	//! - Model text
+	//! - Tables: uint64 number of values and the double values of each table
+	//!\param filename Name of the compiled model file
+	//!\return true if the file was written
+	bool model::compile(const std::string& filename){
+		if (!keep_source || source.empty() || external_definitions){
+			std::cerr << "Only models imported from a model file without external templates or weights, with keepSource(true) set before import, can be compiled" << std::endl;
+			return false;
+		}
+		
+		std::vector<lexicalTable*> tables;
+		_lexicalTables(tables);
+		
+		std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+		if (!out.is_open()){
+			std::cerr << "Can't create compiled model: " << filename << std::endl;
+			return false;
+		}
+		
+		char header[COMPILED_HEADER_SIZE];
+		memset(header, 0, COMPILED_HEADER_SIZE);
+		uint32_t values[2] = {COMPILED_VERSION, (uint32_t) tables.size()};
+		uint64_t length = source.size();
+		memcpy(header, COMPILED_MAGIC, 8);
+		memcpy(header + 8, values, sizeof(values));
+		memcpy(header + 16, &length, sizeof(length));
+		out.write(header, COMPILED_HEADER_SIZE);
+		
+		//Model text padded to 8 bytes
+		static const char zeros[8] = {0,0,0,0,0,0,0,0};
+		out.write(source.data(), source.size());
+		out.write(zeros, ((source.size() + 7) & ~((size_t) 7)) - source.size());
+		
+		for(size_t i = 0; i < tables.size(); ++i){
+			std::vector<double>* table = tables[i]->getEmissionTable();
+			uint64_t count = table->size();
+			out.write((const char*) &count, sizeof(count));
+			if (count > 0){
+				out.write((const char*) &(*table)[0], count * sizeof(double));
+			}
+		}
+		
+		return out.good();
+	}
+	
+	
+	//!Import a model file written by compile()
+	//!The file is memory-mapped, the model text is parsed and the emission
+	//!tables are copied from the file instead of being computed.
+	//!\param filename Name of the compiled model file
+	//!\param funcs Pointer to State functions used by the model
+	//!\return true if import was successful
+	bool model::importCompiled(const std::string& filename, StateFuncs* funcs){
+		int fd = ::open(filename.c_str(), O_RDONLY);
+		if (fd < 0){
+			std::cerr << "Can't open compiled model: " << filename << std::endl;
+			return false;
+		}
+		
+		struct stat st;
+		if (fstat(fd, &st) != 0 || (size_t) st.st_size < COMPILED_HEADER_SIZE){
+			std::cerr << "Invalid compiled model: " << filename << std::endl;
+			::close(fd);
+			return false;
+		}
+		
+		size_t data_size = st.st_size;
+		void* map = mmap(NULL, data_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		
+		if (map == MAP_FAILED){
+			std::cerr << "Can't map compiled model: " << filename << std::endl;
+			return false;
+		}
+		
+		const char* data = (const char*) map;
+		uint32_t values[2];
+		uint64_t length;
+		memcpy(values, data + 8, sizeof(values));
+		memcpy(&length, data + 16, sizeof(length));
+		
+		if (memcmp(data, COMPILED_MAGIC, 8) != 0 || values[0] != COMPILED_VERSION || length > data_size - COMPILED_HEADER_SIZE){
+			std::cerr << "Invalid compiled model or version: " << filename << std::endl;
+			munmap(map, data_size);
+			return false;
+		}
+		
+		std::string text(data + COMPILED_HEADER_SIZE, length);
+		
+		bool parsed = parse(text, funcs, NULL, NULL, true);
+		
+		if (!parsed){
+			munmap(map, data_size);
+			return false;
+		}
+		
+		//Set the emission tables in the same order they were written
+		std::vector<lexicalTable*> tables;
+		_lexicalTables(tables);
+		
+		bool valid = (tables.size() == values[1]);
+		size_t position = (COMPILED_HEADER_SIZE + length + 7) & ~((size_t) 7);
+		for(size_t i = 0; valid && i < tables.size(); ++i){
+			uint64_t count;
+			if (position + sizeof(count) > data_size){
+				valid = false;
+				break;
+			}
+			memcpy(&count, data + position, sizeof(count));
+			position += sizeof(count);
+			
+			if (count > (data_size - position) / sizeof(double)){
+				valid = false;
+				break;
+			}
+			valid = tables[i]->setEmissionTable((const double*) (data + position), count);
+			position += count * sizeof(double);
+		}
+		
+		munmap(map, data_size);
+		
+		if (!valid){
+			std::cerr << "Emission tables of compiled model don't match the model: " << filename << std::endl;
+			return false;
+		}
+		
+		return true;
+	}
+	
+	
+	//!Check to see if the file starts with the compiled model magic number
+	bool model::isCompiled(const std::string& filename){
+		std::ifstream file(filename.c_str(), std::ios::binary);
+		char magic[8];
+		if (!file.read(magic, 8)){
+			return false;
+		}
+		return memcmp(magic, COMPILED_MAGIC, 8) == 0;
+	}
+	
+	
+	//!Get the lexical tables with initialized emission tables
+	//!Emissions and lexical transitions of each state are visited in the order
+	//!of the states, so the order is the same each time the model is parsed.
+	void model::_lexicalTables(std::vector<lexicalTable*>& tables){
+		std::vector<state*> all_states;
+		if (initial != NULL){
+			all_states.push_back(initial);
+		}
+		all_states.insert(all_states.end(), states.begin(), states.end());
+		
+		for(size_t i = 0; i < all_states.size(); ++i){
+			state* st = all_states[i];
+			
+			for(size_t j = 0; j < st->getEmissionSize(); ++j){
+				lexicalTable* table = st->getEmission(j)->getTables();
+				if (table->getEmissionTable() != NULL){
+					tables.push_back(table);
+				}
+			}
+			
+			std::vector<transition*>* trans = st->getTransitions();
+			for(size_t j = 0; trans != NULL && j < trans->size(); ++j){
+				transition* tr = (*trans)[j];
+				if (tr != NULL && tr->getTransitionType() == LEXICAL && tr->getTables()->getEmissionTable() != NULL){
+					tables.push_back(tr->getTables());
+				}
+			}
+		}
+	}
+	
     //!Parses text model file
     //!Splits the model into sections that are then parsed by the individiual classes
     //!parse() functions.
-    bool model::parse(const std::string& model, StateFuncs* funcs, templates* tmpls, weights* scl ){
+    //! \param defer_tables Leave the lexical tables to be set from a compiled model
+    bool model::parse(const std::string& model, StateFuncs* funcs, templates* tmpls, weights* scl, bool defer_tables){
         
         templatedStates=tmpls;
         scaling=scl;
 		
+		if (keep_source){
+			source = model;
+		}
+		external_definitions = (tmpls != NULL || scl != NULL);
+		
         //std::cout << model <<std::endl;
         
         size_t header = model.find("MODEL INFORMATION");
@@ -422,7 +627,7 @@ namespace StochHMM{
             }
             
             std::string stateTxt= model.substr(blank,nlChar-blank);
-            if (!_parseStates(stateTxt,funcs)){
+            if (!_parseStates(stateTxt,funcs,defer_tables)){
                 return false;
             }
             
@@ -685,7 +890,7 @@ namespace StochHMM{
         return true;
     }
     
-    bool model::_parseStates(std::string& txt, StateFuncs* funcs){
+    bool model::_parseStates(std::string& txt, StateFuncs* funcs, bool defer_tables){
         //1. split sections and identify any template sections
         //2. get state names list
         //3. create and parse states
@@ -705,7 +910,7 @@ namespace StochHMM{
                 exit(1);
             }
             
-            if (!st->parse(stats[iter],NameList,trcks,scaling, funcs)){
+            if (!st->parse(stats[iter],NameList,trcks,scaling, funcs, defer_tables)){
                 delete st;
                 return false;
             }
@@ -792,7 +997,6 @@ namespace StochHMM{
         clear_whitespace(lst[0], " \n");
         stringList nmid;
         nmid.splitString(lst[0],":\t");
-        nmid.print();
         
         //Extracting TEMPLATE NAME
         if (nmid.contains("TEMPLATE")){
@@ -834,6 +1038,9 @@ namespace StochHMM{
         
         //Get filled out model template
         std::string filledTemplate = templatedStates->getTemplate(templateName, templateIdentifier, parameters);
+        if (filledTemplate.empty()){
+            return false;
+        }
         
         //Split filled out template into individual states
         stringList sts;
@@ -843,6 +1050,12 @@ namespace StochHMM{
             return false;
         }
         
+        //Return the templated states instead of the lines of the definition
+        lst.clear();
+        for(size_t i=0;i<sts.size();i++){
+            lst.push_back(sts[i]);
+        }
+        
         return true;
     }
     
@@ -903,6 +1116,19 @@ namespace StochHMM{
 			
             
             
+			//Traceback tables store the state index as int16_t
+			if (states.size() > INT16_MAX){
+				std::cerr << "Model has " << states.size() << " states.  Maximum number of states is " << INT16_MAX << std::endl;
+				exit(2);
+			}
+			
+            //Size the state sets to the number of states in the model
+			for(size_t i=0;i<states.size();i++){
+				states[i]->setStateSetSize(states.size());
+			}
+			initial->setStateSetSize(states.size());
+			ending->setStateSetSize(states.size());
+			
             //Add states To and From transition
             
             for(size_t i=0;i<states.size();i++){
@@ -1149,7 +1375,7 @@ namespace StochHMM{
 //            gv << "\tsize=\"8,5\"\n";
 //            gv << "\tnode [shape = circle];\n";
 //            
-////            std::bitset<STATE_MAX>* temp;
+////            dynamic_bitset* temp;
 ////            
 ////            if (q0){
 ////                temp=initial->getTo();
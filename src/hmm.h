@@ -157,7 +157,7 @@ namespace StochHMM{
 		}
 		
 		//!Get vector of states that state at index transitions to
-		inline std::bitset<STATE_MAX>* getStateXTo(size_t iter){
+		inline dynamic_bitset* getStateXTo(size_t iter){
 			if (iter>= states.size()){
 				return NULL;
 			}
@@ -165,10 +165,10 @@ namespace StochHMM{
 		}
 		
 		//!Get vector of states that the initial state transitions to
-		inline std::bitset<STATE_MAX>* getInitialTo(){return &(initial->to);}
+		inline dynamic_bitset* getInitialTo(){return &(initial->to);}
 		
 		//!Get vector of states that transfer to the state at index
-		inline std::bitset<STATE_MAX>* getStateXFrom(size_t iter){
+		inline dynamic_bitset* getStateXFrom(size_t iter){
 			if (iter>= states.size()){
 				return NULL;
 			}
@@ -176,7 +176,7 @@ namespace StochHMM{
 		}
 		
 		//!Get list of states that transition to the ending state
-		inline std::bitset<STATE_MAX>* getEndingFrom(){return &(ending->from);}
+		inline dynamic_bitset* getEndingFrom(){return &(ending->from);}
 		
 		inline stateInfo* getStateInfo(){return &info;}
 		
@@ -294,11 +294,24 @@ namespace StochHMM{
 		
 		//!Parse the model from std::string
 		//!This is used by import functions to parse the model
-		bool parse(const std::string&, StateFuncs*, templates*, weights*);
+		//!The lexical tables are left empty if defer_tables is set (compiled models)
+		bool parse(const std::string&, StateFuncs*, templates*, weights*, bool defer_tables = false);
 		
 		//!Parse the model from std::string
 		bool parse(std::string&,std::string&);
 		
+		//!Keep the model text when the model is parsed, so it can be compiled
+		inline void keepSource(bool keep){keep_source = keep;}
+		
+		//!Write the model to a compiled model file
+		bool compile(const std::string&);
+		
+		//!Import a model file written by compile()
+		bool importCompiled(const std::string&, StateFuncs*);
+		
+		//!Check to see if the file is a compiled model
+		static bool isCompiled(const std::string&);
+		
 		
 		//--------------  Set Model Data
 		
@@ -404,13 +417,17 @@ namespace StochHMM{
 		std::vector<bool>* complex_transition_states;	//! States that have functions associated with transitions
 		std::vector<bool>* complex_emission_states;		//! States that have functions associated with emissions
 		
+		std::string source;			//! Model text that was parsed (only kept to compile the model)
+		bool keep_source;			//! Keep the model text when the model is parsed
+		bool external_definitions;	//! Model was parsed with templates or weights that aren't in the text
+		
 		bool _parseHeader(std::string&);	//! Function to parse header of the model from text file
 		bool _parseTracks(std::string&);	//! Parse Tracks definitions from text file
 		bool _parseAmbiguous(std::string&);	//! Parse Ambiguous definitions from text file
 		bool _parseScaling(std::string&);	//! Parse Scaling definitions from text file
 		bool _parseTemplates(std::string&);	//! Parse Templated States definitions from text file
 		
-		bool _parseStates(std::string&,StateFuncs*); //!Parse state from text file
+		bool _parseStates(std::string&,StateFuncs*,bool); //!Parse state from text file
 		bool _splitStates(std::string&,stringList&); //!Split the state definitions into individual states from text file
 		bool _getOrderedStateNames(stringList&,stringList&); //! Gets list of states names from model
 		bool _processTemplateState(std::string&, stringList&); //! Adds templated states to using template
@@ -428,6 +445,7 @@ namespace StochHMM{
 		void checkBasicModel();	//!Checks to see if the model has basic transitions and emissions(no addtl functions)
 		void checkExplicitDurationStates();  //!Checks to see which states are explicit duration states
 		void _checkTopology(state* st, std::vector<uint16_t>& visited); //!Checks to see that all states are connected and there
+		void _lexicalTables(std::vector<lexicalTable*>&); //!Gets the initialized lexical tables of the states in a fixed order
 			
 		
 	};
@@ -152,6 +152,78 @@ namespace StochHMM{
     }
     
     
+	//!Get the row (word) and column (emitted character) of the counts table
+	//!that correspond to the sequences at the position
+	//!\param seqs Sequences
+	//!\param pos Position in the sequences
+	//!\param[out] word_index Row of the counts table
+	//!\param[out] char_index Column of the counts table
+	//!\return false if the position is within the first order positions or contains an ambiguous character
+	bool lexicalTable::getCountIndex(sequences& seqs, size_t pos, size_t& word_index, size_t& char_index){
+		if (max_order>pos){
+			return false;
+		}
+		
+		word_index = 0;
+		char_index = 0;
+		
+		size_t dim(0);
+		size_t y_iter(0);
+		for(size_t i=0;i<number_of_tracks;++i){
+			for(size_t j=0;j<=order[i];++j){
+				uint8_t letter = seqs[subarray_sequence[dim]][pos - subarray_position[dim]];
+				if (letter > max_unambiguous[i]){
+					return false;
+				}
+				
+				if (j<order[i]){
+					word_index += letter * y_subarray[y_iter];
+					y_iter++;
+				}
+				else{
+					char_index += letter * x_subarray[i];
+				}
+				dim++;
+			}
+		}
+		
+		return true;
+	}
+	
+	
+	//!Re-estimate the probability tables from the counts table
+	//!Each row of the counts table is normalized to give the probabilities
+	//!Rows without any counts are left unchanged.
+	void lexicalTable::estimateFromCounts(){
+		if (counts == NULL || logProb == NULL){
+			return;
+		}
+		
+		for(size_t row=0; row < counts->size() && row < logProb->size(); ++row){
+			double sum(0);
+			for(size_t column=0; column < (*counts)[row].size(); ++column){
+				sum += (*counts)[row][column];
+			}
+			
+			if (sum <= 0){
+				continue;
+			}
+			
+			for(size_t column=0; column < (*counts)[row].size() && column < (*logProb)[row].size(); ++column){
+				(*logProb)[row][column] = log((*counts)[row][column]/sum);
+			}
+		}
+		
+		if (prob != NULL){
+			delete prob;
+			prob = NULL;
+		}
+		
+		update_emission_table();
+		return;
+	}
+	
+	
     //!Add a track to an emission
     //!\param trk Pointer to track
     //!\param orderValue order of emission from track
@@ -850,10 +922,27 @@ namespace StochHMM{
 		return;
 	}
 	
+	void lexicalTable::update_emission_table(){
+		if (log_emission == NULL){
+			initialize_emission_table();
+			return;
+		}
+		
+		if(unknownScoreType == DEFINED_SCORE){
+			log_emission->assign(array_size,unknownDefinedScore);
+		}
+		else{
+			log_emission->assign(array_size,-INFINITY);
+		}
+		
+		std::vector<bool> transferred (array_size,false);
+		transferValues(transferred);
+	}
+	
 	//Todo
 	//Convert table to simpleNtable compatible format
 	//with ambiguous characters
-	void lexicalTable::initialize_emission_table(){
+	void lexicalTable::initialize_emission_table(bool defer_table){
 		if (logProb == NULL){
 			std::cerr << "Cannot initialize emission table until after the tables have been assigned";
 			exit(2);
@@ -865,6 +954,12 @@ namespace StochHMM{
 			max_unambiguous.push_back(trcks[i]->getMaxUnambiguous());
 		}
 		
+		//Table will be assigned by setEmissionTable
+		if (defer_table){
+			log_emission = new std::vector<double>;
+			return;
+		}
+		
 		if(unknownDefinedScore == DEFINED_SCORE){
 			log_emission = new std::vector<double> (array_size,unknownDefinedScore);
 		}
@@ -877,6 +972,18 @@ namespace StochHMM{
 		transferValues(transferred);
 	}
 	
+	
+	//!Set the final emission table from precomputed values
+	//!\param values Scores for every word, including ambiguous characters
+	//!\param size Number of values
+	//!\return false if the size doesn't match the dimensions of the table
+	bool lexicalTable::setEmissionTable(const double* values, size_t size){
+		if (log_emission == NULL || size != array_size){
+			return false;
+		}
+		
+		log_emission->assign(values, values + size);
+		return true;
+	}
     
-    
-}
\ No newline at end of file
+}
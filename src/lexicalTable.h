@@ -43,10 +43,24 @@ namespace StochHMM{
 		
 		//!Initialize the final emission table with ambiguous characters
 		//Creates the log_emission simpleTable
-		void initialize_emission_table();
+		//If defer_table is set the table is left empty to be assigned by
+		//setEmissionTable (used when importing a compiled model)
+		void initialize_emission_table(bool defer_table = false);
 		double getReducedOrder(sequences& seqs, size_t position);
 		
 		double getReducedOrder(sequence& seq, size_t position);
+		
+		//!Rebuild the final emission table from the current log probability table
+		//!Used after the log probabilities have been re-estimated
+		void update_emission_table();
+		
+		//!Get the final emission table (including ambiguous characters)
+		//!\return NULL if the table hasn't been initialized
+		inline std::vector<double>* getEmissionTable(){return log_emission;}
+		bool setEmissionTable(const double* values, size_t size);
+		
+		bool getCountIndex(sequences& seqs, size_t pos, size_t& word_index, size_t& char_index);
+		void estimateFromCounts();
                 
         std::vector<std::vector<double> >* getCountsTable();
         std::vector<std::vector<double> >* getProbabilityTable();
@@ -78,6 +92,9 @@ namespace StochHMM{
         inline std::vector<uint8_t>& getOrder(){return order;};
         inline uint8_t getOrder(size_t i){return order[i];}
         
+        //!Get the highest order of the tracks in the emission
+        inline uint8_t getMaxOrder(){return max_order;}
+        
         //! Get Log(prob) emission table
         //! \return std::vector<std::vector<double> >
         inline std::vector<std::vector<double> >& getLogEmm(){return *logProb;}
@@ -0,0 +1,177 @@
+//
+//  modelGenerator.cpp
+//  StochHMM
+//
+//  Copyright (c) 2013 Korf Lab, Genome Center, UC Davis, Davis, CA. All rights reserved.
+//
+
+#include "modelGenerator.h"
+
+namespace StochHMM{
+
+	static const char* STATE_DIVIDER = "##################################\n";
+	static const char* SECTION_DIVIDER = "======================================================\n";
+
+
+	modelGenerator::modelGenerator():states(2),out_degree(0),duration_states(0),max_duration(10),order(0),real_tracks(0),templates(false),self_transition(0.9){
+	}
+
+
+	//!Get the text of the model file
+	std::string modelGenerator::generate(){
+		size_t degree = (out_degree == 0 || out_degree > states) ? states : out_degree;
+
+		std::stringstream model;
+		model << "#STOCHHMM MODEL FILE\n\n";
+		model << "<MODEL INFORMATION>\n" << SECTION_DIVIDER;
+		if (name.empty()){
+			model << "MODEL_NAME:\tSYNTHETIC_" << states << "_" << degree << "_" << order << "\n";
+		}
+		else{
+			model << "MODEL_NAME:\t" << name << "\n";
+		}
+		model << "MODEL_DESCRIPTION:\tSynthetic model\n\n";
+
+		model << "<TRACK SYMBOL DEFINITIONS>\n" << SECTION_DIVIDER;
+		model << "SEQ:\tA,C,G,T\n";
+		for(size_t i = 0; i < real_tracks; ++i){
+			model << "REAL" << i + 1 << ":\tREAL_NUMBER\n";
+		}
+		model << "\n";
+
+		//Template used by states with standard transitions.  The template
+		//section ends at the first blank line, so the template has none.
+		if (templates && duration_states < states){
+			model << "<TEMPLATED STATES>\n" << SECTION_DIVIDER;
+			model << "TEMPLATE: SYNTHETIC_STATE\n";
+			model << "STATE:\n\tNAME:\t((S))\n\tGFF_DESC:\t((S))\n\tPATH_LABEL:\t<<LABEL>>\n";
+			model << "TRANSITION:\tSTANDARD:\tP(X)\n<<TRANSITIONS>>\n\tEND:\t1\n";
+			model << "EMISSION:\tSEQ:\tCOUNTS\n\tORDER:\t" << order << "\n<<COUNTS>>\n";
+			if (real_tracks > 0){
+				model << "<<REAL>>\n";
+			}
+			model << "\n";
+		}
+
+		model << "<STATE DEFINITIONS>\n" << STATE_DIVIDER;
+		model << "STATE:\n\tNAME:\tINIT\n";
+		model << "TRANSITION:\tSTANDARD:\tP(X)\n";
+		for(size_t i = 0; i < states; ++i){
+			model << "\tS" << i << ":\t" << 1.0 / states << "\n";
+		}
+
+		for(size_t i = 0; i < states; ++i){
+			model << STATE_DIVIDER;
+
+			if (templates && i >= duration_states){
+				//Parameter values continue on the following lines, which
+				//lose their leading whitespace
+				model << "STATE:\tTEMPLATE:\tSYNTHETIC_STATE\tIDENTIFIER:\t" << i << "\n";
+				model << "\t<<LABEL>> = " << i << "\n";
+				model << "\t<<TRANSITIONS>> = ";
+				_transitions(model, i, degree, "");
+				model << "\t<<COUNTS>> = ";
+				_counts(model);
+				if (real_tracks > 0){
+					model << "\t<<REAL>> = ";
+					_realEmissions(model);
+				}
+				continue;
+			}
+
+			model << "STATE:\n\tNAME:\tS" << i << "\n";
+			model << "\tGFF_DESC:\tS" << i << "\n";
+			model << "\tPATH_LABEL:\t" << i << "\n";
+
+			if (i < duration_states){
+				_durations(model, i, degree);
+			}
+			else{
+				model << "TRANSITION:\tSTANDARD:\tP(X)\n";
+				_transitions(model, i, degree, "\t");
+				model << "\tEND:\t1\n";
+			}
+
+			model << "EMISSION:\tSEQ:\tCOUNTS\n";
+			model << "\tORDER:\t" << order << "\n";
+			_counts(model);
+			_realEmissions(model);
+		}
+
+		model << STATE_DIVIDER;
+		model << "//END\n";
+		return model.str();
+	}
+
+
+	//!Write the model to a file
+	//!\return false if the file couldn't be written
+	bool modelGenerator::write(const std::string& filename){
+		std::ofstream file(filename.c_str());
+		if (!file.good()){
+			return false;
+		}
+
+		file << generate();
+		return file.good();
+	}
+
+
+	//!Standard transitions of a state to itself and the next degree-1 states
+	void modelGenerator::_transitions(std::stringstream& model, size_t st, size_t degree, const std::string& indent){
+		if (degree == 1){
+			model << indent << "S" << st << ":\t1\n";
+			return;
+		}
+
+		model << indent << "S" << st << ":\t" << self_transition << "\n";
+		for(size_t j = 1; j < degree; ++j){
+			model << "\tS" << (st + j) % states << ":\t" << (1.0 - self_transition) / (degree - 1) << "\n";
+		}
+	}
+
+
+	//!Duration transitions of a state to itself and the next degree-1 states
+	//!The probability of staying after d positions is (max-d)/max
+	void modelGenerator::_durations(std::stringstream& model, size_t st, size_t degree){
+		model << "TRANSITION:\tSTANDARD:\tP(X)\n\tEND:\t1\n";
+
+		for(size_t j = 0; j < degree; ++j){
+			model << "TRANSITION:\tDURATION:\tP(X)\n";
+			model << "\tS" << (st + j) % states << ":\tDIFF_STATE\n";
+
+			for(size_t d = 1; d <= max_duration; ++d){
+				double stay = (degree == 1) ? 1.0 : (double) (max_duration - d) / max_duration;
+				double value = (j == 0) ? stay : (1.0 - stay) / (degree - 1);
+				model << "\t\t" << d << "\t" << value << "\n";
+			}
+		}
+	}
+
+
+	//!Random counts for every word of the emission order
+	void modelGenerator::_counts(std::stringstream& model){
+		size_t rows = 1;
+		for(size_t i = 0; i < order; ++i){
+			rows *= 4;
+		}
+
+		for(size_t j = 0; j < rows; ++j){
+			for(size_t k = 0; k < 4; ++k){
+				model << ((k > 0) ? "\t" : "") << 1 + rand() % 1000;
+			}
+			model << "\n";
+		}
+	}
+
+
+	//!NORMAL emission of each real track with a random mean between -2 and 2
+	void modelGenerator::_realEmissions(std::stringstream& model){
+		for(size_t i = 0; i < real_tracks; ++i){
+			double mean = -2.0 + 4.0 * rand() / ((double) RAND_MAX + 1.0);
+			model << "EMISSION:\tREAL" << i + 1 << ":\tCONTINUOUS\n";
+			model << "\tPDF:\tNORMAL\tPARAMETERS:\t" << mean << ",1\n";
+		}
+	}
+
+}
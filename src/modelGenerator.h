@@ -0,0 +1,90 @@
+//
+//  modelGenerator.h
+//  StochHMM
+//
+//  Copyright (c) 2013 Korf Lab, Genome Center, UC Davis, Davis, CA. All rights reserved.
+//
+
+#ifndef __StochHMM__modelGenerator__
+#define __StochHMM__modelGenerator__
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <stdlib.h>
+
+namespace StochHMM{
+
+	/*! \class modelGenerator
+	 *	\brief Writes synthetic model files of a given size
+	 *
+	 *	Models have states S0 ... Sn-1 emitting from a SEQ track (A,C,G,T) with
+	 *	random COUNTS tables.  Each state stays in itself with the self
+	 *	transition probability and moves to the next out-degree-1 states
+	 *	(wrapping around) with the rest.  The first duration states use
+	 *	explicit DURATION transitions instead, whose probability of staying
+	 *	falls linearly to zero at the maximum duration.  Each real track REALn
+	 *	adds a NORMAL emission with a random mean to every state.  With
+	 *	templates, states with standard transitions are written as uses of a
+	 *	template from the <TEMPLATED STATES> section.
+	 *
+	 *	Counts and means are drawn with rand(), so models are reproducible with
+	 *	srand().
+	 */
+	class modelGenerator{
+	public:
+		modelGenerator();
+
+		//!Number of states (not counting INIT)
+		inline void setStates(size_t count){states = count;}
+
+		//!Number of states each state can transition to, including itself
+		//!0 connects every state to every state
+		inline void setOutDegree(size_t degree){out_degree = degree;}
+
+		//!Number of states with explicit duration transitions
+		inline void setDurationStates(size_t count){duration_states = count;}
+
+		//!Longest duration with a non-zero probability of staying in a duration state
+		inline void setMaxDuration(size_t length){max_duration = length;}
+
+		//!Order of the emissions
+		inline void setOrder(size_t emission_order){order = emission_order;}
+
+		//!Number of real number tracks
+		inline void setRealTracks(size_t count){real_tracks = count;}
+
+		//!Write states with standard transitions using a template
+		inline void setTemplates(bool use){templates = use;}
+
+		//!Probability of a state transitioning to itself
+		inline void setSelfTransition(double probability){self_transition = probability;}
+
+		//!Name of the model (default SYNTHETIC_states_degree_order)
+		inline void setName(const std::string& model_name){name = model_name;}
+
+		std::string generate();
+		bool write(const std::string& filename);
+
+	private:
+		size_t states;
+		size_t out_degree;
+		size_t duration_states;
+		size_t max_duration;
+		size_t order;
+		size_t real_tracks;
+		bool templates;
+		double self_transition;
+		std::string name;
+
+		void _transitions(std::stringstream& model, size_t st, size_t degree, const std::string& indent);
+		void _durations(std::stringstream& model, size_t st, size_t degree);
+		void _counts(std::stringstream& model);
+		void _realEmissions(std::stringstream& model);
+	};
+
+}
+
+#endif /* defined(__StochHMM__modelGenerator__) */
@@ -106,35 +106,40 @@ namespace StochHMM{
     }
     
     //!Parses the model templates string
-    /*!Takes the string passed to it and parses out each template to then be added to the Templates structure using stensil on each one */
+    /*!Takes the string passed to it and parses out each template to then be added to the Templates structure using stensil on each one.
+     Each template starts with a "TEMPLATE: <name>" line followed by the templated states */
     bool templates::parse(std::string& model_temp){
         
-        std::string copyofpassedstring = model_temp;
-        size_t model_end_position=model_temp.find("TEMPLATE: ",10);
-        size_t model_start_position=0;
-        std::string modelstring = "";
-        std::string stenName;
-        size_t stenNameStart = 10;
-        size_t stenNameEnd;
+        size_t model_start_position=model_temp.find("TEMPLATE:");
+        
         while (model_start_position!=std::string::npos){
+            size_t model_end_position=model_temp.find("TEMPLATE:",model_start_position + 9);
+            size_t stenNameEnd=model_temp.find("\n",model_start_position);
+            
+            if (stenNameEnd==std::string::npos || stenNameEnd > model_end_position){
+                std::cerr << "Template doesn't contain any states: " << model_temp.substr(model_start_position) << std::endl;
+                return false;
+            }
+            
+            std::string stenName=model_temp.substr(model_start_position + 9, stenNameEnd - model_start_position - 9);
+            clear_whitespace(stenName, " \t");
+            
+            std::string modelstring=model_temp.substr(stenNameEnd + 1, (model_end_position==std::string::npos) ? std::string::npos : model_end_position - stenNameEnd - 1);
+            
             stencil* stencil_to_push = new(std::nothrow) stencil();
             if (stencil_to_push==NULL){
                 std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
                 exit(1);
             }
             
-            model_end_position=copyofpassedstring.find("TEMPLATE: ",(model_start_position + 10)) - 1;        
-            
-            modelstring=model_temp.substr(model_start_position,model_end_position - model_start_position);
-            
-            stenNameEnd=modelstring.find("\n");
-            
-            stenName=model_temp.substr(stenNameStart,stenNameEnd-stenNameStart);
-            
             stencil_to_push->parse(modelstring);
-            //Need to correctly push the stencil to the map
+            
+            if (temps.count(stenName)){
+                delete temps[stenName];
+            }
             temps[stenName] = stencil_to_push;
-            model_start_position=model_end_position + 1;
+            
+            model_start_position=model_end_position;
         }
         return true;
     }
@@ -154,6 +159,11 @@ namespace StochHMM{
      */
     std::string templates::getTemplate (std::string& Template, std::string& ID,std::map<std::string,std::string>& UserVals){
         
+        if (!temps.count(Template)){
+            std::cerr << "Template isn't defined: " << Template << std::endl;
+            return "";
+        }
+        
         std::string FilledOutModel = temps[Template]->getTemplate(Template,ID,UserVals);
         return FilledOutModel;
     }
@@ -25,57 +25,80 @@ namespace StochHMM{
     }
 
 	
-	//TODO:  Currently adapt naive algorithm to optimized algorithm
+	//Comparison for max-heap of candidate scores (used by std::push_heap/pop_heap)
+	bool _heap_sort(const nthScore& i, const nthScore& j){
+		return (i.score < j.score);
+	}
+	
 	
-	//As written it's slower than the naive and may use as much memory....
+	//!Calculate the N-best viterbi paths for basic models
+	//!Each trellis column stores the top-n scores of every state in a flat
+	//!(state_size x n) array.  Because each previous cell is already sorted, the
+	//!top-n for the current cell is selected by merging the previous states' lists
+	//!with a heap, rather than generating and sorting all (previous states x n) candidates.
+	//!Traceback pointers of each column are added to a flat nthTrace table,
+	//!only as wide as the most ranks filled at the position.
+	//!\param n Number of paths to calculate
 	void trellis::simple_nth_viterbi(size_t n){
 		if (!hmm->isBasic()){
 			std::cerr << "Model isn't a simple/basic HMM.  Use complex algorithms\n";
 			return;
 		}
 		
+		if (n == 0 || n > INT16_MAX){
+			std::cerr << "Number of paths for nth-best viterbi must be between 1 and " << INT16_MAX << std::endl;
+			return;
+		}
+		
+		TRELLIS_PHASE("simple_nth_viterbi");
+		trellisTiles tile_scope(this, true);
+		
+		nth_size = n;
+		
 		//Initialize the traceback table
 		if (nth_traceback_table != NULL){delete nth_traceback_table;}
+		if (naive_nth_scores	!= NULL){delete naive_nth_scores; naive_nth_scores = NULL;}
 		if (ending_nth_viterbi	!= NULL){delete ending_nth_viterbi;}
 		if (nth_scoring_previous!= NULL){delete nth_scoring_previous;}
 		if (nth_scoring_current	!= NULL){delete nth_scoring_current;}
 		
-		nth_scoring_previous = new (std::nothrow) std::vector<std::vector<nthScore> > (state_size);
-		nth_scoring_current  = new (std::nothrow) std::vector<std::vector<nthScore> > (state_size);
-		nth_traceback_table  = new (std::nothrow) std::vector<nthTrace>(seq_size);
+		nth_scoring_previous = new (std::nothrow) std::vector<nthScore> (state_size * nth_size);
+		nth_scoring_current  = new (std::nothrow) std::vector<nthScore> (state_size * nth_size);
+		nth_traceback_table  = new (std::nothrow) nthTrace(seq_size, state_size, nth_size);
 		ending_nth_viterbi = new(std::nothrow) std::vector<nthScore>;
 		
-		if (nth_scoring_previous == NULL || nth_scoring_current == NULL || nth_traceback_table == NULL){
+		if (nth_scoring_previous == NULL || nth_scoring_current == NULL || nth_traceback_table == NULL || ending_nth_viterbi == NULL){
 			std::cerr << "Can't allocate Viterbi score and traceback table. OUT OF MEMORY" << std::endl;
 			exit(2);
 		}
 		
 		
-		std::bitset<STATE_MAX> next_states;
-		std::bitset<STATE_MAX> current_states;
+		dynamic_bitset next_states(state_size);
+		dynamic_bitset current_states(state_size);
 		
 		double  viterbi_temp(-INFINITY);
 		double  emission(-INFINITY);
 		double	trans(-INFINITY);
 		bool	exDef_position(false);
 		
+		//Candidate heap and emission+transition value for each previous state
+		std::vector<nthScore> candidates;
+		candidates.reserve(state_size);
+		std::vector<double> base(state_size,-INFINITY);
 		
 		state* init = hmm->getInitial();
 		
-		std::bitset<STATE_MAX>* initial_to = hmm->getInitialTo();
-		std::bitset<STATE_MAX>* from_trans(NULL);
+		dynamic_bitset* initial_to = hmm->getInitialTo();
+		dynamic_bitset* from_trans(NULL);
 		
 		//Calculate Viterbi from transitions from INIT (initial) state
-		for(size_t st = 0; st < state_size; ++st){
-			if ((*initial_to)[st]){  //if the bitset is set (meaning there is a transition to this state), calculate the viterbi
-				
-				viterbi_temp = (*hmm)[st]->get_emission_prob(*seqs,0) + getTransition(init, st, 0);
-				
-				if (viterbi_temp > -INFINITY){
-					(*nth_scoring_current)[st].push_back(nthScore(-1,-1,viterbi_temp));
-					
-					next_states |= (*(*hmm)[st]->getTo());
-				}
+		for(size_t st = initial_to->find_first(); st != SIZE_MAX; st = initial_to->find_next(st)){
+			
+			viterbi_temp = _emission(st, 0) + getTransition(init, st, 0);
+			
+			if (viterbi_temp > -INFINITY){
+				(*nth_scoring_current)[st*nth_size] = nthScore(-1,-1,viterbi_temp);
+				next_states |= (*(*hmm)[st]->getTo());
 			}
 		}
 		
@@ -83,13 +106,12 @@ namespace StochHMM{
 		for(size_t position = 1; position < seq_size ; ++position ){
 			
 			//Swap current and previous viterbi scores
-			nth_scoring_previous->assign(state_size,std::vector<nthScore>());
 			nth_swap_ptr = nth_scoring_previous;
 			nth_scoring_previous = nth_scoring_current;
 			nth_scoring_current = nth_swap_ptr;
+			nth_scoring_current->assign(state_size * nth_size, nthScore());
 			
 			//Swap current_states and next states sets
-			
 			current_states.reset();
 			current_states |= next_states;
 			next_states.reset();
@@ -99,15 +121,10 @@ namespace StochHMM{
 			}
 			
 			//Current states
-			for (size_t st_current = 0; st_current < state_size; ++st_current){ //Current state that emits value
-				
-				//Check to see if current state is valid
-				if (!current_states[st_current]){
-					continue;
-				}
+			for (size_t st_current = current_states.find_first(); st_current != SIZE_MAX; st_current = current_states.find_next(st_current)){ //Current state that emits value
 				
 				//Get emission of current state
-				emission = (*hmm)[st_current]->get_emission_prob(*seqs, position);
+				emission = _emission(st_current, position);
 				
 				
 				if (exDef_defined && exDef_position){
@@ -121,62 +138,76 @@ namespace StochHMM{
 				//Get list of states that are valid previous states
 				from_trans = (*hmm)[st_current]->getFrom();
 				
-				for (size_t st_previous = 0; st_previous < state_size ; ++st_previous) {  //for previous states
-					if (!(*from_trans)[st_previous]){
-						continue;
-					}
+				//Seed heap with best score from each valid previous state
+				candidates.clear();
+				for (size_t st_previous = from_trans->find_first(); st_previous != SIZE_MAX; st_previous = from_trans->find_next(st_previous)){  //for previous states
 					
 					//Check that previous state has transition to current state
 					//and that the previous viterbi score is not -INFINITY
-					if (!(*nth_scoring_previous)[st_previous].empty()){
-						
-						trans = getTransition((*hmm)[st_previous], st_current, position);
-						if (trans== -INFINITY){
-							continue;
-						}
-						
-						for(size_t vit_previous=0; vit_previous < (*nth_scoring_previous)[st_previous].size(); vit_previous++){
-							viterbi_temp = emission + trans + (*nth_scoring_previous)[st_previous][vit_previous].score;
-							(*nth_scoring_current)[st_current].push_back(nthScore(st_previous,vit_previous,viterbi_temp));
-						}
-						
-						next_states |= (*(*hmm)[st_current]->getTo());
+					if ((*nth_scoring_previous)[st_previous*nth_size].score == -INFINITY){
+						continue;
 					}
+					
+					trans = getTransition((*hmm)[st_previous], st_current, position);
+					if (trans== -INFINITY){
+						continue;
+					}
+					
+					base[st_previous] = emission + trans;
+					candidates.push_back(nthScore(st_previous, 0, base[st_previous] + (*nth_scoring_previous)[st_previous*nth_size].score));
 				}
 				
-				sort_scores((*nth_scoring_current)[st_current]);
-				if ((*nth_scoring_current)[st_current].size() > nth_size){
-					(*nth_scoring_current)[st_current].resize(nth_size);
+				if (candidates.empty()){
+					continue;
 				}
 				
-				for (size_t i=0; i < (*nth_scoring_current)[st_current].size(); i++){
-					(*nth_traceback_table)[position].assign(st_current, i , (*nth_scoring_current)[st_current][i].st_tb, (*nth_scoring_current)[st_current][i].score_tb);
+				std::make_heap(candidates.begin(), candidates.end(), _heap_sort);
+				
+				//Select the top-n scores for the current cell
+				nthScore* cell = &(*nth_scoring_current)[st_current*nth_size];
+				for (size_t i = 0; i < nth_size && !candidates.empty(); i++){
+					std::pop_heap(candidates.begin(), candidates.end(), _heap_sort);
+					nthScore best = candidates.back();
+					candidates.pop_back();
+					
+					cell[i] = best;
+					
+					//Add the next best score from the same previous state
+					size_t next_rank = best.score_tb + 1;
+					if (next_rank < nth_size){
+						viterbi_temp = (*nth_scoring_previous)[best.st_tb*nth_size + next_rank].score;
+						if (viterbi_temp > -INFINITY){
+							candidates.push_back(nthScore(best.st_tb, next_rank, base[best.st_tb] + viterbi_temp));
+							std::push_heap(candidates.begin(), candidates.end(), _heap_sort);
+						}
+					}
 				}
+				
+				next_states |= (*(*hmm)[st_current]->getTo());
 			}
+			
+			nth_traceback_table->push_back(*nth_scoring_current);
 		}
 		
-		//TODO:  Calculate ending and set the final viterbi and traceback pointer
-		//Swap current and previous viterbi scores
-		nth_scoring_previous->assign(state_size,std::vector<nthScore>());
-		nth_swap_ptr = nth_scoring_previous;
-		nth_scoring_previous = nth_scoring_current;
-		nth_scoring_current = nth_swap_ptr;
-		
 		
 		//Calculate ending viterbi score and traceback from END state
 		for(size_t st_previous = 0; st_previous < state_size ;++st_previous){
-			if (!(*nth_scoring_previous)[st_previous].empty()){
-				
-				trans = (*hmm)[st_previous]->getEndTrans();
-				
-				if (trans == -INFINITY){
-					continue;
-				}
-				
-				for(size_t vit_previous=0; vit_previous < (*nth_scoring_previous)[st_previous].size(); vit_previous++){
-					viterbi_temp = trans + (*nth_scoring_previous)[st_previous][vit_previous].score;
-					ending_nth_viterbi->push_back(nthScore(st_previous,vit_previous,viterbi_temp));
+			if ((*nth_scoring_current)[st_previous*nth_size].score == -INFINITY){
+				continue;
+			}
+			
+			trans = (*hmm)[st_previous]->getEndTrans();
+			
+			if (trans == -INFINITY){
+				continue;
+			}
+			
+			for(size_t vit_previous=0; vit_previous < nth_size; vit_previous++){
+				viterbi_temp = (*nth_scoring_current)[st_previous*nth_size + vit_previous].score;
+				if (viterbi_temp == -INFINITY){
+					break;
 				}
+				ending_nth_viterbi->push_back(nthScore(st_previous,vit_previous,trans + viterbi_temp));
 			}
 		}
 		
@@ -191,10 +222,43 @@ namespace StochHMM{
 		nth_scoring_current  = NULL;
 	}
 	
+	
+	//!Calculate the N-best viterbi paths
+	//!Uses the basic-model algorithm when possible, otherwise the naive algorithm
+	void trellis::nth_viterbi(size_t n){
+		if (hmm->isBasic()){
+			simple_nth_viterbi(n);
+		}
+		else{
+			naive_nth_viterbi(n);
+		}
+	}
+	
+	void trellis::nth_viterbi(model* h, sequences* sqs, size_t n){
+		hmm = h;
+		seqs = sqs;
+		seq_size		= seqs->getLength();
+		state_size		= hmm->state_size();
+		exDef_defined	= seqs->exDefDefined();
+		nth_viterbi(n);
+	}
+	
+	void trellis::simple_nth_viterbi(model* h, sequences* sqs, size_t n){
+		hmm = h;
+		seqs = sqs;
+		seq_size		= seqs->getLength();
+		state_size		= hmm->state_size();
+		exDef_defined	= seqs->exDefDefined();
+		simple_nth_viterbi(n);
+	}
+	
 	void trellis::naive_nth_viterbi(size_t n){
+		TRELLIS_PHASE("naive_nth_viterbi");
+		trellisTiles tile_scope(this, true);
 		nth_size = n;
 		
 		if (naive_nth_scores != NULL){delete naive_nth_scores; naive_nth_scores=NULL;}
+		if (nth_traceback_table != NULL){delete nth_traceback_table; nth_traceback_table = NULL;}
 		if (ending_nth_viterbi != NULL){delete ending_nth_viterbi; ending_nth_viterbi = NULL;}
 		
 		naive_nth_scores = new (std::nothrow) std::vector<std::vector<std::vector<nthScore >* > >(seq_size, std::vector<std::vector<nthScore>* >(state_size,NULL));
@@ -210,7 +274,7 @@ namespace StochHMM{
 		
 		//Calculate from Initial states
 		for(size_t st = 0; st < state_size; ++st){
-			viterbi_temp = (*hmm)[st]->get_emission_prob(*seqs,0) +  getTransition(init, st, 0);
+			viterbi_temp = _emission(st, 0) +  getTransition(init, st, 0);
 			
 			if (viterbi_temp == -INFINITY){
 				continue;
@@ -231,7 +295,7 @@ namespace StochHMM{
 			
 			for (size_t st_current = 0; st_current < state_size; ++st_current){
 				//Calc emissions
-				emission = (*hmm)[st_current]->get_emission_prob(*seqs, position);
+				emission = _emission(st_current, position);
 				
 				if (exDef_defined && exDef_position){
 					emission += seqs->getWeight(position, st_current);
@@ -0,0 +1,252 @@
+//
+//  outputWriter.cpp
+//  StochHMM
+//
+//  Copyright (c) 2013 Korf Lab, Genome Center, UC Davis, Davis, CA. All rights reserved.
+//
+
+#include "outputWriter.h"
+#include <stdio.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace StochHMM{
+
+	static const size_t WRITER_BUFFER_SIZE = 4 << 20;
+
+
+	//!Create a writer for stdout
+	outputWriter::outputWriter():fd(STDOUT_FILENO),owned(false),error(false),precision(6),fixed_notation(false),buffer(WRITER_BUFFER_SIZE),filled(0){
+		pthread_mutex_init(&lock, NULL);
+	}
+
+	outputWriter::~outputWriter(){
+		close();
+		pthread_mutex_destroy(&lock);
+	}
+
+
+	//!Write to a file instead of stdout
+	//!\param filename File to create or truncate
+	//!\return false if the file couldn't be opened
+	bool outputWriter::open(const std::string& filename){
+		close();
+
+		int file = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+		if (file < 0){
+			return false;
+		}
+
+		fd = file;
+		owned = true;
+		return true;
+	}
+
+
+	//!Write to stdout
+	void outputWriter::openStdout(){
+		close();
+	}
+
+
+	//!Write the buffer and close the file
+	//!The writer goes back to writing to stdout
+	void outputWriter::close(){
+		flush();
+
+		if (owned){
+			::close(fd);
+		}
+
+		fd = STDOUT_FILENO;
+		owned = false;
+	}
+
+
+	//!Write the buffer to the file
+	void outputWriter::flush(){
+		pthread_mutex_lock(&lock);
+		_flush();
+		pthread_mutex_unlock(&lock);
+	}
+
+
+	//!Add characters to the output
+	//!Characters from one call are never split by output from other threads
+	//!\param data Characters to write
+	//!\param length Number of characters
+	void outputWriter::write(const char* data, size_t length){
+		pthread_mutex_lock(&lock);
+
+		if (filled + length > buffer.size()){
+			_flush();
+		}
+
+		if (length >= buffer.size()){
+			_writeAll(data, length);
+		}
+		else{
+			memcpy(&buffer[filled], data, length);
+			filled += length;
+		}
+
+		pthread_mutex_unlock(&lock);
+	}
+
+
+	void outputWriter::_flush(){
+		if (filled > 0){
+			_writeAll(&buffer[0], filled);
+			filled = 0;
+		}
+	}
+
+
+	void outputWriter::_writeAll(const char* data, size_t length){
+		while (length > 0 && !error){
+			ssize_t written = ::write(fd, data, length);
+			if (written < 0){
+				if (errno == EINTR){
+					continue;
+				}
+				std::cerr << "Error writing output: " << strerror(errno) << std::endl;
+				error = true;
+				return;
+			}
+			data += written;
+			length -= written;
+		}
+	}
+
+
+	//!Create a buffer that writes to an outputWriter
+	//!Doubles are formatted using the writer's precision
+	outputBuffer::outputBuffer(outputWriter& output):writer(&output),stream(NULL){
+		precision = output.getPrecision();
+		fixed_notation = output.isFixed();
+		data.reserve(FLUSH_SIZE + 256);
+	}
+
+
+	//!Create a buffer that writes to a stream
+	//!Doubles are formatted using the stream's precision and fixed flag
+	outputBuffer::outputBuffer(std::ostream& output):writer(NULL),stream(&output){
+		precision = (int) output.precision();
+		fixed_notation = (output.flags() & std::ios::fixed) != 0;
+	}
+
+
+	outputBuffer::~outputBuffer(){
+		flush();
+	}
+
+
+	//!Pass the characters to the writer or stream
+	void outputBuffer::flush(){
+		if (data.empty()){
+			return;
+		}
+
+		if (writer != NULL){
+			writer->write(data);
+		}
+		else{
+			stream->write(data.data(), data.size());
+		}
+		data.clear();
+	}
+
+
+	//!Append an unsigned integer
+	void outputBuffer::appendInt(uint64_t value){
+		char digits[20];
+		size_t count = 0;
+		do{
+			digits[count++] = '0' + (value % 10);
+			value /= 10;
+		}while(value > 0);
+
+		while(count > 0){
+			data += digits[--count];
+		}
+		_check();
+	}
+
+
+	//!Append a signed integer
+	void outputBuffer::appendInt(int64_t value){
+		if (value < 0){
+			data += '-';
+			appendInt((uint64_t) 0 - (uint64_t) value);
+			return;
+		}
+		appendInt((uint64_t) value);
+	}
+
+
+	//!Append a number with a fixed number of digits after the decimal point
+	//!Gives the same characters as printf("%.*f").  The number is rounded
+	//!without printf unless it is very large or within 1e-6 of halfway between
+	//!two outputs, where printf's exact rounding is needed.
+	//!\param value Number to append
+	//!\param digits Digits after the decimal point
+	void outputBuffer::appendFixed(double value, int digits){
+		static const uint64_t powers[] = {1,10,100,1000,10000,100000,1000000,10000000,100000000,1000000000};
+
+		if (digits >= 0 && digits <= 9){
+			double scaled = fabs(value) * powers[digits];
+
+			if (scaled < 1e9){
+				double whole = floor(scaled);
+				double fraction = scaled - whole;
+
+				if (fabs(fraction - 0.5) > 1e-6){
+					uint64_t rounded = (uint64_t) whole + ((fraction > 0.5) ? 1 : 0);
+
+					if (signbit(value)){
+						data += '-';
+					}
+
+					appendInt(rounded / powers[digits]);
+
+					if (digits > 0){
+						uint64_t decimals = rounded % powers[digits];
+						data += '.';
+						for(int i = digits - 1; i >= 0; --i){
+							data += '0' + (decimals / powers[i]) % 10;
+						}
+					}
+					_check();
+					return;
+				}
+			}
+		}
+
+		char str[400];
+		int length = snprintf(str, sizeof(str), "%.*f", digits, value);
+		if (length >= (int) sizeof(str)){
+			std::vector<char> large(length + 1);
+			snprintf(&large[0], large.size(), "%.*f", digits, value);
+			append(&large[0], length);
+			return;
+		}
+		append(str, length);
+	}
+
+
+	//!Append a number using the precision of the writer or stream
+	//!Same as writing the double to an ostream with that precision
+	void outputBuffer::appendDouble(double value){
+		if (fixed_notation){
+			appendFixed(value, precision);
+			return;
+		}
+
+		char str[400];
+		int length = snprintf(str, sizeof(str), "%.*g", precision, value);
+		append(str, (length < (int) sizeof(str)) ? length : sizeof(str) - 1);
+	}
+
+}
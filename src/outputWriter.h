@@ -0,0 +1,136 @@
+//
+//  outputWriter.h
+//  StochHMM
+//
+//  Copyright (c) 2013 Korf Lab, Genome Center, UC Davis, Davis, CA. All rights reserved.
+//
+
+#ifndef __StochHMM__outputWriter__
+#define __StochHMM__outputWriter__
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+namespace StochHMM{
+
+	/*! \class outputWriter
+	 *	\brief Buffered output to a file descriptor
+	 *
+	 *	Output is collected in a large buffer and written to the file descriptor
+	 *	with write(), so it doesn't go through std::cout.  write() is thread-safe
+	 *	and each call is written contiguously, so jobs decoded by different
+	 *	threads can share a writer by formatting their output in an outputBuffer.
+	 */
+	class outputWriter{
+	public:
+		outputWriter();
+		~outputWriter();
+
+		bool open(const std::string& filename);
+		void openStdout();
+		void close();
+		void flush();
+
+		void write(const char* data, size_t length);
+
+		//!Write a string
+		inline void write(const std::string& str){write(str.data(), str.size());}
+
+		//!Set how doubles are formatted by outputBuffer::appendDouble
+		//!\param digits Number of significant digits, or digits after the decimal point if fixed
+		//!\param fixed Use fixed notation (printf %f) instead of printf %g
+		inline void setPrecision(int digits, bool fixed){precision = digits; fixed_notation = fixed;}
+
+		inline int getPrecision(){return precision;}
+		inline bool isFixed(){return fixed_notation;}
+
+		//!Did a write fail
+		inline bool failed(){return error;}
+
+	private:
+		int fd;
+		bool owned;		//File descriptor was opened by the writer
+		bool error;
+		int precision;
+		bool fixed_notation;
+
+		std::vector<char> buffer;
+		size_t filled;
+		pthread_mutex_t lock;
+
+		void _flush();
+		void _writeAll(const char* data, size_t length);
+	};
+
+
+	/*! \class outputBuffer
+	 *	\brief Formats output for an outputWriter or std::ostream
+	 *
+	 *	Text is appended to a local buffer, which is passed to the writer when it
+	 *	is large or the buffer is flushed or destroyed.  Integers and fixed
+	 *	precision numbers are formatted without printf.  Each outputBuffer
+	 *	should only be used by one thread.
+	 */
+	class outputBuffer{
+	public:
+		outputBuffer(outputWriter& output);
+		outputBuffer(std::ostream& output);
+		~outputBuffer();
+
+		void flush();
+
+		//!Append characters
+		inline void append(const char* str, size_t length){
+			data.append(str, length);
+			_check();
+		}
+
+		//!Append a C string
+		inline void append(const char* str){append(str, strlen(str));}
+
+		//!Append a string
+		inline void append(const std::string& str){append(str.data(), str.size());}
+
+		//!Append a character
+		inline void append(char c){
+			data += c;
+			_check();
+		}
+
+		void appendInt(uint64_t value);
+		void appendInt(int64_t value);
+
+		//!Append an integer
+		inline void appendInt(int value){appendInt((int64_t) value);}
+
+		void appendFixed(double value, int digits);
+		void appendDouble(double value);
+
+		//!Number of characters waiting to be written
+		inline size_t size(){return data.size();}
+
+		//!Size at which the buffer is passed to the writer
+		static const size_t FLUSH_SIZE = 1 << 20;
+
+	private:
+		outputWriter* writer;
+		std::ostream* stream;
+		std::string data;
+		int precision;
+		bool fixed_notation;
+
+		inline void _check(){
+			if (data.size() >= FLUSH_SIZE){
+				flush();
+			}
+		}
+	};
+
+}
+
+#endif /* defined(__StochHMM__outputWriter__) */
@@ -11,6 +11,11 @@
 namespace StochHMM {
 	
 	void trellis::posterior(){
+		if (posterior_concurrent){
+			concurrent_posterior();
+			return;
+		}
+		
 		//if (hmm->isBasic()){
 			simple_posterior();
 		//}
@@ -54,6 +59,8 @@ namespace StochHMM {
 
 	
 	void trellis::simple_posterior(){
+		TRELLIS_PHASE("simple_posterior");
+		trellisTiles tile_scope(this, true);
 		
 //		if (!hmm->isBasic()){
 //			std::cerr << "Model isn't a simple/basic HMM.  Use complex algorithms\n";
@@ -71,221 +78,290 @@ namespace StochHMM {
 			exit(2);
 		}
 		
-        std::bitset<STATE_MAX> next_states;
-        std::bitset<STATE_MAX> current_states;
-		
-        double  forward_temp(-INFINITY);
-        double  emission(-INFINITY);
-		bool	exDef_position(false);
-        
-        state* init = hmm->getInitial();
-		
-		std::bitset<STATE_MAX>* initial_to = hmm->getInitialTo();
-		std::bitset<STATE_MAX>* from_trans(NULL);
+		dynamic_bitset next_states(state_size);
+		dynamic_bitset current_states(state_size);
 		
+		double  forward_temp(-INFINITY);
 		
-        //Calculate Forward from transitions from INIT (initial) state
-        for(size_t i = 0; i < state_size; ++i){
-            if ((*initial_to)[i]){  //if the bitset is set (meaning there is a transition to this state), calculate the viterbi
-				forward_temp = (*hmm)[i]->get_emission_prob(*seqs,0) +  getTransition(init, i, 0);
-				
-				if (forward_temp > -INFINITY){
-					(*scoring_current)[i] = forward_temp;
-					next_states |= (*(*hmm)[i]->getTo());
-                }
-            }
-        }
-        
-        
-        for(size_t position = 1; position < seq_size ; ++position ){
-			(*posterior_score)[position-1].assign(scoring_current->begin(), scoring_current->end());
-            
-			//Swap current and previous viterbi scores
-            scoring_previous->assign(state_size,-INFINITY);
-            swap_ptr = scoring_previous;
-			scoring_previous = scoring_current;
-			scoring_current = swap_ptr;
-			
-			//Swap current_states and next states sets
-			current_states.reset();
-            current_states |= next_states;
-            next_states.reset();
-            
-            if (exDef_defined){
-                exDef_position = seqs->exDefDefined(position);
-            }
-			            
-            for (size_t current = 0; current < state_size; ++current){ //i is current state that emits value
-				
-				if (!current_states[current]){
-                    continue;
-                }
-                
-                emission = (*hmm)[current]->get_emission_prob(*seqs, position);
-				
-				if (exDef_defined && exDef_position){
-                    emission += seqs->getWeight(position, current);
-                }
-				
-				if (emission == -INFINITY){
-					continue;
-				}
-                
-				from_trans = (*hmm)[current]->getFrom();
-				
-                for (size_t previous = 0; previous < state_size ; ++previous) {  //j is previous state
-					
-                    if (!(*from_trans)[previous]){
-                        continue;
-                    }
-					
-					
-					if ((*scoring_previous)[previous] != -INFINITY){
-                        forward_temp = (*scoring_previous)[previous] + emission + getTransition((*hmm)[previous], current , position);
-						
-						if ((*scoring_current)[current] == -INFINITY){
-							(*scoring_current)[current] = forward_temp;
-						}
-						else{
-							(*scoring_current)[current] = addLog(forward_temp, (*scoring_current)[current]);
-						}
-						
-						next_states |= (*(*hmm)[current]->getTo());
-                    }
-                }
-            }
+		//Calculate Forward
+		for(size_t position = 0; position < seq_size ; ++position ){
+			_stream_forward_position(position, position, current_states, next_states);
+			_count_cells(scoring_current);
+			(*posterior_score)[position].assign(scoring_current->begin(), scoring_current->end());
 		}
 		
-		(*posterior_score)[seq_size-1].assign(scoring_current->begin(), scoring_current->end());
-		
-        //Swap current and previous scores
-        scoring_previous->assign(state_size,-INFINITY);
-        swap_ptr = scoring_previous;
-        scoring_previous = scoring_current;
-        scoring_current = swap_ptr;
-		
-		
-        ending_forward_prob = -INFINITY;
-        for(size_t i = 0; i < state_size ;++i){
-            if ((*scoring_previous)[i] != -INFINITY){
-                forward_temp = (*scoring_previous)[i] + (*hmm)[i]->getEndTrans();
+		ending_forward_prob = -INFINITY;
+		for(size_t i = 0; i < state_size ;++i){
+			if ((*scoring_current)[i] != -INFINITY){
+				forward_temp = (*scoring_current)[i] + (*hmm)[i]->getEndTrans();
 				
-                if (forward_temp > -INFINITY){
+				if (forward_temp > -INFINITY){
 					if (ending_forward_prob == -INFINITY){
 						ending_forward_prob = forward_temp;
 					}
 					else{
 						ending_forward_prob = addLog(forward_temp, ending_forward_prob);
 					}
-                }
-            }
-        }
+				}
+			}
+		}
 
 		// Perform Backward Algorithm
-		double  backward_temp(-INFINITY);		
+		double  backward_temp(-INFINITY);
 		scoring_previous->assign(state_size, -INFINITY);
 		scoring_current->assign(state_size, -INFINITY);
-//		std::vector<float> posterior_sum(seq_size,-INFINITY);
+		current_states.reset();
+		next_states.reset();
 
 		std::vector<double> posterior_sum(seq_size,-INFINITY);
 
-		
-		std::bitset<STATE_MAX>* ending_from = hmm->getEndingFrom();
-
-		//Calculate initial Backward from ending state
-		for(size_t st_current = 0; st_current < state_size; ++st_current){
-			if ((*ending_from)[st_current]){  //if the bitset is set (meaning there is a transition to this state)
-
-				backward_temp = (*hmm)[st_current]->getEndTrans();
-
-				if (backward_temp > -INFINITY){
-					(*scoring_current)[st_current] = backward_temp;
-					next_states[st_current] = 1;
+		for(size_t position = seq_size-1; position != SIZE_MAX ; --position ){
+			_backward_position(position, current_states, next_states);
+			_count_cells(scoring_current);
+			
+			for (size_t i=0;i<state_size;++i){
+				if (position == 0){
+					(*posterior_score)[0][i] = ((double)(*posterior_score)[0][i] + (double)(*scoring_current)[i]) - ending_forward_prob;
+					posterior_sum[0] = addLog(posterior_sum[0], (*posterior_score)[0][i]);
+				}
+				else if ((*posterior_score)[position][i] != -INFINITY && (*scoring_current)[i]!= -INFINITY){
+					(*posterior_score)[position][i] = ((double)(*posterior_score)[position][i] + (double)(*scoring_current)[i]) - ending_forward_prob;
+					if ((*posterior_score)[position][i] > -7.6009){  //Above significant value;
+						posterior_sum[position] = addLog(posterior_sum[position], (*posterior_score)[position][i]);
+					}
 				}
 			}
 		}
 
-		for(size_t position = seq_size-2; position != SIZE_MAX ; --position ){
-
-			//Swap current_states and next states sets
-			current_states.reset();
-			current_states |= next_states;
-			next_states.reset();
+		ending_backward_prob = -INFINITY;
+		state* init = hmm->getInitial();
+		for(size_t i = 0; i < state_size ;++i){
 
-			for (size_t i=0;i<state_size;++i){
-				if ((*posterior_score)[position+1][i] != -INFINITY && (*scoring_current)[i]!= -INFINITY){
-					(*posterior_score)[position+1][i] = ((double)(*posterior_score)[position+1][i] + (double)(*scoring_current)[i]) - ending_forward_prob;
-					if ((*posterior_score)[position+1][i] > -7.6009){  //Above significant value;
-						posterior_sum[position+1] = addLog(posterior_sum[position+1], (*posterior_score)[position+1][i]);
+			if ((*scoring_current)[i] != -INFINITY){
+				backward_temp = (*scoring_current)[i] + _emission(i, 0) + getTransition(init, i, 0);
+				
+				if (backward_temp > -INFINITY){
+					if (ending_backward_prob == -INFINITY){
+						ending_backward_prob = backward_temp;
+					}
+					else{
+						ending_backward_prob = addLog(backward_temp, ending_backward_prob);
 					}
 				}
 			}
-
-			//Swap current and previous viterbi scores
-            scoring_previous->assign(state_size,-INFINITY);
-            swap_ptr = scoring_previous;
-			scoring_previous = scoring_current;
-			scoring_current = swap_ptr;
-
-
-
-			if (exDef_defined){
-				exDef_position = seqs->exDefDefined(position);
-			}
-
-
-			for (size_t st_previous	= 0; st_previous < state_size; ++st_previous){ //i is current state that emits value
-				if (!current_states[st_previous]){
+		}
+		
+		if (abs(ending_backward_prob - ending_forward_prob) > 0.0000001){
+			std::cerr << "Ending sequence probabilities calculated by Forward and Backward algorithm are different.  They should be the same.\t" << __FUNCTION__ << std::endl;
+		}
+		
+		
+		
+		for (size_t i=0;i<seq_size;i++){
+			for(size_t j=0;j<state_size;j++){
+				if ((*posterior_score)[i][j] == -INFINITY){
 					continue;
 				}
-
-				emission = (*hmm)[st_previous]->get_emission_prob(*seqs, position+1);
-
-				if (exDef_defined && exDef_position){
-					emission += seqs->getWeight(position+1, st_previous);
+//				std::cout << "Sum:\t" << exp(posterior_sum[i]) << std::endl;
+//				std::cout << "Score:\t" << exp((*posterior_score)[i][j]) << std::endl;
+				
+				if ((*posterior_score)[i][j] > -7.6009){  //Above significant value;
+					(*posterior_score)[i][j] -= posterior_sum[i];
 				}
-
-				if (emission == -INFINITY){
-					continue;
+				else{
+					(*posterior_score)[i][j] = -INFINITY;
 				}
-
-				from_trans = (*hmm)[st_previous]->getFrom();
-
-				for (size_t st_current = 0; st_current < state_size ; ++st_current) {  //j is previous state
-					if (!(*from_trans)[st_current]){
-						continue;
+			}
+		}
+		
+		
+		delete scoring_previous;
+		delete scoring_current;
+		scoring_previous = NULL;
+		scoring_current = NULL;
+	}
+	
+	
+	//!Rows of the posterior table filled by the forward and backward threads
+	//!of concurrent_posterior.  The thread that reaches a row second combines
+	//!the forward and backward scores, and normalizes the rows it combined.
+	struct posteriorSync{
+		pthread_mutex_t lock;
+		pthread_cond_t finished;
+		size_t forward_done;		//Rows before have forward scores
+		size_t backward_done;		//Rows from have backward scores
+		bool forward_finished;
+		double ending_forward_prob;
+		double_2D* table;
+		std::vector<double> sums;	//Posterior sum of each position
+		trellis* helper;			//Trellis of the backward thread
+	};
+	
+	
+	void trellis::concurrent_posterior(){
+		bool safe = hmm->isBasic();
+		for(size_t i = 0; safe && i < state_size; ++i){
+			safe = emissionTiles::threadSafe((*hmm)[i]);
+		}
+		
+		if (!safe || seq_size == 0){
+			simple_posterior();
+			return;
+		}
+		
+		TRELLIS_PHASE("concurrent_posterior");
+		trellisTiles tile_scope(this, true);
+		
+		posterior_score = new (std::nothrow) double_2D(seq_size, std::vector<double>(state_size,-INFINITY));
+		
+		//The backward algorithm uses its own trellis, so the scores,
+		//counters and transitions aren't shared
+		trellis* helper = new (std::nothrow) trellis(hmm, seqs);
+		
+		if (posterior_score == NULL || helper == NULL){
+			std::cerr << "Can't allocate Posterior score table. OUT OF MEMORY" << std::endl;
+			exit(2);
+		}
+		
+		trellisStats helper_stats;
+		if (stats != NULL){
+			helper->setStats(&helper_stats);
+		}
+		
+		posteriorSync sync;
+		pthread_mutex_init(&sync.lock, NULL);
+		pthread_cond_init(&sync.finished, NULL);
+		sync.forward_done = 0;
+		sync.backward_done = seq_size;
+		sync.forward_finished = false;
+		sync.ending_forward_prob = -INFINITY;
+		sync.table = posterior_score;
+		sync.sums.assign(seq_size, -INFINITY);
+		sync.helper = helper;
+		
+		pthread_t backward_thread;
+		if (pthread_create(&backward_thread, NULL, _posterior_thread_start, &sync) != 0){
+			std::cerr << "Unable to create backward thread" << std::endl;
+			exit(2);
+		}
+		
+		_posterior_forward(sync);
+		pthread_join(backward_thread, NULL);
+		
+		pthread_cond_destroy(&sync.finished);
+		pthread_mutex_destroy(&sync.lock);
+		
+		ending_forward_prob = sync.ending_forward_prob;
+		ending_backward_prob = helper->ending_backward_prob;
+		
+		if (stats != NULL){
+			stats->add(helper_stats);
+		}
+		delete helper;
+		
+		if (abs(ending_backward_prob - ending_forward_prob) > 0.0000001){
+			std::cerr << "Ending sequence probabilities calculated by Forward and Backward algorithm are different.  They should be the same.\t" << __FUNCTION__ << std::endl;
+		}
+	}
+	
+	
+	void* trellis::_posterior_thread_start(void* ptr){
+		posteriorSync* sync = static_cast<posteriorSync*>(ptr);
+		sync->helper->_posterior_backward(*sync);
+		return NULL;
+	}
+	
+	
+	//!Forward algorithm of concurrent_posterior
+	void trellis::_posterior_forward(posteriorSync& sync){
+		scoring_current = new (std::nothrow) std::vector<double> (state_size,-INFINITY);
+		scoring_previous= new (std::nothrow) std::vector<double> (state_size,-INFINITY);
+		
+		if (scoring_current == NULL || scoring_previous == NULL){
+			std::cerr << "Can't allocate forward scores. OUT OF MEMORY" << std::endl;
+			exit(2);
+		}
+		
+		dynamic_bitset next_states(state_size);
+		dynamic_bitset current_states(state_size);
+		
+		double  forward_temp(-INFINITY);
+		
+		std::vector<std::pair<size_t,double> > unscaled;
+		size_t combined(seq_size);	//First row combined by this thread
+		
+		for(size_t position = 0; position < seq_size ; ++position ){
+			_stream_forward_position(position, position, current_states, next_states);
+			_count_cells(scoring_current);
+			
+			if (_posterior_store(sync, position, *scoring_current, true, unscaled) && combined == seq_size){
+				combined = position;
+			}
+		}
+		
+		double ending(-INFINITY);
+		for(size_t i = 0; i < state_size ;++i){
+			if ((*scoring_current)[i] != -INFINITY){
+				forward_temp = (*scoring_current)[i] + (*hmm)[i]->getEndTrans();
+				
+				if (forward_temp > -INFINITY){
+					if (ending == -INFINITY){
+						ending = forward_temp;
 					}
-
-					if ((*scoring_previous)[st_previous] != -INFINITY){
-						
-						backward_temp =(*scoring_previous)[st_previous] + emission + getTransition((*hmm)[st_current], st_previous , position+1);
-
-						if ((*scoring_current)[st_current] == -INFINITY){
-							(*scoring_current)[st_current] = backward_temp;
-						}
-						else{
-							(*scoring_current)[st_current] = addLog(backward_temp, (*scoring_current)[st_current]);
-						}
-
-						next_states[st_current] = 1;
+					else{
+						ending = addLog(forward_temp, ending);
 					}
 				}
 			}
 		}
-
-		for (size_t i=0;i<state_size;++i){
-			(*posterior_score)[0][i] = ((double)(*posterior_score)[0][i] + (double)(*scoring_current)[i]) - ending_forward_prob;
-			posterior_sum[0] = addLog(posterior_sum[0], (*posterior_score)[0][i]);
+		
+		pthread_mutex_lock(&sync.lock);
+		sync.ending_forward_prob = ending;
+		sync.forward_finished = true;
+		pthread_cond_broadcast(&sync.finished);
+		pthread_mutex_unlock(&sync.lock);
+		
+		_posterior_finalize(sync, combined, seq_size, unscaled);
+		
+		delete scoring_previous;
+		delete scoring_current;
+		scoring_previous = NULL;
+		scoring_current = NULL;
+	}
+	
+	
+	//!Backward algorithm of concurrent_posterior (run by the helper trellis)
+	void trellis::_posterior_backward(posteriorSync& sync){
+		scoring_current = new (std::nothrow) std::vector<double> (state_size,-INFINITY);
+		scoring_previous= new (std::nothrow) std::vector<double> (state_size,-INFINITY);
+		
+		if (scoring_current == NULL || scoring_previous == NULL){
+			std::cerr << "Can't allocate backward scores. OUT OF MEMORY" << std::endl;
+			exit(2);
+		}
+		
+		dynamic_bitset next_states(state_size);
+		dynamic_bitset current_states(state_size);
+		
+		double  backward_temp(-INFINITY);
+		
+		std::vector<std::pair<size_t,double> > unscaled;
+		size_t combined(0);		//Rows before were combined by this thread
+		
+		for(size_t position = seq_size-1; position != SIZE_MAX ; --position ){
+			_backward_position(position, current_states, next_states);
+			_count_cells(scoring_current);
+			
+			if (_posterior_store(sync, position, *scoring_current, false, unscaled) && combined == 0){
+				combined = position+1;
+			}
 		}
 		
-
-
 		ending_backward_prob = -INFINITY;
-		init = hmm->getInitial();
+		state* init = hmm->getInitial();
 		for(size_t i = 0; i < state_size ;++i){
-
 			if ((*scoring_current)[i] != -INFINITY){
-				backward_temp = (*scoring_current)[i] + (*hmm)[i]->get_emission_prob(*seqs,0) + getTransition(init, i, 0);
+				backward_temp = (*scoring_current)[i] + _emission(i, 0) + getTransition(init, i, 0);
 				
 				if (backward_temp > -INFINITY){
 					if (ending_backward_prob == -INFINITY){
@@ -298,29 +374,632 @@ namespace StochHMM {
 			}
 		}
 		
-		if (abs(ending_backward_prob - ending_forward_prob) > 0.0000001){
-			std::cerr << "Ending sequence probabilities calculated by Forward and Backward algorithm are different.  They should be the same.\t" << __FUNCTION__ << std::endl;
+		//Rows are normalized by the forward probability
+		pthread_mutex_lock(&sync.lock);
+		while (!sync.forward_finished){
+			pthread_cond_wait(&sync.finished, &sync.lock);
 		}
+		pthread_mutex_unlock(&sync.lock);
 		
+		_posterior_finalize(sync, 0, combined, unscaled);
 		
+		delete scoring_previous;
+		delete scoring_current;
+		scoring_previous = NULL;
+		scoring_current = NULL;
+	}
+	
+	
+	//!Store the forward or backward scores of a position in the posterior
+	//!table, or combine them with the scores stored by the other thread
+	//!Combined cells hold the sum of the forward and backward scores.  As in
+	//!simple_posterior, a cell without a backward score keeps its forward
+	//!score (unscaled), except at the first position.
+	//!\return true if the scores were combined
+	bool trellis::_posterior_store(posteriorSync& sync, size_t position, std::vector<double>& scores, bool forward, std::vector<std::pair<size_t,double> >& unscaled){
+		std::vector<double>& row = (*sync.table)[position];
 		
-		for (size_t i=0;i<seq_size;i++){
-			for(size_t j=0;j<state_size;j++){
-				if ((*posterior_score)[i][j] == -INFINITY){
+		pthread_mutex_lock(&sync.lock);
+		bool passed = (forward) ? sync.backward_done <= position : sync.forward_done > position;
+		if (!passed){
+			row.assign(scores.begin(), scores.end());
+			if (forward){
+				sync.forward_done = position + 1;
+			}
+			else{
+				sync.backward_done = position;
+			}
+			pthread_mutex_unlock(&sync.lock);
+			return false;
+		}
+		pthread_mutex_unlock(&sync.lock);
+		
+		for(size_t i = 0; i < state_size; ++i){
+			double forward_score = (forward) ? scores[i] : row[i];
+			double backward_score = (forward) ? row[i] : scores[i];
+			
+			if (position == 0 || (forward_score != -INFINITY && backward_score != -INFINITY)){
+				row[i] = forward_score + backward_score;
+			}
+			else{
+				row[i] = -INFINITY;
+				if (forward_score > -7.6009){
+					unscaled.push_back(std::make_pair(i, forward_score));
+					unscaled.back().first += position * state_size;
+				}
+			}
+		}
+		return true;
+	}
+	
+	
+	//!Scale the combined rows by the forward probability and normalize them
+	//!by the posterior sum of the position, as simple_posterior
+	void trellis::_posterior_finalize(posteriorSync& sync, size_t first, size_t last, std::vector<std::pair<size_t,double> >& unscaled){
+		double ending = sync.ending_forward_prob;
+		
+		for(size_t position = first; position < last; ++position){
+			std::vector<double>& row = (*sync.table)[position];
+			double& sum = sync.sums[position];
+			
+			for(size_t i = 0; i < state_size; ++i){
+				if (position == 0){
+					row[i] -= ending;
+					sum = addLog(sum, row[i]);
+				}
+				else if (row[i] != -INFINITY){
+					row[i] -= ending;
+					if (row[i] > -7.6009){  //Above significant value;
+						sum = addLog(sum, row[i]);
+					}
+				}
+			}
+		}
+		
+		for(size_t i = 0; i < unscaled.size(); ++i){
+			(*sync.table)[unscaled[i].first / state_size][unscaled[i].first % state_size] = unscaled[i].second;
+		}
+		
+		for(size_t position = first; position < last; ++position){
+			std::vector<double>& row = (*sync.table)[position];
+			for(size_t i = 0; i < state_size; ++i){
+				if (row[i] == -INFINITY){
 					continue;
 				}
-//				std::cout << "Sum:\t" << exp(posterior_sum[i]) << std::endl;
-//				std::cout << "Score:\t" << exp((*posterior_score)[i][j]) << std::endl;
 				
-				if ((*posterior_score)[i][j] > -7.6009){  //Above significant value;
-					(*posterior_score)[i][j] -= posterior_sum[i];
+				if (row[i] > -7.6009){  //Above significant value;
+					row[i] -= sync.sums[position];
 				}
 				else{
-					(*posterior_score)[i][j] = -INFINITY;
+					row[i] = -INFINITY;
+				}
+			}
+		}
+	}
+	
+	
+	//!Posteriors of a position from its forward and backward scores, without
+	//!the probability of the sequence.  Posteriors below the significant
+	//!value are dropped and the rest normalized, as simple_posterior.
+	static void _posterior_row(double* forward, std::vector<double>& backward, std::vector<double>& row){
+		size_t states = backward.size();
+		double total(-INFINITY);
+		for(size_t i = 0; i < states; ++i){
+			row[i] = (forward[i] == -INFINITY || backward[i] == -INFINITY) ? -INFINITY : forward[i] + backward[i];
+			total = addLog(total, row[i]);
+		}
+		
+		double sum(-INFINITY);
+		for(size_t i = 0; i < states && total != -INFINITY; ++i){
+			row[i] -= total;
+			if (row[i] > -7.6009){  //Above significant value;
+				sum = addLog(sum, row[i]);
+			}
+		}
+		
+		for(size_t i = 0; i < states; ++i){
+			row[i] = (row[i] > -7.6009) ? row[i] - sum : -INFINITY;
+		}
+	}
+	
+	
+	//!Windows of the sequence calculated by the threads of window_posterior
+	struct posteriorWindows{
+		pthread_mutex_t lock;
+		size_t next;			//Next window to calculate
+		size_t windows;
+		size_t window;			//Positions in each window
+		size_t overlap;			//Positions calculated on each side of a window
+		size_t compared;		//Positions of the overlap compared to the neighbours
+		double_2D* table;		//Posterior table (NULL if the rows are emitted)
+		posteriorCallback emit;
+		void* data;
+		size_t emitted;			//Windows passed to emit
+		std::vector<double> likelihood;	//Log probability of each window
+		
+		//!Posterior probabilities of the compared positions of a window,
+		//!calculated outside of it (before, after) and inside it (head, tail),
+		//!kept until the neighbouring window is finished.  Rows of the window
+		//!are kept until they are emitted.
+		struct margins{
+			margins():done(false){}
+			bool done;
+			std::vector<double> before;
+			std::vector<double> after;
+			std::vector<double> head;
+			std::vector<double> tail;
+			std::vector<std::vector<double> > rows;
+		};
+		std::vector<margins> margin;
+		double difference;		//Largest difference of the overlapping posteriors
+	};
+	
+	
+	//!Largest difference of two lists of posterior probabilities
+	static double _largest_difference(std::vector<double>& first, std::vector<double>& second, double difference){
+		for(size_t i = 0; i < first.size() && i < second.size(); ++i){
+			if (fabs(first[i] - second[i]) > difference){
+				difference = fabs(first[i] - second[i]);
+			}
+		}
+		return difference;
+	}
+	
+	
+	//!Compare the overlap of a finished window and the finished window after
+	//!it, and release the probabilities kept for it
+	static void _compare_windows(posteriorWindows& job, size_t window){
+		posteriorWindows::margins& left = job.margin[window];
+		posteriorWindows::margins& right = job.margin[window+1];
+		
+		job.difference = _largest_difference(left.after, right.head, job.difference);
+		job.difference = _largest_difference(right.before, left.tail, job.difference);
+		
+		std::vector<double>().swap(left.after);
+		std::vector<double>().swap(left.tail);
+		std::vector<double>().swap(right.before);
+		std::vector<double>().swap(right.head);
+	}
+	
+	
+	//!Approximate posterior decoding on overlapping windows of the sequence
+	//!Each window is calculated with the forward and backward algorithms from
+	//!overlap positions before and after it, starting from equal scores for
+	//!every state unless it's the start or end of the sequence.  The scores of
+	//!the overlap converge to the real scores (burn-in) so only the posteriors
+	//!of the window itself are kept.
+	//!Only the inner half of each overlap, the positions next to the window,
+	//!is compared to the posteriors of the neighbouring window.  The outer
+	//!half is still converging from the equal scores, so its differences
+	//!measure the burn-in rather than the posteriors that are kept.
+	//!With emit, the rows of each window are passed to it in order of the
+	//!positions as soon as the windows before are finished, and the posterior
+	//!table isn't allocated.
+	//!Models that aren't basic use posterior().
+	//! \param window Positions in each window
+	//! \param overlap Positions calculated on each side of a window (at most window)
+	//! \param threads Number of threads calculating windows
+	//! \param emit Function receiving the posteriors of each position (NULL
+	//! to fill the posterior table)
+	//! \param data Passed to emit
+	//! \return Largest absolute difference of the posterior probabilities of
+	//! two windows in the inner half of their overlap (-1 if posterior() was used)
+	double trellis::window_posterior(size_t window, size_t overlap, size_t threads, posteriorCallback emit, void* data){
+		if (!hmm->isBasic() || window == 0){
+			posterior();
+			for(size_t position = 0; emit != NULL && posterior_score != NULL && position < seq_size; ++position){
+				emit(position, (*posterior_score)[position], position + 1 == seq_size, data);
+			}
+			return -1;
+		}
+		
+		TRELLIS_PHASE("window_posterior");
+		
+		if (overlap > window){
+			overlap = window;
+		}
+		
+		for(size_t i = 0; i < state_size; ++i){
+			if (!emissionTiles::threadSafe((*hmm)[i])){
+				threads = 1;
+			}
+		}
+		
+		if (posterior_score != NULL){
+			delete posterior_score;
+			posterior_score = NULL;
+		}
+		
+		if (emit == NULL){
+			posterior_score = new (std::nothrow) double_2D(seq_size, std::vector<double>(state_size,-INFINITY));
+			
+			if (posterior_score == NULL){
+				std::cerr << "Can't allocate Posterior score table. OUT OF MEMORY" << std::endl;
+				exit(2);
+			}
+		}
+		
+		posteriorWindows job;
+		pthread_mutex_init(&job.lock, NULL);
+		job.next = 0;
+		job.windows = (seq_size + window - 1) / window;
+		job.window = window;
+		job.overlap = overlap;
+		job.compared = (overlap + 1) / 2;	//Inner half of the overlap
+		job.table = posterior_score;
+		job.emit = emit;
+		job.data = data;
+		job.emitted = 0;
+		job.likelihood.assign(job.windows, 0);
+		job.margin.resize(job.windows);
+		job.difference = 0;
+		
+		if (threads > job.windows){
+			threads = job.windows;
+		}
+		if (threads == 0){
+			threads = 1;
+		}
+		
+		std::vector<trellis*> helpers(threads);
+		std::vector<trellisStats> helper_stats(threads);
+		std::vector<std::pair<trellis*, posteriorWindows*> > params(threads);
+		std::vector<pthread_t> workers(threads);
+		
+		for(size_t i = 0; i < threads; ++i){
+			helpers[i] = new (std::nothrow) trellis(hmm, seqs);
+			if (helpers[i] == NULL){
+				std::cerr << "Can't allocate Posterior windows. OUT OF MEMORY" << std::endl;
+				exit(2);
+			}
+			if (stats != NULL){
+				helpers[i]->setStats(&helper_stats[i]);
+			}
+			params[i] = std::make_pair(helpers[i], &job);
+		}
+		
+		for(size_t i = 1; i < threads; ++i){
+			if (pthread_create(&workers[i], NULL, _posterior_window_start, &params[i]) != 0){
+				std::cerr << "Unable to create posterior thread" << std::endl;
+				exit(2);
+			}
+		}
+		
+		_posterior_window_start(&params[0]);
+		
+		for(size_t i = 1; i < threads; ++i){
+			pthread_join(workers[i], NULL);
+		}
+		pthread_mutex_destroy(&job.lock);
+		
+		for(size_t i = 0; i < threads; ++i){
+			if (stats != NULL){
+				stats->add(helper_stats[i]);
+			}
+			delete helpers[i];
+		}
+		
+		//Probability of the sequence is the product of the probabilities of
+		//each window given the sequence before it
+		ending_forward_prob = 0;
+		for(size_t k = 0; k < job.windows; ++k){
+			ending_forward_prob += job.likelihood[k];
+		}
+		ending_backward_prob = ending_forward_prob;
+		
+		return job.difference;
+	}
+	
+	
+	//!Calculate windows until every window is claimed
+	void* trellis::_posterior_window_start(void* ptr){
+		std::pair<trellis*, posteriorWindows*>* param = static_cast<std::pair<trellis*, posteriorWindows*>*>(ptr);
+		posteriorWindows& job = *param->second;
+		
+		while(true){
+			pthread_mutex_lock(&job.lock);
+			size_t window = job.next++;
+			pthread_mutex_unlock(&job.lock);
+			
+			if (window >= job.windows){
+				break;
+			}
+			param->first->_posterior_window(job, window);
+		}
+		return NULL;
+	}
+	
+	
+	//!Calculate the posteriors of one window and compare its overlap with the
+	//!finished neighbouring windows
+	void trellis::_posterior_window(posteriorWindows& job, size_t window){
+		size_t first = window * job.window;
+		size_t last = (first + job.window < seq_size) ? first + job.window : seq_size;
+		size_t start = (first > job.overlap) ? first - job.overlap : 0;
+		size_t end = (last + job.overlap < seq_size) ? last + job.overlap : seq_size;
+		size_t compare_start = (first > job.compared) ? first - job.compared : 0;
+		size_t compare_end = (last + job.compared < seq_size) ? last + job.compared : seq_size;
+		
+		scoring_previous = new (std::nothrow) std::vector<double> (state_size,-INFINITY);
+		scoring_current  = new (std::nothrow) std::vector<double> (state_size,-INFINITY);
+		std::vector<double> forward((end - start) * state_size, -INFINITY);
+		
+		if (scoring_previous == NULL || scoring_current == NULL){
+			std::cerr << "Can't allocate Posterior window. OUT OF MEMORY" << std::endl;
+			exit(2);
+		}
+		
+		//Forward algorithm from equal scores (or the initial state)
+		double before = (start > 0) ? log((double) state_size) : 0;
+		scoring_current->assign(state_size, 0);
+		
+		for(size_t position = start; position < end; ++position){
+			swap_ptr = scoring_previous;
+			scoring_previous = scoring_current;
+			scoring_current = swap_ptr;
+			
+			_posterior_window_forward(position);
+			_count_cells(scoring_current);
+			std::copy(scoring_current->begin(), scoring_current->end(), forward.begin() + (position - start) * state_size);
+			
+			if (position + 1 == first){
+				before = -INFINITY;
+				for(size_t i = 0; i < state_size; ++i){
+					before = addLog(before, (*scoring_current)[i]);
+				}
+			}
+		}
+		
+		double after(-INFINITY);
+		double* column = &forward[(last - 1 - start) * state_size];
+		for(size_t i = 0; i < state_size; ++i){
+			after = addLog(after, (last == seq_size) ? column[i] + (*hmm)[i]->getEndTrans() : column[i]);
+		}
+		
+		//Backward algorithm from equal scores (or the ending transitions)
+		for(size_t i = 0; i < state_size; ++i){
+			(*scoring_current)[i] = (end == seq_size) ? (*hmm)[i]->getEndTrans() : 0;
+		}
+		
+		std::vector<double> row(state_size);
+		size_t head_end = (first + job.compared < last) ? first + job.compared : last;
+		size_t tail_start = (last > first + job.compared) ? last - job.compared : first;
+		std::vector<double> margin_before((first - compare_start) * state_size);
+		std::vector<double> margin_after((compare_end - last) * state_size);
+		std::vector<double> head((window > 0) ? (head_end - first) * state_size : 0);
+		std::vector<double> tail((window + 1 < job.windows) ? (last - tail_start) * state_size : 0);
+		std::vector<std::vector<double> > rows((job.table == NULL) ? last - first : 0);
+		
+		for(size_t position = end - 1; position != SIZE_MAX && position >= start; --position){
+			_posterior_row(&forward[(position - start) * state_size], *scoring_current, row);
+			
+			if (position < first){
+				for(size_t i = 0; i < state_size && position >= compare_start; ++i){
+					margin_before[(position - compare_start) * state_size + i] = exp(row[i]);
 				}
 			}
+			else if (position >= last){
+				for(size_t i = 0; i < state_size && position < compare_end; ++i){
+					margin_after[(position - last) * state_size + i] = exp(row[i]);
+				}
+			}
+			else{
+				for(size_t i = 0; i < state_size && position < head_end && !head.empty(); ++i){
+					head[(position - first) * state_size + i] = exp(row[i]);
+				}
+				for(size_t i = 0; i < state_size && position >= tail_start && !tail.empty(); ++i){
+					tail[(position - tail_start) * state_size + i] = exp(row[i]);
+				}
+				
+				if (job.table != NULL){
+					(*job.table)[position] = row;
+				}
+				else{
+					rows[position - first] = row;
+				}
+			}
+			
+			if (position == start){
+				break;
+			}
+			
+			_count_cells(scoring_current);
+			swap_ptr = scoring_previous;
+			scoring_previous = scoring_current;
+			scoring_current = swap_ptr;
+			_posterior_window_backward(position, position);
+		}
+		
+		delete scoring_previous;
+		delete scoring_current;
+		scoring_previous = NULL;
+		scoring_current = NULL;
+		
+		//Compare the overlaps of this window and the finished neighbours
+		pthread_mutex_lock(&job.lock);
+		posteriorWindows::margins& current = job.margin[window];
+		current.done = true;
+		current.before.swap(margin_before);
+		current.after.swap(margin_after);
+		current.head.swap(head);
+		current.tail.swap(tail);
+		current.rows.swap(rows);
+		job.likelihood[window] = after - before;
+		
+		if (window > 0 && job.margin[window-1].done){
+			_compare_windows(job, window-1);
+		}
+		if (window + 1 < job.windows && job.margin[window+1].done){
+			_compare_windows(job, window);
+		}
+		
+		//Emit the rows of the finished windows that follow the emitted ones
+		while(job.emit != NULL && job.emitted < job.windows && job.margin[job.emitted].done){
+			std::vector<std::vector<double> >& finished = job.margin[job.emitted].rows;
+			size_t position = job.emitted * job.window;
+			for(size_t i = 0; i < finished.size(); ++i){
+				job.emit(position + i, finished[i], i + 1 == finished.size(), job.data);
+			}
+			std::vector<std::vector<double> >().swap(finished);
+			job.emitted++;
+		}
+		pthread_mutex_unlock(&job.lock);
+	}
+	
+	
+	//!Calculate the forward scores of a position into scoring_current from
+	//!scoring_previous
+	void trellis::_posterior_window_forward(size_t position){
+		scoring_current->assign(state_size, -INFINITY);
+		
+		if (position == 0){
+			state* init = hmm->getInitial();
+			dynamic_bitset* initial_to = hmm->getInitialTo();
+			for(size_t i = initial_to->find_first(); i != SIZE_MAX; i = initial_to->find_next(i)){
+				(*scoring_current)[i] = _emission(i, 0) + getTransition(init, i, 0);
+			}
+			return;
+		}
+		
+		bool exDef_position = exDef_defined && seqs->exDefDefined(position);
+		
+		for(size_t current = 0; current < state_size; ++current){
+			double emission = _emission(current, position);
+			
+			if (exDef_position){
+				emission += seqs->getWeight(position, current);
+			}
+			
+			if (emission == -INFINITY){
+				continue;
+			}
+			
+			dynamic_bitset* from_trans = (*hmm)[current]->getFrom();
+			for (size_t previous = from_trans->find_first(); previous != SIZE_MAX; previous = from_trans->find_next(previous)){
+				if ((*scoring_previous)[previous] != -INFINITY){
+					double forward_temp = (*scoring_previous)[previous] + emission + getTransition((*hmm)[previous], current, position);
+					(*scoring_current)[current] = addLog(forward_temp, (*scoring_current)[current]);
+				}
+			}
+		}
+	}
+	
+	
+	//!Calculate the backward scores of the position before position into
+	//!scoring_current from the backward scores of position in scoring_previous
+	//! \param position Position in the sequence
+	//! \param relative Position in the window of the sequence
+	void trellis::_posterior_window_backward(size_t position, size_t relative){
+		scoring_current->assign(state_size, -INFINITY);
+		bool exDef_position = exDef_defined && seqs->exDefDefined(position);
+		
+		for(size_t next = 0; next < state_size; ++next){
+			if ((*scoring_previous)[next] == -INFINITY){
+				continue;
+			}
+			
+			double emission = _emission(next, relative);
+			
+			if (exDef_position){
+				emission += seqs->getWeight(position, next);
+			}
+			
+			if (emission == -INFINITY){
+				continue;
+			}
+			
+			dynamic_bitset* from_trans = (*hmm)[next]->getFrom();
+			for (size_t current = from_trans->find_first(); current != SIZE_MAX; current = from_trans->find_next(current)){
+				double backward_temp = (*scoring_previous)[next] + emission + getTransition((*hmm)[current], next, relative);
+				(*scoring_current)[current] = addLog(backward_temp, (*scoring_current)[current]);
+			}
+		}
+	}
+	
+	
+	//!Fixed-lag posterior smoother on a sequence read from a seqWindow
+	//!Forward scores of the last 2 * lag positions are kept in a ring.  When
+	//!the ring is full, the backward algorithm is calculated over it from equal
+	//!scores at its last position, and the posteriors of its first lag
+	//!positions are passed to emit, so each position is smoothed with the
+	//!backward scores from lag to 2 * lag - 1 positions ahead.  The posteriors
+	//!of the last positions of the sequence use the real backward scores.
+	//!The window must retain 2 * lag symbols, so the ring is still in it.
+	//! \param h Model
+	//! \param window Window opened on the sequence (seqWindow::next() called)
+	//! \param lag Fewest positions ahead used for the posteriors of a position
+	//! \param emit Function receiving the posteriors of each position
+	//! \param data Passed to emit
+	void trellis::stream_posterior(model* h, seqWindow* window, size_t lag, posteriorCallback emit, void* data){
+		hmm = h;
+		seqs = window->getSeqs();
+		state_size		= hmm->state_size();
+		exDef_defined	= false;
+		seq_size		= 0;
+		ending_forward_prob = -INFINITY;
+		ending_backward_prob = -INFINITY;
+		
+		if (!hmm->isBasic()){
+			std::cerr << "Model isn't a simple/basic HMM.  Windowed decoding requires a basic model\n";
+			return;
 		}
 		
+		TRELLIS_PHASE("stream_posterior");
+		
+		if (lag == 0){
+			lag = 1;
+		}
+		size_t ring = 2 * lag;
+		
+		scoring_current = new (std::nothrow) std::vector<double> (state_size,-INFINITY);
+		scoring_previous= new (std::nothrow) std::vector<double> (state_size,-INFINITY);
+		std::vector<double> forward(ring * state_size, -INFINITY);
+		
+		if (scoring_current == NULL || scoring_previous == NULL){
+			std::cerr << "Can't allocate forward scores. OUT OF MEMORY" << std::endl;
+			exit(2);
+		}
+		TRELLIS_STATS(tableBytes(forward.size() * sizeof(double)));
+		
+		dynamic_bitset next_states(state_size);
+		dynamic_bitset current_states(state_size);
+		
+		size_t position(0);
+		size_t emitted(0);		//Posteriors are emitted for the positions before
+		while(window->fill()){
+			size_t start = window->getStart();
+			size_t end = start + window->size();
+			
+			for(; position < end; ++position){
+				_stream_forward_position(position, position - start, current_states, next_states);
+				_count_cells(scoring_current);
+				std::copy(scoring_current->begin(), scoring_current->end(), forward.begin() + (position % ring) * state_size);
+				
+				if (position + 1 - emitted == ring){
+					_stream_posterior_block(window, forward, emitted, position + 1, emitted + lag, emit, data);
+					emitted += lag;
+				}
+			}
+		}
+		seq_size = position;
+		
+		if (seq_size == 0){
+			delete scoring_previous;
+			delete scoring_current;
+			scoring_previous = NULL;
+			scoring_current = NULL;
+			return;
+		}
+		
+		for(size_t st_previous = 0; st_previous < state_size ;++st_previous){
+			if ((*scoring_current)[st_previous] != -INFINITY){
+				ending_forward_prob = addLog(ending_forward_prob, (*scoring_current)[st_previous] + (*hmm)[st_previous]->getEndTrans());
+			}
+		}
+		ending_backward_prob = ending_forward_prob;
+		
+		//Remaining positions from the ending transitions
+		_stream_posterior_block(window, forward, emitted, seq_size, seq_size, emit, data);
 		
 		delete scoring_previous;
 		delete scoring_current;
@@ -329,12 +1008,70 @@ namespace StochHMM {
 	}
 	
 	
+	//!Calculate the backward scores of positions of the forward ring of
+	//!stream_posterior and emit the posteriors of the first positions
+	//! \param window Window of the sequence containing the positions
+	//! \param forward Ring of forward scores
+	//! \param first First position
+	//! \param last Position after the last position (backward starts from the
+	//! ending transitions if it's the end of the sequence)
+	//! \param emitted Position after the last posterior to emit
+	void trellis::_stream_posterior_block(seqWindow* window, std::vector<double>& forward, size_t first, size_t last, size_t emitted, posteriorCallback emit, void* data){
+		if (first >= last){
+			return;
+		}
+		
+		size_t ring = forward.size() / state_size;
+		size_t start = window->getStart();
+		std::vector<double> row(state_size);
+		std::vector<std::vector<double> > rows(emitted - first, row);
+		
+		//Forward scores of the last position are still needed by stream_posterior
+		std::vector<double>* forward_previous = scoring_previous;
+		std::vector<double>* forward_current = scoring_current;
+		std::vector<double> backward_previous(state_size);
+		std::vector<double> backward_current(state_size);
+		scoring_previous = &backward_previous;
+		scoring_current = &backward_current;
+		
+		//Backward algorithm from equal scores (or the ending transitions)
+		for(size_t i = 0; i < state_size; ++i){
+			(*scoring_current)[i] = (last == seq_size) ? (*hmm)[i]->getEndTrans() : 0;
+		}
+		
+		for(size_t position = last - 1; ; --position){
+			if (position < emitted){
+				_posterior_row(&forward[(position % ring) * state_size], *scoring_current, rows[position - first]);
+			}
+			
+			if (position == first){
+				break;
+			}
+			
+			_count_cells(scoring_current);
+			swap_ptr = scoring_previous;
+			scoring_previous = scoring_current;
+			scoring_current = swap_ptr;
+			_posterior_window_backward(position, position - start);
+		}
+		
+		scoring_previous = forward_previous;
+		scoring_current = forward_current;
+		
+		for(size_t position = first; position < emitted; ++position){
+			emit(position, rows[position - first], position + 1 == emitted, data);
+		}
+	}
+	
+	
 	void trellis::traceback_posterior(traceback_path& path){
 		if (posterior_score == NULL){
 			std::cerr << __FUNCTION__ << " called before trellis::posterior was completed\n";
 			exit(2);
 		}
 		
+		TRELLIS_PHASE("traceback_posterior");
+		
 		double max(-INFINITY);
 		int16_t max_ptr(-1);
 		for(size_t position=seq_size-1; position != SIZE_MAX ;position--){
@@ -349,11 +1086,13 @@ namespace StochHMM {
                 
 			}
             path.push_back(max_ptr);
+			TRELLIS_STATS(traceback_steps++);
         }
 		return;
 	}
 	
 	void trellis::traceback_stoch_posterior(traceback_path& path){
+		TRELLIS_PHASE("traceback_stoch_posterior");
 		for (size_t position =seq_size-1; position != SIZE_MAX; --position){
             double random=((double)rand()/((double)(RAND_MAX)+(double)(1)));
             double cumulative_prob(0.0);
@@ -362,6 +1101,7 @@ namespace StochHMM {
                 cumulative_prob+=exp((*posterior_score)[position][st]);
                 if (random < cumulative_prob){
                     path.push_back( (int16_t) st);
+					TRELLIS_STATS(traceback_steps++);
                 }
             }
         }
@@ -0,0 +1,441 @@
+//
+//  seqCache.cpp
+//  StochHMM
+//
+//  Copyright (c) 2013 Korf Lab, Genome Center, UC Davis, Davis, CA. All rights reserved.
+//
+
+#include "seqCache.h"
+#include "sequences.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sstream>
+
+namespace StochHMM{
+
+	static const char CACHE_MAGIC[8] = {'S','T','O','C','H','S','Q','C'};
+	static const uint32_t CACHE_VERSION = 2;
+	static const size_t CACHE_HEADER_SIZE = 32;
+
+	//Round up to a multiple of 8 bytes
+	static inline size_t _aligned(size_t size){
+		return (size + 7) & ~((size_t) 7);
+	}
+
+
+	seqCache::seqCache():single_precision(false),data(NULL),data_size(0),index(NULL),records(0),track_count(0){
+	}
+
+	seqCache::~seqCache(){
+		close();
+	}
+
+
+	//!Does the file exist and start with the cache magic number
+	bool seqCache::isCache(const std::string& filename){
+		std::ifstream file(filename.c_str(), std::ios::binary);
+		char magic[8];
+		if (!file.read(magic, 8)){
+			return false;
+		}
+		return memcmp(magic, CACHE_MAGIC, 8) == 0;
+	}
+
+
+	//!Get the definition of a track, used to check that a cache matches the model
+	std::string seqCache::_signature(track* trk){
+		std::string signature = trk->stringify();
+		if (trk->isAmbiguousSet()){
+			signature += trk->stringifyAmbig();
+		}
+		return signature;
+	}
+
+
+	//!Describe the sequence files a cache is written from
+	//!\return path, size and modification time of each file, one per line
+	std::string seqCache::describeFiles(const std::vector<std::string>& filenames){
+		std::stringstream description;
+		for(size_t i = 0; i < filenames.size(); ++i){
+			struct stat st;
+			description << filenames[i];
+			if (stat(filenames[i].c_str(), &st) == 0){
+				description << "\t" << st.st_size << "\t" << st.st_mtime;
+			}
+			description << "\n";
+		}
+		return description.str();
+	}
+
+
+	//!Describe the regions imported into a cache
+	//!\return name:start-end of each region, one per line.  Empty if the whole
+	//!file was imported.
+	std::string seqCache::describeRegions(const std::vector<seqRegion>& regions){
+		std::stringstream description;
+		for(size_t i = 0; i < regions.size(); ++i){
+			description << regions[i].name << ":" << regions[i].start + 1 << "-";
+			if (regions[i].end != SIZE_MAX){
+				description << regions[i].end;
+			}
+			description << "\n";
+		}
+		return description.str();
+	}
+
+
+	//!Write zeros until the output is aligned to 8 bytes
+	void seqCache::_pad(){
+		static const char zeros[8] = {0,0,0,0,0,0,0,0};
+		size_t position = out.tellp();
+		out.write(zeros, _aligned(position) - position);
+	}
+
+
+	//!Create a cache file
+	//!\param filename Name of the cache file
+	//!\param model_tracks Tracks of the model
+	//!\param track_numbers Model tracks that are stored for each record
+	//!\param files Description of the sequence files (describeFiles)
+	//!\param regions Description of the imported regions (describeRegions)
+	//!\return true if the file was created
+	bool seqCache::create(const std::string& filename, tracks* model_tracks, std::vector<size_t>& track_numbers, const std::string& files, const std::string& regions){
+		close();
+
+		out.open(filename.c_str(), std::ios::binary | std::ios::trunc);
+		if (!out.is_open()){
+			std::cerr << "Can't create sequence cache: " << filename << std::endl;
+			return false;
+		}
+
+		numbers = track_numbers;
+		track_count = numbers.size();
+		records = 0;
+		offsets.clear();
+
+		//Header is written again by finish()
+		char header[CACHE_HEADER_SIZE];
+		memset(header, 0, CACHE_HEADER_SIZE);
+		out.write(header, CACHE_HEADER_SIZE);
+
+		uint32_t lengths[2] = {(uint32_t) files.size(), (uint32_t) regions.size()};
+		out.write((const char*) lengths, sizeof(lengths));
+		out.write(files.data(), files.size());
+		out.write(regions.data(), regions.size());
+		_pad();
+
+		for(size_t i = 0; i < track_count; ++i){
+			track* trk = (*model_tracks)[numbers[i]];
+			std::string signature = _signature(trk);
+			uint32_t values[3] = {(uint32_t) numbers[i], (uint32_t) (trk->getAlphaType() == REAL), (uint32_t) signature.size()};
+			out.write((const char*) values, sizeof(values));
+			out.write(signature.data(), signature.size());
+			_pad();
+		}
+
+		return out.good();
+	}
+
+
+	//!Add a record to the cache
+	//!\param seqs Sequences for each of the tracks given to create()
+	//!\return true if the record was written
+	bool seqCache::add(sequences* seqs){
+		if (!out.is_open()){
+			return false;
+		}
+
+		for(size_t i = 0; i < track_count; ++i){
+			sequence* sq = seqs->getSeq(numbers[i]);
+			if (sq == NULL){
+				std::cerr << "Missing sequence for track " << numbers[i] << " in sequence cache" << std::endl;
+				return false;
+			}
+
+			if (sq->exDefDefined()){
+				std::cerr << "External definitions of " << sq->getHeader() << " aren't stored in the sequence cache" << std::endl;
+			}
+
+			offsets.push_back(out.tellp());
+
+			std::string header = sq->getHeader();
+			std::string source = sq->getSource();
+			uint64_t length = sq->getLength();
+			uint64_t offset = sq->getOffset();
+			uint32_t encoding;
+
+			if (sq->isRealSeq()){
+				encoding = (single_precision) ? CACHE_FLOAT : CACHE_DOUBLE;
+			}
+			else{
+				//Pack if every value fits
+				uint8_t max_value = 0;
+				for(size_t j = 0; j < length; ++j){
+					max_value |= (*sq)[j];
+				}
+				encoding = (max_value < 4) ? CACHE_2BIT : (max_value < 16) ? CACHE_4BIT : CACHE_8BIT;
+			}
+
+			uint32_t values[4] = {encoding, (uint32_t) header.size(), (uint32_t) source.size(), 0};
+			out.write((const char*) &length, sizeof(length));
+			out.write((const char*) &offset, sizeof(offset));
+			out.write((const char*) values, sizeof(values));
+			out.write(header.data(), header.size());
+			out.write(source.data(), source.size());
+			_pad();
+
+			if (length == 0){
+				//No data
+			}
+			else if (encoding == CACHE_DOUBLE && sq->getRealSeq() != NULL){
+				out.write((const char*) &(*sq->getRealSeq())[0], length * sizeof(double));
+			}
+			else if (encoding == CACHE_DOUBLE){
+				//Converted without changing how the sequence stores its values
+				std::vector<double> values(length);
+				for(size_t j = 0; j < length; ++j){
+					values[j] = sq->realValue(j);
+				}
+				out.write((const char*) &values[0], length * sizeof(double));
+			}
+			else if (encoding == CACHE_FLOAT){
+				std::vector<float> single(length);
+				for(size_t j = 0; j < length; ++j){
+					single[j] = (float) sq->realValue(j);
+				}
+				out.write((const char*) &single[0], length * sizeof(float));
+			}
+			else if (encoding == CACHE_8BIT){
+				if (!sq->isPacked()){
+					out.write((const char*) &(*sq->getDigitalSeq())[0], length);
+				}
+				else{
+					//Packed sequences are written without unpacking them
+					std::vector<uint8_t> symbols(length);
+					for(size_t j = 0; j < length; ++j){
+						symbols[j] = (*sq)[j];
+					}
+					out.write((const char*) &symbols[0], length);
+				}
+			}
+			else{
+				size_t per_byte = (encoding == CACHE_2BIT) ? 4 : 2;
+				size_t bits = 8 / per_byte;
+				std::vector<uint8_t> packed((length + per_byte - 1) / per_byte, 0);
+
+				for(size_t j = 0; j < length; ++j){
+					packed[j / per_byte] |= (*sq)[j] << ((j % per_byte) * bits);
+				}
+				out.write((const char*) &packed[0], packed.size());
+			}
+			_pad();
+		}
+
+		records++;
+		return out.good();
+	}
+
+
+	//!Write the record index and header and close the cache file
+	//!\return true if the cache was written
+	bool seqCache::finish(){
+		if (!out.is_open()){
+			return false;
+		}
+
+		uint64_t index_offset = out.tellp();
+		if (!offsets.empty()){
+			out.write((const char*) &offsets[0], offsets.size() * sizeof(uint64_t));
+		}
+
+		uint32_t version[2] = {CACHE_VERSION, (uint32_t) track_count};
+		uint64_t counts[2] = {(uint64_t) records, index_offset};
+		out.seekp(0);
+		out.write(CACHE_MAGIC, 8);
+		out.write((const char*) version, sizeof(version));
+		out.write((const char*) counts, sizeof(counts));
+
+		bool success = out.good();
+		out.close();
+		offsets.clear();
+		return success;
+	}
+
+
+	//!Open and map a cache file
+	//!\return true if the file is a valid cache
+	bool seqCache::open(const std::string& filename){
+		close();
+
+		int fd = ::open(filename.c_str(), O_RDONLY);
+		if (fd < 0){
+			std::cerr << "Can't open sequence cache: " << filename << std::endl;
+			return false;
+		}
+
+		struct stat st;
+		if (fstat(fd, &st) != 0 || (size_t) st.st_size < CACHE_HEADER_SIZE){
+			std::cerr << "Invalid sequence cache: " << filename << std::endl;
+			::close(fd);
+			return false;
+		}
+
+		void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+
+		if (map == MAP_FAILED){
+			std::cerr << "Can't map sequence cache: " << filename << std::endl;
+			return false;
+		}
+
+		data = (const char*) map;
+		data_size = st.st_size;
+
+		const uint32_t* version = (const uint32_t*) (data + 8);
+		const uint64_t* counts = (const uint64_t*) (data + 16);
+
+		if (memcmp(data, CACHE_MAGIC, 8) != 0 || version[0] != CACHE_VERSION){
+			std::cerr << "Invalid sequence cache or version: " << filename << std::endl;
+			close();
+			return false;
+		}
+
+		track_count = version[1];
+		records = counts[0];
+
+		if (counts[1] > data_size || records * track_count > (data_size - counts[1]) / sizeof(uint64_t)){
+			std::cerr << "Truncated sequence cache: " << filename << std::endl;
+			close();
+			return false;
+		}
+		index = (const uint64_t*) (data + counts[1]);
+
+		//Sources
+		size_t position = CACHE_HEADER_SIZE;
+		const uint32_t* lengths = (const uint32_t*) (data + position);
+		if (position + 8 > data_size || position + 8 + (size_t) lengths[0] + lengths[1] > data_size){
+			std::cerr << "Truncated sequence cache: " << filename << std::endl;
+			close();
+			return false;
+		}
+		source_files.assign(data + position + 8, lengths[0]);
+		source_regions.assign(data + position + 8 + lengths[0], lengths[1]);
+		position = _aligned(position + 8 + lengths[0] + lengths[1]);
+
+		//Track definitions
+		for(size_t i = 0; i < track_count; ++i){
+			const uint32_t* values = (const uint32_t*) (data + position);
+			if (position + 12 > data_size || position + 12 + values[2] > data_size){
+				std::cerr << "Truncated sequence cache: " << filename << std::endl;
+				close();
+				return false;
+			}
+			numbers.push_back(values[0]);
+			signatures.push_back(std::string(data + position + 12, values[2]));
+			position = _aligned(position + 12 + values[2]);
+		}
+
+		return true;
+	}
+
+
+	//!Check that the cache was created with the same tracks as the model, from
+	//!the same sequence files and regions
+	//!\param model_tracks Tracks of the model
+	//!\param track_numbers Model tracks that will be imported
+	//!\param files Description of the sequence files (describeFiles).  If empty
+	//!the files aren't checked, so a cache can be used without the sequence files.
+	//!\param regions Description of the regions to import (describeRegions)
+	//!\return true if the cache can be used with the model
+	bool seqCache::check(tracks* model_tracks, std::vector<size_t>& track_numbers, const std::string& files, const std::string& regions){
+		if (!files.empty() && files != source_files){
+			std::cerr << "Sequence cache was written from different or modified sequence files:\n" << source_files;
+			return false;
+		}
+
+		if (regions != source_regions){
+			std::cerr << "Sequence cache was written for different regions:\n" << ((source_regions.empty()) ? "(whole file)\n" : source_regions);
+			return false;
+		}
+
+		if (track_numbers != numbers){
+			std::cerr << "Sequence cache doesn't contain the tracks used by the model" << std::endl;
+			return false;
+		}
+
+		for(size_t i = 0; i < track_count; ++i){
+			if (signatures[i] != _signature((*model_tracks)[numbers[i]])){
+				std::cerr << "Sequence cache track doesn't match the model track:\n" << signatures[i] << std::endl;
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+
+	//!Unmap the cache file
+	void seqCache::close(){
+		if (data != NULL){
+			munmap((void*) data, data_size);
+		}
+
+		if (out.is_open()){
+			out.close();
+		}
+
+		data = NULL;
+		data_size = 0;
+		index = NULL;
+		records = 0;
+		track_count = 0;
+		numbers.clear();
+		signatures.clear();
+		source_files.clear();
+		source_regions.clear();
+		offsets.clear();
+	}
+
+
+	//!Get the sequence stored for a record and track
+	//!\param record Record number
+	//!\param track Track number (position in the cache, not the model)
+	//!\param[out] block Sequence information
+	//!\return false if the sequence isn't in the cache
+	bool seqCache::getBlock(size_t record, size_t track, cacheBlock& block){
+		if (data == NULL || record >= records || track >= track_count){
+			return false;
+		}
+
+		size_t position = index[record * track_count + track];
+		if (position + 32 > data_size){
+			return false;
+		}
+
+		const uint64_t* sizes = (const uint64_t*) (data + position);
+		const uint32_t* values = (const uint32_t*) (data + position + 16);
+		block.length = sizes[0];
+		block.offset = sizes[1];
+		block.encoding = (cacheEncoding) values[0];
+		block.header_length = values[1];
+		block.source_length = values[2];
+		block.header = data + position + 32;
+		block.source = block.header + block.header_length;
+		block.data = data + _aligned(position + 32 + block.header_length + block.source_length);
+
+		size_t bytes;
+		switch(block.encoding){
+			case CACHE_2BIT:	bytes = (block.length + 3) / 4;				break;
+			case CACHE_4BIT:	bytes = (block.length + 1) / 2;				break;
+			case CACHE_8BIT:	bytes = block.length;						break;
+			case CACHE_FLOAT:	bytes = block.length * sizeof(float);		break;
+			case CACHE_DOUBLE:	bytes = block.length * sizeof(double);		break;
+			default:			return false;
+		}
+
+		return block.data + bytes <= data + data_size;
+	}
+
+}
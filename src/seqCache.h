@@ -0,0 +1,124 @@
+//
+//  seqCache.h
+//  StochHMM
+//
+//  Copyright (c) 2013 Korf Lab, Genome Center, UC Davis, Davis, CA. All rights reserved.
+//
+
+#ifndef __StochHMM__seqCache__
+#define __StochHMM__seqCache__
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "track.h"
+#include "fastaIndex.h"
+
+namespace StochHMM{
+
+	class sequences;
+
+	//!\enum cacheEncoding
+	//!How the data of a sequence is stored in the cache
+	enum cacheEncoding {CACHE_8BIT, CACHE_2BIT, CACHE_4BIT, CACHE_FLOAT, CACHE_DOUBLE};
+
+
+	//!\struct cacheBlock
+	//!Sequence stored in the cache.  Pointers are into the mapped file.
+	struct cacheBlock{
+		const char* header;
+		size_t header_length;
+		const char* source;		//Source sequence name of a region
+		size_t source_length;
+		size_t offset;			//Position of a region in the source sequence
+		size_t length;			//Number of symbols or values
+		cacheEncoding encoding;
+		const char* data;
+	};
+
+
+	/*! \class seqCache
+	 *	\brief Binary cache of digitized sequences
+	 *
+	 *	Sequences are stored already digitized, so they can be loaded without
+	 *	parsing.  Digitized tracks are packed into 2 or 4 bits per symbol when all
+	 *	of the values in the sequence allow it.  Real tracks are stored as
+	 *	doubles, or floats if single precision is set.  The file is memory-mapped
+	 *	when it is read, and sequences imported from it read their values from
+	 *	the mapping, so the cache must stay open while they are in use.
+	 *
+	 *	The cache records the sequence files it was written from (path, size and
+	 *	modification time) and the regions that were imported.  check() refuses
+	 *	a cache whose sources don't match, so a cache isn't used for other
+	 *	regions or after the sequence file was changed.
+	 *
+	 *	Layout (native byte order, all sections 8-byte aligned):
+	 *	- Header: magic "STOCHSQC", uint32 version, uint32 tracks, uint64 records,
+	 *	  uint64 offset of the record index
+	 *	- Sources: uint32 files length, uint32 regions length, the description
+	 *	  of the files (describeFiles) and of the regions (describeRegions)
+	 *	- Tracks: uint32 track number, uint32 real track, uint32 length and the
+	 *	  track definition, which must match the model when the cache is read
+	 *	- Sequences: uint64 length, uint64 offset, uint32 encoding, uint32 header
+	 *	  length, uint32 source length, uint32 unused, header, source, data
+	 *	- Record index: uint64 offset of each sequence (records x tracks)
+	 */
+	class seqCache{
+	public:
+		seqCache();
+		~seqCache();
+
+		//Writing
+		bool create(const std::string& filename, tracks* model_tracks, std::vector<size_t>& track_numbers, const std::string& files, const std::string& regions);
+		bool add(sequences* seqs);
+		bool finish();
+
+		//!Store real tracks as floats instead of doubles
+		inline void setSinglePrecision(bool single){single_precision = single;}
+
+		//Reading
+		bool open(const std::string& filename);
+		bool check(tracks* model_tracks, std::vector<size_t>& track_numbers, const std::string& files, const std::string& regions);
+		void close();
+
+		//!Number of records (jobs) in the cache
+		inline size_t size(){return records;}
+
+		//!Number of tracks in each record
+		inline size_t trackCount(){return track_count;}
+
+		bool getBlock(size_t record, size_t track, cacheBlock& block);
+
+		static bool isCache(const std::string& filename);
+		static std::string describeFiles(const std::vector<std::string>& filenames);
+		static std::string describeRegions(const std::vector<seqRegion>& regions);
+
+	private:
+		//Writing
+		std::ofstream out;
+		std::vector<uint64_t> offsets;
+		std::vector<size_t> numbers;
+		bool single_precision;
+
+		//Reading
+		const char* data;
+		size_t data_size;
+		const uint64_t* index;
+
+		size_t records;
+		size_t track_count;
+		std::vector<std::string> signatures;
+		std::string source_files;
+		std::string source_regions;
+
+		static std::string _signature(track* trk);
+		void _pad();
+	};
+
+}
+
+#endif /* defined(__StochHMM__seqCache__) */
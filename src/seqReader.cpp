@@ -0,0 +1,450 @@
+//
+//  seqReader.cpp
+//  StochHMM
+//
+//  Copyright (c) 2013 Korf Lab, Genome Center, UC Davis, Davis, CA. All rights reserved.
+//
+
+#include "seqReader.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <zlib.h>
+
+namespace StochHMM{
+
+	//Size of chunks inflated from a plain gzip stream
+	static const size_t GZIP_CHUNK = 1048576;
+
+	//Largest input given to zlib at once (avail_in is 32 bits)
+	static const size_t GZIP_MAX_INPUT = 1073741824;
+
+
+	//!Start decompressing the data in the background
+	//!\param src Compressed data
+	//!\param length Length of compressed data
+	//!\param threads Number of threads used for BGZF data
+	gzInflater::gzInflater(const char* src, size_t length, size_t threads){
+		source = (const unsigned char*) src;
+		source_size = length;
+		next_offset = 0;
+		next_index = 0;
+		consumed = 0;
+		total = SIZE_MAX;
+		exhausted = (length == 0);
+		error = false;
+		stop = false;
+
+		bgzf = (_blockSize(0) != 0);
+		if (!bgzf || threads == 0){
+			threads = 1;
+		}
+
+		slots.resize(4 * threads);
+		ready.assign(4 * threads, 0);
+
+		pthread_mutex_init(&lock, NULL);
+		pthread_cond_init(&produced, NULL);
+		pthread_cond_init(&space, NULL);
+
+		workers.resize(threads);
+		for(size_t i = 0; i < threads; ++i){
+			if (pthread_create(&workers[i], NULL, _thread_start, this) != 0){
+				std::cerr << "Unable to create decompression thread" << std::endl;
+				exit(2);
+			}
+		}
+	}
+
+
+	gzInflater::~gzInflater(){
+		pthread_mutex_lock(&lock);
+		stop = true;
+		pthread_cond_broadcast(&space);
+		pthread_mutex_unlock(&lock);
+
+		for(size_t i = 0; i < workers.size(); ++i){
+			pthread_join(workers[i], NULL);
+		}
+
+		pthread_cond_destroy(&space);
+		pthread_cond_destroy(&produced);
+		pthread_mutex_destroy(&lock);
+	}
+
+
+	//!Does the data start with the gzip magic number
+	bool gzInflater::isGzip(const char* src, size_t length){
+		return length >= 2 && (unsigned char) src[0] == 0x1f && (unsigned char) src[1] == 0x8b;
+	}
+
+
+	//!Append the next decompressed chunk to the window
+	//!Waits for the workers if the chunk isn't ready yet
+	//!\return false if there is no more data or an error occurred
+	bool gzInflater::next(std::string& window){
+		size_t slot = consumed % slots.size();
+
+		pthread_mutex_lock(&lock);
+		while(!ready[slot] && !error && consumed < total){
+			pthread_cond_wait(&produced, &lock);
+		}
+
+		if (error || !ready[slot]){
+			pthread_mutex_unlock(&lock);
+			return false;
+		}
+		pthread_mutex_unlock(&lock);
+
+		//Slot won't be reused until consumed is incremented
+		window.append(slots[slot]);
+
+		pthread_mutex_lock(&lock);
+		ready[slot] = 0;
+		consumed++;
+		pthread_cond_broadcast(&space);
+		pthread_mutex_unlock(&lock);
+		return true;
+	}
+
+
+	void* gzInflater::_thread_start(void* ptr){
+		((gzInflater*) ptr)->_work();
+		return NULL;
+	}
+
+
+	//!Get the size of the BGZF block that starts at offset
+	//!\return Size of the block or zero if it isn't a valid BGZF block
+	size_t gzInflater::_blockSize(size_t offset){
+		const unsigned char* block = source + offset;
+		if (offset + 18 > source_size || block[0] != 0x1f || block[1] != 0x8b ||
+			block[2] != 8 || !(block[3] & 4)){
+			return 0;
+		}
+
+		size_t xlen = block[10] | (block[11] << 8);
+		size_t field = 12;
+		while(field + 4 <= 12 + xlen && offset + field + 4 <= source_size){
+			size_t slen = block[field+2] | (block[field+3] << 8);
+			if (block[field] == 'B' && block[field+1] == 'C' && slen == 2 && offset + field + 6 <= source_size){
+				size_t bsize = (block[field+4] | (block[field+5] << 8)) + 1;
+				return (offset + bsize <= source_size) ? bsize : 0;
+			}
+			field += 4 + slen;
+		}
+
+		return 0;
+	}
+
+
+	//!Worker thread
+	//!Claims the next chunk, inflates it into its slot and marks it ready
+	void gzInflater::_work(){
+		z_stream strm;
+		memset(&strm, 0, sizeof(strm));
+		bool ok = (inflateInit2(&strm, 15 + 16) == Z_OK);
+
+		pthread_mutex_lock(&lock);
+		if (!ok){
+			error = true;
+			exhausted = true;
+		}
+
+		while(true){
+			while(!stop && !exhausted && next_index >= consumed + slots.size()){
+				pthread_cond_wait(&space, &lock);
+			}
+
+			if (stop || exhausted){
+				break;
+			}
+
+			size_t index = next_index++;
+			size_t offset = next_offset;
+			size_t length = 0;
+
+			if (bgzf){
+				length = _blockSize(offset);
+				if (length == 0){
+					error = true;
+					exhausted = true;
+					break;
+				}
+
+				next_offset += length;
+				if (next_offset >= source_size){
+					exhausted = true;
+					total = next_index;
+				}
+			}
+			pthread_mutex_unlock(&lock);
+
+			std::string& chunk = slots[index % slots.size()];
+			bool end(false);
+
+			if (bgzf){
+				//Block ends with uncompressed size (ISIZE)
+				const unsigned char* isize = source + offset + length - 4;
+				size_t out_size = isize[0] | (isize[1] << 8) | (isize[2] << 16) | ((size_t) isize[3] << 24);
+
+				chunk.resize(out_size + 1);
+				inflateReset(&strm);
+				strm.next_in = (Bytef*) source + offset;
+				strm.avail_in = (uInt) length;
+				strm.next_out = (Bytef*) &chunk[0];
+				strm.avail_out = (uInt) out_size + 1;
+
+				ok = (inflate(&strm, Z_FINISH) == Z_STREAM_END && strm.total_out == out_size);
+				chunk.resize(out_size);
+			}
+			else{
+				//Only one worker for plain gzip, so it owns next_offset and the stream
+				chunk.resize(GZIP_CHUNK);
+				strm.next_out = (Bytef*) &chunk[0];
+				strm.avail_out = (uInt) GZIP_CHUNK;
+
+				while(strm.avail_out > 0){
+					if (strm.avail_in == 0 && next_offset < source_size){
+						size_t feed = std::min(source_size - next_offset, GZIP_MAX_INPUT);
+						strm.next_in = (Bytef*) source + next_offset;
+						strm.avail_in = (uInt) feed;
+						next_offset += feed;
+					}
+
+					int ret = inflate(&strm, Z_NO_FLUSH);
+
+					if (ret == Z_STREAM_END){
+						//Concatenated gzip members are read as one stream
+						size_t position = (const unsigned char*) strm.next_in - source;
+						if (isGzip((const char*) strm.next_in, source_size - position)){
+							inflateReset(&strm);
+							continue;
+						}
+						end = true;
+						break;
+					}
+					else if (ret != Z_OK){
+						ok = false;
+						break;
+					}
+				}
+
+				chunk.resize(GZIP_CHUNK - strm.avail_out);
+			}
+
+			pthread_mutex_lock(&lock);
+			if (!ok){
+				error = true;
+				exhausted = true;
+			}
+			else if (end){
+				exhausted = true;
+				total = next_index;
+			}
+
+			ready[index % slots.size()] = 1;
+			pthread_cond_broadcast(&produced);
+		}
+
+		pthread_cond_broadcast(&produced);
+		pthread_mutex_unlock(&lock);
+
+		inflateEnd(&strm);
+		return;
+	}
+
+
+	seqReader::seqReader():data(NULL),size(0),pos(0),source(NULL),source_size(0),opened(false),mapped(false),threads(1),inflater(NULL){
+	}
+
+	seqReader::~seqReader(){
+		close();
+	}
+
+
+	//!Open the file and map it into memory
+	//!If the file is gzip or BGZF compressed it is decompressed in the background
+	//!\param filename Name of file to open
+	//!\return true if the file was opened
+	bool seqReader::open(const std::string& filename){
+		close();
+
+		int fd = ::open(filename.c_str(), O_RDONLY);
+		if (fd < 0){
+			return false;
+		}
+
+		struct stat st;
+		if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0){
+			void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (map != MAP_FAILED){
+				madvise(map, st.st_size, MADV_SEQUENTIAL);
+				source = (const char*) map;
+				source_size = st.st_size;
+				mapped = true;
+			}
+		}
+
+		//Can't map the file so read it into the buffer
+		if (!mapped){
+			char chunk[65536];
+			ssize_t n;
+			while((n = ::read(fd, chunk, sizeof(chunk))) > 0){
+				buffer.append(chunk, n);
+			}
+
+			if (n < 0){
+				::close(fd);
+				buffer.clear();
+				return false;
+			}
+
+			source = buffer.data();
+			source_size = buffer.size();
+		}
+		::close(fd);
+
+		if (gzInflater::isGzip(source, source_size)){
+			inflater = new(std::nothrow) gzInflater(source, source_size, threads);
+			if (inflater == NULL){
+				std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+				exit(1);
+			}
+			data = window.data();
+			size = 0;
+		}
+		else{
+			data = source;
+			size = source_size;
+		}
+
+		opened = true;
+		return true;
+	}
+
+
+	//!Close the file and unmap the memory
+	void seqReader::close(){
+		//Stop the workers before the source is unmapped
+		delete inflater;
+		inflater = NULL;
+
+		if (mapped){
+			munmap((void*) source, source_size);
+		}
+
+		buffer.clear();
+		window.clear();
+		data = NULL;
+		size = 0;
+		pos = 0;
+		source = NULL;
+		source_size = 0;
+		mapped = false;
+		opened = false;
+		return;
+	}
+
+
+	//!Refill the window with the next decompressed chunk
+	//!Data before the current position is discarded
+	//!\return true if more data was added
+	bool seqReader::_fill(){
+		if (inflater == NULL){
+			return false;
+		}
+
+		window.erase(0, pos);
+		pos = 0;
+
+		size_t previous = window.size();
+		while(window.size() == previous && inflater->next(window)){
+		}
+
+		data = window.data();
+		size = window.size();
+
+		if (inflater->failed()){
+			std::cerr << "Error decompressing sequence file" << std::endl;
+			delete inflater;
+			inflater = NULL;
+		}
+
+		return size > previous;
+	}
+
+
+	//!Refill the window until the line at the current position is complete
+	//!\return Pointer to the newline or NULL if the file ends without one
+	const char* seqReader::_fillLine(){
+		size_t scanned = size - pos;
+		while(_fill()){
+			const char* nl = (const char*) memchr(data + scanned, '\n', size - scanned);
+			if (nl != NULL){
+				return nl;
+			}
+			scanned = size;
+		}
+		return NULL;
+	}
+
+
+	//!Get the next line as a std::string
+	//!\return false if there are no more lines
+	bool seqReader::getLine(std::string& line){
+		const char* start;
+		size_t length;
+		if (!getLine(start, length)){
+			line.clear();
+			return false;
+		}
+
+		line.assign(start, length);
+		return true;
+	}
+
+
+	//!Copy the next bytes of the file
+	//!\param dest Buffer to copy the bytes to
+	//!\param length Number of bytes to copy
+	//!\return number of bytes copied.  Less than length at the end of the file
+	size_t seqReader::read(char* dest, size_t length){
+		size_t copied = 0;
+		while (copied < length && (pos < size || _fill())){
+			size_t count = (size - pos < length - copied) ? size - pos : length - copied;
+			memcpy(dest + copied, data + pos, count);
+			pos += count;
+			copied += count;
+		}
+		return copied;
+	}
+
+
+	//!Get the number of bytes before the next line that starts with marker
+	//!Used to preallocate the memory for a record.  Includes newlines, so it is
+	//!an upper bound of the number of symbols in the record.  For compressed
+	//!files only the current window is searched, so it may be an underestimate.
+	//!\param marker Character that starts the next record
+	size_t seqReader::recordSize(char marker){
+		const char* current = data + pos;
+		const char* end = data + size;
+
+		while (current < end){
+			const char* nl = (const char*) memchr(current, '\n', end - current);
+			if (nl == NULL || nl + 1 >= end){
+				break;
+			}
+
+			if (nl[1] == marker){
+				return (nl + 1) - (data + pos);
+			}
+			current = nl + 1;
+		}
+
+		return size - pos;
+	}
+
+}
@@ -0,0 +1,200 @@
+//
+//  seqReader.h
+//  StochHMM
+//
+//  Copyright (c) 2013 Korf Lab, Genome Center, UC Davis, Davis, CA. All rights reserved.
+//
+
+#ifndef __StochHMM__seqReader__
+#define __StochHMM__seqReader__
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+namespace StochHMM{
+
+	/*! \class gzInflater
+	 *	\brief Background decompression of gzip and BGZF data
+	 *
+	 *	Decompressed chunks are produced by worker threads into a ring of slots
+	 *	and returned to the reader in file order.  BGZF blocks are independent,
+	 *	so they are decompressed by all the workers at once.  A plain gzip stream
+	 *	can only be inflated in order, so it uses a single worker that runs ahead
+	 *	of the reader.  Workers stop when the ring is full until the reader
+	 *	catches up.
+	 */
+	class gzInflater{
+	public:
+		gzInflater(const char* src, size_t length, size_t threads);
+		~gzInflater();
+
+		bool next(std::string& window);
+
+		//!Was there an error decompressing the data
+		inline bool failed(){return error;}
+
+		//!Is the data in BGZF format
+		inline bool isBGZF(){return bgzf;}
+
+		static bool isGzip(const char* src, size_t length);
+
+	private:
+		const unsigned char* source;
+		size_t source_size;
+		bool bgzf;
+
+		size_t next_offset;		//Offset of next compressed block to claim
+		size_t next_index;		//Index of next chunk to claim
+		size_t consumed;		//Number of chunks returned to reader
+		size_t total;			//Total number of chunks (SIZE_MAX until known)
+		bool exhausted;			//No more chunks to claim
+		bool error;
+		bool stop;
+
+		std::vector<std::string> slots;
+		std::vector<char> ready;
+
+		pthread_mutex_t lock;
+		pthread_cond_t produced;
+		pthread_cond_t space;
+		std::vector<pthread_t> workers;
+
+		static void* _thread_start(void*);
+		void _work();
+		size_t _blockSize(size_t offset);
+	};
+
+
+	/*! \class seqReader
+	 *	\brief Line reader for sequence files
+	 *
+	 *	The file is memory-mapped and lines are returned as pointers into the
+	 *	mapped memory, so they are never copied.  Lines are found with memchr.
+	 *	If the file can't be mapped (pipes, special files), it is read into memory.
+	 *	A trailing '\r' is removed from each line.
+	 *
+	 *	Gzip and BGZF files are detected by their magic number and decompressed
+	 *	by a gzInflater into a window that is refilled as lines are read.  In that
+	 *	case a line is only valid until the next call to the reader.
+	 */
+	class seqReader{
+	public:
+		seqReader();
+		~seqReader();
+
+		bool open(const std::string& filename);
+		void close();
+
+		//!Set the number of threads used to decompress BGZF files
+		inline void setThreads(size_t n){threads = (n==0) ? 1 : n;}
+
+		//!Is the file open
+		inline bool is_open(){return opened;}
+
+		//!Is the file compressed
+		inline bool is_compressed(){return inflater!=NULL;}
+
+		//!Is there any remaining data to read (blank lines are skipped)
+		inline bool good(){
+			do{
+				while (pos < size && (data[pos] == '\n' || data[pos] == '\r')){
+					++pos;
+				}
+			}while(pos >= size && _fill());
+			return pos < size;
+		}
+
+		//!Get the next character without consuming it
+		//!\return character or EOF if at end of file
+		inline int peek(){
+			if (pos >= size && !_fill()){
+				return EOF;
+			}
+			return (unsigned char) data[pos];
+		}
+
+		//!Get the next line without the newline
+		//!\param[out] line Pointer to start of the line
+		//!\param[out] length Length of the line
+		//!\return false if there are no more lines
+		inline bool getLine(const char*& line, size_t& length){
+			if (pos >= size && !_fill()){
+				return false;
+			}
+
+			const char* nl = (const char*) memchr(data + pos, '\n', size - pos);
+			if (nl == NULL && inflater != NULL){
+				nl = _fillLine();
+			}
+
+			line = data + pos;
+			length = (nl == NULL) ? size - pos : nl - line;
+			pos += (nl == NULL) ? length : length + 1;
+
+			if (length > 0 && line[length-1] == '\r'){
+				--length;
+			}
+			return true;
+		}
+
+		bool getLine(std::string&);
+		
+		size_t read(char*, size_t);
+		
+		//!Number of bytes left in the data that has been read or mapped
+		//!For uncompressed files this is the rest of the file
+		inline size_t available(){return size - pos;}
+
+		size_t recordSize(char marker);
+
+		//!Current offset in the file (uncompressed files only)
+		inline size_t tell(){return pos;}
+
+		//!Move to offset in the file (uncompressed files only)
+		inline void seek(size_t offset){
+			if (inflater == NULL){
+				pos = (offset < size) ? offset : size;
+			}
+		}
+
+		//!Get a pointer to bytes in the file (uncompressed files only)
+		//!\return NULL if the range is outside of the file or the file is compressed
+		inline const char* getRange(size_t offset, size_t length){
+			if (inflater != NULL || offset > size || length > size - offset){
+				return NULL;
+			}
+			return data + offset;
+		}
+
+	private:
+		const char* data;	//Current data (whole file or decompressed window)
+		size_t size;
+		size_t pos;
+
+		const char* source;	//Whole file
+		size_t source_size;
+
+		bool opened;
+		bool mapped;
+		size_t threads;
+
+		//Used when file can't be mapped
+		std::string buffer;
+
+		//Used when file is compressed
+		gzInflater* inflater;
+		std::string window;
+
+		bool _fill();
+		const char* _fillLine();
+	};
+
+}
+
+#endif /* defined(__StochHMM__seqReader__) */
@@ -178,12 +178,25 @@ namespace StochHMM{
     
     //!Destroy seqTracks
     seqTracks::~seqTracks(){
+        //exit() may be called by the producer thread if a sequence can't be imported
+        if (producer_running && pthread_equal(producer, pthread_self())){
+            return;
+        }
+        
+        _stopProducer();
+        
         for(size_t i=0;i<filehandles.size();i++){
             if (filehandles[i]!=NULL){
                 filehandles[i]->close();
             }
         }
         
+        for(size_t i=0;i<indices.size();i++){
+            delete indices[i];
+        }
+        
+        delete cache;
+        
         hmms=NULL;
         trackFunctions = NULL;
         attribModelFunc = NULL;
@@ -195,12 +208,24 @@ namespace StochHMM{
             element = NULL;
         }
         
+        pthread_mutex_destroy(&queue_lock);
+        pthread_cond_destroy(&queue_filled);
+        pthread_cond_destroy(&queue_space);
+        
         return;
     }
     
     
     void seqTracks::_init(){
         numImportJobs=1;
+        readerThreads=1;
+        packSequences=false;
+        realFormat=REAL_TEXT;
+        realFormatSet=false;
+        singleReal=false;
+        regionIter=0;
+        cache=NULL;
+        cacheIter=0;
         jobs=0;
         
         hmms    = NULL;
@@ -215,21 +240,33 @@ namespace StochHMM{
         good=false;
         
         //Make seqTrack thread-safe
-#ifdef THREADS
-        pthread_mutex_init(&exit_thread_flag_mutex, NULL);
-        pthread_cond_init(&exit_thread_flag_cv, NULL);
-#endif
-        exit_thread=1;
+        pthread_mutex_init(&queue_lock, NULL);
+        pthread_cond_init(&queue_filled, NULL);
+        pthread_cond_init(&queue_space, NULL);
+        producer_running=false;
+        producer_stop=false;
+        producer_done=false;
     }
     
     //Reset the Queue, Files, and Import Tracks
     //Does not reset track Functions or Attribute model selection functions 
     void seqTracks::_reset(){
+        _stopProducer();
+        
         for(size_t i=0;i<filehandles.size();i++){
             delete filehandles[i];
         }
         
+        for(size_t i=0;i<indices.size();i++){
+            delete indices[i];
+        }
+        
         filehandles.clear();
+        indices.clear();
+        
+        delete cache;
+        cache = NULL;
+        cacheIter = 0;
         seqFilenames.clear();
         
         hmms    = NULL;
@@ -239,8 +276,6 @@ namespace StochHMM{
         
         good = false;
         
-        exit_thread = 1;
-        
         importTracks.clear();
     }
 
@@ -571,49 +606,232 @@ namespace StochHMM{
     }
 
     
+    ///////////////////////////////////////////////////////////////////////////////
+    ////////////////////////////  Sequence Cache  /////////////////////////////////
+    ///////////////////////////////////////////////////////////////////////////////
+    
+    //! Load the sequences from a sequence cache instead of sequence files
+    //! The cache must have been written for the same model tracks and regions
+    //! \param mod  Model to be used
+    //! \param cacheFile  Sequence cache filename
+    bool seqTracks::loadCache(model& mod, std::string& cacheFile){
+        std::vector<std::string> seqFiles;
+        return loadCache(mod, cacheFile, seqFiles);
+    }
+    
+    
+    //! Load the sequences from a sequence cache instead of sequence files
+    //! The cache must have been written for the same model tracks and regions,
+    //! from the sequence files as they are now
+    //! \param mod  Model to be used
+    //! \param cacheFile  Sequence cache filename
+    //! \param seqFiles  Sequence files the cache should have been written from.
+    //! If empty, the cache is used without checking the files.
+    bool seqTracks::loadCache(model& mod, std::string& cacheFile, std::vector<std::string>& seqFiles){
+        if (filehandles.size()>0 || importTracks.size()>0 || cache!=NULL){
+            _reset();
+        }
+        
+        hmm = &mod;
+        seqFormat = FASTA;
+        
+        info = mod.getStateInfo();
+        _initImportTrackInfo();
+        fileType = (importTracks.size()>1) ? MULTI_TRACK : SINGLE_TRACK;
+        
+        cache = new(std::nothrow) seqCache;
+        
+        if (cache==NULL){
+            std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+            exit(1);
+        }
+        
+        std::vector<size_t> numbers;
+        for(size_t i=0;i<importTracks.size();i++){
+            numbers.push_back(importTracks[i].first);
+        }
+        
+        if (!cache->open(cacheFile) || !cache->check(modelTracks, numbers, seqCache::describeFiles(seqFiles), seqCache::describeRegions(regions))){
+            _reset();
+            return false;
+        }
+        
+        cacheIter = 0;
+        good = (cache->size() > 0);
+        
+        //Fill Job Queue
+        importJobs();
+        
+        return true;
+    }
+    
+    
+    //! Write all of the remaining sequences to a sequence cache
+    //! The jobs are imported and written one at a time, so the queue is empty afterwards
+    //! \param cacheFile  Sequence cache filename
+    //! \param seqFiles  Sequence files the jobs were loaded from, recorded in the cache
+    bool seqTracks::writeCache(std::string& cacheFile, std::vector<std::string>& seqFiles){
+        seqCache writer;
+        
+        std::vector<size_t> numbers;
+        for(size_t i=0;i<importTracks.size();i++){
+            numbers.push_back(importTracks[i].first);
+        }
+        
+        if (!writer.create(cacheFile, modelTracks, numbers, seqCache::describeFiles(seqFiles), seqCache::describeRegions(regions))){
+            return false;
+        }
+        
+        seqJob* job;
+        while((job = getJob()) != NULL){
+            if (!writer.add(job->getSeqs())){
+                delete job;
+                return false;
+            }
+            delete job;
+        }
+        
+        return writer.finish();
+    }
+    
+    
     //!Get the next sequence(s) and model from the job queue
-    //!If the number of jobs falls below MIN_JOBS/2 then refill the queue
-    //!Else give pointer to the next job in the queue
+    //!Waits for the producer thread if the queue is empty
+    //!\return NULL if there are no more jobs
     seqJob* seqTracks::getJob(){
         seqJob *jb= NULL;
         
-        //Check job queue and if necessary fill the job queue
-        if ((jobs==0 || (jobs < (numImportJobs/2))) && good){
-            while(good && jobs<numImportJobs){
-                getNext();
-            }
+        if (!producer_running){
+            _startProducer();
         }
         
-        if (!good){
-            if (fileType==SINGLE_TRACK){
-                if (seqFilenames.size()>importTracks.size()){
-                    _close();
-                    _open();
-                }
-                else{
-                    _close();
-                }
-            }
-            else {
-                if (seqFilenames.size()>0){
-                    _close();
-                    _open();
-                }
-                else{
-                    _close();
-                }
-            }
+        pthread_mutex_lock(&queue_lock);
+        
+        while(jobs==0 && !producer_done){
+            pthread_cond_wait(&queue_filled, &queue_lock);
         }
         
         if (jobs>0){
             jb=jobQueue.front();
             jobQueue.pop();
             jobs--;
+            pthread_cond_signal(&queue_space);
         }
         
+        pthread_mutex_unlock(&queue_lock);
+        
         return jb;
     }
     
+    
+    //!Number of jobs waiting in the queue
+    size_t seqTracks::size(void){
+        pthread_mutex_lock(&queue_lock);
+        size_t waiting = jobQueue.size();
+        pthread_mutex_unlock(&queue_lock);
+        return waiting;
+    }
+    
+    
+    //!Close the current sequence files and open the next ones
+    //!\return false if there are no more files
+    bool seqTracks::_nextFiles(){
+        size_t remaining = seqFilenames.size();
+        bool more = (fileType==SINGLE_TRACK) ? remaining>importTracks.size() : remaining>1;
+        
+        _close();
+        
+        //Stop if the files couldn't be closed (incomplete set of track files)
+        if (!more || seqFilenames.size()==remaining){
+            return false;
+        }
+        
+        _open();
+        return true;
+    }
+    
+    
+    //!Get the format of the real number file of a file handle
+    RealFileFormat seqTracks::_realFormat(size_t handle){
+        if (realFormatSet){
+            return realFormat;
+        }
+        return realFileFormat(seqFilenames[handle]);
+    }
+    
+    
+    void* seqTracks::_producer_start(void* arg){
+        ((seqTracks*) arg)->_produce();
+        return NULL;
+    }
+    
+    
+    //!Import jobs until all of the files are read
+    //!Waits while the queue holds numImportJobs jobs
+    void seqTracks::_produce(){
+        while(true){
+            pthread_mutex_lock(&queue_lock);
+            while(jobs>=numImportJobs && !producer_stop){
+                pthread_cond_wait(&queue_space, &queue_lock);
+            }
+            bool stop = producer_stop;
+            pthread_mutex_unlock(&queue_lock);
+            
+            if (stop){
+                break;
+            }
+            
+            if (good){
+                getNext();
+            }
+            else if (!_nextFiles()){
+                break;
+            }
+        }
+        
+        pthread_mutex_lock(&queue_lock);
+        producer_done=true;
+        pthread_cond_broadcast(&queue_filled);
+        pthread_mutex_unlock(&queue_lock);
+    }
+    
+    
+    //!Start the thread that imports the jobs
+    void seqTracks::_startProducer(){
+        if (producer_running){
+            return;
+        }
+        
+        producer_stop=false;
+        producer_done=false;
+        producer_running=true;
+        
+        if (pthread_create(&producer, NULL, _producer_start, this) != 0){
+            std::cerr << "Unable to create sequence import thread" << std::endl;
+            exit(2);
+        }
+    }
+    
+    
+    //!Stop and join the thread that imports the jobs
+    //!Jobs already in the queue are kept
+    void seqTracks::_stopProducer(){
+        if (!producer_running){
+            return;
+        }
+        
+        pthread_mutex_lock(&queue_lock);
+        producer_stop=true;
+        pthread_cond_broadcast(&queue_space);
+        pthread_mutex_unlock(&queue_lock);
+        
+        pthread_join(producer, NULL);
+        
+        producer_running=false;
+        producer_stop=false;
+        producer_done=false;
+    }
+    
       
     
     
@@ -644,6 +862,17 @@ namespace StochHMM{
         //Determine which tracks to import and which to get by using track functions
         track* tempTrack;
         trackCount= temp->track_size();
+        
+        pdfTracks.assign(trackCount, false);
+        if (hmms!=NULL){
+            for(size_t i=0;i<hmms->size();i++){
+                _markPDFTracks((*hmms)[i]);
+            }
+        }
+        else{
+            _markPDFTracks(temp);
+        }
+        
         for(size_t i=0;i<trackCount;i++){
             tempTrack = temp->getTrack(i);
             if (tempTrack->isTrackFuncDefined()){
@@ -663,6 +892,29 @@ namespace StochHMM{
         return true;
     }
 
+    //!Mark the tracks that PDF transitions of a model read
+    //!PDF functions are passed the vector of doubles, so these tracks aren't
+    //!stored as floats or read in place from a sequence cache
+    void seqTracks::_markPDFTracks(model* mod){
+        for(size_t i=0;i<=mod->state_size();i++){
+            state* st = (i < mod->state_size()) ? mod->getState(i) : mod->getInitial();
+            std::vector<transition*>* trans = st->getTransitions();
+            
+            for(size_t j=0;j<trans->size();j++){
+                transition* tr = (*trans)[j];
+                if (tr == NULL || tr->getTransitionType() != PDF || tr->getPDFTrack() == NULL){
+                    continue;
+                }
+                
+                size_t index = tr->getPDFTrack()->getIndex();
+                if (index < pdfTracks.size()){
+                    pdfTracks[index] = true;
+                }
+            }
+        }
+        return;
+    }
+    
     //!Print the seqTracks to stdout
     void seqTracks::print(){
         
@@ -673,17 +925,9 @@ namespace StochHMM{
     }
 
 
-    //!Get a job and Add to the queue
+    //!Start importing jobs into the queue in the background
     bool seqTracks::importJobs(){
-        while(good && jobs<numImportJobs){
-            getNext();
-        }
-        
-        if (!good && seqFilenames.size()>importTracks.size()){
-            _close();
-            _open();
-        }
-        
+        _startProducer();
         return true;
     }
 
@@ -710,7 +954,38 @@ namespace StochHMM{
         for(size_t i=0;i<importTracks.size();i++){
             bool success;
 
-            if (importTracks[i].second == REAL){
+            if (cache!=NULL){
+                sq=new(std::nothrow) sequence(importTracks[i].second == REAL);
+                
+                if (sq==NULL){
+                    std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+                    exit(1);
+                }
+                
+                success = sq->getCached(*cache, cacheIter, i, (*modelTracks)[importTracks[i].first]);
+            }
+            else if (!regions.empty()){
+                sq=new(std::nothrow) sequence(false);
+                
+                if (sq==NULL){
+                    std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+                    exit(1);
+                }
+                
+                //Multiple tracks per file use the ith record with the region name
+                size_t handle = (fileType == SINGLE_TRACK) ? i : 0;
+                size_t occurrence = (fileType == SINGLE_TRACK) ? 0 : i;
+                const faiRecord* rec = indices[handle]->find(regions[regionIter].name, occurrence);
+                
+                if (rec==NULL){
+                    std::cerr << "Sequence " << regions[regionIter].name << " isn't in " << seqFilenames[handle] << std::endl;
+                    success = false;
+                }
+                else{
+                    success = sq->getFastaRegion(*filehandles[handle], *rec, regions[regionIter], (*modelTracks)[importTracks[i].first]);
+                }
+            }
+            else if (importTracks[i].second == REAL){
                 sq=new(std::nothrow) sequence(true);
                 
                 if (sq==NULL){
@@ -718,11 +993,14 @@ namespace StochHMM{
                     exit(1);
                 }
                 
-                if (fileType == SINGLE_TRACK){
-                    success = sq->getReal(*filehandles[i], (*modelTracks)[importTracks[i].first]);
+                size_t handle = (fileType == SINGLE_TRACK) ? i : 0;
+                RealFileFormat format = _realFormat(handle);
+                
+                if (format != REAL_TEXT){
+                    success = sq->getRealBinary(*filehandles[handle], (*modelTracks)[importTracks[i].first], format, seqFilenames[handle], singleReal);
                 }
                 else{
-                    success = sq->getReal(*filehandles[0], (*modelTracks)[importTracks[i].first]);
+                    success = sq->getReal(*filehandles[handle], (*modelTracks)[importTracks[i].first], info);
                 }
                 
             }
@@ -757,7 +1035,10 @@ namespace StochHMM{
             }
             
             
-            if (fileType == SINGLE_TRACK){
+            if (cache!=NULL || !regions.empty()){
+                //Checked after all tracks are imported
+            }
+            else if (fileType == SINGLE_TRACK){
                 if (!filehandles[i]->good()){
                     good=false;
                 }
@@ -769,7 +1050,7 @@ namespace StochHMM{
             }
             
             if (!success){
-                std::cerr << "Failed to import data track from " << seqFilenames[i] << std::endl;
+                std::cerr << "Failed to import data track from " << ((cache!=NULL) ? "sequence cache" : seqFilenames[i]) << std::endl;
                 delete sq;
                 sq = NULL;
             }
@@ -779,13 +1060,26 @@ namespace StochHMM{
                 break;
             }
             else{
+                if (packSequences && !sq->isRealSeq()){
+                    sq->pack();
+                }
+                else if (sq->isRealSeq() && pdfTracks[importTracks[i].first]){
+                    sq->toDoublePrecision();
+                }
+                else if (singleReal && sq->isRealSeq()){
+                    sq->toSinglePrecision();
+                }
+                
                 //If exDef is defined in sequence put it in sequences
                 if (sq->exDefDefined()){
                     temp_job->set->setExDef(sq->getExDef());
                 }
                 temp_job->set->addSeq(sq,importTracks[i].first);
                 
-                if (fileType==SINGLE_TRACK){
+                if (cache!=NULL){
+                    //Sequences aren't from a file
+                }
+                else if (fileType==SINGLE_TRACK){
                     temp_job->setSeqFilename(seqFilenames[i]);
                 }
                 else{
@@ -795,6 +1089,19 @@ namespace StochHMM{
         }
         
         
+        if (cache!=NULL){
+            cacheIter++;
+            if (cacheIter >= cache->size()){
+                good=false;
+            }
+        }
+        else if (!regions.empty()){
+            regionIter++;
+            if (regionIter >= regions.size()){
+                good=false;
+            }
+        }
+        
         if (valid){
             
             //Get sequences defined by sequence external function that is user-defined
@@ -876,8 +1183,12 @@ namespace StochHMM{
 
             }
             temp_job->set->setLength(lengthOfAll);
+            
+            pthread_mutex_lock(&queue_lock);
             jobQueue.push(temp_job);
             jobs++;
+            pthread_cond_signal(&queue_filled);
+            pthread_mutex_unlock(&queue_lock);
         }
         else{
             delete temp_job;
@@ -899,7 +1210,7 @@ namespace StochHMM{
             }
             
             for(size_t i = 0; i<importTracks.size();i++){
-                std::ifstream *SEQ= new(std::nothrow) std::ifstream;
+                seqReader *SEQ= new(std::nothrow) seqReader;
                 
                 if (SEQ==NULL){
                     std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
@@ -907,19 +1218,21 @@ namespace StochHMM{
                 }
                 
                 filehandles.push_back(SEQ);
+                SEQ->setThreads(readerThreads);
                 
                 if (seqFilenames.size()<i+1){
                     return false;
                 }
                 
-                filehandles[i]->open(seqFilenames[i].c_str());
-                
-                if (!filehandles[i]->is_open()){
+                if (!filehandles[i]->open(seqFilenames[i])){
                     std::cerr << "Can't open sequence file: "  << seqFilenames[i] << std::endl;
                     return false;
                 }
                 
-                if (filehandles[i]->good()){
+                //good() skips newlines, which would be data in a binary file
+                bool binary = (importTracks[i].second == REAL && _realFormat(i) != REAL_TEXT);
+                
+                if ((binary) ? filehandles[i]->peek() != EOF : filehandles[i]->good()){
                     good = true;
                 }
                 else{
@@ -937,7 +1250,7 @@ namespace StochHMM{
         }
         else {
             
-            std::ifstream *SEQ= new(std::nothrow) std::ifstream;
+            seqReader *SEQ= new(std::nothrow) seqReader;
             
             if (SEQ==NULL){
                 std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
@@ -945,14 +1258,20 @@ namespace StochHMM{
             }
             
             filehandles.push_back(SEQ);
+            SEQ->setThreads(readerThreads);
             
-            filehandles[0]->open(seqFilenames[0].c_str());
-            
-            if (!filehandles[0]->is_open()){
+            if (!filehandles[0]->open(seqFilenames[0])){
                 std::cerr << "Can't open sequence file: "  << seqFilenames[0] << std::endl;
                 return false;
             }
             
+            for(size_t i = 0; i < importTracks.size(); i++){
+                if (importTracks[i].second == REAL && _realFormat(0) != REAL_TEXT){
+                    std::cerr << "Binary real number files can only contain a single track: " << seqFilenames[0] << std::endl;
+                    return false;
+                }
+            }
+            
             if (filehandles[0]->good()){
                 good = true;
             }
@@ -962,13 +1281,55 @@ namespace StochHMM{
             }
         }
         
-        
+        //Regions are read directly using an index of each file
+        if (!regions.empty() && good){
+            if (seqFormat != FASTA){
+                std::cerr << "Regions can only be imported from FASTA files" << std::endl;
+                good = false;
+                return false;
+            }
+            
+            for(size_t i = 0; i < importTracks.size(); i++){
+                if (importTracks[i].second == REAL){
+                    std::cerr << "Regions can't be imported for real number tracks" << std::endl;
+                    good = false;
+                    return false;
+                }
+            }
+            
+            for(size_t i = 0; i < filehandles.size(); i++){
+                fastaIndex* index = new(std::nothrow) fastaIndex;
+                
+                if (index==NULL){
+                    std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+                    exit(1);
+                }
+                
+                indices.push_back(index);
+                
+                if (!index->load(seqFilenames[i], *filehandles[i])){
+                    good = false;
+                    return false;
+                }
+            }
+            
+            regionIter = 0;
+        }
                 
         return true;
     }
                    
                    
     bool seqTracks::_close(){
+        for(size_t i=0;i<indices.size();i++){
+            delete indices[i];
+        }
+        indices.clear();
+        
+        if (filehandles.empty()){
+            return true;
+        }
+        
         if (fileType == SINGLE_TRACK){
             for(size_t i=0;i<importTracks.size();i++){
                 //std::cout << importTracks.size() << "\t" << filehandles.size() << std::endl;
@@ -984,7 +1345,7 @@ namespace StochHMM{
             }
         }
         else{
-            filehandles[0]->clear();
+            filehandles[0]->close();
             delete filehandles[0];
             filehandles.erase(filehandles.begin());
             seqFilenames.erase(seqFilenames.begin());
@@ -38,21 +38,18 @@
 #include "hmm.h"
 #include "sequences.h"
 #include <stdlib.h>
+#include <pthread.h>
 
 
 
 
 namespace StochHMM{
     
-        
-#ifdef THREADS
-    extern pthread_cond_t exit_thread_flag_cv;
-    extern pthread_mutex_t exit_thread_flag_mutex;
-#endif 
-    
     //!\file seqTracks.h
     //! Contains functions to import FASTA/FASTQ sequences from files and select the applicable model to deal with that sequence.
     //! It was set up to generate a seqJob for each sequence, then select a model, and then allow the programmer to thread the decoding algorithm.
+    //! Jobs are imported by a producer thread into a bounded queue of numImportJobs jobs, so the next
+    //! sequences are parsed and digitized while the current job is decoded.
     
     //!\enum SeqFileFormat
     //!File format of the sequences
@@ -145,13 +142,38 @@ namespace StochHMM{
         bool loadSeqs(models&, std::vector<std::string>&, SeqFileFormat, SeqFilesType); //only allow if pt2Attrib is set else error
         bool loadSeqs(models&, std::vector<std::string>&, SeqFileFormat, SeqFilesType, pt2Attrib*);
         
+        ////////////////  Sequence Cache  ////////////////////
+        bool loadCache(model&, std::string&);
+        bool loadCache(model&, std::string&, std::vector<std::string>&);
+        bool writeCache(std::string&, std::vector<std::string>&);
+        
 
         //!Sets the function to evaluate the which model to use with a particular sequence
         inline void setAttribFunc(pt2Attrib* func){attribModelFunc=func;}
 		
 		//!Sets a trackfunction that will be evaluated to generate a necessary track for the model
         inline void setTrackFunc(TrackFuncs* func){trackFunctions=func;}
-        inline void setNumImportJobs(size_t value){numImportJobs=value;}
+        
+        //!Sets the number of jobs that are imported ahead of the job being decoded
+        inline void setNumImportJobs(size_t value){numImportJobs=(value==0) ? 1 : value;}
+        
+        //!Sets the number of threads used to decompress BGZF sequence files
+        inline void setReaderThreads(size_t value){readerThreads=value;}
+        
+        //!Sets whether digitized sequences are packed into 2 or 4 bits per symbol
+        //!(default false).  Packed sequences are unpacked by sequence::getDigitalSeq()
+        inline void setPacking(bool value){packSequences=value;}
+        
+        //!Sets the format of real number track files
+        //!If it isn't set the format is chosen by the filename extension
+        inline void setRealFormat(RealFileFormat value){realFormat=value; realFormatSet=true;}
+        
+        //!Sets whether real number tracks are stored as floats instead of doubles
+        inline void setSingleReal(bool value){singleReal=value;}
+        
+        //!Sets the regions to import from indexed FASTA files
+        //!Only these regions are imported instead of the whole sequences
+        inline void setRegions(std::vector<seqRegion>& list){regions=list; regionIter=0;}
         
         void setTrackFilename(std::string&,std::string&);
 
@@ -165,7 +187,7 @@ namespace StochHMM{
         sequence* getFastq(int);
         sequence* getReal(int);
         
-        size_t size(void){return jobQueue.size();}
+        size_t size(void);
         inline size_t getTrackCount(){return trackCount;}
         
         void print();
@@ -177,9 +199,19 @@ namespace StochHMM{
         
     private:
         
-        std::vector<std::ifstream*> filehandles; //input file stream
+        std::vector<seqReader*> filehandles; //input file readers
         std::vector<std::string> seqFilenames; //input filenames
+        std::vector<fastaIndex*> indices; //FASTA indices (regions only)
+        std::vector<seqRegion> regions; //regions to import
+        size_t regionIter; //next region to import
+        seqCache* cache; //pre-digitized sequences
+        size_t cacheIter; //next cache record to import
         size_t numImportJobs;
+        size_t readerThreads;
+        bool packSequences;
+        RealFileFormat realFormat;
+        bool realFormatSet;
+        bool singleReal;
         bool good;
         
         TrackFuncs* trackFunctions;
@@ -192,6 +224,7 @@ namespace StochHMM{
         
         std::vector<std::pair<int,trackType> > importTracks;
         std::vector<ppTrack> postprocessTracks;
+        std::vector<bool> pdfTracks; //Real tracks passed to PDF transitions as doubles
         
         
         models* hmms; //Models
@@ -212,7 +245,6 @@ namespace StochHMM{
         //Threading Variables
         std::queue<seqJob*> jobQueue; //used to be trcks
         size_t jobs;  //Counts of # of jobs waiting
-        int exit_thread;  //set to 0 if file stream is EOF
         
         
         //External Definition import function for Sequence
@@ -226,10 +258,27 @@ namespace StochHMM{
         
         
         bool _initImportTrackInfo(void);
+        void _markPDFTracks(model*);
         void _reset();
         void _init();
         bool _open();
         bool _close();
+        bool _nextFiles();
+        RealFileFormat _realFormat(size_t);
+        
+        //Producer thread
+        pthread_t producer;
+        pthread_mutex_t queue_lock;
+        pthread_cond_t queue_filled;  //Signaled when a job is added or the producer is done
+        pthread_cond_t queue_space;   //Signaled when a job is removed or the producer should stop
+        bool producer_running;  //Producer thread has been started and not joined
+        bool producer_stop;     //Producer thread should exit
+        bool producer_done;     //No more jobs will be added to the queue
+        
+        static void* _producer_start(void*);
+        void _produce();
+        void _startProducer();
+        void _stopProducer();
     };
     
     
@@ -41,6 +41,14 @@ namespace StochHMM{
         max_mask=-1;
         external= NULL;
         attrib  = -INFINITY;
+        offset  = 0;
+        packed  = NULL;
+        packed_bits = 0;
+        packed_shift = 0;
+        packed_data = NULL;
+        real_single = NULL;
+        cached_real = NULL;
+        cached_single = false;
     }
     
     //!Create a sequence data type
@@ -71,6 +79,14 @@ namespace StochHMM{
         max_mask=-1;
         external= NULL;
         attrib  = -INFINITY;
+        offset  = 0;
+        packed  = NULL;
+        packed_bits = 0;
+        packed_shift = 0;
+        packed_data = NULL;
+        real_single = NULL;
+        cached_real = NULL;
+        cached_single = false;
     }
     
     //! \brief Create a sequence typ
@@ -80,8 +96,17 @@ namespace StochHMM{
         realSeq = true;
         seqtrk  = tr;
         real    = vec;
+        seq     = NULL;
         external= NULL;
         attrib  = -INFINITY;
+        offset  = 0;
+        packed  = NULL;
+        packed_bits = 0;
+        packed_shift = 0;
+        packed_data = NULL;
+        real_single = NULL;
+        cached_real = NULL;
+        cached_single = false;
         length  = vec->size();
         max_mask=-1;
     }
@@ -102,6 +127,14 @@ namespace StochHMM{
         
         external= NULL;
         attrib  = -INFINITY;
+        offset  = 0;
+        packed  = NULL;
+        packed_bits = 0;
+        packed_shift = 0;
+        packed_data = NULL;
+        real_single = NULL;
+        cached_real = NULL;
+        cached_single = false;
         realSeq = false;
         seqtrk  = tr;
         undigitized = sq;
@@ -126,6 +159,14 @@ namespace StochHMM{
         
         external= NULL;
         attrib  = -INFINITY;
+        offset  = 0;
+        packed  = NULL;
+        packed_bits = 0;
+        packed_shift = 0;
+        packed_data = NULL;
+        real_single = NULL;
+        cached_real = NULL;
+        cached_single = false;
         realSeq = false;
         seqtrk  = tr;
         undigitized = sq;
@@ -138,9 +179,13 @@ namespace StochHMM{
         delete seq;
         delete real;
         delete mask;
+        delete packed;
+        delete real_single;
         
         seq     = NULL;
+        packed  = NULL;
         real    = NULL;
+        real_single = NULL;
         mask    = NULL;
         seqtrk  = NULL;
         external= NULL;
@@ -154,6 +199,8 @@ namespace StochHMM{
         realSeq = rhs.realSeq;
         header  = rhs.header;
         attrib  = rhs.attrib;
+        offset  = rhs.offset;
+        source  = rhs.source;
         length  = rhs.length;
         seqtrk  = rhs.seqtrk;
         external= rhs.external;  //Need copy constructor for this
@@ -171,6 +218,24 @@ namespace StochHMM{
             seq=NULL;
         }
         
+        packed_bits = rhs.packed_bits;
+        packed_shift = rhs.packed_shift;
+        if (rhs.packed!=NULL){
+            packed = new(std::nothrow) std::vector<uint64_t>(*rhs.packed);
+            if (packed==NULL){
+                std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+                exit(1);
+            }
+            packed_data = (packed->empty()) ? NULL : &(*packed)[0];
+        }
+        else{
+            packed=NULL;
+            packed_data = rhs.packed_data;  //Shares the sequence cache mapping
+        }
+        
+        cached_real = rhs.cached_real;
+        cached_single = rhs.cached_single;
+        
         if (rhs.real!=NULL){
             real = new(std::nothrow) std::vector<double>(*rhs.real);
             if (real==NULL){
@@ -182,6 +247,17 @@ namespace StochHMM{
             real=NULL;
         }
         
+        if (rhs.real_single!=NULL){
+            real_single = new(std::nothrow) std::vector<float>(*rhs.real_single);
+            if (real_single==NULL){
+                std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+                exit(1);
+            }
+        }
+        else{
+            real_single=NULL;
+        }
+        
         if (rhs.mask!=NULL){
             mask = new(std::nothrow) std::vector<int>(*rhs.mask);
             if (mask==NULL){
@@ -210,17 +286,35 @@ namespace StochHMM{
 			real->clear();
 		}
 		
+		if (real_single!=NULL){
+			delete real_single;
+			real_single = NULL;
+		}
+		
 		if (seq!=NULL){
 			seq->clear();
 		}
 		
+		if (packed!=NULL){
+			delete packed;
+			packed = NULL;
+		}
+		packed_data = NULL;
+		packed_bits = 0;
+		packed_shift = 0;
+		cached_real = NULL;
+		cached_single = false;
+		
 		if (external!=NULL){
 			delete external;
+			external = NULL;
 		}
 		
 		seqtrk = NULL;
 		length = 0;
 		attrib = -INFINITY;
+		offset = 0;
+		source.clear();
 		
 	}
     
@@ -247,10 +341,22 @@ namespace StochHMM{
 			mask = NULL;
 		}
 		
+		if (packed!= NULL){
+			delete packed;
+			packed = NULL;
+		}
+		
+		if (real_single!= NULL){
+			delete real_single;
+			real_single = NULL;
+		}
+		
 		//Copy rhs over to this
         realSeq = rhs.realSeq;
         header  = rhs.header;
         attrib  = rhs.attrib;
+        offset  = rhs.offset;
+        source  = rhs.source;
         length  = rhs.length;
         seqtrk  = rhs.seqtrk;
         external= rhs.external;
@@ -268,6 +374,24 @@ namespace StochHMM{
             seq=NULL;
         }
         
+        packed_bits = rhs.packed_bits;
+        packed_shift = rhs.packed_shift;
+        if (rhs.packed!=NULL){
+            packed = new(std::nothrow) std::vector<uint64_t>(*rhs.packed);
+            if (packed==NULL){
+                std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+                exit(1);
+            }
+            packed_data = (packed->empty()) ? NULL : &(*packed)[0];
+        }
+        else{
+            packed=NULL;
+            packed_data = rhs.packed_data;  //Shares the sequence cache mapping
+        }
+        
+        cached_real = rhs.cached_real;
+        cached_single = rhs.cached_single;
+        
         if (rhs.real!=NULL){
             real = new(std::nothrow) std::vector<double>(*rhs.real);
             if (real==NULL){
@@ -279,6 +403,17 @@ namespace StochHMM{
             real=NULL;
         }
         
+        if (rhs.real_single!=NULL){
+            real_single = new(std::nothrow) std::vector<float>(*rhs.real_single);
+            if (real_single==NULL){
+                std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+                exit(1);
+            }
+        }
+        else{
+            real_single=NULL;
+        }
+        
         if (rhs.mask!=NULL){
             mask = new(std::nothrow) std::vector<int>(*rhs.mask);
             if (mask==NULL){
@@ -300,7 +435,7 @@ namespace StochHMM{
     uint8_t sequence::seqValue (size_t position){
         if (!realSeq){
             if (seq!=NULL){
-                return (*seq)[position];
+                return (*this)[position];
             }
             else{
                 std::cerr << "sequence has not been digitized. \n";
@@ -318,7 +453,13 @@ namespace StochHMM{
     //! \return positioin 
     double sequence::realValue(size_t position){
         if (realSeq){
-            if (real!=NULL){
+            if (real_single!=NULL){
+                return (*real_single)[position];
+            }
+            else if (cached_real!=NULL){
+                return (cached_single) ? ((const float*) cached_real)[position] : ((const double*) cached_real)[position];
+            }
+            else if (real!=NULL){
                 return (*real)[position];
             }
             else{
@@ -347,12 +488,12 @@ namespace StochHMM{
         
         if (realSeq){
             for(size_t i=0;i<length;i++){
-                output+= double_to_string((*real)[i]) + " ";
+                output+= double_to_string(realValue(i)) + " ";
             }
         }
         else{
             for(size_t i=0;i<length;i++){
-                output+= int_to_string((int)(*seq)[i]) + " ";
+                output+= int_to_string((int)(*this)[i]) + " ";
             }
         }
         
@@ -381,12 +522,12 @@ namespace StochHMM{
         
         if (realSeq){
             for(size_t i=0;i<length;i++){
-                output+= double_to_string((*real)[i]) + " ";
+                output+= double_to_string(realValue(i)) + " ";
             }
         }
         else{
             for(size_t i=0;i<length;i++){
-                output+= int_to_string((int)(*seq)[i]) + " ";
+                output+= int_to_string((int)(*this)[i]) + " ";
             }
         }
         
@@ -424,7 +565,7 @@ namespace StochHMM{
             size_t alphaMax = seqtrk->getAlphaMax();
             
             for (size_t i=0;i<length;i++){
-                output+=seqtrk->getAlpha((*seq)[i]);
+                output+=seqtrk->getAlpha((*this)[i]);
                 if (alphaMax!=1){
                     output+=" ";
                 }
@@ -506,6 +647,630 @@ namespace StochHMM{
         return success;
     }
     
+	//!Extract sequence from a memory-mapped fasta file
+	//!Single character alphabets are digitized directly from the file into the
+	//!digital sequence using the track's symbol table.  The digital sequence is
+	//!preallocated from the size of the record.
+	//! \param file Sequence file reader
+	//! \param trk Track to use for digitizing sequence
+	//! \param info stateInfo from model used to parse External Definitions
+	//! \return true if function was able to get a sequence from the file
+	bool sequence::getFasta(seqReader& file, track* trk, stateInfo* info){
+		
+		if (seq!=NULL){
+			this->clear();
+		}
+		else{
+			seq = new(std::nothrow) std::vector<uint8_t>;
+			if (seq==NULL){
+				std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+				exit(1);
+			}
+		}
+		
+		seqtrk=trk;
+		
+		if (!file.good()){
+			return false;
+		}
+		
+		if (seqtrk==NULL){
+			std::cerr << "Can't digitize sequence without a valid track defined\n";
+			return false;
+		}
+		
+		const char* line(NULL);
+		size_t line_length(0);
+		
+		//Find next header mark
+		while(file.peek() != '>'){
+			if (!file.getLine(line, line_length) || !file.good()){
+				std::cerr << "Sequence doesn't contain a header \">\" "<< std::endl;
+				return false;
+			}
+		}
+		
+		file.getLine(header);
+		
+		bool single_char = (seqtrk->getAlphaMax() == 1);
+		size_t filled(0);
+		std::string exdef;
+		
+		if (single_char){
+			seq->resize(file.recordSize('>'));
+		}
+		
+		//get sequence
+		while(file.peek() != '>' && file.peek() != EOF){
+			if (file.peek() == '['){
+				_readExDef(file, exdef);
+				continue;
+			}
+			
+			if (!file.getLine(line, line_length)){
+				break;
+			}
+			
+			if (single_char){
+				_digitize(line, line_length, filled);
+			}
+			else{
+				undigitized.append(line, line_length);
+			}
+		}
+		
+		bool success(true);
+		if (single_char){
+			seq->resize(filled);
+		}
+		else{
+			success = _digitize();
+		}
+		
+		length=seq->size();
+		
+		if (!exdef.empty()){
+			success &= _parseExDef(exdef, length, info);
+		}
+		
+		return success;
+	}
+	
+	
+	//! Import a region of a sequence from an indexed FASTA file
+	//! Only the lines within the region are read.  The header is set to
+	//! name:start-end and the offset to the start of the region.
+	//! \param file Sequence file reader
+	//! \param rec Index record of the sequence
+	//! \param region Region of the sequence to import
+	//! \param trk Track to used to digitize
+	//! \return true if the sequence was successfully imported
+	bool sequence::getFastaRegion(seqReader& file, const faiRecord& rec, const seqRegion& region, track* trk){
+		
+		if (seq!=NULL){
+			this->clear();
+		}
+		else{
+			seq = new(std::nothrow) std::vector<uint8_t>;
+			if (seq==NULL){
+				std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+				exit(1);
+			}
+		}
+		
+		seqtrk=trk;
+		
+		if (seqtrk==NULL){
+			std::cerr << "Can't digitize sequence without a valid track defined\n";
+			return false;
+		}
+		
+		size_t end = std::min(region.end, rec.length);
+		if (region.start >= end){
+			std::cerr << "Region " << region.name << ":" << region.start+1 << " is outside of the sequence" << std::endl;
+			return false;
+		}
+		
+		std::stringstream head;
+		head << ">" << rec.name << ":" << region.start+1 << "-" << end;
+		header = head.str();
+		source = rec.name;
+		offset = region.start;
+		
+		bool single_char = (seqtrk->getAlphaMax() == 1);
+		size_t filled(0);
+		
+		if (single_char){
+			seq->resize(end - region.start);
+		}
+		
+		//Read the region one line at a time
+		for(size_t pos = region.start; pos < end;){
+			size_t count = std::min(rec.line_bases - pos % rec.line_bases, end - pos);
+			const char* line = file.getRange(fastaIndex::position(rec, pos), count);
+			
+			if (line == NULL){
+				std::cerr << "Unable to read region " << header.substr(1) << " from file" << std::endl;
+				return false;
+			}
+			
+			if (single_char){
+				_digitize(line, count, filled);
+			}
+			else{
+				undigitized.append(line, count);
+			}
+			
+			pos += count;
+		}
+		
+		bool success(true);
+		if (!single_char){
+			success = _digitize();
+		}
+		
+		length=seq->size();
+		return success;
+	}
+	
+	
+	//!Is the computer little-endian
+	static inline bool _littleEndian(){
+		const uint16_t one = 1;
+		return *((const uint8_t*) &one) == 1;
+	}
+	
+	
+	//! Import a digitized sequence from a sequence cache
+	//! The sequence refers to the mapped cache instead of copying it
+	//! \param cache Opened sequence cache
+	//! \param record Record to import
+	//! \param trk_number Track within the record
+	//! \param trk Track of the model
+	//! \return true if the sequence was successfully imported
+	bool sequence::getCached(seqCache& cache, size_t record, size_t trk_number, track* trk){
+		cacheBlock block;
+		if (!cache.getBlock(record, trk_number, block)){
+			std::cerr << "Unable to read record " << record << " from sequence cache" << std::endl;
+			return false;
+		}
+		
+		bool real_block = (block.encoding == CACHE_FLOAT || block.encoding == CACHE_DOUBLE);
+		if (real_block != realSeq || (realSeq && real == NULL) || (!realSeq && seq == NULL)){
+			std::cerr << "Sequence cache track type doesn't match the model track" << std::endl;
+			return false;
+		}
+		
+		clear();
+		
+		seqtrk = trk;
+		header.assign(block.header, block.header_length);
+		source.assign(block.source, block.source_length);
+		offset = block.offset;
+		length = block.length;
+		
+		//Values are read in place from the mapping, so the cache has to stay
+		//open while the sequence is used.  Packed symbols share the layout of
+		//the packed words only on little-endian hosts; otherwise they're copied.
+		if (block.encoding == CACHE_DOUBLE || block.encoding == CACHE_FLOAT){
+			cached_real = block.data;
+			cached_single = (block.encoding == CACHE_FLOAT);
+		}
+		else if (_littleEndian()){
+			packed_data = (const uint64_t*) block.data;
+			packed_bits = (block.encoding == CACHE_2BIT) ? 2 : (block.encoding == CACHE_4BIT) ? 4 : 8;
+			packed_shift = (block.encoding == CACHE_2BIT) ? 5 : (block.encoding == CACHE_4BIT) ? 4 : 3;
+		}
+		else if (block.encoding == CACHE_8BIT){
+			const uint8_t* src = (const uint8_t*) block.data;
+			seq->assign(src, src + length);
+		}
+		else{
+			const uint8_t* src = (const uint8_t*) block.data;
+			seq->resize(length);
+			uint8_t* dst = (length > 0) ? &(*seq)[0] : NULL;
+			
+			if (block.encoding == CACHE_2BIT){
+				for(size_t i = 0; i < length; ++i){
+					dst[i] = (src[i >> 2] >> ((i & 3) << 1)) & 3;
+				}
+			}
+			else{
+				for(size_t i = 0; i < length; ++i){
+					dst[i] = (src[i >> 1] >> ((i & 1) << 2)) & 15;
+				}
+			}
+		}
+		
+		return true;
+	}
+	
+	
+	//! Import one fastq entry from a memory-mapped file
+	//! \param file Sequence file reader
+	//! \param trk Track to used to digitize
+	//! \return true if the sequence was successfully imported
+	bool sequence::getFastq(seqReader& file, track* trk){
+		
+		if (seq!=NULL){
+			this->clear();
+		}
+		else{
+			seq = new(std::nothrow) std::vector<uint8_t>;
+			if (seq==NULL){
+				std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+				exit(1);
+			}
+		}
+		
+		seqtrk=trk;
+		
+		if (!file.good()){
+			return false;
+		}
+		
+		if (seqtrk==NULL){
+			std::cerr << "Can't digitize sequence without a valid track defined\n";
+			return false;
+		}
+		
+		const char* line(NULL);
+		size_t line_length(0);
+		
+		//Move down until the next line has a "@"
+		while(file.peek() != '@'){
+			if (!file.getLine(line, line_length) || !file.good()){
+				return false;
+			}
+		}
+		
+		//Get Header (One line)
+		file.getLine(header);
+		
+		bool single_char = (seqtrk->getAlphaMax() == 1);
+		size_t filled(0);
+		
+		if (single_char){
+			seq->resize(file.recordSize('+'));
+		}
+		
+		//Get sequence (Multiple Lines)
+		while(file.peek() != '+' && file.peek() != EOF){
+			if (!file.getLine(line, line_length)){
+				break;
+			}
+			
+			if (single_char){
+				_digitize(line, line_length, filled);
+			}
+			else{
+				undigitized.append(line, line_length);
+			}
+		}
+		
+		if (single_char){
+			seq->resize(filled);
+		}
+		else{
+			_digitize();
+		}
+		length=seq->size();
+		
+		//Skip "+" line
+		if (!file.getLine(line, line_length)){
+			return false;
+		}
+		
+		//Get Quality String (Multiple Lines) until it is the length of the sequence
+		size_t quality_length(0);
+		while(quality_length < length && file.getLine(line, line_length)){
+			quality_length += line_length;
+		}
+		
+		return true;
+	}
+	
+	
+	//! Import one Real number sequence from a memory-mapped file
+	//! \param file Sequence file reader
+	//! \param trk Track to used to digitize
+	//! \param info stateInfo from model used to parse External Definitions
+	//! \return true if the sequence was successfully imported
+	bool sequence::getReal(seqReader& file, track* trk, stateInfo* info){
+		
+		if (real!=NULL){
+			this->clear();
+		}
+		else{
+			real = new(std::nothrow) std::vector<double>;
+			if (real==NULL){
+				std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+				exit(1);
+			}
+		}
+		
+		seqtrk=trk;
+		
+		if (!file.good()){
+			return false;
+		}
+		
+		const char* line(NULL);
+		size_t line_length(0);
+		
+		//get header
+		while(file.peek() != '>'){
+			if (!file.getLine(line, line_length) || !file.good()){
+				std::cerr << "Sequence doesn't contain a header \">\" "<< std::endl;
+				return false;
+			}
+		}
+		
+		file.getLine(header);
+		
+		//get sequence
+		std::string exdef;
+		size_t record_size = file.recordSize('>');
+		bool reserved = false;
+		
+		while(file.peek() != '>' && file.peek() != EOF){
+			if (file.peek() == '['){
+				_readExDef(file, exdef);
+				continue;
+			}
+			
+			if (!file.getLine(line, line_length)){
+				break;
+			}
+			_parseReals(line, line_length);
+			
+			//Reserve space for the record using the characters per value of the first line
+			if (!reserved && !real->empty()){
+				real->reserve(record_size / (line_length / real->size() + 1) + real->size());
+				reserved = true;
+			}
+		}
+		
+		length = real->size();
+		
+		if (!exdef.empty()){
+			return _parseExDef(exdef, length, info);
+		}
+		
+		return true;
+	}
+	
+	
+	//!Parse the comma, tab or space delimited numbers of a line into real
+	//!Anything that isn't a number is imported as zero
+	//! \param line Pointer to the characters of the line
+	//! \param line_length Number of characters
+	void sequence::_parseReals(const char* line, size_t line_length){
+		const char* pos = line;
+		const char* end = line + line_length;
+		
+		while(pos < end){
+			while(pos < end && (*pos == ' ' || *pos == '\t' || *pos == ',')){
+				++pos;
+			}
+			
+			if (pos >= end){
+				break;
+			}
+			
+			double value;
+			parseDouble(pos, end, value);
+			real->push_back(value);
+			
+			//Skip the rest of the value
+			while(pos < end && *pos != ' ' && *pos != '\t' && *pos != ','){
+				++pos;
+			}
+		}
+		return;
+	}
+	
+	
+	//!Append little-endian binary values to a vector
+	//! \param src Binary values
+	//! \param count Number of values
+	//! \param dest Vector to append the values to
+	template<typename SOURCE, typename DEST>
+	static void _appendBinary(const char* src, size_t count, std::vector<DEST>& dest){
+		size_t start = dest.size();
+		dest.resize(start + count);
+		DEST* out = &dest[start];
+		
+		if (_littleEndian()){
+			for(size_t i = 0; i < count; ++i){
+				SOURCE value;
+				memcpy(&value, src + i * sizeof(SOURCE), sizeof(SOURCE));
+				out[i] = value;
+			}
+		}
+		else{
+			for(size_t i = 0; i < count; ++i){
+				char bytes[sizeof(SOURCE)];
+				std::reverse_copy(src + i * sizeof(SOURCE), src + (i + 1) * sizeof(SOURCE), bytes);
+				SOURCE value;
+				memcpy(&value, bytes, sizeof(SOURCE));
+				out[i] = value;
+			}
+		}
+		return;
+	}
+	
+	
+	//!Get the format of a real number file from the filename extension
+	//!.f32 or .float32 are REAL_FLOAT32, .f64 or .float64 are REAL_FLOAT64.
+	//!Anything else is REAL_TEXT.
+	//! \param filename Name of the file
+	RealFileFormat realFileFormat(const std::string& filename){
+		size_t dot = filename.find_last_of("./");
+		if (dot == std::string::npos || filename[dot] != '.'){
+			return REAL_TEXT;
+		}
+		
+		std::string extension = filename.substr(dot + 1);
+		if (extension == "f32" || extension == "float32"){
+			return REAL_FLOAT32;
+		}
+		else if (extension == "f64" || extension == "float64"){
+			return REAL_FLOAT64;
+		}
+		return REAL_TEXT;
+	}
+	
+	
+	//!Import a binary file of real numbers
+	//!The rest of the file is a single sequence without a header, so the
+	//!filename is used as the header.
+	//! \param file Sequence file reader
+	//! \param trk Track of the sequence
+	//! \param format REAL_FLOAT32 or REAL_FLOAT64
+	//! \param filename Name of the file
+	//! \param single Store the values as floats instead of doubles
+	bool sequence::getRealBinary(seqReader& file, track* trk, RealFileFormat format, const std::string& filename, bool single){
+		
+		if (real!=NULL){
+			this->clear();
+		}
+		else{
+			real = new(std::nothrow) std::vector<double>;
+			if (real==NULL){
+				std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+				exit(1);
+			}
+		}
+		
+		seqtrk=trk;
+		
+		if (format == REAL_TEXT){
+			std::cerr << "Binary real number format not given for " << filename << std::endl;
+			return false;
+		}
+		
+		if (single){
+			real_single = new(std::nothrow) std::vector<float>;
+			if (real_single==NULL){
+				std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+				exit(1);
+			}
+		}
+		
+		size_t slash = filename.find_last_of('/');
+		header = ">" + filename.substr((slash == std::string::npos) ? 0 : slash + 1);
+		
+		size_t width = (format == REAL_FLOAT32) ? sizeof(float) : sizeof(double);
+		
+		//Size is only known if the file isn't compressed
+		if (!file.is_compressed()){
+			if (single){
+				real_single->reserve(file.available() / width);
+			}
+			else{
+				real->reserve(file.available() / width);
+			}
+		}
+		
+		char buffer[65536];
+		size_t filled = 0;
+		size_t bytes;
+		while((bytes = file.read(buffer + filled, sizeof(buffer) - filled)) > 0){
+			filled += bytes;
+			size_t count = filled / width;
+			
+			if (format == REAL_FLOAT32 && single){
+				_appendBinary<float>(buffer, count, *real_single);
+			}
+			else if (format == REAL_FLOAT32){
+				_appendBinary<float>(buffer, count, *real);
+			}
+			else if (single){
+				_appendBinary<double>(buffer, count, *real_single);
+			}
+			else{
+				_appendBinary<double>(buffer, count, *real);
+			}
+			
+			filled -= count * width;
+			memmove(buffer, buffer + count * width, filled);
+		}
+		
+		if (filled != 0){
+			std::cerr << "Size of binary real number file isn't a multiple of " << width << " bytes: " << filename << std::endl;
+			return false;
+		}
+		
+		length = (single) ? real_single->size() : real->size();
+		return true;
+	}
+	
+	
+	//!Digitize single character symbols into seq starting at filled
+	//!seq must already be large enough (preallocated) or it will be extended
+	//! \param line Pointer to the characters to digitize
+	//! \param line_length Number of characters
+	//! \param filled Number of symbols in seq.  Incremented by line_length
+	void sequence::_digitize(const char* line, size_t line_length, size_t& filled){
+		if (filled + line_length > seq->size()){
+			seq->resize(filled + line_length);
+		}
+		
+		const uint8_t* table = seqtrk->getSymbolTable();
+		uint8_t* digital = &(*seq)[filled];
+		
+		for(size_t i = 0; i < line_length; ++i){
+			uint8_t symbl = table[(unsigned char) line[i]];
+			
+			//Not defined in the alphabet, so let the track handle it (ambiguous or error)
+			if (symbl == 255){
+				symbl = seqtrk->symbolIndex((unsigned char) line[i]);
+			}
+			
+			digital[i] = symbl;
+		}
+		
+		filled += line_length;
+		return;
+	}
+	
+	
+	//!Read the External Definition lines ("[" lines) from the file
+	//! \param file Sequence file reader
+	//! \param exdef String to append the definition lines to
+	void sequence::_readExDef(seqReader& file, std::string& exdef){
+		const char* line;
+		size_t line_length;
+		
+		while(file.peek() == '[' && file.getLine(line, line_length)){
+			exdef.append(line, line_length);
+			exdef += '\n';
+		}
+		return;
+	}
+	
+	
+	//!Parse the External Definitions of the sequence
+	//! \param exdef External Definition lines
+	//! \param size Length of the sequence
+	//! \param info stateInfo from model
+	bool sequence::_parseExDef(std::string& exdef, size_t size, stateInfo* info){
+		if (info == NULL){
+			std::cerr << "Found brackets [] in fasta sequence.\nHEADER: " << header << "\nCan't import External Definitions without stateInfo from HMM model.  Pass stateInfo from model to " << __FUNCTION__ << std::endl;
+			exit(2);
+		}
+		
+		external= new (std::nothrow) ExDefSequence(size);
+		if (external==NULL){
+			std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+			exit(1);
+		}
+		
+		std::istringstream defs(exdef);
+		return external->parse(defs, *info);
+	}
+    
     bool sequence::getMaskedFasta(std::ifstream& file, track* trk){
 		
 		if (seq!=NULL){
@@ -849,12 +1614,37 @@ namespace StochHMM{
         seqtrk = tr;
         realSeq = true;
         real=rl;
+        cached_real = NULL;
 		
 		length = rl->size();
 		
 		return;
     }
     
+    //!Set the sequence from a vector of digital values
+    //!The sequence takes ownership of the vector
+    //! \param dg Digitized values of the alphabet in the track
+    //! \param tr Track that defines the alphabet
+    void sequence::setDigitalSeq(std::vector<uint8_t>* dg, track* tr){
+        if (seq != dg){
+            delete seq;
+        }
+        delete packed;
+        
+        seqtrk = tr;
+        realSeq = false;
+        seq = dg;
+        packed = NULL;
+        packed_data = NULL;
+        packed_bits = 0;
+        packed_shift = 0;
+        undigitized.clear();
+        
+        length = dg->size();
+        
+        return;
+    }
+    
     
     //! Get the symbol (alphabet character or word) for a a given position of a alphanumerical sequence
     //! \param pos  Position within sequence
@@ -871,7 +1661,7 @@ namespace StochHMM{
             return "";
         }
         
-        return seqtrk->getAlpha((*seq)[pos]);
+        return seqtrk->getAlpha((*this)[pos]);
     }
     
     
@@ -920,11 +1710,13 @@ namespace StochHMM{
     bool sequence::reverse(){
         if (realSeq){
             if (real!=NULL){
+                toDoublePrecision();
                 std::reverse(real->begin(), real->end());
                 return true;
             }
         }
         else if (seq!=NULL){
+            unpack();
             std::reverse(seq->begin(), seq->end());
             
             if (mask!=NULL){
@@ -964,6 +1756,7 @@ namespace StochHMM{
             std::cerr << "StochHMM::track is not defined.  Can't complement without defined complement in track\n";
         }
         else if (seq!=NULL){
+            unpack();
             
             for (size_t i = 0; i < seq->size(); i++) {
                 (*seq)[i] = seqtrk->getComplementIndex((*seq)[i]);
@@ -1034,9 +1827,11 @@ namespace StochHMM{
 	void sequence::shuffle(){
 		
 		if (realSeq){
+			toDoublePrecision();
 			std::random_shuffle(real->begin(), real->end());
 		}
 		else if (seq!=NULL){
+			unpack();
 			std::random_shuffle(seq->begin(), seq->end());
 		}
 		else{
@@ -1046,6 +1841,132 @@ namespace StochHMM{
 	}
 	
 	
+	//! Pack the digitized sequence into 2 or 4 bits per symbol
+	//! The sequence is packed if every value fits (2 bits for 4 symbols, 4 bits
+	//! for 16 symbols including ambiguous symbols) and the unpacked sequence is
+	//! released.  Sequences read from a sequence cache are already packed.
+	//! \return true if the sequence is packed
+	bool sequence::pack(){
+		if (packed_bits != 0){
+			return true;
+		}
+		
+		if (realSeq || seq == NULL){
+			return false;
+		}
+		
+		uint8_t max_value(0);
+		for(size_t i = 0; i < seq->size(); ++i){
+			max_value |= (*seq)[i];
+		}
+		
+		if (max_value >= 16){
+			return false;
+		}
+		
+		uint8_t bits = (max_value < 4) ? 2 : 4;
+		uint8_t shift = (bits == 2) ? 5 : 4;
+		size_t per_word = (size_t) 1 << shift;
+		
+		packed = new(std::nothrow) std::vector<uint64_t>((seq->size() + per_word - 1) >> shift, 0);
+		if (packed==NULL){
+			std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+			exit(1);
+		}
+		
+		for(size_t i = 0; i < seq->size(); ++i){
+			(*packed)[i >> shift] |= (uint64_t) (*seq)[i] << ((i & (per_word - 1)) * bits);
+		}
+		
+		length = seq->size();
+		std::vector<uint8_t>().swap(*seq);
+		
+		packed_data = (packed->empty()) ? NULL : &(*packed)[0];
+		packed_bits = bits;
+		packed_shift = shift;
+		return true;
+	}
+	
+	
+	//! Restore the unpacked digitized sequence
+	//! Called before the sequence is modified or the digitized vector is requested
+	void sequence::unpack(){
+		if (packed_bits == 0){
+			return;
+		}
+		
+		seq->resize(length);
+		for(size_t i = 0; i < length; ++i){
+			(*seq)[i] = (*this)[i];
+		}
+		
+		delete packed;
+		packed = NULL;
+		packed_data = NULL;
+		packed_bits = 0;
+		packed_shift = 0;
+		return;
+	}
+	
+	
+	//!Store the real numbers as floats instead of doubles
+	//!Values lose precision, but use half of the memory
+	//!\return true if the sequence is stored as floats
+	bool sequence::toSinglePrecision(){
+		if (!realSeq || real == NULL){
+			return false;
+		}
+		
+		if (real_single != NULL || (cached_real != NULL && cached_single)){
+			return true;
+		}
+		
+		if (cached_real != NULL){
+			const double* src = (const double*) cached_real;
+			real_single = new(std::nothrow) std::vector<float>(src, src + length);
+			cached_real = NULL;
+		}
+		else{
+			real_single = new(std::nothrow) std::vector<float>(real->begin(), real->end());
+		}
+		
+		if (real_single==NULL){
+			std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+			exit(1);
+		}
+		
+		length = real_single->size();
+		std::vector<double>().swap(*real);
+		return true;
+	}
+	
+	
+	//!Store the real numbers as doubles
+	void sequence::toDoublePrecision(){
+		if (cached_real != NULL){
+			if (cached_single){
+				const float* src = (const float*) cached_real;
+				real->assign(src, src + length);
+			}
+			else{
+				const double* src = (const double*) cached_real;
+				real->assign(src, src + length);
+			}
+			cached_real = NULL;
+			return;
+		}
+		
+		if (real_single == NULL){
+			return;
+		}
+		
+		real->assign(real_single->begin(), real_single->end());
+		delete real_single;
+		real_single = NULL;
+		return;
+	}
+	
+	
 	//Randomly generate a sequence based on Probabilities of each character
 	sequence random_sequence(std::vector<double>& freq, size_t length, track* tr){
         sequence random_seq;
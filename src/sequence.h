@@ -34,16 +34,29 @@
 #include <iostream>
 #include <math.h>
 #include <fstream>
+#include <sstream>
 #include <algorithm>
 #include "text.h"
 #include "track.h"
 #include "stateInfo.h"
 #include "externDefinitions.h"
 #include "index.h"
+#include "seqReader.h"
+#include "fastaIndex.h"
+#include "seqCache.h"
 
 //!  \file 
 
 namespace StochHMM{
+    
+    //!\enum RealFileFormat
+    //!Format of a file of real numbers
+    //!REAL_TEXT is FASTA-like records of comma, tab or space delimited numbers
+    //!REAL_FLOAT32 and REAL_FLOAT64 are little-endian binary values, one sequence per file
+    enum RealFileFormat {REAL_TEXT, REAL_FLOAT32, REAL_FLOAT64};
+    
+    RealFileFormat realFileFormat(const std::string&);
+    
     //! \class sequence
     //! Contains individual sequence information and functions to deal with importing and digitizing the sequence
 	//! Sequence can be either real numbers (double values)  or sequence(characters or words) discrete values
@@ -60,7 +73,7 @@ namespace StochHMM{
         sequence(std::string&, track*);
         sequence(char* , track*);
 		
-        ~sequence();
+        virtual ~sequence();
         
         //Copy Constructors
         sequence(const sequence&);
@@ -76,7 +89,7 @@ namespace StochHMM{
 		//!store the result.   (Only undigitizes the sequence once, then passes
 		//!reference to undigitized sequence)
         inline std::string* getUndigitized(){
-            if (!undigitized.empty() || seq->empty()){
+            if (!undigitized.empty() || size() == 0){
                 return &undigitized;
             }
             else {
@@ -108,7 +121,7 @@ namespace StochHMM{
         
         //!Get the size of the sequence
         //! \return size_t size of the sequence
-        inline size_t size(){if (realSeq){return real->size();} else {return seq->size();}};  // Returns size of sequence
+        inline size_t size(){if (realSeq){return (real_single || cached_real) ? length : real->size();} else if (packed_bits){return length;} else {return seq->size();}};  // Returns size of sequence
         
         //! Get the pointer to the track that is defined for the sequence;
         //! \return pointer to track
@@ -145,6 +158,7 @@ namespace StochHMM{
         
         void setSeq(std::string&,track*);
         void setRealSeq(std::vector<double>*,track*);
+        void setDigitalSeq(std::vector<uint8_t>*,track*);
 		
 		inline bool getFasta(std::ifstream& file){return getFasta(file,NULL,NULL);}
         inline bool getFasta(std::ifstream& file, track* trk){ return getFasta(file,trk,NULL);}
@@ -158,6 +172,14 @@ namespace StochHMM{
 		inline bool getReal (std::ifstream& file, track* trk){ return getReal(file,trk,NULL);}
 		bool getReal (std::ifstream&, track*, stateInfo*);
 		
+		//Import from memory-mapped file
+		bool getFasta(seqReader&, track*, stateInfo*);
+		bool getFastq(seqReader&, track*);
+		bool getReal (seqReader&, track*, stateInfo*);
+		bool getRealBinary(seqReader&, track*, RealFileFormat, const std::string&, bool);
+		bool getFastaRegion(seqReader&, const faiRecord&, const seqRegion&, track*);
+		bool getCached(seqCache&, size_t, size_t, track*);
+		
         int  getMaxMask(){return max_mask;}
         int  getMask(size_t);
     
@@ -169,6 +191,13 @@ namespace StochHMM{
 		//! Returns the header of the sequence as a std::string
         inline std::string getHeader() { return header; }
         
+        //! Returns the position of the first symbol in the source sequence
+        //! Zero unless the sequence is a region of a larger sequence
+        inline size_t getOffset() { return offset; }
+        
+        //! Returns the name of the source sequence if the sequence is a region
+        inline std::string& getSource() { return source; }
+        
         bool reverseComplement();
         bool complement();
         bool reverse();
@@ -179,16 +208,40 @@ namespace StochHMM{
 		//! Shuffles the sequence using std::random_shuffle
 		void shuffle();
 		
-		inline std::vector<uint8_t>* getDigitalSeq(){return seq;}
+		//!Get the digitized sequence
+		//!Packed sequences (and those read from a sequence cache) are unpacked first
+		inline std::vector<uint8_t>* getDigitalSeq(){if (packed_bits != 0){unpack();} return seq;}
+        
+        //!Get the digitized value at a position
+        //!Packed sequences are read directly from the packed words
+        inline uint8_t operator[](size_t index) const{
+            if (packed_bits == 0){
+                return (*seq)[index];
+            }
+            return (packed_data[index >> packed_shift] >> ((index & ((1 << packed_shift) - 1)) * packed_bits)) & ((1 << packed_bits) - 1);
+        }
+        
+        bool pack();
+        void unpack();
+        
+        //!Is the digitized sequence packed
+        inline bool isPacked(){return packed_bits != 0;}
+        
+        bool toSinglePrecision();
+        void toDoublePrecision();
         
-        inline uint8_t operator[](size_t index){return (*seq)[index];}
+        //!Are the real numbers stored as floats
+        inline bool isSinglePrecision(){return real_single != NULL || (cached_real != NULL && cached_single);}
 		
 		inline bool isRealSeq(){
 			return realSeq;
 		}
 		
-		inline std::vector<double>* getRealSeq(){
-			if (realSeq){
+		//!Get the real number sequence
+		//!Returns NULL unless the values are stored as doubles; call
+		//!toDoublePrecision() first for single precision or cached values
+		inline std::vector<double>* getRealSeq() const{
+			if (realSeq && real_single == NULL && cached_real == NULL){
 				return real;
 			}
 			else{
@@ -211,6 +264,8 @@ namespace StochHMM{
         
         double attrib; //Attribute value (Could be %GC or whatever user defines)
         size_t length; //Lenght of the Sequence
+        size_t offset; //Position of sequence within source sequence (regions)
+        std::string source; //Name of source sequence (regions)
         
         track* seqtrk; //Ptr to track describing alphabet and type
         
@@ -220,6 +275,13 @@ namespace StochHMM{
         // FIXME:: DIGITIZED SEQUENCES STORED AS SHORT.  NEED TO STANDARDIZE BOTH TRACK AND SEQUENCE CLASS (Track stores as (int) but sequence stores as short.
         std::vector<uint8_t>* seq; // Digitized Sequence
         std::vector<double>* real; // Real Number Sequence
+        std::vector<float>* real_single; //Single precision real numbers (NULL if stored as doubles)
+        std::vector<uint64_t>* packed; //Packed digitized sequence
+        const uint64_t* packed_data; //Packed words (packed or the sequence cache mapping)
+        uint8_t packed_bits;  //Bits per symbol in packed words (0 if not packed)
+        uint8_t packed_shift; //log2 of symbols per packed word
+        const void* cached_real; //Real numbers in the sequence cache mapping (NULL if not cached)
+        bool cached_single; //Cached real numbers are floats
         std::vector<int>* mask; //Stores State masking information for training
         int max_mask;  //Maximum mask number
         
@@ -227,6 +289,10 @@ namespace StochHMM{
         std::string undigitized;  //Undigitized sequence
         
         bool _digitize();  //Digitize the sequence
+		void _digitize(const char*, size_t, size_t&);  //Digitize single character symbols into seq
+		void _readExDef(seqReader&, std::string&);
+		void _parseReals(const char*, size_t);
+		bool _parseExDef(std::string&, size_t, stateInfo*);
     };
 	
 	
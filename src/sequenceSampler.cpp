@@ -0,0 +1,475 @@
+//
+//  sequenceSampler.cpp
+//  StochHMM
+//
+//  Copyright (c) 2013 Korf Lab, Genome Center, UC Davis, Davis, CA. All rights reserved.
+//
+
+#include "sequenceSampler.h"
+
+namespace StochHMM{
+
+	static const double TWO_PI = 6.283185307179586;
+
+	//!Uniform value in (0,1]
+	static double _uniform(){
+		return ((double) rand() + 1.0) / ((double) RAND_MAX + 1.0);
+	}
+
+	static double _normal(double mu, double sigma){
+		return mu + sigma * sqrt(-2.0 * log(_uniform())) * cos(TWO_PI * _uniform());
+	}
+
+	//!Gamma distributed value with shape alpha and rate 1 (Marsaglia and Tsang)
+	static double _gamma(double alpha){
+		if (alpha < 1.0){
+			return _gamma(alpha + 1.0) * pow(_uniform(), 1.0 / alpha);
+		}
+
+		double d = alpha - 1.0 / 3.0;
+		double c = 1.0 / sqrt(9.0 * d);
+		while(true){
+			double x = _normal(0.0, 1.0);
+			double v = 1.0 + c * x;
+			if (v <= 0.0){
+				continue;
+			}
+			v = v * v * v;
+			if (log(_uniform()) < 0.5 * x * x + d - d * v + d * log(v)){
+				return d * v;
+			}
+		}
+	}
+
+	//!Poisson distributed value
+	//!Large means are split, because a sum of Poisson values is Poisson
+	static double _poisson(double lambda){
+		double count = 0;
+		while(lambda > 0){
+			double part = (lambda > 30.0) ? 30.0 : lambda;
+			lambda -= part;
+
+			double limit = exp(-part);
+			double product = _uniform();
+			while(product > limit){
+				count++;
+				product *= _uniform();
+			}
+		}
+		return count;
+	}
+
+
+	//!Create a sampler for a model
+	//!\param h Model to sample from.  Use check() to see if it can be sampled
+	sequenceSampler::sequenceSampler(model* h):hmm(h){
+		tracks* model_tracks = hmm->getTracks();
+		for(size_t i = 0; i < model_tracks->size(); ++i){
+			if ((*model_tracks)[i]->getAlphaType() == REAL){
+				real_tracks.push_back(i);
+			}
+			else{
+				discrete_tracks.push_back(i);
+			}
+		}
+
+		//Every combination of unambiguous symbols of the discrete tracks
+		size_t count = 1;
+		for(size_t i = 0; i < discrete_tracks.size() && count <= MAX_COMBINATIONS; ++i){
+			count *= (*model_tracks)[discrete_tracks[i]]->getAlphaSize();
+		}
+
+		if (count <= MAX_COMBINATIONS){
+			combinations.assign(count, std::vector<uint8_t>(discrete_tracks.size()));
+			for(size_t c = 0; c < count; ++c){
+				size_t remaining = c;
+				for(size_t i = 0; i < discrete_tracks.size(); ++i){
+					size_t alpha_size = (*model_tracks)[discrete_tracks[i]]->getAlphaSize();
+					combinations[c][i] = remaining % alpha_size;
+					remaining /= alpha_size;
+				}
+			}
+		}
+
+		size_t state_size = hmm->state_size();
+		joint.assign(state_size + 1, false);
+		duration_stops.resize(state_size + 1);
+
+		for(size_t i = 0; i <= state_size; ++i){
+			state* st = (i < state_size) ? hmm->getState(i) : hmm->getInitial();
+			std::vector<transition*>* trans = st->getTransitions();
+
+			for(size_t j = 0; j < trans->size(); ++j){
+				transition* tr = (*trans)[j];
+				if (tr == NULL){
+					continue;
+				}
+
+				if (tr->getTransitionType() == LEXICAL){
+					joint[i] = true;
+				}
+				else if (tr->getTransitionType() == DURATION){
+					tracebackIdentifier identifier = tr->getTracebackIdentifier();
+					if (identifier == DIFF_STATE || identifier == START_INIT){
+						continue;
+					}
+
+					duration_stops[i].resize(state_size);
+					std::string& name = tr->getTracebackString();
+					for(size_t k = 0; k < state_size; ++k){
+						state* stop = hmm->getState(k);
+						if ((identifier == STATE_NAME && name == stop->getName()) ||
+							(identifier == STATE_LABEL && name == stop->getLabel()) ||
+							(identifier == STATE_GFF && name == stop->getGFF())){
+							duration_stops[i][j].push_back(k);
+						}
+					}
+				}
+			}
+		}
+	}
+
+
+	//!Check that the model can be sampled
+	//!\return false if the model uses something the sampler can't sample
+	bool sequenceSampler::check(){
+		if (combinations.empty()){
+			std::cerr << "Too many combinations of symbols to sample.  Maximum is " << MAX_COMBINATIONS << std::endl;
+			return false;
+		}
+
+		tracks* model_tracks = hmm->getTracks();
+		for(size_t i = 0; i < model_tracks->size(); ++i){
+			if ((*model_tracks)[i]->isTrackFuncDefined()){
+				std::cerr << "Can't sample track defined by a function: " << (*model_tracks)[i]->getName() << std::endl;
+				return false;
+			}
+		}
+
+		if (!_supported(hmm->getInitial())){
+			return false;
+		}
+
+		for(size_t i = 0; i < hmm->state_size(); ++i){
+			if (!_supported(hmm->getState(i))){
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+
+	bool sequenceSampler::_supported(state* st){
+		std::vector<transition*>* trans = st->getTransitions();
+		for(size_t i = 0; i < trans->size(); ++i){
+			transition* tr = (*trans)[i];
+			if (tr == NULL){
+				continue;
+			}
+
+			if (tr->getTransitionType() == PDF || tr->FunctionDefined()){
+				std::cerr << "Can't sample transition from " << st->getName() << " to " << tr->getName() << std::endl;
+				return false;
+			}
+		}
+
+		for(size_t i = 0; i < st->getEmissionSize(); ++i){
+			emm* emission = st->getEmission(i);
+			if (emission->getExtFunction() != NULL || emission->isFunction() || emission->isMultiContinuous()){
+				std::cerr << "Can't sample emission of state " << st->getName() << std::endl;
+				return false;
+			}
+
+			if (emission->isContinuous()){
+				std::string& pdf = emission->getPDFName();
+				if (pdf != "NORMAL" && pdf != "LOG_NORMAL" && pdf != "EXPONENTIAL" && pdf != "GAMMA" && pdf != "CONTINUOUS_UNIFORM" && pdf != "POISSON"){
+					std::cerr << "Can't sample " << pdf << " distribution of state " << st->getName() << std::endl;
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+
+	//!Sample sequences and their state path
+	//!\param length Length of the sequences
+	//!\param path Traceback path to store the states in (can be NULL)
+	//!\return Sequences for every track of the model, or NULL if no state or
+	//!symbol can follow at a position
+	sequences* sequenceSampler::sample(size_t length, traceback_path* path){
+		tracks* model_tracks = hmm->getTracks();
+		sequences* seqs = new(std::nothrow) sequences(model_tracks);
+
+		if (seqs == NULL){
+			std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+			exit(1);
+		}
+
+		std::vector<std::vector<double>*> values(real_tracks.size());
+
+		for(size_t i = 0; i < model_tracks->size(); ++i){
+			sequence* sq;
+
+			if ((*model_tracks)[i]->getAlphaType() == REAL){
+				std::vector<double>* real = new(std::nothrow) std::vector<double>(length, 0.0);
+				if (real == NULL){
+					std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+					exit(1);
+				}
+				sq = new(std::nothrow) sequence(real, (*model_tracks)[i]);
+			}
+			else{
+				std::vector<uint8_t>* digital = new(std::nothrow) std::vector<uint8_t>(length, 0);
+				if (digital == NULL){
+					std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+					exit(1);
+				}
+				sq = new(std::nothrow) sequence();
+				if (sq != NULL){
+					sq->setDigitalSeq(digital, (*model_tracks)[i]);
+				}
+			}
+
+			if (sq == NULL){
+				std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+				exit(1);
+			}
+			seqs->addSeq(sq);
+		}
+
+		//Sampled values are written to the vectors of doubles
+		for(size_t i = 0; i < real_tracks.size(); ++i){
+			sequence* sq = seqs->getSeq(real_tracks[i]);
+			sq->toDoublePrecision();
+			values[i] = sq->getRealSeq();
+		}
+
+		size_t state_size = hmm->state_size();
+		size_t combination_size = combinations.size();
+		std::vector<size_t> states(length);
+
+		//Durations of the sampled path
+		std::vector<size_t> last(state_size, SIZE_MAX);	//Last position of each state
+		size_t run = 0;					//Length of the run of the previous state
+		size_t before_run = SIZE_MAX;	//Last position of the previous state before its run
+
+		for(size_t position = 0; position < length; ++position){
+			size_t from = (position == 0) ? state_size : states[position - 1];
+			state* from_state = (position == 0) ? hmm->getInitial() : hmm->getState(from);
+			std::vector<transition*>* trans = from_state->getTransitions();
+
+			weights.assign(state_size, -INFINITY);
+			for(size_t j = 0; j < state_size && j < trans->size(); ++j){
+				transition* tr = (*trans)[j];
+				if (tr == NULL || tr->getTransitionType() == LEXICAL){
+					continue;
+				}
+
+				size_t duration = run + 1;
+				if (tr->getTransitionType() == DURATION){
+					tracebackIdentifier identifier = tr->getTracebackIdentifier();
+					if (identifier == START_INIT){
+						duration = position + 1;
+					}
+					else if (identifier != DIFF_STATE){
+						//Duration goes back to the last stop state before the
+						//previous position
+						std::vector<size_t>& stops = duration_stops[from][j];
+						size_t stop_end = 0;
+						for(size_t k = 0; k < stops.size(); ++k){
+							size_t stop = (stops[k] != from) ? last[stops[k]] : ((run >= 2) ? position - 2 : before_run);
+							if (stop != SIZE_MAX && stop + 1 > stop_end){
+								stop_end = stop + 1;
+							}
+						}
+						duration = position + 1 - stop_end;
+					}
+				}
+
+				weights[j] = _transition(tr, position, *seqs, duration);
+			}
+
+			size_t next;
+			size_t combination;
+
+			if (!joint[from]){
+				next = _choose();
+				if (next == SIZE_MAX){
+					std::cerr << "No state can follow " << from_state->getName() << " at position " << position + 1 << std::endl;
+					delete seqs;
+					return NULL;
+				}
+
+				state* st = hmm->getState(next);
+				weights.resize(combination_size);
+				for(size_t c = 0; c < combination_size; ++c){
+					_setSymbols(*seqs, c, position);
+					weights[c] = _lexicalEmission(st, *seqs, position);
+				}
+				combination = _choose();
+			}
+			else{
+				//State and symbols are drawn together, because lexical
+				//transitions depend on the symbols
+				std::vector<double> transition_weights(weights);
+				weights.assign(state_size * combination_size, -INFINITY);
+				for(size_t c = 0; c < combination_size; ++c){
+					_setSymbols(*seqs, c, position);
+					for(size_t j = 0; j < state_size && j < trans->size(); ++j){
+						transition* tr = (*trans)[j];
+						if (tr == NULL){
+							continue;
+						}
+
+						double value = (tr->getTransitionType() == LEXICAL) ? _transition(tr, position, *seqs, 0) : transition_weights[j];
+						if (value != -INFINITY){
+							weights[j * combination_size + c] = value + _lexicalEmission(hmm->getState(j), *seqs, position);
+						}
+					}
+				}
+
+				size_t choice = _choose();
+				next = (choice == SIZE_MAX) ? SIZE_MAX : choice / combination_size;
+				combination = (choice == SIZE_MAX) ? SIZE_MAX : choice % combination_size;
+			}
+
+			if (combination == SIZE_MAX){
+				std::cerr << "No symbols can be emitted from " << ((next == SIZE_MAX) ? from_state->getName() : hmm->getState(next)->getName()) << " at position " << position + 1 << std::endl;
+				delete seqs;
+				return NULL;
+			}
+
+			_setSymbols(*seqs, combination, position);
+
+			state* st = hmm->getState(next);
+			for(size_t i = 0; i < real_tracks.size(); ++i){
+				(*values[i])[position] = _sampleReal(st, real_tracks[i]);
+			}
+
+			if (position > 0 && next == from){
+				run++;
+			}
+			else{
+				before_run = last[next];
+				run = 1;
+			}
+			last[next] = position;
+			states[position] = next;
+		}
+
+		if (path != NULL){
+			for(size_t position = length - 1; position != SIZE_MAX; --position){
+				path->push_back((int) states[position]);
+			}
+		}
+
+		return seqs;
+	}
+
+
+	double sequenceSampler::_transition(transition* trans, size_t position, sequences& seqs, size_t duration){
+		if (trans->getTransitionType() == DURATION){
+			return trans->getTransition(duration, NULL);
+		}
+		else if (trans->getTransitionType() == LEXICAL){
+			return trans->getTransition(position, &seqs);
+		}
+		return trans->getTransition(0, NULL);
+	}
+
+
+	//!Score of the lexical emissions of a state with the symbols at the position
+	double sequenceSampler::_lexicalEmission(state* st, sequences& seqs, size_t position){
+		double value = 0;
+		for(size_t i = 0; i < st->getEmissionSize(); ++i){
+			emm* emission = st->getEmission(i);
+			if (emission->isLexical()){
+				value += emission->get_emission(seqs, position);
+			}
+		}
+		return value;
+	}
+
+
+	//!Write a combination of symbols to the discrete tracks at a position
+	//!The sampled sequences are created unpacked, so they're written directly
+	void sequenceSampler::_setSymbols(sequences& seqs, size_t combination, size_t position){
+		for(size_t i = 0; i < discrete_tracks.size(); ++i){
+			(*seqs.getSeq(discrete_tracks[i])->getDigitalSeq())[position] = combinations[combination][i];
+		}
+	}
+
+
+	//!Sample a value of a real track from the continuous emission of a state
+	double sequenceSampler::_sampleReal(state* st, size_t track_index){
+		for(size_t i = 0; i < st->getEmissionSize(); ++i){
+			emm* emission = st->getEmission(i);
+			if (!emission->isContinuous() || emission->getRealTrack()->getIndex() != track_index){
+				continue;
+			}
+
+			std::string& pdf = emission->getPDFName();
+			std::vector<double>& param = *emission->getPDFParameters();
+
+			if (pdf == "NORMAL"){
+				return _normal(param[0], param[1]);
+			}
+			else if (pdf == "LOG_NORMAL"){
+				return exp(_normal(param[0], sqrt(param[1])));
+			}
+			else if (pdf == "EXPONENTIAL"){
+				return -log(_uniform()) / param[0];
+			}
+			else if (pdf == "GAMMA"){
+				return _gamma(param[0]) / param[1];
+			}
+			else if (pdf == "CONTINUOUS_UNIFORM"){
+				return param[0] + (param[1] - param[0]) * (1.0 - _uniform());
+			}
+			else if (pdf == "POISSON"){
+				return _poisson(param[0]);
+			}
+		}
+
+		return 1.0 - _uniform();
+	}
+
+
+	//!Choose an index of the weights with probability proportional to exp(weight)
+	//!\return SIZE_MAX if every weight is -INFINITY
+	size_t sequenceSampler::_choose(){
+		double max = -INFINITY;
+		for(size_t i = 0; i < weights.size(); ++i){
+			if (weights[i] > max){
+				max = weights[i];
+			}
+		}
+
+		if (max == -INFINITY || isnan(max)){
+			return SIZE_MAX;
+		}
+
+		double sum = 0;
+		for(size_t i = 0; i < weights.size(); ++i){
+			sum += exp(weights[i] - max);
+		}
+
+		double value = (1.0 - _uniform()) * sum;
+		size_t last_choice = SIZE_MAX;
+		for(size_t i = 0; i < weights.size(); ++i){
+			if (weights[i] == -INFINITY){
+				continue;
+			}
+			last_choice = i;
+			value -= exp(weights[i] - max);
+			if (value < 0){
+				return i;
+			}
+		}
+		return last_choice;
+	}
+
+}
@@ -0,0 +1,78 @@
+//
+//  sequenceSampler.h
+//  StochHMM
+//
+//  Copyright (c) 2013 Korf Lab, Genome Center, UC Davis, Davis, CA. All rights reserved.
+//
+
+#ifndef __StochHMM__sequenceSampler__
+#define __StochHMM__sequenceSampler__
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <math.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "hmm.h"
+#include "sequences.h"
+#include "traceback_path.h"
+
+namespace StochHMM{
+
+	/*! \class sequenceSampler
+	 *	\brief Samples sequences and their state paths from a model
+	 *
+	 *	At each position the next state is drawn from the transitions of the
+	 *	previous state (INIT at the first position), then the symbols of the
+	 *	alphanumerical tracks are drawn from the state's lexical emissions and
+	 *	the values of the real tracks from its continuous emissions.
+	 *	- Duration transitions use the duration of the sampled path, measured
+	 *	  the same way as the trellis
+	 *	- Lexical transitions depend on the symbols at the position, so the
+	 *	  state and the symbols are drawn together
+	 *	- Transitions to END are ignored
+	 *	- Real tracks without a continuous emission and REAL_NUMBER emissions
+	 *	  get uniform values between 0 and 1
+	 *
+	 *	Continuous emissions can be sampled for NORMAL, LOG_NORMAL, EXPONENTIAL,
+	 *	GAMMA, CONTINUOUS_UNIFORM and POISSON distributions.  Models with other
+	 *	distributions, multivariate or function emissions, external functions
+	 *	or PDF transitions can't be sampled.  Random numbers come from rand().
+	 */
+	class sequenceSampler{
+	public:
+		sequenceSampler(model* h);
+
+		bool check();
+		sequences* sample(size_t length, traceback_path* path);
+
+		//!Maximum number of symbol combinations of the alphanumerical tracks
+		static const size_t MAX_COMBINATIONS = 4096;
+
+	private:
+		model* hmm;
+		std::vector<size_t> discrete_tracks;		//Indices of alphanumerical tracks
+		std::vector<size_t> real_tracks;			//Indices of real number tracks
+		std::vector<std::vector<uint8_t> > combinations;	//Symbols of the discrete tracks
+
+		std::vector<bool> joint;	//State has lexical transitions
+
+		//States that end the duration of the transition from state i to
+		//state j, for transitions that trace back to a name, label or GFF
+		//tag.  Index i of the INIT state is the number of states.
+		std::vector<std::vector<std::vector<size_t> > > duration_stops;
+
+		std::vector<double> weights;	//Log weights of the choices at a position
+
+		bool _supported(state* st);
+		double _transition(transition* trans, size_t position, sequences& seqs, size_t duration);
+		double _lexicalEmission(state* st, sequences& seqs, size_t position);
+		void _setSymbols(sequences& seqs, size_t combination, size_t position);
+		double _sampleReal(state* st, size_t track_index);
+		size_t _choose();
+	};
+
+}
+
+#endif /* defined(__StochHMM__sequenceSampler__) */
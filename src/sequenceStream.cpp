@@ -13,60 +13,80 @@ namespace StochHMM {
         bufferSize=0;
         retainSize=0;
         readingFile = false;
+        reader = NULL;
+        start = 0;
     }
     
     sequenceStream::sequenceStream(bool realTrack): sequence(realTrack){
         bufferSize=0;
         retainSize=0;
         readingFile = false;
+        reader = NULL;
+        start = 0;
     }
     
     sequenceStream::sequenceStream(std::vector<double>*vec, track* tr ): sequence(vec, tr){
         bufferSize=0;
         retainSize=0;
         readingFile = false;
+        reader = NULL;
+        start = 0;
     }
     
     sequenceStream::sequenceStream(char* seq, track* tr ): sequence(seq, tr){
         bufferSize=0;
         retainSize=0;
         readingFile = false;
+        reader = NULL;
+        start = 0;
     }
     
     sequenceStream::sequenceStream(std::string& sq, track* tr ): sequence(sq, tr){
         bufferSize=0;
         retainSize=0;
         readingFile = false;
+        reader = NULL;
+        start = 0;
     }
     
     sequenceStream::sequenceStream(size_t buff, size_t ret): sequence(){
         bufferSize=buff;
         retainSize=ret;
         readingFile = false;
+        reader = NULL;
+        start = 0;
     }
     
     sequenceStream::sequenceStream(size_t buff, size_t ret, bool realTrack): sequence(realTrack){
         bufferSize=buff;
         retainSize=ret;
         readingFile = false;
+        reader = NULL;
+        start = 0;
     }
 
     sequenceStream::sequenceStream(size_t buff, size_t ret, std::vector<double>*vec, track* tr ): sequence(vec, tr){
         bufferSize=buff;
         retainSize=ret;
         readingFile = false;
+        reader = NULL;
+        start = 0;
     }
     
     sequenceStream::sequenceStream(size_t buff, size_t ret, char* seq, track* tr ): sequence(seq, tr){
         bufferSize=buff;
         retainSize=ret;
         readingFile = false;
+        reader = NULL;
+        start = 0;
     }
     
     sequenceStream::sequenceStream(size_t buff, size_t ret, std::string& sq, track* tr ): sequence(sq, tr){
         bufferSize=buff;
         retainSize=ret;
         readingFile = false;
+        reader = NULL;
+        start = 0;
     }
 
 //    sequenceStream::~sequenceStream(){
@@ -99,7 +119,7 @@ namespace StochHMM {
         }
         
 
-        bool success;
+        bool success(false);
         
         size_t fillBuffer=0;
         
@@ -213,30 +233,325 @@ namespace StochHMM {
 
         }
         
+        //The file ended before the buffer filled or the end was peeked
+        if (readingFile && fillBuffer < bufferSize){
+            if (!undigitized.empty() && !_digitize()) {
+                std::cerr << "sequence was not digitized" << std::endl;
+            }
+            success = false;
+            readingFile = false;
+        }
+        
         length = seq->size();
         return success;
     }
     
     void sequenceStream::resetSeq() {
         if (realSeq) {
-            real=new(std::nothrow) std::vector<double>;
-            
             if (real==NULL){
-                std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
-                exit(1);
+                real=new(std::nothrow) std::vector<double>;
+                
+                if (real==NULL){
+                    std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+                    exit(1);
+                }
             }
-            
-            seq=NULL;
+            real->clear();
         }
         else{
-            real=NULL;
-            seq=new(std::nothrow) std::vector<short>;
-            
             if (seq==NULL){
+                seq=new(std::nothrow) std::vector<uint8_t>;
+                
+                if (seq==NULL){
+                    std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+                    exit(1);
+                }
+            }
+            seq->clear();
+        }
+    }
+    
+    
+    //! Start windowed import of the next sequence in the file
+    //! Only the header is read.  The sequence is read by fill()
+    //! \param file Sequence file reader
+    //! \param trk Track used to digitize the sequence
+    //! \return true if a sequence header was found
+    bool sequenceStream::open(seqReader& file, track* trk){
+        clear();
+        resetSeq();
+        reader = &file;
+        seqtrk = trk;
+        start = 0;
+        previousSeq.clear();
+        readingFile = false;
+        
+        if (seqtrk==NULL){
+            std::cerr << "Can't digitize sequence without a valid track defined\n";
+            return false;
+        }
+        
+        if (realSeq || seqtrk->getAlphaMax() != 1){
+            std::cerr << "Windowed import is only available for tracks with single character alphabets\n";
+            return false;
+        }
+        
+        const char* line;
+        size_t line_length;
+        
+        //Find next header mark
+        while(file.peek() != '>'){
+            if (!file.getLine(line, line_length)){
+                return false;
+            }
+        }
+        
+        file.getLine(header);
+        readingFile = true;
+        return true;
+    }
+    
+    
+    //! Move the window forward
+    //! The last retainSize symbols of the window are kept and up to bufferSize
+    //! symbols are added from the file.
+    //! \return true if any symbols were added
+    bool sequenceStream::fill(){
+        if (reader == NULL || seq == NULL){
+            return false;
+        }
+        
+        //Keep the end of the window
+        size_t keep = std::min(retainSize, seq->size());
+        if (keep < seq->size()){
+            start += seq->size() - keep;
+            seq->erase(seq->begin(), seq->end() - keep);
+        }
+        
+        size_t filled = keep;
+        size_t target = keep + bufferSize;
+        seq->resize(target);
+        
+        //Part of the last line that didn't fit in the previous window
+        if (!previousSeq.empty()){
+            size_t count = std::min(previousSeq.size(), target - filled);
+            _digitize(previousSeq.data(), count, filled);
+            previousSeq.erase(0, count);
+        }
+        
+        const char* line(NULL);
+        size_t line_length(0);
+        std::string exdef;
+        
+        while(filled < target && readingFile){
+            int next = reader->peek();
+            if (next == '>' || next == EOF){
+                readingFile = false;
+                break;
+            }
+            else if (next == '['){
+                _readExDef(*reader, exdef);
+                continue;
+            }
+            
+            if (!reader->getLine(line, line_length)){
+                readingFile = false;
+                break;
+            }
+            
+            size_t count = std::min(line_length, target - filled);
+            _digitize(line, count, filled);
+            
+            if (count < line_length){
+                previousSeq.assign(line + count, line_length - count);
+            }
+        }
+        
+        if (!exdef.empty()){
+            std::cerr << "External definitions of " << header << " aren't used in windowed import" << std::endl;
+        }
+        
+        //Check if the sequence is finished, so the caller knows this is the last window
+        if (readingFile && previousSeq.empty() && (reader->peek() == '>' || reader->peek() == EOF)){
+            readingFile = false;
+        }
+        
+        seq->resize(filled);
+        length = filled;
+        return filled > keep;
+    }
+    
+    
+    //! Save the position of the stream, so the next window can be read again
+    //! \param[out] pos Position of the stream
+    void sequenceStream::save(streamPosition& pos){
+        size_t keep = std::min(retainSize, seq->size());
+        pos.offset = reader->tell();
+        pos.start = start + seq->size() - keep;
+        pos.pending = previousSeq;
+        pos.retained.assign(seq->end() - keep, seq->end());
+        pos.reading = readingFile;
+    }
+    
+    
+    //! Return the stream to a saved position
+    //! The next call to fill() gets the same window as it did after save()
+    //! \param pos Position of the stream
+    void sequenceStream::restore(streamPosition& pos){
+        reader->seek(pos.offset);
+        start = pos.start;
+        previousSeq = pos.pending;
+        seq->assign(pos.retained.begin(), pos.retained.end());
+        length = seq->size();
+        readingFile = pos.reading;
+    }
+    
+    
+    seqWindow::seqWindow(size_t buffer, size_t retain):bufferSize(buffer),retainSize(retain),seqs(NULL),hmm(NULL){
+    }
+    
+    seqWindow::~seqWindow(){
+        delete seqs;
+        for(size_t i=0;i<files.size();i++){
+            delete files[i];
+        }
+    }
+    
+    
+    //! Get the highest order of the lexical emissions and transitions of the model
+    size_t seqWindow::_maxOrder(model* hmm){
+        size_t max_order(0);
+        for(size_t i=0;i<hmm->state_size();i++){
+            state* st = (*hmm)[i];
+            
+            for(size_t j=0;j<st->getEmissionSize();j++){
+                if (st->getEmission(j)->isLexical()){
+                    max_order = std::max(max_order, (size_t) st->getEmission(j)->getTables()->getMaxOrder());
+                }
+            }
+            
+            std::vector<transition*>* trans = st->getTransitions();
+            for(size_t j=0;j<trans->size();j++){
+                if ((*trans)[j] != NULL && (*trans)[j]->getTransitionType() == LEXICAL){
+                    max_order = std::max(max_order, (size_t) (*trans)[j]->getTables()->getMaxOrder());
+                }
+            }
+        }
+        return max_order;
+    }
+    
+    
+    //! Open the sequence files for windowed decoding with a model
+    //! \param h Model used to decode the sequences
+    //! \param filenames Sequence file, or one file for each track of the model
+    //! \param threads Number of threads used to decompress BGZF files
+    //! \return true if the files were opened
+    bool seqWindow::open(model* h, std::vector<std::string>& filenames, size_t threads){
+        hmm = h;
+        tracks* trcks = hmm->getTracks();
+        
+        if (bufferSize == 0){
+            std::cerr << "Window buffer size must be greater than zero" << std::endl;
+            return false;
+        }
+        
+        if (filenames.size() != trcks->size()){
+            std::cerr << "Windowed decoding requires one sequence file for each track of the model" << std::endl;
+            return false;
+        }
+        
+        size_t retain = retainSize + _maxOrder(hmm);
+        
+        seqs = new(std::nothrow) sequences(trcks->size());
+        if (seqs==NULL){
+            std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+            exit(1);
+        }
+        
+        for(size_t i=0;i<trcks->size();i++){
+            if ((*trcks)[i]->getAlphaType() == REAL){
+                std::cerr << "Windowed decoding isn't available for real number tracks" << std::endl;
+                return false;
+            }
+            
+            seqReader* file = new(std::nothrow) seqReader;
+            sequenceStream* stream = new(std::nothrow) sequenceStream(bufferSize, retain, false);
+            if (file==NULL || stream==NULL){
                 std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
                 exit(1);
             }
+            
+            files.push_back(file);
+            streams.push_back(stream);
+            seqs->addSeq(stream, i);
+            
+            file->setThreads(threads);
+            if (!file->open(filenames[i])){
+                std::cerr << "Can't open sequence file: " << filenames[i] << std::endl;
+                return false;
+            }
         }
+        
+        return true;
     }
-
-}
\ No newline at end of file
+    
+    
+    //! Start the next sequence in each of the files
+    //! \return false if there are no more sequences
+    bool seqWindow::next(){
+        bool success(true);
+        for(size_t i=0;i<streams.size();i++){
+            success &= streams[i]->open(*files[i], (*hmm->getTracks())[i]);
+        }
+        return success;
+    }
+    
+    
+    //! Move the windows of all the tracks forward
+    //! \return true if any symbols were added
+    bool seqWindow::fill(){
+        bool added = streams[0]->fill();
+        
+        for(size_t i=1;i<streams.size();i++){
+            streams[i]->fill();
+            
+            if (streams[i]->getStart() != streams[0]->getStart() || streams[i]->getLength() != streams[0]->getLength()){
+                std::cerr << "Sequence Lengths not the same" << std::endl;
+                return false;
+            }
+        }
+        
+        return added;
+    }
+    
+    
+    //! Can the windows be read again (uncompressed files)
+    bool seqWindow::seekable(){
+        for(size_t i=0;i<files.size();i++){
+            if (files[i]->is_compressed()){
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    
+    //! Save the position of all the tracks
+    //! \param[out] pos Positions of the tracks
+    void seqWindow::save(std::vector<streamPosition>& pos){
+        pos.resize(streams.size());
+        for(size_t i=0;i<streams.size();i++){
+            streams[i]->save(pos[i]);
+        }
+    }
+    
+    
+    //! Return all of the tracks to a saved position
+    //! \param pos Positions of the tracks
+    void seqWindow::restore(std::vector<streamPosition>& pos){
+        for(size_t i=0;i<streams.size();i++){
+            streams[i]->restore(pos[i]);
+        }
+    }
+    
+}
@@ -9,13 +9,29 @@
 #define sequenceStream_H
 
 #include "sequence.h"
+#include "sequences.h"
 #include "track.h"
+#include "hmm.h"
 #include <iostream>
 #include <fstream>
 #include <string>
 
 namespace StochHMM {
     
+    //!\struct streamPosition
+    //!Saved position of a sequenceStream, used to read a window again
+    struct streamPosition{
+        size_t offset;      //File offset
+        size_t start;       //Sequence position of the first retained symbol
+        std::string pending;    //Part of a line that hasn't been digitized
+        std::vector<uint8_t> retained;  //Symbols kept from the previous window
+        bool reading;
+    };
+    
+    //! \class sequenceStream
+    //! Sequence that is imported in windows of bufferSize symbols.  The last
+    //! retainSize symbols of a window are kept at the start of the next window,
+    //! so the sequence can be scored using the preceding symbols.
     class sequenceStream: public sequence {
     public:
         
@@ -39,6 +55,18 @@ namespace StochHMM {
         inline void setBuffer (size_t buff) { bufferSize = buff; }
         inline void setRetain (size_t ret) { retainSize = ret; }
         
+        //Windowed import from a sequence file reader
+        bool open(seqReader&, track*);
+        bool fill();
+        void save(streamPosition&);
+        void restore(streamPosition&);
+        
+        //!Get the position in the sequence of the first symbol in the window
+        inline size_t getStart(){ return start; }
+        
+        //!Has the whole sequence been read
+        inline bool complete(){ return !readingFile; }
+        
     private:
         size_t bufferSize;
         size_t retainSize;
@@ -52,8 +80,62 @@ namespace StochHMM {
         //!Keeps track of whether the sequence under the same header is being read
         bool readingFile;
         
+        //!Reader of the windowed import
+        seqReader* reader;
+        
+        //!Position in the sequence of the first symbol in the window
+        size_t start;
+        
         //!Reset seq or realseq each time getfasta is called
         void resetSeq ();
     };
+    
+    
+    /*! \class seqWindow
+     *  \brief Windowed sequence source for decoding
+     *
+     *  Reads the sequences for all the tracks of a model as sequenceStreams,
+     *  so only bufferSize + max_order + retainSize symbols of each track are
+     *  in memory, where max_order is the highest order of the model emissions
+     *  and transitions.  Positions in the window are relative to getStart().
+     *
+     *  A single-track model reads one file.  Otherwise one file is required for
+     *  each track, because the tracks are read at the same time.
+     */
+    class seqWindow{
+    public:
+        seqWindow(size_t buffer, size_t retain);
+        ~seqWindow();
+        
+        bool open(model* hmm, std::vector<std::string>& filenames, size_t threads);
+        bool next();
+        bool fill();
+        
+        void save(std::vector<streamPosition>&);
+        void restore(std::vector<streamPosition>&);
+        bool seekable();
+        
+        //!Get the sequences of the window
+        inline sequences* getSeqs(){return seqs;}
+        
+        //!Get the position in the sequence of the first symbol in the window
+        inline size_t getStart(){return streams[0]->getStart();}
+        
+        //!Get the number of symbols in the window
+        inline size_t size(){return streams[0]->getLength();}
+        
+        //!Has the whole sequence been read
+        inline bool complete(){return streams[0]->complete();}
+        
+    private:
+        size_t bufferSize;
+        size_t retainSize;
+        std::vector<seqReader*> files;
+        std::vector<sequenceStream*> streams;  //Owned by seqs
+        sequences* seqs;
+        model* hmm;
+        
+        static size_t _maxOrder(model*);
+    };
 }
 #endif /*sequenceStream_H*/
\ No newline at end of file
@@ -104,6 +104,24 @@ namespace StochHMM {
             exit(1);
         } 
         
+        //!Get the position of the sequences within the source sequence
+        //!Zero unless the sequences are a region of a larger sequence
+        inline size_t getOffset(){
+            if (num_of_sequences>0 && seq[0]!=NULL){
+                return seq[0]->offset;
+            }
+            return 0;
+        }
+        
+        //!Get the name to use for the sequences in coordinate based output
+        //!This is the name of the source sequence for regions, otherwise the header
+        inline std::string& getSourceName(){
+            if (num_of_sequences>0 && seq[0]!=NULL && !seq[0]->source.empty()){
+                return seq[0]->source;
+            }
+            return getHeader();
+        }
+        
         //TODO: fix if iter is not defined
         //!Get the header for the ith sequence
         //! \param iter size_t iterator for ith sequence
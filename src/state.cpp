@@ -70,7 +70,8 @@ namespace StochHMM{
     //! \param txt String of state definition
     //! \param names StringList with names of other states. Used to identify position of transitions in transition
     //! In future, may want to organize transitions in non-linear fashion
-    bool state::parse(std::string& txt, stringList& names,tracks& trks, weights* wts, StateFuncs* funcs){
+    //! \param defer_tables Leave the lexical tables to be set from a compiled model
+    bool state::parse(std::string& txt, stringList& names,tracks& trks, weights* wts, StateFuncs* funcs, bool defer_tables){
         size_t stateHeaderInfo = txt.find("STATE:");
         size_t transitionsInfo = txt.find("TRANSITION:");
         size_t emissionInfo    = txt.find("EMISSION:");
@@ -96,7 +97,7 @@ namespace StochHMM{
         //Extract and Parse Transition Information
         std::string trans = (emissionInfo==std::string::npos) ? txt.substr(transitionsInfo) : txt.substr(transitionsInfo, emissionInfo - transitionsInfo);
         //std::cout << trans << std::endl;
-        if (!_parseTransition(trans, names, trks, wts, funcs)){
+        if (!_parseTransition(trans, names, trks, wts, funcs, defer_tables)){
             return false;
         }
         
@@ -104,7 +105,7 @@ namespace StochHMM{
         //Check emissions existence  (only INIT state can have no emission)
         if (emissionInfo != std::string::npos){
             std::string emmis = txt.substr(emissionInfo);
-            if (!_parseEmission(emmis, names, trks, wts, funcs)){
+            if (!_parseEmission(emmis, names, trks, wts, funcs, defer_tables)){
                 std::cerr << "Couldn't parse the emissions for state: " << name << std::endl;
                 return false;
             }
@@ -194,7 +195,7 @@ namespace StochHMM{
     //! \param trks Reference to tracks for the model
     //! \param wts Weight defined in the model
     //! \param funcs State functions defined for the model
-    bool state::_parseTransition(std::string& txt, stringList& names, tracks& trks, weights* wts, StateFuncs* funcs){
+    bool state::_parseTransition(std::string& txt, stringList& names, tracks& trks, weights* wts, StateFuncs* funcs, bool defer_tables){
         //SPLIT UP TRANSITIONS AND APPLY SEPARATELY
         stringList lst;
         lst.splitND(txt,"TRANSITION:");
@@ -279,7 +280,7 @@ namespace StochHMM{
                     exit(1);
                 }
                 
-                if (!temp->parse(line,names,valtyp,trks,wts,funcs)){
+                if (!temp->parse(line,names,valtyp,trks,wts,funcs,defer_tables)){
                     std::cerr << "Couldn't parse Transition "<< std::endl;
                     return false;
                 }
@@ -302,7 +303,7 @@ namespace StochHMM{
     //! \param wts Weight defined of the model
     //! \param funcs StateFunction defined for the model
     
-    bool state::_parseEmission(std::string& txt, stringList& names, tracks& trks, weights* wts, StateFuncs* funcs){
+    bool state::_parseEmission(std::string& txt, stringList& names, tracks& trks, weights* wts, StateFuncs* funcs, bool defer_tables){
         stringList lst;
         lst.splitND(txt,"EMISSION:");
         //lst.print();
@@ -315,7 +316,7 @@ namespace StochHMM{
                 exit(1);
             }
             
-            if (!temp->parse(lst[iter],trks,wts,funcs)){
+            if (!temp->parse(lst[iter],trks,wts,funcs,defer_tables)){
                 return false;
             }
             emission.push_back(temp);
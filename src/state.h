@@ -35,17 +35,12 @@
 #include "transitions.h"
 #include <stdint.h>
 #include <stdlib.h>
-#include <bitset>
+#include "dynamic_bitset.h"
 
 #ifndef SIZE_MAX
 #define SIZE_MAX ((size_t)-1)
 #endif
 
-//Define size of bitset.  If not set in makefile then will use default 1024.
-#ifndef STATE_MAX
-#define STATE_MAX 1024
-#endif
-
 namespace StochHMM{
 
     class transition;
@@ -83,13 +78,13 @@ namespace StochHMM{
 		
 		//!Get all states that this state has transitions to
 		//! \return std::vector<state*>* Pointer to all state that are transitioned to
-		inline std::bitset<STATE_MAX>* getTo(){return &to;};
+		inline dynamic_bitset* getTo(){return &to;};
 
 
 		
 		//!Get all states that transition to this state
 		//!\return std::vector<state*>* Pointer to all state that transition to this state
-		inline std::bitset<STATE_MAX>* getFrom(){return &from;};
+		inline dynamic_bitset* getFrom(){return &from;};
 		
 		
 		//TODO: Check that undefined return values are NULL
@@ -108,6 +103,9 @@ namespace StochHMM{
 		//!\results emm* pointer to emission
 		inline emm* getEmission(size_t iter){return emission[iter];};
 		
+		//!Get the number of emissions defined in the state
+		inline size_t getEmissionSize(){return emission.size();};
+		
 		double get_emission_prob(sequences& seqs, size_t iter);  //get emission for given (position)
 		double get_transition_prob(sequences& seqs, size_t to, size_t iter);  //get transition  (position,from or too)
 		double getEndTrans();
@@ -116,7 +114,7 @@ namespace StochHMM{
 		std::string stringify();
 		
 		//MUTATORS
-		bool parse(std::string&,stringList&,tracks&,weights*,StateFuncs*);
+		bool parse(std::string&,stringList&,tracks&,weights*,StateFuncs*,bool defer_tables = false);
 		
 		//!Add the transition to the state
 		//!\param trans Pointer to transition to add to the state
@@ -140,6 +138,10 @@ namespace StochHMM{
 		//!Set the Label for the state
 		inline void setLabel(std::string& txt){label=txt;};
 		
+		//!Size the to and from state sets to the number of states in the model
+		//!All states are cleared from the sets
+		inline void setStateSetSize(size_t sz){to.resize(sz); to.reset(); from.resize(sz); from.reset();};
+		
 		//!Add state that this state transitions to
 		inline void addToState(state* st){to[st->getIterator()]=1;};
 		
@@ -175,12 +177,12 @@ namespace StochHMM{
 		
 		//Linking State Information (These are assigned at model finalization)
 		size_t stateIterator;  //index of state in HMM
-		std::bitset<STATE_MAX> to;
-		std::bitset<STATE_MAX> from;
+		dynamic_bitset to;
+		dynamic_bitset from;
 		
 		bool _parseHeader(std::string&);
-		bool _parseTransition(std::string&,stringList&, tracks&, weights* , StateFuncs*);
-		bool _parseEmission(std::string&,stringList&, tracks&, weights*, StateFuncs*);
+		bool _parseTransition(std::string&,stringList&, tracks&, weights* , StateFuncs*, bool);
+		bool _parseEmission(std::string&,stringList&, tracks&, weights*, StateFuncs*, bool);
 	};
 	
 }
@@ -59,6 +59,9 @@ namespace StochHMM {
 		
 		void traceback(traceback_path& path);
 		
+		//!Get the number of bytes of the table
+		inline size_t bytes(){return state_val->capacity() * sizeof(stoch_value) + position->capacity() * sizeof(size_t);}
+		
 	private:
 		size_t last_position;
 		std::vector<stoch_value>* state_val;
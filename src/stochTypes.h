@@ -107,6 +107,13 @@ namespace StochHMM{
     //!LOG_PROG = log2 value of probability
     //!PERCENTAGE = [0,100] or 100*Probability
     enum valueType {UNKNOWN, PROBABILITY, LOG_ODDS, COUNTS, LOG_PROB, PERCENTAGE} ;
+    
+    
+    //!\enum trainingType {BAUM_WELCH_TRAINING, VITERBI_TRAINING};
+    //!Type of expectation step to use when training a model
+    //! BAUM_WELCH_TRAINING = Expected counts from forward/backward (soft EM)
+    //! VITERBI_TRAINING = Counts along the viterbi path (hard EM)
+    enum trainingType {BAUM_WELCH_TRAINING, VITERBI_TRAINING};
 
 
 }
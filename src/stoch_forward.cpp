@@ -28,6 +28,8 @@ namespace StochHMM {
 	}
 	
 	void trellis::simple_stochastic_forward(){
+		TRELLIS_PHASE("simple_stochastic_forward");
+		trellisTiles tile_scope(this, true);
 		
 //		if (!hmm->isBasic()){
 //			std::cerr << "Model isn't a simple/basic HMM.  Use complex algorithms\n";
@@ -44,8 +46,8 @@ namespace StochHMM {
 			exit(2);
 		}
 		
-        std::bitset<STATE_MAX> next_states;
-        std::bitset<STATE_MAX> current_states;
+        dynamic_bitset next_states(state_size);
+        dynamic_bitset current_states(state_size);
 		
         double  forward_temp(-INFINITY);
         double  emission(-INFINITY);
@@ -53,21 +55,19 @@ namespace StochHMM {
         
         state* init = hmm->getInitial();
 		
-		std::bitset<STATE_MAX>* initial_to = hmm->getInitialTo();
-		std::bitset<STATE_MAX>* from_trans(NULL);
+		dynamic_bitset* initial_to = hmm->getInitialTo();
+		dynamic_bitset* from_trans(NULL);
 		
 		
 		//		std::cout << "Position: 0" << std::endl;
         //Calculate Viterbi from transitions from INIT (initial) state
-        for(size_t st = 0; st < state_size; ++st){
-            if ((*initial_to)[st]){  //if the bitset is set (meaning there is a transition to this state), calculate the viterbi
-				
-				forward_temp = (*hmm)[st]->get_emission_prob(*seqs,0) + getTransition(init, st, 0);
-                
-				if (forward_temp > -INFINITY){                    
-					(*scoring_current)[st] = forward_temp;
-					next_states |= (*(*hmm)[st]->getTo());
-                }
+        for(size_t st = initial_to->find_first(); st != SIZE_MAX; st = initial_to->find_next(st)){
+			
+			forward_temp = _emission(st, 0) + getTransition(init, st, 0);
+            
+			if (forward_temp > -INFINITY){                    
+				(*scoring_current)[st] = forward_temp;
+				next_states |= (*(*hmm)[st]->getTo());
             }
         }
         
@@ -75,6 +75,7 @@ namespace StochHMM {
         for(size_t position = 1; position < seq_size ; ++position ){
             
             
+            _count_cells(scoring_current);
 			//Swap current and previous viterbi scores
             scoring_previous->assign(state_size,-INFINITY);
             swap_ptr = scoring_previous;
@@ -93,12 +94,9 @@ namespace StochHMM {
 			
 			//			std::cout << "\nPosition: " << position << std::endl;
             
-            for (size_t st_current = 0; st_current < state_size; ++st_current){ //i is current state that emits value
-                if (!current_states[st_current]){
-                    continue;
-                }
+            for (size_t st_current = current_states.find_first(); st_current != SIZE_MAX; st_current = current_states.find_next(st_current)){ //i is current state that emits value
                 
-                emission = (*hmm)[st_current]->get_emission_prob(*seqs, position);
+                emission = _emission(st_current, position);
 				
 				if (exDef_defined && exDef_position){
                     emission += seqs->getWeight(position, st_current);
@@ -106,10 +104,7 @@ namespace StochHMM {
                 
 				from_trans = (*hmm)[st_current]->getFrom();
 				
-                for (size_t st_previous = 0; st_previous < state_size ; ++st_previous) {  //j is previous state
-                    if (!(*from_trans)[st_previous]){
-                        continue;
-                    }
+                for (size_t st_previous = from_trans->find_first(); st_previous != SIZE_MAX; st_previous = from_trans->find_next(st_previous)){  //j is previous state
 					
 					if ((*scoring_previous)[st_previous] != -INFINITY){
                         forward_temp = (*scoring_previous)[st_previous] + emission + getTransition((*hmm)[st_previous], st_current , position);
@@ -133,6 +128,7 @@ namespace StochHMM {
             }
 		}
 		
+        _count_cells(scoring_current);
         //Swap current and previous scores
         scoring_previous->assign(state_size,-INFINITY);
         swap_ptr = scoring_previous;
@@ -172,6 +168,8 @@ namespace StochHMM {
 	
 	
 	void trellis::naive_stochastic_forward(){
+		TRELLIS_PHASE("naive_stochastic_forward");
+		trellisTiles tile_scope(this, true);
 		dbl_forward_score = new (std::nothrow) double_2D(seq_size, std::vector<double>(state_size,-INFINITY));
 		stochastic_table = new (std::nothrow) stochTable(seq_size);
 
@@ -191,7 +189,7 @@ namespace StochHMM {
 		
 		//Calculate from Initial states
 		for(size_t st = 0; st < state_size; ++st){
-			forward_temp = (*hmm)[st]->get_emission_prob(*seqs,0) +  getTransition(init, st, 0);
+			forward_temp = _emission(st, 0) +  getTransition(init, st, 0);
 			(*dbl_forward_score)[0][st]=forward_temp;
 		}
 		
@@ -199,7 +197,7 @@ namespace StochHMM {
 		for (size_t position = 1 ; position < seq_size ; ++position){
 			for (size_t st_current = 0; st_current < state_size; ++st_current){
 				//Calc emissions
-				emission = (*hmm)[st_current]->get_emission_prob(*seqs, position);
+				emission = _emission(st_current, position);
 				
 				if (exDef_defined && exDef_position){
 					emission += seqs->getWeight(position, st_current);
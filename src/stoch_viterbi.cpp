@@ -40,13 +40,15 @@ namespace StochHMM{
 	}
 	
 	void trellis::simple_stochastic_viterbi(){
+		TRELLIS_PHASE("simple_stochastic_viterbi");
+		trellisTiles tile_scope(this, true);
 		scoring_previous = new (std::nothrow) std::vector<double> (state_size,-INFINITY);
 		scoring_current  = new (std::nothrow) std::vector<double> (state_size,-INFINITY);
 		traceback_table = new int_2D(seq_size,std::vector<int16_t> (state_size,-1));
 		stochastic_table = new (std::nothrow) stochTable(seq_size);
 		
-		std::bitset<STATE_MAX> next_states;
-		std::bitset<STATE_MAX> current_states;
+		dynamic_bitset next_states(state_size);
+		dynamic_bitset current_states(state_size);
 		
 		double  viterbi_temp(-INFINITY);
 		double  emission(-INFINITY);
@@ -55,26 +57,25 @@ namespace StochHMM{
 		
 		state* init = hmm->getInitial();
 		
-		std::bitset<STATE_MAX>* initial_to = hmm->getInitialTo();
-		std::bitset<STATE_MAX>* from_trans(NULL);
+		dynamic_bitset* initial_to = hmm->getInitialTo();
+		dynamic_bitset* from_trans(NULL);
 		
 		//Calculate Viterbi from transitions from INIT (initial) state
-		for(size_t st = 0; st < state_size; ++st){
-			if ((*initial_to)[st]){  //if the bitset is set (meaning there is a transition to this state), calculate the viterbi
-				
-				viterbi_temp = (*hmm)[st]->get_emission_prob(*seqs,0) + getTransition(init, st, 0);;
-				
-				if (viterbi_temp > -INFINITY){
-					if ((*scoring_current)[st] < viterbi_temp){
-						(*scoring_current)[st] = viterbi_temp;
-					}
-					next_states |= (*(*hmm)[st]->getTo());
+		for(size_t st = initial_to->find_first(); st != SIZE_MAX; st = initial_to->find_next(st)){
+			
+			viterbi_temp = _emission(st, 0) + getTransition(init, st, 0);;
+			
+			if (viterbi_temp > -INFINITY){
+				if ((*scoring_current)[st] < viterbi_temp){
+					(*scoring_current)[st] = viterbi_temp;
 				}
+				next_states |= (*(*hmm)[st]->getTo());
 			}
 		}
 		
 		for(size_t position = 1; position < seq_size ; ++position ){
 			
+			_count_cells(scoring_current);
 			//Swap current and previous viterbi scores
 			scoring_previous->assign(state_size,-INFINITY);
 			swap_ptr = scoring_previous;
@@ -90,14 +91,9 @@ namespace StochHMM{
 				exDef_position = seqs->exDefDefined(position);
 			}
 			
-			for (size_t st_current = 0; st_current < state_size; ++st_current){ //i is current state that emits value
+			for (size_t st_current = current_states.find_first(); st_current != SIZE_MAX; st_current = current_states.find_next(st_current)){ //i is current state that emits value
 				
-				//Check to see if current state is valid
-				if (!current_states[st_current]){
-					continue;
-				}
-				
-				emission = (*hmm)[st_current]->get_emission_prob(*seqs, position);
+				emission = _emission(st_current, position);
 				
 				
 				if (exDef_defined && exDef_position){
@@ -111,10 +107,7 @@ namespace StochHMM{
 				//Get list of states that are valid previous states
 				from_trans = (*hmm)[st_current]->getFrom();
 				
-				for (size_t st_previous = 0; st_previous < state_size ; ++st_previous) {  //j is previous state
-					if (!(*from_trans)[st_previous]){
-						continue;
-					}
+				for (size_t st_previous = from_trans->find_first(); st_previous != SIZE_MAX; st_previous = from_trans->find_next(st_previous)){  //j is previous state
 					
 					if ((*scoring_previous)[st_previous] != -INFINITY){
 						viterbi_temp = getTransition((*hmm)[st_previous], st_current , position) + emission + (*scoring_previous)[st_previous];
@@ -138,6 +131,7 @@ namespace StochHMM{
 		}
 		
 		//TODO:  Calculate ending and set the final viterbi and traceback pointer
+		_count_cells(scoring_current);
 		//Swap current and previous viterbi scores
 		scoring_previous->assign(state_size,-INFINITY);
 		swap_ptr = scoring_previous;
@@ -179,6 +173,8 @@ namespace StochHMM{
 	}
 	
 	void trellis::naive_stochastic_viterbi(){
+		TRELLIS_PHASE("naive_stochastic_viterbi");
+		trellisTiles tile_scope(this, true);
 		traceback_table = new(std::nothrow) int_2D(seq_size, std::vector<int16_t>(state_size,-1));
 		dbl_viterbi_score = new (std::nothrow) double_2D(seq_size, std::vector<double>(state_size,-INFINITY));
 		stochastic_table = new (std::nothrow) stochTable(seq_size);
@@ -195,7 +191,7 @@ namespace StochHMM{
 		
 		//Calculate from Initial states
 		for(size_t st = 0; st < state_size; ++st){
-			viterbi_temp = (*hmm)[st]->get_emission_prob(*seqs,0) +  getTransition(init, st, 0);
+			viterbi_temp = _emission(st, 0) +  getTransition(init, st, 0);
 			(*dbl_viterbi_score)[0][st]=viterbi_temp;
 			(*traceback_table)[0][st]=-1;
 		}
@@ -209,7 +205,7 @@ namespace StochHMM{
 			
 			for (size_t st_current = 0; st_current < state_size; ++st_current){
 				//Calc emissions
-				emission = (*hmm)[st_current]->get_emission_prob(*seqs, position);
+				emission = _emission(st_current, position);
 				
 				if (exDef_defined && exDef_position){
 					emission += seqs->getWeight(position, st_current);
@@ -280,8 +276,8 @@ namespace StochHMM{
 //		traceback_table = new int_2D(seq_size,std::vector<int16_t> (state_size,-1));
 //		alt_stochastic_table = new (std::nothrow) alt_stochTable(state_size,seq_size);
 //		
-//		std::bitset<STATE_MAX> next_states;
-//		std::bitset<STATE_MAX> current_states;
+//		dynamic_bitset next_states(state_size);
+//		dynamic_bitset current_states(state_size);
 //		
 //		double  viterbi_temp(-INFINITY);
 //		double  emission(-INFINITY);
@@ -290,8 +286,8 @@ namespace StochHMM{
 //		
 //		state* init = hmm->getInitial();
 //		
-//		std::bitset<STATE_MAX>* initial_to = hmm->getInitialTo();
-//		std::bitset<STATE_MAX>* from_trans(NULL);
+//		dynamic_bitset* initial_to = hmm->getInitialTo();
+//		dynamic_bitset* from_trans(NULL);
 //		
 //		//Calculate Viterbi from transitions from INIT (initial) state
 //		for(size_t st = 0; st < state_size; ++st){
@@ -411,13 +407,16 @@ namespace StochHMM{
 		state_size		= hmm->state_size();
 		exDef_defined	= seqs->exDefDefined();
 		
+		TRELLIS_PHASE("simple_simple_stochastic_viterbi");
+		trellisTiles tile_scope(this, true);
+		
 		scoring_previous = new (std::nothrow) std::vector<double> (state_size,-INFINITY);
 		scoring_current  = new (std::nothrow) std::vector<double> (state_size,-INFINITY);
 		traceback_table = new int_2D(seq_size,std::vector<int16_t> (state_size,-1));
 		alt_simple_stochastic_table = new (std::nothrow) alt_simple_stochTable(state_size,seq_size);
 		
-		std::bitset<STATE_MAX> next_states;
-		std::bitset<STATE_MAX> current_states;
+		dynamic_bitset next_states(state_size);
+		dynamic_bitset current_states(state_size);
 		
 		double  viterbi_temp(-INFINITY);
 		double  emission(-INFINITY);
@@ -426,26 +425,25 @@ namespace StochHMM{
 		
 		state* init = hmm->getInitial();
 		
-		std::bitset<STATE_MAX>* initial_to = hmm->getInitialTo();
-		std::bitset<STATE_MAX>* from_trans(NULL);
+		dynamic_bitset* initial_to = hmm->getInitialTo();
+		dynamic_bitset* from_trans(NULL);
 		
 		//Calculate Viterbi from transitions from INIT (initial) state
-		for(size_t st = 0; st < state_size; ++st){
-			if ((*initial_to)[st]){  //if the bitset is set (meaning there is a transition to this state), calculate the viterbi
-				
-				viterbi_temp = (*hmm)[st]->get_emission_prob(*seqs,0) + getTransition(init, st, 0);;
-				
-				if (viterbi_temp > -INFINITY){
-					if ((*scoring_current)[st] < viterbi_temp){
-						(*scoring_current)[st] = viterbi_temp;
-					}
-					next_states |= (*(*hmm)[st]->getTo());
+		for(size_t st = initial_to->find_first(); st != SIZE_MAX; st = initial_to->find_next(st)){
+			
+			viterbi_temp = _emission(st, 0) + getTransition(init, st, 0);;
+			
+			if (viterbi_temp > -INFINITY){
+				if ((*scoring_current)[st] < viterbi_temp){
+					(*scoring_current)[st] = viterbi_temp;
 				}
+				next_states |= (*(*hmm)[st]->getTo());
 			}
 		}
 		
 		for(size_t position = 1; position < seq_size ; ++position ){
 			
+			_count_cells(scoring_current);
 			//Swap current and previous viterbi scores
 			scoring_previous->assign(state_size,-INFINITY);
 			swap_ptr = scoring_previous;
@@ -461,14 +459,9 @@ namespace StochHMM{
 				exDef_position = seqs->exDefDefined(position);
 			}
 			
-			for (size_t st_current = 0; st_current < state_size; ++st_current){ //i is current state that emits value
+			for (size_t st_current = current_states.find_first(); st_current != SIZE_MAX; st_current = current_states.find_next(st_current)){ //i is current state that emits value
 				
-				//Check to see if current state is valid
-				if (!current_states[st_current]){
-					continue;
-				}
-				
-				emission = (*hmm)[st_current]->get_emission_prob(*seqs, position);
+				emission = _emission(st_current, position);
 				
 				
 				if (exDef_defined && exDef_position){
@@ -482,10 +475,7 @@ namespace StochHMM{
 				//Get list of states that are valid previous states
 				from_trans = (*hmm)[st_current]->getFrom();
 				
-				for (size_t st_previous = 0; st_previous < state_size ; ++st_previous) {  //j is previous state
-					if (!(*from_trans)[st_previous]){
-						continue;
-					}
+				for (size_t st_previous = from_trans->find_first(); st_previous != SIZE_MAX; st_previous = from_trans->find_next(st_previous)){  //j is previous state
 					
 					if ((*scoring_previous)[st_previous] != -INFINITY){
 						viterbi_temp = getTransition((*hmm)[st_previous], st_current , position) + emission + (*scoring_previous)[st_previous];
@@ -509,6 +499,7 @@ namespace StochHMM{
 		}
 		
 		//TODO:  Calculate ending and set the final viterbi and traceback pointer
+		_count_cells(scoring_current);
 		//Swap current and previous viterbi scores
 		scoring_previous->assign(state_size,-INFINITY);
 		swap_ptr = scoring_previous;
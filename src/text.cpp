@@ -642,6 +642,110 @@ namespace StochHMM{
     }
     
     
+    //! Parse a decimal number from characters that aren't NUL-terminated
+    //! Doesn't use the locale.  Numbers with at most 19 significant digits and
+    //! a power of ten up to 22 are converted exactly (correctly rounded) without
+    //! strtod.  Other numbers (nan, inf, hex or long mantissas) are copied and
+    //! passed to strtod.
+    //! \param[in,out] pos Start of the number.  Set to the character after the number
+    //! \param end End of the characters
+    //! \param[out] val Value of the number
+    //! \return false if there isn't a number at pos
+    bool parseDouble(const char*& pos, const char* end, double& val){
+        static const double powers[] = {1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,
+            1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22};
+        
+        const char* p = pos;
+        bool negative = false;
+        
+        if (p < end && (*p == '-' || *p == '+')){
+            negative = (*p == '-');
+            ++p;
+        }
+        
+        uint64_t mantissa = 0;
+        int digits = 0;       //Significant digits in mantissa
+        int exponent = 0;
+        bool found = false;   //Any digits found
+        
+        for(; p < end && *p >= '0' && *p <= '9'; ++p){
+            found = true;
+            if (mantissa == 0 && *p == '0'){
+                continue;
+            }
+            if (digits < 19){
+                mantissa = mantissa * 10 + (*p - '0');
+            }
+            else{
+                ++exponent;
+            }
+            ++digits;
+        }
+        
+        if (p < end && *p == '.'){
+            for(++p; p < end && *p >= '0' && *p <= '9'; ++p){
+                found = true;
+                if (mantissa == 0 && *p == '0'){
+                    --exponent;
+                    continue;
+                }
+                if (digits < 19){
+                    mantissa = mantissa * 10 + (*p - '0');
+                    --exponent;
+                }
+                ++digits;
+            }
+        }
+        
+        if (found && p < end && (*p == 'e' || *p == 'E')){
+            const char* e = p + 1;
+            bool negative_exp = false;
+            if (e < end && (*e == '-' || *e == '+')){
+                negative_exp = (*e == '-');
+                ++e;
+            }
+            
+            if (e < end && *e >= '0' && *e <= '9'){
+                int value = 0;
+                for(; e < end && *e >= '0' && *e <= '9'; ++e){
+                    if (value < 100000){
+                        value = value * 10 + (*e - '0');
+                    }
+                }
+                exponent += (negative_exp) ? -value : value;
+                p = e;
+            }
+        }
+        
+        //Fast path: mantissa and power of ten are exact doubles
+        if (found && digits <= 19 && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22){
+            double value = (double) mantissa;
+            value = (exponent < 0) ? value / powers[-exponent] : value * powers[exponent];
+            val = (negative) ? -value : value;
+            pos = p;
+            return true;
+        }
+        
+        //Slow path: let strtod handle it
+        const char* token_end = pos;
+        while(token_end < end && *token_end != ' ' && *token_end != '\t' && *token_end != ',' && *token_end != '\n'){
+            ++token_end;
+        }
+        
+        std::string token(pos, token_end);
+        char* parsed_end;
+        val = strtod(token.c_str(), &parsed_end);
+        
+        if (parsed_end == token.c_str()){
+            val = 0;
+            return false;
+        }
+        
+        pos += parsed_end - token.c_str();
+        return true;
+    }
+    
+    
 
         
     //! Converts a vector of shorts into a string delimited by a character c
@@ -33,6 +33,7 @@
 #include <string>
 #include <vector>
 #include <stdlib.h>
+#include <stdint.h>
 #ifndef SIZE_MAX
 #define SIZE_MAX ((size_t)-1)
 #endif
@@ -174,6 +175,7 @@ namespace StochHMM{
     bool stringToInt(std::string&, int&);
 	bool stringToInt(std::string&, size_t&);
     bool stringToDouble(std::string&, double&);
+    bool parseDouble(const char*&, const char*, double&);
 
     bool isNumeric(const std::string&);
 
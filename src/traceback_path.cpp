@@ -190,12 +190,17 @@ namespace StochHMM{
     
     //!Print the path to stdout
     void traceback_path::print_path() const{
-        int line=0;
+        outputBuffer out(std::cout);
+        print_path(out);
+    }
+    
+    //!Print the path to an output buffer
+    void traceback_path::print_path(outputBuffer& out) const{
         for(size_t k = this->size()-1; k != SIZE_MAX; k--){
-            std::cout << trace_path[k]<< " ";
-            line++;
+            out.appendInt(trace_path[k]);
+            out.append(' ');
         }
-        std::cout << std::endl << std::endl;
+        out.append("\n\n", 2);
     }
 
     //!Print the path to file stream
@@ -261,7 +266,12 @@ namespace StochHMM{
 
     //!Print traceback_path labels to stdout
     void traceback_path::print_label() const {
-        int line=0;
+        outputBuffer out(std::cout);
+        print_label(out);
+    }
+    
+    //!Print traceback_path labels to an output buffer
+    void traceback_path::print_label(outputBuffer& out) const {
 		
 		if ( hmm==NULL ){
 			std::cerr << "Model is NULL.  traceback::print_label() must have valid HMM model defined.\n";
@@ -269,15 +279,11 @@ namespace StochHMM{
 		}
 		
         for(size_t k = trace_path.size()-1;k != SIZE_MAX;k--){
-//            if(line==WID && WID>0){
-//                std::cout<< std::endl;
-//                line=0;
-//            }
             state* st = hmm->getState(trace_path[k]);
-            std::cout << st->getLabel() << " ";
-            line++;
+            out.append(st->getLabel());
+            out.append(' ');
         }
-        std::cout << std::endl << std::endl;
+        out.append("\n\n", 2);
         
     }
 
@@ -329,6 +335,31 @@ namespace StochHMM{
 
     //!outputs the gff formatted output for the traceback
     void traceback_path::print_gff(std::string sequence_name) const {
+        print_gff(sequence_name, 0);
+    }
+    
+    
+    void traceback_path::print_gff(std::string sequence_name, size_t offset) const {
+        outputBuffer out(std::cout);
+        print_gff(out, sequence_name, offset);
+    }
+    
+    
+    //!Append one GFF line to the output buffer
+    static void _gff_line(outputBuffer& out, const std::string& sequence_name, const std::string& label, size_t start, size_t end){
+        out.append(sequence_name);
+        out.append("\tStochHMM\t", 10);
+        out.append(label);
+        out.append('\t');
+        out.appendInt((uint64_t) start);
+        out.append('\t');
+        out.appendInt((uint64_t) end);
+        out.append("\t.\t+\t.\n", 7);
+    }
+    
+    
+    //!Outputs the gff formatted output for the traceback to an output buffer
+    void traceback_path::print_gff(outputBuffer& out, std::string sequence_name, size_t offset) const {
         std::string current_label="";
         long long start=0;
         size_t path_size=size();
@@ -349,7 +380,7 @@ namespace StochHMM{
 			//If no label then print 
             if (new_label.compare("")==0){
                 if (start>0){
-                    std::cout << sequence_name << "\tStochHMM\t" << current_label <<"\t"<< start << "\t" << path_size-(k+1) << "\t.\t+\t."<<std::endl;
+                    _gff_line(out, sequence_name, current_label, start+offset, path_size-(k+1)+offset);
                     start=0;
                     current_label=new_label;
                 }
@@ -364,20 +395,20 @@ namespace StochHMM{
                 }
                 else if (new_label.compare(current_label)==0){
 					if(k==0){
-						std::cout << sequence_name << "\tStochHMM\t" << current_label <<"\t"<< start << "\t" << path_size << "\t.\t+\t."<<std::endl;
+						_gff_line(out, sequence_name, current_label, start+offset, path_size+offset);
 						
 					}
 					
                     continue;
                 }
                 else {
-                    std::cout << sequence_name << "\tStochHMM\t" << current_label <<"\t"<< start << "\t" << path_size-(k+1) << "\t.\t+\t."<<std::endl;
+                    _gff_line(out, sequence_name, current_label, start+offset, path_size-(k+1)+offset);
 					
 					start=path_size-k;
                     current_label=new_label;
 					
 					if(k==0){
-						std::cout << sequence_name << "\tStochHMM\t" << current_label <<"\t"<< start << "\t" << path_size << "\t.\t+\t."<<std::endl;
+						_gff_line(out, sequence_name, current_label, start+offset, path_size+offset);
 					}
                     
                 }
@@ -385,7 +416,7 @@ namespace StochHMM{
             
         }
         
-        std::cout << std::endl<<std::endl;
+        out.append("\n\n", 2);
     }
 
 
@@ -559,22 +590,37 @@ namespace StochHMM{
     
     
     void multiTraceback::print_hits(){
+        print_hits(0);
+    }
+    
+    
+    void multiTraceback::print_hits(size_t offset){
+        outputBuffer out(std::cout);
+        print_hits(out, offset);
+    }
+    
+    
+    void multiTraceback::print_hits(outputBuffer& out, size_t offset){
         if (table==NULL){
             get_hit_table();
         }
         
-        std::string header_row = "Position";
+        out.append("Position");
         model* hmm = ((*pathAccess[0]).first).getModel();
         for (size_t state_iter =0; state_iter<hmm->state_size(); state_iter++){
-            header_row+="\t";
-            header_row+=hmm->getStateName(state_iter);
+            out.append('\t');
+            out.append(hmm->getStateName(state_iter));
         }
-
-        std::cout << header_row << std::endl;
+        out.append('\n');
         
         for(size_t position = 0; position < table->size(); position++){
-            std::string line = join((*table)[position], '\t');
-            std::cout << position+1 << "\t" << line << std::endl;
+            out.appendInt((uint64_t) (position+1+offset));
+            std::vector<int>& row = (*table)[position];
+            for(size_t i = 0; i < row.size(); i++){
+                out.append('\t');
+                out.appendInt(row[i]);
+            }
+            out.append('\n');
         }
         
         return;
@@ -582,31 +628,56 @@ namespace StochHMM{
     
     
     void multiTraceback::print_path(){
+        outputBuffer out(std::cout);
+        print_path(out);
+    }
+    
+    void multiTraceback::print_path(outputBuffer& out){
         this->finalize();
         for(size_t iter=0; iter<this->size(); iter++){
-            std::cout << "Traceback occurred:\t " << (*pathAccess[iter]).second << std::endl;
-            (*pathAccess[iter]).first.print_path();
-            std::cout << std::endl;
+            out.append("Traceback occurred:\t ");
+            out.appendInt((*pathAccess[iter]).second);
+            out.append('\n');
+            (*pathAccess[iter]).first.print_path(out);
+            out.append('\n');
         }
         return;
     }
     
     void multiTraceback::print_label(){
+        outputBuffer out(std::cout);
+        print_label(out);
+    }
+    
+    void multiTraceback::print_label(outputBuffer& out){
         this->finalize();
         for(size_t iter=0; iter<this->size(); iter++){
-            std::cout << "Traceback occurred:\t " << (*pathAccess[iter]).second << std::endl;
-            (*pathAccess[iter]).first.print_label();
-            std::cout << std::endl;
+            out.append("Traceback occurred:\t ");
+            out.appendInt((*pathAccess[iter]).second);
+            out.append('\n');
+            (*pathAccess[iter]).first.print_label(out);
+            out.append('\n');
         }
         return;
     }
     
     void multiTraceback::print_gff(std::string& header){
+        print_gff(header, 0);
+    }
+    
+    void multiTraceback::print_gff(std::string& header, size_t offset){
+        outputBuffer out(std::cout);
+        print_gff(out, header, offset);
+    }
+    
+    void multiTraceback::print_gff(outputBuffer& out, std::string& header, size_t offset){
         this->finalize();
         for(size_t iter=0; iter<this->size(); iter++){
-            std::cout << "Traceback occurred:\t " << (*pathAccess[iter]).second << std::endl;
-            (*pathAccess[iter]).first.print_gff(header);
-            std::cout << std::endl;
+            out.append("Traceback occurred:\t ");
+            out.appendInt((*pathAccess[iter]).second);
+            out.append('\n');
+            (*pathAccess[iter]).first.print_gff(out, header, offset);
+            out.append('\n');
         }
         return;
     }
@@ -41,6 +41,7 @@
 #include "options.h"
 #include "hmm.h"
 #include "stochMath.h"
+#include "outputWriter.h"
 namespace StochHMM{
 
     //! \struct gff_feature
@@ -116,10 +117,12 @@ namespace StochHMM{
 		//! Print the traceback path as path to stdout using cout
         //! Path numbers correspond to state index in model
 		void print_path() const ;
+		void print_path(outputBuffer&) const ;
 		
 		//! Print the traceback path as state labels
 		//! State labels
         void print_label() const ;
+        void print_label(outputBuffer&) const ;
 		
 		//!Outputs the gff formatted output for the traceback to stdout
 		//!Allows user to provide additional information, that may be
@@ -133,6 +136,12 @@ namespace StochHMM{
         
 		//!Outputs the gff formatted output for the traceback
 		void print_gff(std::string) const ;
+		
+		//!Outputs the gff formatted output for the traceback
+		//!\param[in] sequence_name  Name of sequence used
+		//!\param[in] offset Added to the positions (sequence is a region)
+		void print_gff(std::string, size_t offset) const ;
+		void print_gff(outputBuffer&, std::string, size_t offset) const ;
         
 		//!Get the score that is associated with the traceback
         inline double getScore(){
@@ -182,7 +191,15 @@ namespace StochHMM{
         void print_path();
         void print_label();
         void print_gff(std::string&);
+        void print_gff(std::string&, size_t offset);
         void print_hits();
+        void print_hits(size_t offset);
+        
+        //Print to an output buffer
+        void print_path(outputBuffer&);
+        void print_label(outputBuffer&);
+        void print_gff(outputBuffer&, std::string&, size_t offset);
+        void print_hits(outputBuffer&, size_t offset);
         
         
         //Access the data at a point
@@ -281,10 +281,7 @@ namespace StochHMM{
 		}
 		
 		if (charIndices == NULL){
-			charIndices = new (std::nothrow) std::vector<uint8_t>(255,255);
-			for(std::map<std::string,uint8_t>::iterator it = symbolIndices.begin(); it != symbolIndices.end(); it++){
-				(*charIndices)[(it->first)[0]] = it->second;
-			}
+			_buildSymbolTable();
 		}
 		
 		
@@ -303,6 +300,22 @@ namespace StochHMM{
     }
     
     
+	//! Build the table of digital values indexed by character
+	void track::_buildSymbolTable(){
+		charIndices = new (std::nothrow) std::vector<uint8_t>(256,255);
+		
+		if (charIndices == NULL){
+			std::cerr << "Can't allocate track symbol table. OUT OF MEMORY" << std::endl;
+			exit(2);
+		}
+		
+		for(std::map<std::string,uint8_t>::iterator it = symbolIndices.begin(); it != symbolIndices.end(); it++){
+			(*charIndices)[(unsigned char)(it->first)[0]] = it->second;
+		}
+		return;
+	}
+    
+    
     //FIXME: Change return value so only returns true if parse is OK
     //! Parse a string representation of track to define a tracks parameters
     //! \param txt Line from model that describes a track
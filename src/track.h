@@ -186,6 +186,16 @@ namespace StochHMM{
         
         uint8_t symbolIndex(const std::string&);
 		uint8_t symbolIndex(unsigned char);
+		
+		//! Get the 256 entry table of digital values indexed by character
+		//! Characters that aren't defined in the track are 255
+		//! Only valid for tracks with single character symbols
+		inline const uint8_t* getSymbolTable(){
+			if (charIndices == NULL){
+				_buildSymbolTable();
+			}
+			return &(*charIndices)[0];
+		}
         
         uint8_t getComplementIndex(uint8_t val);
         uint8_t getComplementIndex(std::string&);
@@ -280,6 +290,7 @@ namespace StochHMM{
 		//std::map<char,uint8_t>* charIndices;
 		std::vector<uint8_t>* charIndices;
         
+        void _buildSymbolTable();
         void _splitAmbiguousList(std::vector<std::pair<std::string ,std::vector<std::string> > >&, const std::string&);
     };
 	
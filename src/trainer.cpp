@@ -0,0 +1,358 @@
+//
+//  trainer.cpp
+//  StochHMM
+//
+//  Copyright (c) 2013 Korf Lab, Genome Center, UC Davis, Davis, CA. All rights reserved.
+//
+
+#include "trainer.h"
+
+namespace StochHMM{
+	
+	//Parameters passed to each training thread
+	struct trainerThreadParam{
+		trainer* train;
+		size_t thread;
+	};
+	
+	
+	//!Create a trainer for the model
+	//!\param h Model to be trained
+	//!\param funcs StateFuncs used to import the model copies used by threads
+	trainer::trainer(model* h, StateFuncs* funcs){
+		hmm = h;
+		functions = funcs;
+		type = BAUM_WELCH_TRAINING;
+		threads = 1;
+		max_iterations = 100;
+		iterations = 0;
+		tolerance = 0.001;
+		log_likelihood = -INFINITY;
+		best_model = NULL;
+	}
+	
+	
+	trainer::~trainer(){
+		for(size_t i=0; i < jobs.size(); ++i){
+			delete jobs[i];
+		}
+		
+		for(size_t i=0; i < thread_models.size(); ++i){
+			delete thread_models[i];
+		}
+		
+		for(size_t i=0; i < thread_trellis.size(); ++i){
+			delete thread_trellis[i];
+		}
+		
+		delete best_model;
+		hmm = NULL;
+		functions = NULL;
+	}
+	
+	
+	//!Add sequences to the training set
+	//!Sequences are not owned by the trainer
+	void trainer::addSequences(sequences* sqs){
+		if (sqs != NULL){
+			corpus.push_back(sqs);
+		}
+	}
+	
+	
+	//!Load all of the jobs in the seqTracks into the training set
+	void trainer::loadSequences(seqTracks& tracks){
+		seqJob* job = tracks.getJob();
+		while (job != NULL){
+			jobs.push_back(job);
+			corpus.push_back(job->getSeqs());
+			job = tracks.getJob();
+		}
+	}
+	
+	
+	//!Train the model until the change in log-likelihood is less than the tolerance
+	//!or the maximum number of iterations is reached.
+	//!If the log-likelihood decreases, the model of the previous iteration is
+	//!restored and training stops.
+	//!\return log-likelihood of the training set from the final expectation step
+	double trainer::train(){
+		if (corpus.size() == 0){
+			std::cerr << "No sequences provided for training" << std::endl;
+			return -INFINITY;
+		}
+		
+		if (type == BAUM_WELCH_TRAINING && !hmm->isBasic()){
+			std::cerr << "Model isn't a simple/basic HMM.  Baum-Welch training requires a basic model (use -train viterbi)" << std::endl;
+			return -INFINITY;
+		}
+		
+		double previous(-INFINITY);
+		iterations = 0;
+		
+		for(size_t iter = 0; iter < max_iterations; ++iter){
+			log_likelihood = expectation();
+			iterations++;
+			
+			std::cerr << "Iteration: " << iterations << "\tLog-likelihood: " << log_likelihood << std::endl;
+			
+			//EM doesn't lower the likelihood, so a decrease means the last update
+			//made the model worse.  Go back to the model of the previous iteration.
+			if (iter > 0 && log_likelihood < previous){
+				if (previous - log_likelihood >= tolerance){
+					std::cerr << "Warning: log-likelihood decreased from " << previous << " to " << log_likelihood << ".  Keeping the model of iteration " << iterations - 1 << std::endl;
+				}
+				
+				_copy_parameters(best_model, hmm);
+				log_likelihood = previous;
+				_write_model();
+				break;
+			}
+			
+			//Keep the parameters the likelihood was computed with
+			_copy_parameters(hmm, best_model);
+			
+			maximization();
+			_write_model();
+			
+			if (iter > 0 && log_likelihood - previous < tolerance){
+				break;
+			}
+			
+			previous = log_likelihood;
+		}
+		
+		return log_likelihood;
+	}
+	
+	
+	//!Perform the expectation step over all sequences
+	//!Counts are reduced into the model and the trellis of the first thread
+	//!\return Sum of log-likelihood (or viterbi score) of all the sequences
+	double trainer::expectation(){
+		size_t n = (threads < corpus.size()) ? threads : corpus.size();
+		_init_threads(n);
+		
+		for(size_t i=0; i < n-1; ++i){
+			_copy_parameters(hmm, thread_models[i]);
+		}
+		
+		if (n == 1){
+			_run_thread(0);
+		}
+		else{
+			std::vector<pthread_t> thread_ids(n);
+			std::vector<trainerThreadParam> params(n);
+			
+			for(size_t i=1; i < n; ++i){
+				params[i].train = this;
+				params[i].thread = i;
+				if (pthread_create(&thread_ids[i], NULL, _thread_start, &params[i]) != 0){
+					std::cerr << "Couldn't create training thread" << std::endl;
+					exit(2);
+				}
+			}
+			
+			_run_thread(0);
+			
+			for(size_t i=1; i < n; ++i){
+				pthread_join(thread_ids[i], NULL);
+			}
+		}
+		
+		_reduce();
+		
+		double total(0);
+		for(size_t i=0; i < n; ++i){
+			total += thread_likelihood[i];
+		}
+		return total;
+	}
+	
+	
+	//!Update the model transitions and emissions from the reduced counts
+	void trainer::maximization(){
+		if (thread_trellis.size() == 0 || thread_trellis[0] == NULL){
+			return;
+		}
+		
+		thread_trellis[0]->update_transitions();
+		thread_trellis[0]->update_emissions();
+	}
+	
+	
+	void* trainer::_thread_start(void* ptr){
+		trainerThreadParam* param = static_cast<trainerThreadParam*>(ptr);
+		param->train->_run_thread(param->thread);
+		return NULL;
+	}
+	
+	
+	//!Perform the expectation step on every n-th sequence
+	//!Thread zero uses the model, the other threads use their own copy.
+	void trainer::_run_thread(size_t thread){
+		size_t n = thread_trellis.size();
+		model* mdl = (thread == 0) ? hmm : thread_models[thread-1];
+		
+		//The trellis is kept between iterations so its table of transition
+		//count slots is only built once per training run
+		if (thread_trellis[thread] == NULL){
+			thread_trellis[thread] = new(std::nothrow) trellis(mdl, corpus[thread]);
+			
+			if (thread_trellis[thread] == NULL){
+				std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+				exit(1);
+			}
+		}
+		
+		trellis* trell = thread_trellis[thread];
+		trell->clear_counts();
+		
+		thread_likelihood[thread] = 0;
+		thread_sequences[thread] = 0;
+		
+		for(size_t i = thread; i < corpus.size(); i += n){
+			double score(-INFINITY);
+			
+			if (type == VITERBI_TRAINING){
+				trell->viterbi_training(mdl, corpus[i]);
+				score = trell->getViterbiScore();
+			}
+			else{
+				trell->simple_baum_welch(mdl, corpus[i]);
+				score = trell->getForwardProbability();
+			}
+			
+			if (score > -INFINITY){
+				thread_likelihood[thread] += score;
+				thread_sequences[thread]++;
+			}
+		}
+	}
+	
+	
+	//!Create a copy of the model using its text
+	model* trainer::_copy_model(){
+		std::string model_text = hmm->stringify();
+		model* copy = new(std::nothrow) model;
+		
+		if (copy == NULL){
+			std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+			exit(1);
+		}
+		
+		if (!copy->importFromString(model_text, functions)){
+			std::cerr << "Couldn't create copy of model for training" << std::endl;
+			exit(1);
+		}
+		
+		return copy;
+	}
+	
+	
+	//!Create the model copies and per-thread storage
+	void trainer::_init_threads(size_t n){
+		if (best_model == NULL){
+			best_model = _copy_model();
+		}
+		
+		while (thread_models.size() < n-1){
+			thread_models.push_back(_copy_model());
+		}
+		
+		for(size_t i=n; i < thread_trellis.size(); ++i){
+			delete thread_trellis[i];
+		}
+		
+		thread_trellis.resize(n, NULL);
+		thread_likelihood.assign(n, 0);
+		thread_sequences.assign(n, 0);
+	}
+	
+	
+	//!Copy the standard transitions and lexical emissions between copies of the model
+	void trainer::_copy_parameters(model* from, model* to){
+		for(size_t st = 0; st <= from->state_size(); ++st){
+			state* source = (st == from->state_size()) ? from->getInitial() : from->getState(st);
+			state* dest   = (st == to->state_size()) ? to->getInitial() : to->getState(st);
+			
+			std::vector<transition*>* source_trans = source->getTransitions();
+			std::vector<transition*>* dest_trans = dest->getTransitions();
+			for(size_t i = 0; i < source_trans->size() && i < dest_trans->size(); ++i){
+				if ((*source_trans)[i] != NULL && (*dest_trans)[i] != NULL && (*source_trans)[i]->getTransitionType() == STANDARD){
+					(*dest_trans)[i]->setTransProb((*source_trans)[i]->getTransition(0,NULL));
+				}
+			}
+			
+			if (source->getEnding() != NULL && dest->getEnding() != NULL && source->getEnding()->getTransitionType() == STANDARD){
+				dest->getEnding()->setTransProb(source->getEnding()->getTransition(0,NULL));
+			}
+			
+			if (st == from->state_size()){
+				continue;
+			}
+			
+			for(size_t i = 0; i < source->getEmissionSize(); ++i){
+				if (!source->getEmission(i)->isLexical()){
+					continue;
+				}
+				
+				lexicalTable* source_table = source->getEmission(i)->getTables();
+				lexicalTable* dest_table = dest->getEmission(i)->getTables();
+				*dest_table->getLogProbabilityTable() = *source_table->getLogProbabilityTable();
+				dest_table->update_emission_table();
+			}
+		}
+	}
+	
+	
+	//!Add the counts from each thread to the model and the first thread's trellis
+	void trainer::_reduce(){
+		for(size_t thread = 1; thread < thread_trellis.size(); ++thread){
+			if (thread_sequences[thread] == 0){
+				continue;
+			}
+			
+			thread_trellis[0]->add_counts(*thread_trellis[thread]);
+			
+			model* copy = thread_models[thread-1];
+			for(size_t st = 0; st < hmm->state_size(); ++st){
+				state* source = copy->getState(st);
+				state* dest   = hmm->getState(st);
+				
+				for(size_t i = 0; i < dest->getEmissionSize(); ++i){
+					if (!dest->getEmission(i)->isLexical()){
+						continue;
+					}
+					
+					std::vector<std::vector<double> >* source_counts = source->getEmission(i)->getTables()->getCountsTable();
+					std::vector<std::vector<double> >* dest_counts = dest->getEmission(i)->getTables()->getCountsTable();
+					
+					for(size_t row = 0; row < source_counts->size() && row < dest_counts->size(); ++row){
+						for(size_t column = 0; column < (*source_counts)[row].size() && column < (*dest_counts)[row].size(); ++column){
+							(*dest_counts)[row][column] += (*source_counts)[row][column];
+						}
+					}
+				}
+			}
+		}
+	}
+	
+	
+	//!Write the model to the output file
+	void trainer::_write_model(){
+		if (output_file.empty()){
+			return;
+		}
+		
+		std::ofstream out(output_file.c_str());
+		if (!out.is_open()){
+			std::cerr << "Couldn't open file for trained model: " << output_file << std::endl;
+			return;
+		}
+		
+		out << hmm->stringify();
+		out.close();
+	}
+	
+}
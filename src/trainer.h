@@ -0,0 +1,93 @@
+//
+//  trainer.h
+//  StochHMM
+//
+//  Copyright (c) 2013 Korf Lab, Genome Center, UC Davis, Davis, CA. All rights reserved.
+//
+
+#ifndef __StochHMM__trainer__
+#define __StochHMM__trainer__
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include "stochTypes.h"
+#include "hmm.h"
+#include "sequences.h"
+#include "seqTracks.h"
+#include "trellis.h"
+
+namespace StochHMM{
+	
+	/*! \class trainer
+	 *	\brief Re-estimates model parameters from a set of sequences using EM
+	 *
+	 *	Each iteration performs the expectation step on every sequence, using
+	 *	either Baum-Welch (expected counts) or Viterbi training (counts along the
+	 *	viterbi path).  Sequences are divided among threads.  Each thread uses
+	 *	its own copy of the model, so the lexicalTable counts of the copy serve as
+	 *	that thread's accumulator.  The counts are reduced into the model before
+	 *	the standard transitions and lexical emissions are updated.  Iterations
+	 *	stop when the increase in log-likelihood is below the tolerance.  If the
+	 *	log-likelihood decreases, a warning is printed and the parameters of the
+	 *	previous (best) iteration are restored.
+	 */
+	class trainer{
+	public:
+		trainer(model* h, StateFuncs* funcs);
+		~trainer();
+		
+		void addSequences(sequences* sqs);
+		void loadSequences(seqTracks& tracks);
+		
+		inline void setType(trainingType typ){type = typ;}
+		inline void setThreads(size_t n){threads = (n==0) ? 1 : n;}
+		inline void setMaxIterations(size_t n){max_iterations = n;}
+		inline void setTolerance(double val){tolerance = val;}
+		
+		//!Set the file to write the model to after each iteration
+		inline void setOutputFile(std::string& file){output_file = file;}
+		
+		inline size_t size(){return corpus.size();}
+		inline size_t getIterations(){return iterations;}
+		inline double getLogLikelihood(){return log_likelihood;}
+		
+		double train();
+		double expectation();
+		void maximization();
+		
+	private:
+		model* hmm;
+		StateFuncs* functions;
+		trainingType type;
+		
+		size_t threads;
+		size_t max_iterations;
+		size_t iterations;
+		double tolerance;
+		double log_likelihood;
+		std::string output_file;
+		
+		std::vector<sequences*> corpus;
+		std::vector<seqJob*> jobs;		//Jobs loaded from seqTracks (owned)
+		
+		std::vector<model*> thread_models;	//Model copies for threads > 0
+		model* best_model;					//Parameters of the best iteration so far
+		std::vector<trellis*> thread_trellis;
+		std::vector<double> thread_likelihood;
+		std::vector<size_t> thread_sequences;
+		
+		void _init_threads(size_t n);
+		model* _copy_model();
+		void _copy_parameters(model* from, model* to);
+		void _reduce();
+		void _run_thread(size_t thread);
+		void _write_model();
+		static void* _thread_start(void* ptr);
+	};
+	
+}
+
+#endif /* defined(__StochHMM__trainer__) */
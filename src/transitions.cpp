@@ -93,7 +93,8 @@ namespace StochHMM{
     //! \param trks  Tracks of the model
     //! \param wts  Weight defined in the model
     //! \param funcs State Functions created by the user
-    bool transition::parse(stringList& txt,stringList& names, valueType valtyp, tracks& trks, weights* wts , StateFuncs* funcs){
+    //! \param defer_tables Leave the lexical table to be set from a compiled model
+    bool transition::parse(stringList& txt,stringList& names, valueType valtyp, tracks& trks, weights* wts , StateFuncs* funcs, bool defer_tables){
         
         //txt.print();
         
@@ -115,7 +116,7 @@ namespace StochHMM{
             }
         }
         else if (transition_type == LEXICAL){
-            if (!_parseLexical(txt, names, valtyp, trks, funcs)){
+            if (!_parseLexical(txt, names, valtyp, trks, funcs, defer_tables)){
                 std::cerr << "Couldn't parse Lexical Transition" << std::endl;
                 return false;
             }
@@ -301,7 +302,7 @@ namespace StochHMM{
     }
     
     //Parse the lexical transition from the model file
-    bool transition::_parseLexical(stringList& txt, stringList& names, valueType valtyp, tracks& trks, StateFuncs* funcs){
+    bool transition::_parseLexical(stringList& txt, stringList& names, valueType valtyp, tracks& trks, StateFuncs* funcs, bool defer_tables){
         
         //Process Transition
         stringList line;
@@ -525,6 +526,8 @@ namespace StochHMM{
                 std::cerr << " The Lexical table doesn't contain enough rows.  Expected Rows: " << expectedRows << " \n Please check the Lexical Table and formatting\n";
                 return false;
             }
+			
+			scoreTable.initialize_emission_table(defer_tables);
 
         }
         
@@ -65,7 +65,7 @@ public:
     
     //
     bool parse(std::string&, stringList&, valueType valtyp, tracks& ,weights*, StateFuncs*);
-    bool parse(stringList&, stringList&, valueType valtyp, tracks&  ,weights*, StateFuncs*);
+    bool parse(stringList&, stringList&, valueType valtyp, tracks&  ,weights*, StateFuncs*, bool defer_tables = false);
     
     //! Set the name of the state we are transitioning to
     //! \param txt  Name of the next state
@@ -157,11 +157,17 @@ public:
     inline transitionFuncParam* getExtFunction(){return func;};
     inline bool FunctionDefined(){if(func!=NULL){return true;} else {return false;}};
     
+    //! Get the lexical table of a LEXICAL transition
+    inline lexicalTable* getTables(){return &scoreTable;}
+    
     inline bool LexFunctionDefined(){return function;}
     inline std::string getLexicalFunctionName(){return lexFunc->getName();}
 	
 	inline std::string getPDFFunctionName(){return pdfFunctionName;}
 	
+	//! Get the real number track passed to the PDF function (NULL if none)
+	inline track* getPDFTrack(){return pdfTrack;}
+	
 	inline bool isSimple(){
 		if (transition_type != DURATION && func == NULL && !function){
 			return true;
@@ -220,7 +226,7 @@ private:
     //Private Methods
     bool _parseStandard(std::string&,stringList&, valueType);
     bool _parseDuration(stringList&, stringList&, valueType);              
-    bool _parseLexical(stringList&, stringList&, valueType, tracks&, StateFuncs*);
+    bool _parseLexical(stringList&, stringList&, valueType, tracks&, StateFuncs*, bool);
 	bool _parsePDF(stringList&,stringList&,valueType,tracks&, StateFuncs*);
     bool _processTags(std::string&, tracks& , weights*, StateFuncs*);
 };
@@ -20,7 +20,14 @@ namespace StochHMM {
 		
 		type = SIMPLE;
 		store_values=false;
+		beam_threshold = INFINITY;
+		beam_width = 0;
+		pruned_cells = 0;
 		exDef_defined=false;
+		stats = NULL;
+		tile_pool = NULL;
+		tiles = NULL;
+		posterior_concurrent = false;
 		
 		traceback_table		= NULL;
 		stochastic_table	= NULL;
@@ -33,6 +40,12 @@ namespace StochHMM {
 		dbl_viterbi_score	= NULL;
 		dbl_backward_score	= NULL;
 		dbl_posterior_score = NULL;
+		dbl_baum_welch_score= NULL;
+		
+		transition_counts	= NULL;
+		initial_counts		= NULL;
+		ending_counts		= NULL;
+		transition_slots	= NULL;
 		
 		ending_viterbi_score = -INFINITY;
 		ending_viterbi_tb = -1;
@@ -62,7 +75,14 @@ namespace StochHMM {
 		
 		type = SIMPLE;
 		store_values=false;
+		beam_threshold = INFINITY;
+		beam_width = 0;
+		pruned_cells = 0;
 		exDef_defined	= seqs->exDefDefined();
+		stats = NULL;
+		tile_pool = NULL;
+		tiles = NULL;
+		posterior_concurrent = false;
 		
 		traceback_table		= NULL;
 		stochastic_table	= NULL;
@@ -75,6 +95,12 @@ namespace StochHMM {
 		dbl_viterbi_score	= NULL;
 		dbl_backward_score	= NULL;
 		dbl_posterior_score = NULL;
+		dbl_baum_welch_score= NULL;
+		
+		transition_counts	= NULL;
+		initial_counts		= NULL;
+		ending_counts		= NULL;
+		transition_slots	= NULL;
 		
 		ending_viterbi_score = -INFINITY;
 		ending_viterbi_tb = -1;
@@ -98,6 +124,8 @@ namespace StochHMM {
 	
 	
 	trellis::~trellis(){
+		delete tile_pool;
+		
 		delete traceback_table;
 		delete stochastic_table;
 
@@ -109,6 +137,12 @@ namespace StochHMM {
 		delete dbl_viterbi_score;
 		delete dbl_backward_score;
 		delete dbl_posterior_score;
+		delete dbl_baum_welch_score;
+		
+		delete transition_counts;
+		delete initial_counts;
+		delete ending_counts;
+		delete transition_slots;
 		
 		delete naive_nth_scores;
 		delete ending_nth_viterbi;
@@ -132,6 +166,12 @@ namespace StochHMM {
 		dbl_viterbi_score	= NULL;
 		dbl_backward_score	= NULL;
 		dbl_posterior_score	= NULL;
+		dbl_baum_welch_score= NULL;
+		
+		transition_counts	= NULL;
+		initial_counts		= NULL;
+		ending_counts		= NULL;
+		transition_slots	= NULL;
 		
 		naive_nth_scores	= NULL;
 		ending_nth_viterbi	= NULL;
@@ -154,6 +194,7 @@ namespace StochHMM {
 		type= SIMPLE;
 		store_values = false;
 		exDef_defined = false;
+		pruned_cells = 0;
 		
 		delete traceback_table;
 		delete stochastic_table;
@@ -173,6 +214,12 @@ namespace StochHMM {
 		delete dbl_backward_score;
 		delete dbl_viterbi_score;
 		delete dbl_posterior_score;
+		delete dbl_baum_welch_score;
+		
+		delete transition_counts;
+		delete initial_counts;
+		delete ending_counts;
+		delete transition_slots;
 		
 		delete naive_nth_scores;
 		delete ending_nth_viterbi;
@@ -199,6 +246,12 @@ namespace StochHMM {
 		dbl_viterbi_score	= NULL;
 		dbl_backward_score	= NULL;
 		dbl_posterior_score	= NULL;
+		dbl_baum_welch_score= NULL;
+		
+		transition_counts	= NULL;
+		initial_counts		= NULL;
+		ending_counts		= NULL;
+		transition_slots	= NULL;
 		
 		naive_nth_scores	= NULL;
 		ending_nth_viterbi	= NULL;
@@ -225,6 +278,7 @@ namespace StochHMM {
 		}
 				
 		transType trans_type= trans->getTransitionType();
+		TRELLIS_STATS(transitions[trans_type]++);
         
         
         
@@ -299,6 +353,7 @@ namespace StochHMM {
 		//Traceback through trellis until the correct identifier is reached.
 		for(size_t trellPos=sequencePosition-1 ; trellPos != SIZE_MAX ;trellPos--){
 			length++;
+			TRELLIS_STATS(duration_steps++);
 			tbState = (*traceback_table)[trellPos][tbState];
 			
 			if (tbState == SIZE_MAX){
@@ -357,6 +412,7 @@ namespace StochHMM {
         for(size_t trellisPos = position-1; trellisPos != SIZE_MAX ; --trellisPos){
             
             tracebackPath.push_back(tb_state);
+			TRELLIS_STATS(duration_steps++);
             //std::cout << tb_state << "\t" << temp_st->getLabel() << std::endl;
 			
 			
@@ -403,6 +459,15 @@ namespace StochHMM {
 		}
         
 		//Call the transitionFunc and get the score back
+#ifndef STOCHHMM_NO_STATS
+		if (stats != NULL){
+			double start = trellisStats::now();
+			double transitionValue = func->evaluate(seqs->getUndigitized(trackIndex), position, &CombinedString, length);
+			stats->transition_function_calls++;
+			stats->transition_function_seconds += trellisStats::now() - start;
+			return transitionValue;
+		}
+#endif
         double transitionValue = func->evaluate(seqs->getUndigitized(trackIndex), position, &CombinedString, length);
         
         return transitionValue;
@@ -420,6 +485,8 @@ namespace StochHMM {
 			return;
 		}
 		
+		TRELLIS_PHASE("traceback");
+		
 		if (path.getModel() == NULL){
 			path.setModel(hmm);
 		}
@@ -430,6 +497,7 @@ namespace StochHMM {
         else{
             path.setScore(ending_viterbi_score);
             path.push_back(ending_viterbi_tb);
+			TRELLIS_STATS(traceback_steps++);
             
 			int16_t pointer = ending_viterbi_tb;
 			
@@ -442,6 +510,7 @@ namespace StochHMM {
 				}
 				
 				path.push_back(pointer);
+				TRELLIS_STATS(traceback_steps++);
             }
         }
         return;
@@ -476,6 +545,7 @@ namespace StochHMM {
 			}
 			
 			path.push_back(pointer);
+			TRELLIS_STATS(traceback_steps++);
 		}
 		
 		return;
@@ -483,16 +553,19 @@ namespace StochHMM {
 	
 	
 	void trellis::stochastic_traceback(traceback_path& path){
-		
+		TRELLIS_PHASE("stochastic_traceback");
 		stochastic_table->traceback(path);
+		TRELLIS_STATS(traceback_steps += path.size());
 		return;
 	}
 	
 	
 	void trellis::stochastic_traceback(multiTraceback& paths, size_t reps){
+		TRELLIS_PHASE("stochastic_traceback");
 		for(size_t i=0;i<reps;i++){
 			traceback_path pth(hmm);
 			stochastic_table->traceback(pth);
+			TRELLIS_STATS(traceback_steps += pth.size());
 			paths.assign(pth);
 		}
 		return;
@@ -500,22 +573,26 @@ namespace StochHMM {
 	
 	
 	
-	//TODO: Finish nth traceback function
+	//!Traceback the nth-best path (zero-based)
+	//!Path is left empty if fewer than n+1 paths exist
 	void trellis::traceback_nth(traceback_path& path, size_t n){
-		if (seq_size == 0 || n > nth_size || (nth_traceback_table == NULL && naive_nth_scores == NULL)){
+		if (seq_size == 0 || ending_nth_viterbi == NULL || n >= ending_nth_viterbi->size() || (nth_traceback_table == NULL && naive_nth_scores == NULL)){
 			return;
 		}
 		
+		TRELLIS_PHASE("traceback_nth");
+		
 		if (nth_traceback_table != NULL){
 			int16_t st_pointer = (*ending_nth_viterbi)[n].st_tb;
 			int16_t sc_pointer = (*ending_nth_viterbi)[n].score_tb;
 			
 			path.setScore((*ending_nth_viterbi)[n].score);
 			path.push_back(st_pointer);
+			TRELLIS_STATS(traceback_steps++);
 			
 			
 			for( size_t position = seq_size -1 ; position>0 ; position--){
-				(*nth_traceback_table)[position].get(st_pointer,sc_pointer);
+				nth_traceback_table->get(position, st_pointer, sc_pointer);
 				
 				if (st_pointer == -1){
 					std::cerr << "No valid path at Position: " << position << std::endl;
@@ -523,6 +600,7 @@ namespace StochHMM {
 				}
 				
 				path.push_back(st_pointer);
+				TRELLIS_STATS(traceback_steps++);
             }
 			
 		}
@@ -532,6 +610,7 @@ namespace StochHMM {
 			
 			path.setScore((*ending_nth_viterbi)[n].score);
 			path.push_back(st_pointer);
+			TRELLIS_STATS(traceback_steps++);
 			
 			for( size_t position = seq_size -1 ; position>0 ; position--){
 				nthScore& temp = (*(*naive_nth_scores)[position][st_pointer])[sc_pointer];
@@ -542,6 +621,7 @@ namespace StochHMM {
 					return;
 				}
 				path.push_back(st_pointer);
+				TRELLIS_STATS(traceback_steps++);
             }
 		}
 		return;
@@ -550,6 +630,158 @@ namespace StochHMM {
 	
 
 	
+	
+	trellisTiles::trellisTiles(trellis* trell, bool forward):owner(NULL){
+		if (trell->tile_pool != NULL && trell->tiles == NULL && trell->seq_size > 0){
+			owner = trell;
+			owner->tiles = owner->tile_pool;
+			owner->tiles->start(owner->hmm, owner->seqs, owner->seq_size, forward, owner->stats);
+		}
+	}
+	
+	trellisTiles::~trellisTiles(){
+		if (owner != NULL){
+			owner->tiles->stop();
+			owner->tiles = NULL;
+		}
+	}
+	
+	
+	//!Calculate the emissions with worker threads
+	//!\param threads Number of emission threads (0 to calculate them in the algorithm)
+	//!\param tile Number of positions in a tile
+	void trellis::setEmissionThreads(size_t threads, size_t tile){
+		delete tile_pool;
+		tile_pool = NULL;
+		
+		if (threads > 0){
+			tile_pool = new(std::nothrow) emissionTiles(threads, tile);
+			if (tile_pool == NULL){
+				std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+				exit(1);
+			}
+		}
+	}
+	
+	
+	trellisPhase::trellisPhase(trellis* trell, const char* phase_name):owner(trell),name(phase_name),start(0){
+		if (owner->stats != NULL){
+			start = trellisStats::now();
+		}
+	}
+	
+	trellisPhase::~trellisPhase(){
+		if (owner->stats != NULL){
+			owner->stats->addPhase(name, trellisStats::now() - start);
+			owner->stats->tableBytes(owner->table_bytes());
+		}
+	}
+	
+	
+	//!Get the emission of a state at a position and count it by the kinds of
+	//!emissions of the state in counts.  States with function or external
+	//!emissions are timed.
+	double trellis::_counted_emission(state* current, sequences& sqs, size_t position, trellisStats* counts){
+		size_t functions(0);
+		
+		for(size_t i = 0; i < current->getEmissionSize(); ++i){
+			emm* em = current->getEmission(i);
+			if (em->isFunction()){
+				counts->emissions[FUNCTION_EMISSION]++;
+				functions++;
+			}
+			else if (em->isMultiContinuous()){
+				counts->emissions[MULTI_CONTINUOUS_EMISSION]++;
+			}
+			else if (em->isContinuous()){
+				counts->emissions[CONTINUOUS_EMISSION]++;
+			}
+			else if (em->isReal()){
+				counts->emissions[REAL_NUMBER_EMISSION]++;
+			}
+			else{
+				counts->emissions[LEXICAL_EMISSION]++;
+			}
+			
+			if (em->getExtFunction() != NULL){
+				counts->emissions[EXTERNAL_EMISSION]++;
+				functions++;
+			}
+		}
+		
+		if (functions == 0){
+			return current->get_emission_prob(sqs, position);
+		}
+		
+		double start = trellisStats::now();
+		double emission = current->get_emission_prob(sqs, position);
+		counts->emission_function_calls += functions;
+		counts->emission_function_seconds += trellisStats::now() - start;
+		return emission;
+	}
+	
+	
+	//!Count the cells of a column that have a score and that were left at -INFINITY
+	void trellis::_count_column(std::vector<double>* scores){
+		size_t skipped(0);
+		for(size_t st = 0; st < state_size; ++st){
+			if ((*scores)[st] == -INFINITY){
+				skipped++;
+			}
+		}
+		stats->cells_evaluated += state_size - skipped;
+		stats->cells_skipped += skipped;
+	}
+	
+	
+	template<typename T>
+	static size_t _table_size(std::vector<std::vector<T> >* table){
+		if (table == NULL){
+			return 0;
+		}
+		
+		size_t bytes = table->capacity() * sizeof(std::vector<T>);
+		for(size_t i = 0; i < table->size(); ++i){
+			bytes += (*table)[i].capacity() * sizeof(T);
+		}
+		return bytes;
+	}
+	
+	
+	//!Get the number of bytes held by the traceback and score tables
+	size_t trellis::table_bytes(){
+		size_t bytes(0);
+		bytes += _table_size(traceback_table);
+		bytes += _table_size(viterbi_score);
+		bytes += _table_size(forward_score);
+		bytes += _table_size(backward_score);
+		bytes += _table_size(posterior_score);
+		bytes += _table_size(dbl_forward_score);
+		bytes += _table_size(dbl_viterbi_score);
+		bytes += _table_size(dbl_backward_score);
+		bytes += _table_size(dbl_posterior_score);
+		
+		if (dbl_baum_welch_score != NULL){
+			for(size_t i = 0; i < dbl_baum_welch_score->size(); ++i){
+				bytes += _table_size(&(*dbl_baum_welch_score)[i]);
+			}
+		}
+		
+		if (stochastic_table != NULL){
+			bytes += stochastic_table->bytes();
+		}
+		
+		if (nth_traceback_table != NULL){
+			bytes += nth_traceback_table->bytes();
+		}
+		
+		if (tile_pool != NULL){
+			bytes += tile_pool->bytes();
+		}
+		
+		return bytes;
+	}
+	
 }
 
 
@@ -30,8 +30,10 @@
 #include <fstream>
 #include <bitset>
 #include <map>
+#include <algorithm>
 #include "stochTypes.h"
 #include "sequences.h"
+#include "sequenceStream.h"
 #include "hmm.h"
 #include "traceback_path.h"
 #include "stochMath.h"
@@ -39,6 +41,19 @@
 #include <iomanip>
 #include "stochTable.h"
 #include "sparseArray.h"
+#include "trellisStats.h"
+#include "emissionTiles.h"
+
+//Statistics are collected when a trellisStats is set with trellis::setStats()
+//Compiling with STOCHHMM_NO_STATS removes the instrumentation
+//TRELLIS_STATS is a single statement, so it is safe in an unbraced if/else
+#ifndef STOCHHMM_NO_STATS
+#define TRELLIS_STATS(expression) do { if (stats != NULL) { stats->expression; } } while (0)
+#define TRELLIS_PHASE(name) trellisPhase phase_timer(this, name)
+#else
+#define TRELLIS_STATS(expression) do { } while (0)
+#define TRELLIS_PHASE(name)
+#endif
 
 namespace StochHMM{
 	
@@ -67,33 +82,137 @@ namespace StochHMM{
 		
 	};
 	
-//	struct nthTrace{
-//		int16_t st_tb;
-//		int16_t score_tb;
-//		nthTrace():st_tb(0),score_tb(0){};
-//		nthTrace(int16_t st, int16_t tb):st_tb(st),score_tb(tb){};
-//	};
-	
+	//! \class nthTrace
+	//! Flat traceback table for the N-best viterbi
+	//! Stores for each position, state, and rank a packed pointer (previous state, previous rank)
+	//! in a single contiguous array.  Each position is only as wide as the most ranks
+	//! filled in any of its states, so ranks that no path reaches aren't stored.
+	//! Consecutive positions of the same width are kept as one run.  Unassigned cells are -1.
 	class nthTrace{
 	public:
-		std::map<int32_t,int32_t> tb;
-		
-		inline void assign(int16_t st, int16_t n_score, int16_t tb_ptr, int16_t tb_sc){
-			tb[(((int32_t) st) << 16 | n_score)] = (((int32_t)tb_ptr) << 16) | tb_sc;
+		nthTrace(size_t positions, size_t states, size_t n):position_size(positions),state_size(states),nth_size(n),position_count(1),reserved(false){
+			//Position 0 has no traceback pointers
+			runs.push_back(run(0,0,0));
+		};
+		
+		//!Add the traceback pointers of the next position from its cells
+		//!(state_size x n, sorted by rank, unassigned cells scored -INFINITY)
+		inline void push_back(std::vector<nthScore>& cells){
+			size_t ranks(0);
+			for(size_t st = 0; st < state_size; ++st){
+				while(ranks < nth_size && cells[st*nth_size + ranks].score != -INFINITY){
+					ranks++;
+				}
+			}
+			
+			//Once the positions are full width, reserve the rest of the table
+			//instead of growing it
+			if (ranks == nth_size && !reserved){
+				tb.reserve(tb.size() + (position_size - position_count) * state_size * nth_size);
+				reserved = true;
+			}
+			
+			if (ranks != runs.back().width){
+				runs.push_back(run(position_count, tb.size(), ranks));
+			}
+			position_count++;
+			
+			for(size_t st = 0; st < state_size; ++st){
+				for(size_t i = 0; i < ranks; ++i){
+					nthScore& cell = cells[st*nth_size + i];
+					tb.push_back((cell.score == -INFINITY) ? -1 : (((int32_t)cell.st_tb) << 16) | (uint16_t) cell.score_tb);
+				}
+			}
 		}
 		
-		inline void get(int16_t& st, int16_t& n_score){
-			int32_t key_val = (((int32_t) st) << 16 | n_score);
-			if (tb.count(key_val)){
+		//!Get the traceback pointer for the cell and assign it to st and n_score
+		//!If the cell isn't defined st is set to -1
+		inline void get(size_t position, int16_t& st, int16_t& n_score){
+			//Last run starting at or before the position
+			size_t low(0);
+			size_t high(runs.size());
+			while(high - low > 1){
+				size_t middle = (low + high) / 2;
+				if (runs[middle].position <= position){
+					low = middle;
+				}
+				else{
+					high = middle;
+				}
+			}
+			
+			const run& rn = runs[low];
+			if ((size_t) n_score >= rn.width){
 				st = -1;
+				return;
 			}
-			int32_t val = tb[key_val];
-			st	= (val >> 16) & 0xFFFF;
-			n_score	= val & 0xFFFF;
+			
+			int32_t val = tb[rn.start + ((position - rn.position) * state_size + st) * rn.width + n_score];
+			if (val == -1){
+				st = -1;
+				return;
+			}
+			st		= (int16_t)((val >> 16) & 0xFFFF);
+			n_score	= (int16_t)(val & 0xFFFF);
 		}
+		
+		//!Get the number of bytes of the table
+		inline size_t bytes(){return tb.capacity() * sizeof(int32_t) + runs.capacity() * sizeof(run);}
+		
+	private:
+		//!Positions of the same width, starting at cell start of the table
+		struct run{
+			size_t position;
+			size_t start;
+			size_t width;
+			run(size_t p, size_t s, size_t w):position(p),start(s),width(w){};
+		};
+		
+		size_t position_size;
+		size_t state_size;
+		size_t nth_size;
+		size_t position_count;	//Positions added
+		bool reserved;
+		std::vector<run> runs;
+		std::vector<int32_t> tb;
 	};
 
+	class trellis;
+	struct posteriorSync;
+	struct viterbiChunk;
+	struct tracebackChunk;
+	struct posteriorWindows;
+	
+	//!Receives the posterior probabilities (log) of a position from
+	//!trellis::stream_posterior or window_posterior, in order of the
+	//!positions.  block_end is set for the last position finished at once.
+	typedef void (*posteriorCallback)(size_t position, std::vector<double>& posteriors, bool block_end, void* data);
+	
+	//! \class trellisTiles
+	//! Reads the emissions of the trellis from emission tiles filled by worker
+	//! threads from construction to destruction, if the trellis has emission
+	//! threads.  Does nothing within the scope of another trellisTiles.
+	class trellisTiles{
+	public:
+		trellisTiles(trellis* trell, bool forward);
+		~trellisTiles();
+	private:
+		trellis* owner;
+	};
 	
+	//! \class trellisPhase
+	//! Adds the time from construction to destruction to the trellis statistics
+	//! as a call of the named algorithm, and records the size of the tables
+	class trellisPhase{
+	public:
+		trellisPhase(trellis* trell, const char* phase_name);
+		~trellisPhase();
+	private:
+		trellis* owner;
+		const char* name;
+		double start;
+	};
+
 	/*! \class Trellis
 	 *	\brief Implements the HMM scoring trellis and algorithms
 	 *
@@ -109,6 +228,9 @@ namespace StochHMM{
 		inline model* getModel(){return hmm;}
 		inline sequences* getSeq(){return seqs;}
 		
+		//!Length of the sequence decoded by the last algorithm
+		inline size_t getSeqLength(){return seq_size;}
+		
 		/*-----------   Decoding Algorithms ------------*/
 		
 		//TODO: Fix these functions so that they evaluate the model and choose a
@@ -136,8 +258,8 @@ namespace StochHMM{
 		void stochastic_forward();
 		void stochastic_forward(model* h, sequences* sqs);
 		
-		void nth_viterbi();
-		void nth_viterbi(model* h, sequences* sqs);
+		void nth_viterbi(size_t n);
+		void nth_viterbi(model* h, sequences* sqs, size_t n);
 		
 		void baum_welch();
 		
@@ -189,6 +311,16 @@ namespace StochHMM{
 		
 		void simple_posterior();
 		void simple_posterior(model* h, sequences* sqs);
+		
+		//!Posterior with the forward and backward algorithms run at the same
+		//!time on two threads (basic models with thread-safe emissions,
+		//!otherwise simple_posterior)
+		void concurrent_posterior();
+		
+		//!Use concurrent_posterior for posterior()
+		inline void setConcurrentPosterior(bool concurrent){posterior_concurrent = concurrent;}
+		
+		double window_posterior(size_t window, size_t overlap, size_t threads, posteriorCallback emit = NULL, void* data = NULL);
 				
 		void simple_stochastic_viterbi();
 		void simple_stochastic_viterbi(model* h, sequences* sqs);
@@ -201,10 +333,96 @@ namespace StochHMM{
 		void simple_baum_welch();
 		void simple_baum_welch(model* h, sequences* sqs);
 		
+		void viterbi_training();
+		void viterbi_training(model* h, sequences* sqs);
+		
 		void simple_nth_viterbi(size_t n);
 		void simple_nth_viterbi(model* h, sequences* sqs, size_t n);
+		
+		
+		/*-----------   Beam Pruned Decoding Algorithms ------------*/
+		/* These algorithms only extend the states that are within the beam
+			(beam_threshold of the column maximum and the top beam_width cells).
+		 */
+		
+		void beam_viterbi();
+		void beam_viterbi(model* h, sequences* sqs);
+		
+		void beam_forward();
+		void beam_forward(model* h, sequences* sqs);
+		
+		//!Set the beam used by the beam algorithms
+		//!\param threshold Log-score below the column maximum to prune (INFINITY to disable)
+		//!\param width Maximum number of cells to keep per column (0 to disable)
+		inline void setBeam(double threshold, size_t width){beam_threshold = threshold; beam_width = width;}
+		
+		//!Get the number of cells pruned by the last beam algorithm
+		inline size_t getPrunedCells(){return pruned_cells;}
+		
+		
+		/*-----------   Statistics ------------*/
+		
+		//!Collect counters and timers of the algorithms in stats (NULL to stop)
+		inline void setStats(trellisStats* st){stats = st;}
+		inline trellisStats* getStats(){return stats;}
+		
+		size_t table_bytes();
+		
+		
+		/*-----------   Emission Threads ------------*/
+		/* The viterbi, nth-best, forward, backward, posterior and stochastic
+			algorithms read the emissions from tiles of positions filled ahead of
+			the recurrence by emission threads.  Windowed and beam algorithms
+			calculate their own emissions.
+		 */
+		
+		void setEmissionThreads(size_t threads, size_t tile = 4096);
 
 		
+		/*-----------   Windowed Decoding Algorithms ------------*/
+		/* These algorithms read the sequence from a seqWindow, so only a window
+			of the sequence is in memory.  For use with basic models.
+		 
+			stream_viterbi saves the scores at the start of each window, then
+			recalculates each window from the last to the first to traceback the
+			path, so only one window of traceback pointers is stored.
+		 
+			stream_posterior is a fixed-lag smoother: the posteriors of each
+			position are calculated from the forward scores and the backward
+			scores from at least lag positions ahead, and passed to a callback
+			as they are finished.  The window must retain 2 * lag symbols.
+		 */
+		
+		void stream_forward(model* h, seqWindow* window);
+		void stream_viterbi(model* h, seqWindow* window, traceback_path& path);
+		void stream_posterior(model* h, seqWindow* window, size_t lag, posteriorCallback emit, void* data);
+		
+		
+		/*-----------   Checkpointed Decoding Algorithms ------------*/
+		/* checkpoint_viterbi stores the scores every interval positions instead
+			of the traceback table, and recalculates each interval to traceback
+			the path.  For use with basic models.
+		 */
+		
+		void checkpoint_viterbi(traceback_path& path, size_t interval = 0);
+		static size_t checkpointInterval(size_t length);
+		
+		
+		/*-----------   Parallel Decoding Algorithms ------------*/
+		/* parallel_viterbi splits the sequence into chunks calculated at the
+			same time by threads, each starting from arbitrary scores.  Chunks
+			are then fixed in order from the real scores until the pointers are
+			the same and the scores exactly parallel to the arbitrary ones
+			(differ by a constant), after which the real scores are summed
+			along the pointers.  parallel_traceback traces back
+			the chunks at the same time and fixes them the same way.
+			For use with basic models.
+		 */
+		
+		void parallel_viterbi(size_t threads);
+		void parallel_traceback(traceback_path& path, size_t threads);
+		
+		
 		/*-----------   Fast Complex Model Decoding Algorithms  ----------*/
 		/*	These algorithms are for use with models that define external functions
 			or explicit duration states.
@@ -302,17 +520,84 @@ namespace StochHMM{
 		
 		inline float_2D* getForwardTable(){return forward_score;}
 		inline float_2D* getBackwardTable(){return backward_score;}
+		inline float_2D* getViterbiTable(){return viterbi_score;}
 		inline double_2D* getPosteriorTable(){return posterior_score;}
 		
 		inline double getForwardProbability(){return ending_forward_prob;}
+		inline double getViterbiScore(){return ending_viterbi_score;}
+		
+		//!Get the transition counts of each state, in the order of the states
+		//!it transitions to (state::getTo())
+		inline double_2D* getTransitionCounts(){return transition_counts;}
+		inline std::vector<double>* getInitialCounts(){return initial_counts;}
+		inline std::vector<double>* getEndingCounts(){return ending_counts;}
+		void clear_counts();
+		void add_counts(trellis& other);
 		inline double getBackwardProbability(){return ending_backward_prob;}
 
 		
 	private:
+		friend class trellisPhase;
+		friend class trellisTiles;
+		friend class emissionTiles;
+		
+		//!Get the emission of a state at a position
+		inline double _emission(size_t st, size_t position){
+			if (tiles != NULL){
+				return tiles->get(st, position);
+			}
+#ifndef STOCHHMM_NO_STATS
+			if (stats != NULL){
+				return _counted_emission((*hmm)[st], *seqs, position, stats);
+			}
+#endif
+			return (*hmm)[st]->get_emission_prob(*seqs, position);
+		}
+		
+		//!Count the evaluated and skipped cells of a column of scores
+		inline void _count_cells(std::vector<double>* scores){
+#ifndef STOCHHMM_NO_STATS
+			if (stats != NULL){
+				_count_column(scores);
+			}
+#endif
+		}
+		
+		static double _counted_emission(state* current, sequences& sqs, size_t position, trellisStats* counts);
+		void _count_column(std::vector<double>* scores);
+		
 		double getEndingTransition(size_t);
+		void _store_viterbi(size_t position);
         double getTransition(state* st, size_t trans_to_state, size_t sequencePosition);
         size_t get_explicit_duration_length(transition* trans, size_t sequencePosition,size_t state_iter, size_t to_state);
         double transitionFuncTraceback(state* st, size_t position, transitionFuncParam* func);
+		void _accumulate_emissions(size_t position, double prob);
+		void _get_to_states(std::vector<std::vector<size_t> >& to_states);
+		void _beam_prune(std::vector<size_t>& active, std::vector<double>& scores);
+		void _accumulate_state_emissions(size_t position, size_t st, double weight);
+		void _allocate_counts();
+		static bool _ending_normalized(state* st);
+		void _stream_forward_position(size_t position, size_t relative, dynamic_bitset& current_states, dynamic_bitset& next_states);
+		void _backward_position(size_t position, dynamic_bitset& current_states, dynamic_bitset& next_states);
+		void _stream_viterbi_position(size_t position, size_t relative, dynamic_bitset& current_states, dynamic_bitset& next_states, int16_t* traceback);
+		
+		void _posterior_forward(posteriorSync& sync);
+		void _posterior_backward(posteriorSync& sync);
+		bool _posterior_store(posteriorSync& sync, size_t position, std::vector<double>& scores, bool forward, std::vector<std::pair<size_t,double> >& unscaled);
+		void _posterior_finalize(posteriorSync& sync, size_t first, size_t last, std::vector<std::pair<size_t,double> >& unscaled);
+		static void* _posterior_thread_start(void* ptr);
+		
+		void _posterior_window(posteriorWindows& job, size_t window);
+		void _posterior_window_forward(size_t position);
+		void _posterior_window_backward(size_t position, size_t relative);
+		void _stream_posterior_block(seqWindow* window, std::vector<double>& forward, size_t first, size_t last, size_t emitted, posteriorCallback emit, void* data);
+		static void* _posterior_window_start(void* ptr);
+		
+		void _viterbi_chunk(viterbiChunk& chunk);
+		bool _viterbi_fix_chunk(viterbiChunk& chunk, std::vector<double>& scores, dynamic_bitset& next_states);
+		void _viterbi_replay_position(size_t position, int16_t* traceback);
+		static void* _viterbi_chunk_start(void* ptr);
+		static void* _traceback_chunk_start(void* ptr);
 		
 		
 		model* hmm;		//HMM model
@@ -327,6 +612,18 @@ namespace StochHMM{
 		
 		bool store_values;
 		bool exDef_defined;
+		bool posterior_concurrent;
+		
+		//Beam pruning
+		double	beam_threshold;
+		size_t	beam_width;
+		size_t	pruned_cells;
+		
+		trellisStats* stats;	//Collected statistics (NULL if not collected)
+		
+		//Emissions calculated by worker threads
+		emissionTiles* tile_pool;	//NULL if there are no emission threads
+		emissionTiles* tiles;		//Tiles read by the current algorithm (NULL if none)
 		
 		//Traceback Tables
 		int_2D*		traceback_table;	//Simple traceback table
@@ -346,10 +643,16 @@ namespace StochHMM{
 		double_2D*  dbl_backward_score;
 		double_2D*	dbl_posterior_score;
 		double_3D*  dbl_baum_welch_score;
+		
+		//Expected counts accumulated by Baum-Welch
+		double_2D*	transition_counts;	//Expected transitions of each state to its getTo() states
+		std::vector<double>* initial_counts;	//Expected transitions from INIT
+		std::vector<double>* ending_counts;		//Expected transitions to END
+		std::vector<std::vector<size_t> >* transition_slots;	//Index in transition_counts[st] of each state st transitions to (SIZE_MAX if none)
 		std::vector<std::vector<std::vector<nthScore >* > >* naive_nth_scores;
 		
 		
-		std::vector<nthTrace>*  nth_traceback_table;
+		nthTrace*  nth_traceback_table;
 		
 		//Ending Cells
 		double	ending_viterbi_score;
@@ -376,13 +679,14 @@ namespace StochHMM{
 		std::vector<std::vector<double>* > complex_emissions;
 		std::vector<std::vector<std::map<uint16_t,double>* >* >* complex_transitions;
 		
-		std::vector<std::vector<nthScore> >* nth_scoring_current;
-		std::vector<std::vector<nthScore> >* nth_scoring_previous;
-		std::vector<std::vector<nthScore> >* nth_swap_ptr;
+		std::vector<nthScore>* nth_scoring_current;	//Flat (state_size x nth_size) cells
+		std::vector<nthScore>* nth_scoring_previous;
+		std::vector<nthScore>* nth_swap_ptr;
 	};
 	
 	void sort_scores(std::vector<nthScore>& nth_scores);
 	bool _vec_sort(const nthScore& i, const nthScore& j);
+	bool _heap_sort(const nthScore& i, const nthScore& j);
 	
 }
 
@@ -0,0 +1,556 @@
+//
+//  trellisExport.cpp
+//  StochHMM
+//
+//  Copyright (c) 2013 Korf Lab, Genome Center, UC Davis, Davis, CA. All rights reserved.
+//
+
+#include "trellisExport.h"
+#include "trellis.h"
+#include <math.h>
+#include <zlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace StochHMM{
+
+	static const char TABLE_MAGIC[8] = {'S','T','O','C','H','T','R','L'};
+	static const uint32_t TABLE_VERSION = 1;
+	static const size_t TABLE_HEADER_SIZE = 64;
+
+	//Values converted at a time when the table isn't compressed
+	static const size_t TABLE_CHUNK_SIZE = 1 << 20;
+
+	//Round up to a multiple of 8 bytes
+	static inline size_t _aligned(size_t size){
+		return (size + 7) & ~((size_t) 7);
+	}
+
+
+	//!Convert a float to a half float (IEEE binary16), rounding to nearest even
+	static inline uint16_t _toHalf(float value){
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+
+		uint32_t sign = (bits >> 16) & 0x8000;
+		int32_t exponent = (int32_t) ((bits >> 23) & 0xff);
+		uint32_t mantissa = bits & 0x7fffff;
+
+		//Infinity and NaN
+		if (exponent == 0xff){
+			return sign | 0x7c00 | ((mantissa != 0) ? 0x200 : 0);
+		}
+
+		exponent = exponent - 127 + 15;
+
+		//Too large
+		if (exponent >= 31){
+			return sign | 0x7c00;
+		}
+
+		//Subnormal or zero
+		if (exponent <= 0){
+			if (exponent < -10){
+				return sign;
+			}
+			mantissa |= 0x800000;
+			uint32_t shift = 14 - exponent;
+			uint32_t half = mantissa >> shift;
+			uint32_t remainder = mantissa & ((1u << shift) - 1);
+			uint32_t halfway = 1u << (shift - 1);
+			if (remainder > halfway || (remainder == halfway && (half & 1))){
+				half++;
+			}
+			return sign | half;
+		}
+
+		//Rounding may carry into the exponent, which is still correct
+		uint32_t half = sign | (exponent << 10) | (mantissa >> 13);
+		uint32_t remainder = mantissa & 0x1fff;
+		if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))){
+			half++;
+		}
+		return half;
+	}
+
+
+	//!Convert a half float to a float
+	static inline float _fromHalf(uint16_t half){
+		uint32_t sign = (uint32_t) (half & 0x8000) << 16;
+		uint32_t exponent = (half >> 10) & 0x1f;
+		uint32_t mantissa = half & 0x3ff;
+
+		if (exponent == 0){
+			float value = ldexpf((float) mantissa, -24);
+			return (sign) ? -value : value;
+		}
+
+		uint32_t bits;
+		if (exponent == 31){
+			bits = sign | 0x7f800000 | (mantissa << 13);
+		}
+		else{
+			bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+		}
+
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+
+	//!Copy values of a trellis table in the order of the layout
+	//!\param table Table of the trellis (positions x states)
+	//!\param start Index of the first value in the layout order
+	//!\param count Number of values
+	//!\param probability Convert log'd values to probabilities
+	//!\param[out] values Converted values
+	template<class TABLE>
+	static void _fill(TABLE& table, size_t states, tableLayout layout, size_t start, size_t count, bool probability, float* values){
+		size_t positions = table.size();
+		size_t position, state;
+
+		if (layout == POSITION_MAJOR){
+			position = start / states;
+			state = start % states;
+		}
+		else{
+			state = start / positions;
+			position = start % positions;
+		}
+
+		for(size_t i = 0; i < count; ++i){
+			double value = table[position][state];
+			values[i] = (probability) ? exp(value) : value;
+
+			if (layout == POSITION_MAJOR){
+				if (++state == states){
+					state = 0;
+					++position;
+				}
+			}
+			else if (++position == positions){
+				position = 0;
+				++state;
+			}
+		}
+	}
+
+
+	trellisWriter::trellisWriter():is_open(false),written(0),value_type(TABLE_FLOAT32),layout(POSITION_MAJOR),block_size(0){
+	}
+
+
+	//!Create the file
+	//!\return false if the file couldn't be created
+	bool trellisWriter::open(const std::string& filename){
+		close();
+
+		if (!out.open(filename)){
+			std::cerr << "Can't create trellis table file: " << filename << std::endl;
+			return false;
+		}
+
+		is_open = true;
+		written = 0;
+		return true;
+	}
+
+
+	//!Write the remaining data and close the file
+	//!\return false if writing the file failed
+	bool trellisWriter::close(){
+		if (!is_open){
+			return true;
+		}
+
+		out.close();
+		is_open = false;
+		return !out.failed();
+	}
+
+
+	void trellisWriter::_write(const char* data, size_t length){
+		out.write(data, length);
+		written += length;
+	}
+
+
+	//!Write zeros until the output is aligned to 8 bytes
+	void trellisWriter::_pad(){
+		static const char zeros[8] = {0,0,0,0,0,0,0,0};
+		_write(zeros, _aligned(written) - written);
+	}
+
+
+	//!Add a table of the trellis to the file
+	//!\param trell Trellis that has been filled by the algorithm for the table
+	//!\param type Table to add
+	//!\return false if the trellis doesn't have the table or it couldn't be written
+	bool trellisWriter::add(trellis& trell, tableType type){
+		if (!is_open){
+			return false;
+		}
+
+		if (value_type == TABLE_FLOAT16 && type != POSTERIOR_TABLE){
+			std::cerr << "Only posterior tables can be stored as half floats" << std::endl;
+			return false;
+		}
+
+		float_2D* single_table(NULL);
+		double_2D* double_table(NULL);
+		double score(0);
+
+		switch(type){
+			case POSTERIOR_TABLE:
+				double_table = trell.getPosteriorTable();
+				score = trell.getForwardProbability();
+				break;
+			case FORWARD_TABLE:
+				single_table = trell.getForwardTable();
+				double_table = trell.get_naive_forward_scores();
+				score = trell.getForwardProbability();
+				break;
+			case BACKWARD_TABLE:
+				single_table = trell.getBackwardTable();
+				double_table = trell.get_naive_backward_scores();
+				score = trell.getBackwardProbability();
+				break;
+			case VITERBI_TABLE:
+				single_table = trell.getViterbiTable();
+				double_table = trell.get_naive_viterbi_scores();
+				score = trell.getViterbiScore();
+				break;
+		}
+
+		if (single_table == NULL && double_table == NULL){
+			std::cerr << "Trellis doesn't have the table to export" << std::endl;
+			return false;
+		}
+
+		model* hmm = trell.getModel();
+		sequences* seqs = trell.getSeq();
+
+		uint64_t positions = (single_table != NULL) ? single_table->size() : double_table->size();
+		uint64_t states = hmm->state_size();
+
+		//Names
+		std::vector<std::string*> names;
+		names.push_back(&hmm->getName());
+		names.push_back(&seqs->getHeader());
+		for(size_t i = 0; i < states; ++i){
+			names.push_back(&hmm->getStateName(i));
+		}
+
+		size_t names_size(0);
+		for(size_t i = 0; i < names.size(); ++i){
+			names_size += sizeof(uint32_t) + names[i]->size();
+		}
+
+		//Header
+		char header[TABLE_HEADER_SIZE];
+		memset(header, 0, TABLE_HEADER_SIZE);
+		uint32_t values[6] = {TABLE_VERSION, (uint32_t) type, (uint32_t) value_type, (uint32_t) layout, (uint32_t) block_size, (uint32_t) names_size};
+		uint64_t sizes[3] = {positions, states, (uint64_t) seqs->getOffset()};
+		memcpy(header, TABLE_MAGIC, 8);
+		memcpy(header + 8, values, sizeof(values));
+		memcpy(header + 32, sizes, sizeof(sizes));
+		memcpy(header + 56, &score, sizeof(score));
+		_write(header, TABLE_HEADER_SIZE);
+
+		for(size_t i = 0; i < names.size(); ++i){
+			uint32_t length = names[i]->size();
+			_write((const char*) &length, sizeof(length));
+			_write(names[i]->data(), length);
+		}
+		_pad();
+
+		//Values
+		size_t total = positions * states;
+		size_t chunk = (block_size > 0) ? block_size : TABLE_CHUNK_SIZE;
+		bool probability = (type == POSTERIOR_TABLE);
+
+		std::vector<float> converted(std::min(chunk, total));
+		std::vector<uint16_t> halves((value_type == TABLE_FLOAT16) ? converted.size() : 0);
+		std::vector<char> compressed((block_size > 0) ? compressBound(converted.size() * sizeof(float)) : 0);
+
+		for(size_t start = 0; start < total; start += chunk){
+			size_t count = std::min(chunk, total - start);
+
+			if (single_table != NULL){
+				_fill(*single_table, states, layout, start, count, probability, &converted[0]);
+			}
+			else{
+				_fill(*double_table, states, layout, start, count, probability, &converted[0]);
+			}
+
+			const char* bytes = (const char*) &converted[0];
+			size_t length = count * sizeof(float);
+
+			if (value_type == TABLE_FLOAT16){
+				for(size_t i = 0; i < count; ++i){
+					halves[i] = _toHalf(converted[i]);
+				}
+				bytes = (const char*) &halves[0];
+				length = count * sizeof(uint16_t);
+			}
+
+			if (block_size > 0){
+				uLongf compressed_size = compressed.size();
+				if (compress2((Bytef*) &compressed[0], &compressed_size, (const Bytef*) bytes, length, Z_BEST_SPEED) != Z_OK){
+					std::cerr << "Can't compress trellis table" << std::endl;
+					return false;
+				}
+				uint64_t block_length = compressed_size;
+				_write((const char*) &block_length, sizeof(block_length));
+				_write(&compressed[0], compressed_size);
+				_pad();
+			}
+			else{
+				_write(bytes, length);
+			}
+		}
+		_pad();
+
+		return !out.failed();
+	}
+
+
+	trellisReader::trellisReader():data(NULL),data_size(0),current(NULL),block_number(SIZE_MAX){
+	}
+
+	trellisReader::~trellisReader(){
+		close();
+	}
+
+
+	//!Open and map a file written by trellisWriter
+	//!The first table is selected
+	//!\return false if the file isn't a valid table file or has no tables
+	bool trellisReader::open(const std::string& filename){
+		close();
+
+		int fd = ::open(filename.c_str(), O_RDONLY);
+		if (fd < 0){
+			std::cerr << "Can't open trellis table file: " << filename << std::endl;
+			return false;
+		}
+
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0){
+			std::cerr << "Invalid trellis table file: " << filename << std::endl;
+			::close(fd);
+			return false;
+		}
+
+		void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+
+		if (map == MAP_FAILED){
+			std::cerr << "Can't map trellis table file: " << filename << std::endl;
+			return false;
+		}
+
+		data = (const char*) map;
+		data_size = st.st_size;
+
+		size_t position(0);
+		while(position < data_size){
+			tableRecord rec;
+			if (!_parse(position, rec)){
+				std::cerr << "Invalid or truncated trellis table file: " << filename << std::endl;
+				close();
+				return false;
+			}
+			records.push_back(rec);
+		}
+
+		return select(0);
+	}
+
+
+	//!Read the record starting at position
+	//!\param[in,out] position Offset of the record, set to the offset of the next record
+	bool trellisReader::_parse(size_t& position, tableRecord& rec){
+		if (position + TABLE_HEADER_SIZE > data_size || memcmp(data + position, TABLE_MAGIC, 8) != 0){
+			return false;
+		}
+
+		uint32_t values[6];
+		uint64_t sizes[3];
+		memcpy(values, data + position + 8, sizeof(values));
+		memcpy(sizes, data + position + 32, sizeof(sizes));
+		memcpy(&rec.score, data + position + 56, sizeof(rec.score));
+
+		if (values[0] != TABLE_VERSION || values[1] > VITERBI_TABLE || values[2] > TABLE_FLOAT16 || values[3] > STATE_MAJOR){
+			return false;
+		}
+
+		rec.type = (tableType) values[1];
+		rec.value = (tableValue) values[2];
+		rec.layout = (tableLayout) values[3];
+		rec.block_values = values[4];
+		rec.positions = sizes[0];
+		rec.states = sizes[1];
+		rec.offset = sizes[2];
+
+		//Names
+		size_t names_end = position + TABLE_HEADER_SIZE + values[5];
+		if (names_end > data_size){
+			return false;
+		}
+
+		position += TABLE_HEADER_SIZE;
+		for(size_t i = 0; i < rec.states + 2; ++i){
+			uint32_t length;
+			if (position + sizeof(length) > names_end){
+				return false;
+			}
+			memcpy(&length, data + position, sizeof(length));
+			position += sizeof(length);
+			if (position + length > names_end){
+				return false;
+			}
+
+			std::string name(data + position, length);
+			position += length;
+
+			if (i == 0){
+				rec.model_name = name;
+			}
+			else if (i == 1){
+				rec.sequence_name = name;
+			}
+			else{
+				rec.state_names.push_back(name);
+			}
+		}
+		position = _aligned(names_end);
+
+		//Values
+		size_t value_size = (rec.value == TABLE_FLOAT16) ? sizeof(uint16_t) : sizeof(float);
+		size_t total = rec.positions * rec.states;
+		rec.data = data + position;
+
+		if (rec.block_values == 0){
+			if (rec.states != 0 && (data_size - std::min(position, data_size)) / rec.states / value_size < rec.positions){
+				return false;
+			}
+			position = _aligned(position + total * value_size);
+		}
+		else{
+			size_t blocks = (total + rec.block_values - 1) / rec.block_values;
+			for(size_t i = 0; i < blocks; ++i){
+				uint64_t length;
+				if (position + sizeof(length) > data_size){
+					return false;
+				}
+				memcpy(&length, data + position, sizeof(length));
+				if (length > data_size - position - sizeof(length)){
+					return false;
+				}
+				rec.blocks.push_back(data + position);
+				position = _aligned(position + sizeof(length) + length);
+			}
+		}
+
+		return true;
+	}
+
+
+	//!Unmap the file
+	void trellisReader::close(){
+		if (data != NULL){
+			munmap((void*) data, data_size);
+		}
+
+		data = NULL;
+		data_size = 0;
+		records.clear();
+		current = NULL;
+		block.clear();
+		block_number = SIZE_MAX;
+	}
+
+
+	//!Select the table to read
+	//!\param table Number of the table in the file
+	bool trellisReader::select(size_t table){
+		if (table >= records.size()){
+			return false;
+		}
+
+		current = &records[table];
+		block_number = SIZE_MAX;
+		return true;
+	}
+
+
+	//!Get the value at index in the layout order
+	float trellisReader::_value(size_t index){
+		const char* values = current->data;
+
+		if (current->block_values != 0){
+			size_t number = index / current->block_values;
+			index %= current->block_values;
+
+			if (number != block_number){
+				size_t value_size = (current->value == TABLE_FLOAT16) ? sizeof(uint16_t) : sizeof(float);
+				size_t total = current->positions * current->states;
+				size_t count = std::min(current->block_values, total - number * current->block_values);
+
+				uint64_t length;
+				memcpy(&length, current->blocks[number], sizeof(length));
+
+				block.resize(count * value_size);
+				uLongf block_size = block.size();
+				if (uncompress((Bytef*) &block[0], &block_size, (const Bytef*) current->blocks[number] + sizeof(length), length) != Z_OK || block_size != block.size()){
+					std::cerr << "Can't decompress trellis table block" << std::endl;
+					exit(1);
+				}
+				block_number = number;
+			}
+			values = &block[0];
+		}
+
+		if (current->value == TABLE_FLOAT16){
+			uint16_t half;
+			memcpy(&half, values + index * sizeof(uint16_t), sizeof(half));
+			return _fromHalf(half);
+		}
+
+		float value;
+		memcpy(&value, values + index * sizeof(float), sizeof(value));
+		return value;
+	}
+
+
+	//!Get the value of a state at a position
+	float trellisReader::getValue(size_t position, size_t state){
+		if (current->layout == POSITION_MAJOR){
+			return _value(position * current->states + state);
+		}
+		return _value(state * current->positions + position);
+	}
+
+
+	//!Get the values of all states at a position
+	void trellisReader::getPosition(size_t position, std::vector<float>& values){
+		values.resize(current->states);
+		for(size_t state = 0; state < current->states; ++state){
+			values[state] = getValue(position, state);
+		}
+	}
+
+
+	//!Get the values of a state at all positions
+	void trellisReader::getState(size_t state, std::vector<float>& values){
+		values.resize(current->positions);
+		for(size_t position = 0; position < current->positions; ++position){
+			values[position] = getValue(position, state);
+		}
+	}
+
+}
@@ -0,0 +1,165 @@
+//
+//  trellisExport.h
+//  StochHMM
+//
+//  Copyright (c) 2013 Korf Lab, Genome Center, UC Davis, Davis, CA. All rights reserved.
+//
+
+#ifndef __StochHMM__trellisExport__
+#define __StochHMM__trellisExport__
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "outputWriter.h"
+
+namespace StochHMM{
+
+	class trellis;
+
+	//!\enum tableType
+	//!Table of the trellis stored in an exported table
+	enum tableType {POSTERIOR_TABLE, FORWARD_TABLE, BACKWARD_TABLE, VITERBI_TABLE};
+
+	//!\enum tableValue
+	//!How values are stored in an exported table
+	enum tableValue {TABLE_FLOAT32, TABLE_FLOAT16};
+
+	//!\enum tableLayout
+	//!Order of the values in an exported table
+	//!POSITION_MAJOR stores all states of a position together
+	//!STATE_MAJOR stores all positions of a state together
+	enum tableLayout {POSITION_MAJOR, STATE_MAJOR};
+
+
+	/*! \class trellisWriter
+	 *	\brief Writes trellis tables to a binary file
+	 *
+	 *	Each table added to the file is stored as a record:
+	 *	- Header (64 bytes): magic "STOCHTRL", uint32 version, uint32 table type,
+	 *	  uint32 value type, uint32 layout, uint32 values per compressed block
+	 *	  (0 if not compressed), uint32 size of the names, uint64 positions,
+	 *	  uint64 states, uint64 sequence offset, double score
+	 *	- Names: uint32 length and characters of the model name, sequence
+	 *	  header and each state name
+	 *	- Values: positions x states floats or half floats in the layout order.
+	 *	  Compressed tables are split into blocks of values, each stored as
+	 *	  a uint64 size and zlib data.
+	 *
+	 *	Sections are 8-byte aligned and numbers are in native byte order, so
+	 *	uncompressed tables can be used directly from a mapped file.
+	 *	Posterior tables are stored as probabilities.  Forward, backward and
+	 *	Viterbi tables are stored as natural log'd scores, which can't be stored
+	 *	as half floats.  The score is the forward probability for posterior and
+	 *	forward tables, the backward probability for backward tables and the
+	 *	Viterbi score for Viterbi tables.
+	 */
+	class trellisWriter{
+	public:
+		trellisWriter();
+
+		bool open(const std::string& filename);
+		bool add(trellis& trell, tableType type);
+		bool close();
+
+		//!Store values as floats or half floats
+		inline void setValueType(tableValue value){value_type = value;}
+
+		//!Store values by position or by state
+		inline void setLayout(tableLayout order){layout = order;}
+
+		//!Compress the values in blocks of block_values (0 for no compression)
+		inline void setCompression(size_t block_values){block_size = block_values;}
+
+	private:
+		outputWriter out;
+		bool is_open;
+		size_t written;
+		tableValue value_type;
+		tableLayout layout;
+		size_t block_size;
+
+		void _write(const char* data, size_t length);
+		void _pad();
+	};
+
+
+	/*! \class trellisReader
+	 *	\brief Reads tables written by trellisWriter
+	 *
+	 *	The file is memory-mapped.  Values of uncompressed tables are read from
+	 *	the mapped file, compressed blocks are decompressed when they are used.
+	 *	A reader caches one decompressed block, so it should only be used by one
+	 *	thread.
+	 */
+	class trellisReader{
+	public:
+		trellisReader();
+		~trellisReader();
+
+		bool open(const std::string& filename);
+		void close();
+
+		//!Number of tables in the file
+		inline size_t size(){return records.size();}
+
+		bool select(size_t table);
+
+		//Information about the selected table
+		inline tableType getType(){return current->type;}
+		inline tableValue getValueType(){return current->value;}
+		inline tableLayout getLayout(){return current->layout;}
+		inline size_t positions(){return current->positions;}
+		inline size_t states(){return current->states;}
+		inline size_t getOffset(){return current->offset;}
+		inline double getScore(){return current->score;}
+		inline std::string& getModelName(){return current->model_name;}
+		inline std::string& getSequenceName(){return current->sequence_name;}
+		inline std::vector<std::string>& getStateNames(){return current->state_names;}
+
+		//!Is the selected table compressed
+		inline bool isCompressed(){return current->block_values != 0;}
+
+		//!Values of the selected table in the mapped file
+		//!\return NULL if the table is compressed
+		inline const void* getData(){return (isCompressed()) ? NULL : current->data;}
+
+		float getValue(size_t position, size_t state);
+		void getPosition(size_t position, std::vector<float>& values);
+		void getState(size_t state, std::vector<float>& values);
+
+	private:
+		struct tableRecord{
+			tableType type;
+			tableValue value;
+			tableLayout layout;
+			size_t block_values;
+			size_t positions;
+			size_t states;
+			size_t offset;
+			double score;
+			std::string model_name;
+			std::string sequence_name;
+			std::vector<std::string> state_names;
+			const char* data;
+			std::vector<const char*> blocks;	//Size and data of each compressed block
+		};
+
+		const char* data;
+		size_t data_size;
+		std::vector<tableRecord> records;
+		tableRecord* current;
+
+		std::vector<char> block;	//Decompressed block
+		size_t block_number;
+
+		bool _parse(size_t& position, tableRecord& rec);
+		float _value(size_t index);
+	};
+
+}
+
+#endif /* defined(__StochHMM__trellisExport__) */
@@ -0,0 +1,119 @@
+//
+//  trellisStats.cpp
+//  StochHMM
+//
+//  Copyright (c) 2013 Korf Lab, Genome Center, UC Davis, Davis, CA. All rights reserved.
+//
+
+#include "trellisStats.h"
+
+namespace StochHMM{
+
+	static const char* EMISSION_NAMES[] = {"lexical","real_number","continuous","multi_continuous","function","external"};
+	static const char* TRANSITION_NAMES[] = {"standard","duration","lexical","pdf"};
+
+
+	trellisStats::trellisStats(){
+		clear();
+	}
+
+
+	//!Reset the counters and timers
+	void trellisStats::clear(){
+		cells_evaluated = 0;
+		cells_skipped = 0;
+		for(size_t i = 0; i <= EXTERNAL_EMISSION; ++i){
+			emissions[i] = 0;
+		}
+		for(size_t i = 0; i < 4; ++i){
+			transitions[i] = 0;
+		}
+		emission_function_calls = 0;
+		emission_function_seconds = 0;
+		transition_function_calls = 0;
+		transition_function_seconds = 0;
+		traceback_steps = 0;
+		duration_steps = 0;
+		table_bytes = 0;
+		phases.clear();
+	}
+
+
+	//!Add the counters and timers of another trellisStats
+	//!Table bytes keeps the larger of the two
+	void trellisStats::add(trellisStats& other){
+		cells_evaluated += other.cells_evaluated;
+		cells_skipped += other.cells_skipped;
+		for(size_t i = 0; i <= EXTERNAL_EMISSION; ++i){
+			emissions[i] += other.emissions[i];
+		}
+		for(size_t i = 0; i < 4; ++i){
+			transitions[i] += other.transitions[i];
+		}
+		emission_function_calls += other.emission_function_calls;
+		emission_function_seconds += other.emission_function_seconds;
+		transition_function_calls += other.transition_function_calls;
+		transition_function_seconds += other.transition_function_seconds;
+		traceback_steps += other.traceback_steps;
+		duration_steps += other.duration_steps;
+		tableBytes(other.table_bytes);
+
+		for(size_t i = 0; i < other.phases.size(); ++i){
+			addPhase(other.phases[i].name, other.phases[i].seconds, other.phases[i].calls);
+		}
+	}
+
+
+	//!Add calls of an algorithm
+	//!Phases are kept in the order they were first called
+	void trellisStats::addPhase(const std::string& name, double seconds, uint64_t calls){
+		for(size_t i = 0; i < phases.size(); ++i){
+			if (phases[i].name == name){
+				phases[i].calls += calls;
+				phases[i].seconds += seconds;
+				return;
+			}
+		}
+
+		phase added;
+		added.name = name;
+		added.calls = calls;
+		added.seconds = seconds;
+		phases.push_back(added);
+	}
+
+
+	//!Get the statistics as a JSON object on one line
+	std::string trellisStats::stringify(){
+		std::stringstream json;
+		json << "{\"cells\":{\"evaluated\":" << cells_evaluated << ",\"skipped\":" << cells_skipped << "}";
+
+		json << ",\"emissions\":{";
+		for(size_t i = 0; i <= EXTERNAL_EMISSION; ++i){
+			json << ((i > 0) ? "," : "") << "\"" << EMISSION_NAMES[i] << "\":" << emissions[i];
+		}
+
+		json << "},\"transitions\":{";
+		for(size_t i = 0; i < 4; ++i){
+			json << ((i > 0) ? "," : "") << "\"" << TRANSITION_NAMES[i] << "\":" << transitions[i];
+		}
+
+		json << "},\"external\":{\"emission_calls\":" << emission_function_calls;
+		json << ",\"emission_seconds\":" << emission_function_seconds;
+		json << ",\"transition_calls\":" << transition_function_calls;
+		json << ",\"transition_seconds\":" << transition_function_seconds << "}";
+
+		json << ",\"traceback_steps\":" << traceback_steps;
+		json << ",\"duration_steps\":" << duration_steps;
+		json << ",\"table_bytes\":" << table_bytes;
+
+		json << ",\"phases\":{";
+		for(size_t i = 0; i < phases.size(); ++i){
+			json << ((i > 0) ? "," : "") << "\"" << phases[i].name << "\":{\"calls\":" << phases[i].calls << ",\"seconds\":" << phases[i].seconds << "}";
+		}
+		json << "}}";
+
+		return json.str();
+	}
+
+}
@@ -0,0 +1,90 @@
+//
+//  trellisStats.h
+//  StochHMM
+//
+//  Copyright (c) 2013 Korf Lab, Genome Center, UC Davis, Davis, CA. All rights reserved.
+//
+
+#ifndef __StochHMM__trellisStats__
+#define __StochHMM__trellisStats__
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <stdint.h>
+#include <sys/time.h>
+
+namespace StochHMM{
+
+	//!Kinds of emissions counted by trellisStats
+	enum emissionKind {LEXICAL_EMISSION, REAL_NUMBER_EMISSION, CONTINUOUS_EMISSION, MULTI_CONTINUOUS_EMISSION, FUNCTION_EMISSION, EXTERNAL_EMISSION};
+
+	/*! \class trellisStats
+	 *	\brief Counters and timers collected by the trellis algorithms
+	 *
+	 *	A trellis only collects statistics after trellis::setStats() is given a
+	 *	trellisStats, and never if StochHMM is compiled with STOCHHMM_NO_STATS.
+	 *	Counts accumulate until clear() is called, so one trellisStats can
+	 *	collect several trellises.  A trellisStats shouldn't be shared by
+	 *	trellises used in different threads; add() combines them instead.
+	 *
+	 *	- Cells are counted for each position of the algorithms that keep a
+	 *	  column of scores: evaluated cells got a score, skipped cells were
+	 *	  left at -INFINITY (unreachable, or skipped because their emission or
+	 *	  all their previous scores were -INFINITY).
+	 *	- Each emission of a state is counted by its kind.  The time of states
+	 *	  with function or external emissions is the time of the external calls.
+	 *	- Duration steps are the positions traced back to get the duration of
+	 *	  DURATION transitions and the sequence of external transition functions.
+	 *	- Table bytes are the most memory held by the trellis tables at the end
+	 *	  of an algorithm.
+	 */
+	class trellisStats{
+	public:
+		trellisStats();
+
+		void clear();
+		void add(trellisStats& other);
+		std::string stringify();
+
+		//!Get the current time in seconds
+		static inline double now(){
+			timeval time;
+			gettimeofday(&time, NULL);
+			return time.tv_sec + time.tv_usec / 1e6;
+		}
+
+		void addPhase(const std::string& name, double seconds, uint64_t calls = 1);
+
+		//!Record the memory held by the trellis tables
+		inline void tableBytes(size_t bytes){if (bytes > table_bytes){table_bytes = bytes;}}
+
+		uint64_t cells_evaluated;
+		uint64_t cells_skipped;
+
+		uint64_t emissions[EXTERNAL_EMISSION + 1];	//Emission calls by emissionKind
+		uint64_t transitions[4];					//Transition calls by transType
+
+		uint64_t emission_function_calls;		//External and function emissions
+		double	 emission_function_seconds;
+		uint64_t transition_function_calls;		//External transition functions
+		double	 transition_function_seconds;
+
+		uint64_t traceback_steps;
+		uint64_t duration_steps;
+		size_t	 table_bytes;
+
+		//!Time and number of calls of each algorithm (including the time of
+		//!the algorithms it calls)
+		struct phase{
+			std::string name;
+			uint64_t calls;
+			double seconds;
+		};
+		std::vector<phase> phases;
+	};
+
+}
+
+#endif /* defined(__StochHMM__trellisStats__) */
@@ -49,6 +49,9 @@ namespace StochHMM {
 			return;
 		}
 		
+		TRELLIS_PHASE("simple_viterbi");
+		trellisTiles tile_scope(this, true);
+		
 		//Initialize the traceback table
 		if (traceback_table != NULL){
 			delete traceback_table;
@@ -64,8 +67,8 @@ namespace StochHMM {
 		}
 		
 		
-		std::bitset<STATE_MAX> next_states;
-		std::bitset<STATE_MAX> current_states;
+		dynamic_bitset next_states(state_size);
+		dynamic_bitset current_states(state_size);
 		
 		double  viterbi_temp(-INFINITY);
 		double  emission(-INFINITY);
@@ -75,23 +78,23 @@ namespace StochHMM {
 		
 		state* init = hmm->getInitial();
 		
-		std::bitset<STATE_MAX>* initial_to = hmm->getInitialTo();
-		std::bitset<STATE_MAX>* from_trans(NULL);
+		dynamic_bitset* initial_to = hmm->getInitialTo();
+		dynamic_bitset* from_trans(NULL);
 		
 		//Calculate Viterbi from transitions from INIT (initial) state
-		for(size_t st = 0; st < state_size; ++st){
-			if ((*initial_to)[st]){  //if the bitset is set (meaning there is a transition to this state), calculate the viterbi
-				
-				viterbi_temp = (*hmm)[st]->get_emission_prob(*seqs,0) + getTransition(init, st, 0);
-				
-				if (viterbi_temp > -INFINITY){
-					if ((*scoring_current)[st] < viterbi_temp){
-						(*scoring_current)[st] = viterbi_temp;
-					}
-					next_states |= (*(*hmm)[st]->getTo());
+		for(size_t st = initial_to->find_first(); st != SIZE_MAX; st = initial_to->find_next(st)){
+			
+			viterbi_temp = _emission(st, 0) + getTransition(init, st, 0);
+			
+			if (viterbi_temp > -INFINITY){
+				if ((*scoring_current)[st] < viterbi_temp){
+					(*scoring_current)[st] = viterbi_temp;
 				}
+				next_states |= (*(*hmm)[st]->getTo());
 			}
 		}
+		_store_viterbi(0);
+		_count_cells(scoring_current);
 		
 		//Each position in the sequence
 		for(size_t position = 1; position < seq_size ; ++position ){
@@ -113,15 +116,10 @@ namespace StochHMM {
 			}
 			
 			//Current states
-			for (size_t st_current = 0; st_current < state_size; ++st_current){ //Current state that emits value
-				
-				//Check to see if current state is valid
-				if (!current_states[st_current]){
-					continue;
-				}
+			for (size_t st_current = current_states.find_first(); st_current != SIZE_MAX; st_current = current_states.find_next(st_current)){ //Current state that emits value
 				
 				//Get emission of current state
-				emission = (*hmm)[st_current]->get_emission_prob(*seqs, position);
+				emission = _emission(st_current, position);
 				
 				
 				if (exDef_defined && exDef_position){
@@ -136,10 +134,7 @@ namespace StochHMM {
 				//Get list of states that are valid previous states
 				from_trans = (*hmm)[st_current]->getFrom();
 				
-				for (size_t st_previous = 0; st_previous < state_size ; ++st_previous) {  //for previous states
-					if (!(*from_trans)[st_previous]){
-						continue;
-					}
+				for (size_t st_previous = from_trans->find_first(); st_previous != SIZE_MAX; st_previous = from_trans->find_next(st_previous)){  //for previous states
 					
 					//Check that previous state has transition to current state
 					//and that the previous viterbi score is not -INFINITY
@@ -155,6 +150,8 @@ namespace StochHMM {
 					}
 				}
 			}
+			_store_viterbi(position);
+			_count_cells(scoring_current);
 		}
 		
 		//TODO:  Calculate ending and set the final viterbi and traceback pointer
@@ -184,6 +181,32 @@ namespace StochHMM {
 	}
 	
 	
+	//!Copy the Viterbi scores of the current position to the Viterbi table
+	//!Scores are only kept if store() is set
+	void trellis::_store_viterbi(size_t position){
+		if (!store_values){
+			return;
+		}
+		
+		if (position == 0){
+			if (viterbi_score != NULL){
+				delete viterbi_score;
+			}
+			
+			viterbi_score = new (std::nothrow) float_2D(seq_size, std::vector<float>(state_size,-INFINITY));
+			if (viterbi_score == NULL){
+				std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+				exit(1);
+			}
+		}
+		
+		std::vector<float>& row = (*viterbi_score)[position];
+		for(size_t st = 0; st < state_size; ++st){
+			row[st] = (*scoring_current)[st];
+		}
+	}
+	
+	
 	void trellis::naive_viterbi(model* h, sequences* sqs){
 		//Initialize the table
 		hmm = h;
@@ -199,6 +222,8 @@ namespace StochHMM {
 	
 	
 	void trellis::naive_viterbi(){
+		TRELLIS_PHASE("naive_viterbi");
+		trellisTiles tile_scope(this, true);
 		traceback_table = new(std::nothrow) int_2D(seq_size, std::vector<int16_t>(state_size,-1));
 		dbl_viterbi_score = new (std::nothrow) double_2D(seq_size, std::vector<double>(state_size,-INFINITY));
 		
@@ -214,7 +239,7 @@ namespace StochHMM {
 		
 		//Calculate from Initial states
 		for(size_t st = 0; st < state_size; ++st){
-			viterbi_temp = (*hmm)[st]->get_emission_prob(*seqs,0) +  getTransition(init, st, 0);
+			viterbi_temp = _emission(st, 0) +  getTransition(init, st, 0);
 			(*dbl_viterbi_score)[0][st]=viterbi_temp;
 			(*traceback_table)[0][st]=-1;
 		}
@@ -228,7 +253,7 @@ namespace StochHMM {
 			
 			for (size_t st_current = 0; st_current < state_size; ++st_current){
 				//Calc emissions
-				emission = (*hmm)[st_current]->get_emission_prob(*seqs, position);
+				emission = _emission(st_current, position);
 				
 				if (exDef_defined && exDef_position){
 					emission += seqs->getWeight(position, st_current);
@@ -297,8 +322,8 @@ namespace StochHMM {
 //		}
 //		
 //		
-//		std::bitset<STATE_MAX> next_states;
-//		std::bitset<STATE_MAX> current_states;
+//		dynamic_bitset next_states(state_size);
+//		dynamic_bitset current_states(state_size);
 //		
 //		double  viterbi_temp(-INFINITY);
 //		double  emission(-INFINITY);
@@ -316,8 +341,8 @@ namespace StochHMM {
 //		
 //		state* init = hmm->getInitial();
 //		
-//		std::bitset<STATE_MAX>* initial_to = hmm->getInitialTo();
-//		std::bitset<STATE_MAX>* from_trans(NULL);
+//		dynamic_bitset* initial_to = hmm->getInitialTo();
+//		dynamic_bitset* from_trans(NULL);
 //		
 //		//Calculate Viterbi from transitions from INIT (initial) state
 //		for(size_t i = 0; i < state_size; ++i){
@@ -468,6 +493,8 @@ namespace StochHMM {
 	//! Stores the transition duration probabilities in a hashmap (memory efficient, slower)
 	//! The duratio probabilities can then be used in forward and backward algorithms.
 	void trellis::sparse_complex_viterbi(){
+		TRELLIS_PHASE("sparse_complex_viterbi");
+		trellisTiles tile_scope(this, true);
 		
 		//Initialize the traceback table
         if (traceback_table != NULL){
@@ -484,8 +511,8 @@ namespace StochHMM {
 		}
 		
 		
-        std::bitset<STATE_MAX> next_states;
-        std::bitset<STATE_MAX> current_states;
+        dynamic_bitset next_states(state_size);
+        dynamic_bitset current_states(state_size);
 		
         double  viterbi_temp(-INFINITY);
         double  emission(-INFINITY);
@@ -517,24 +544,23 @@ namespace StochHMM {
         
         state* init = hmm->getInitial();
 		
-		std::bitset<STATE_MAX>* initial_to = hmm->getInitialTo();
-		std::bitset<STATE_MAX>* from_trans(NULL);
+		dynamic_bitset* initial_to = hmm->getInitialTo();
+		dynamic_bitset* from_trans(NULL);
 		
         //Calculate Viterbi from transitions from INIT (initial) state
-        for(size_t i = 0; i < state_size; ++i){
-            if ((*initial_to)[i]){  //if the bitset is set (meaning there is a transition to this state), calculate the viterbi
-				
-				//Transitions here are guarenteed to be standard from the initial state
-				viterbi_temp = (*hmm)[i]->get_emission_prob(*seqs,0) + getTransition(init, i, 0);
-                
-				if (viterbi_temp > -INFINITY){
-                    if ((*scoring_current)[i] < viterbi_temp){
-                        (*scoring_current)[i] = viterbi_temp;
-                    }
-					next_states |= (*(*hmm)[i]->getTo());
+        for(size_t i = initial_to->find_first(); i != SIZE_MAX; i = initial_to->find_next(i)){
+			
+			//Transitions here are guarenteed to be standard from the initial state
+			viterbi_temp = _emission(i, 0) + getTransition(init, i, 0);
+            
+			if (viterbi_temp > -INFINITY){
+                if ((*scoring_current)[i] < viterbi_temp){
+                    (*scoring_current)[i] = viterbi_temp;
                 }
+				next_states |= (*(*hmm)[i]->getTo());
             }
         }
+		_count_cells(scoring_current);
 		
         
         for(size_t position = 1; position < seq_size ; ++position ){
@@ -560,12 +586,9 @@ namespace StochHMM {
 			//std::cout << "\nPosition:\t" << position << "\n";
 			//			std::cout << "Letter:\t" << seqs->seqValue(0, position) << std::endl;
 			
-            for (size_t st_current = 0; st_current < state_size; ++st_current){ //i is current state that emits value
-                if (!current_states[st_current]){
-                    continue;
-                }
+            for (size_t st_current = current_states.find_first(); st_current != SIZE_MAX; st_current = current_states.find_next(st_current)){ //i is current state that emits value
 				
-                emission = (*hmm)[st_current]->get_emission_prob(*seqs, position);
+                emission = _emission(st_current, position);
 				
 				
 				//Check External definitions
@@ -576,10 +599,7 @@ namespace StochHMM {
 				//Get list of state that transition to current state
 				from_trans = (*hmm)[st_current]->getFrom();
 				
-                for (size_t st_previous = 0; st_previous < state_size ; ++st_previous) {  //j is previous state
-                    if (!(*from_trans)[st_previous]){ //if transition not possible next
-                        continue;
-                    }
+                for (size_t st_previous = from_trans->find_first(); st_previous != SIZE_MAX; st_previous = from_trans->find_next(st_previous)){  //j is previous state
 					
                     if ((*scoring_previous)[st_previous] != -INFINITY){
 						
@@ -633,6 +653,7 @@ namespace StochHMM {
 				explicit_duration_current= swap_ptr_duration;
 				explicit_duration_current->assign(state_size,0);
 			}
+			_count_cells(scoring_current);
             
         }
         
@@ -663,6 +684,8 @@ namespace StochHMM {
 	//!Store transition in a table  (more memory, but faster than sparse complex)
 	//!Need testing and more develepment;
 	void trellis::fast_complex_viterbi(){
+		TRELLIS_PHASE("fast_complex_viterbi");
+		trellisTiles tile_scope(this, true);
 		
 		//Initialize the traceback table
         if (traceback_table != NULL){
@@ -679,8 +702,8 @@ namespace StochHMM {
 		}
 		
 		
-        std::bitset<STATE_MAX> next_states;
-        std::bitset<STATE_MAX> current_states;
+        dynamic_bitset next_states(state_size);
+        dynamic_bitset current_states(state_size);
 		
         double  viterbi_temp(-INFINITY);
         double  emission(-INFINITY);
@@ -700,26 +723,26 @@ namespace StochHMM {
         
         state* init = hmm->getInitial();
 		
-		std::bitset<STATE_MAX>* initial_to = hmm->getInitialTo();
-		std::bitset<STATE_MAX>* from_trans(NULL);
+		dynamic_bitset* initial_to = hmm->getInitialTo();
+		dynamic_bitset* from_trans(NULL);
 		
         //Calculate Viterbi from transitions from INIT (initial) state
-        for(size_t i = 0; i < state_size; ++i){
-            if ((*initial_to)[i]){  //if the bitset is set (meaning there is a transition to this state), calculate the viterbi
-				
-				viterbi_temp = (*hmm)[i]->get_emission_prob(*seqs,0) + getTransition(init, i, 0);
-                
-				if (viterbi_temp > -INFINITY){
-                    if ((*scoring_current)[i] < viterbi_temp){
-                        (*scoring_current)[i] = viterbi_temp;
-                    }
-					next_states |= (*(*hmm)[i]->getTo());
+        for(size_t i = initial_to->find_first(); i != SIZE_MAX; i = initial_to->find_next(i)){
+			
+			viterbi_temp = _emission(i, 0) + getTransition(init, i, 0);
+            
+			if (viterbi_temp > -INFINITY){
+                if ((*scoring_current)[i] < viterbi_temp){
+                    (*scoring_current)[i] = viterbi_temp;
+                }
+				next_states |= (*(*hmm)[i]->getTo());
 //					if ((*duration)[i]){
 //						(*explicit_duration_previous)[i]=1;
 //					}
-                }
             }
         }
+		_store_viterbi(0);
+		_count_cells(scoring_current);
 		
         
         for(size_t position = 1; position < seq_size ; ++position ){
@@ -745,14 +768,11 @@ namespace StochHMM {
 //			std::cout << "\nPosition:\t" << position << "\n";
 //			std::cout << "Letter:\t" << seqs->seqValue(0, position)+1 << std::endl;
 			
-            for (size_t i = 0; i < state_size; ++i){ //i is current state that emits value
-                if (!current_states[i]){
-                    continue;
-                }
+            for (size_t i = current_states.find_first(); i != SIZE_MAX; i = current_states.find_next(i)){ //i is current state that emits value
 				
                 //current_state = (*hmm)[i];
                 //emission = current_state->get_emission(*seqs,position);
-                emission = (*hmm)[i]->get_emission_prob(*seqs, position);
+                emission = _emission(i, position);
 				
 				
 //				std::cout << "State Emission:\t" << i << "\t" << exp(emission) << std::endl;
@@ -763,10 +783,7 @@ namespace StochHMM {
                 
 				from_trans = (*hmm)[i]->getFrom();
 				
-                for (size_t j = 0; j < state_size ; ++j) {  //j is previous state
-                    if (!(*from_trans)[j]){
-                        continue;
-                    }
+                for (size_t j = from_trans->find_first(); j != SIZE_MAX; j = from_trans->find_next(j)){  //j is previous state
 					
                     if ((*scoring_previous)[j] != -INFINITY){
                         viterbi_temp = getTransition((*hmm)[j], i , position) + emission + (*scoring_previous)[j];
@@ -813,6 +830,8 @@ namespace StochHMM {
 				explicit_duration_current= swap_ptr_duration;
 				explicit_duration_current->assign(state_size,0);
 			}
+			_store_viterbi(position);
+			_count_cells(scoring_current);
             
         }
         
@@ -841,5 +860,975 @@ namespace StochHMM {
 	}
 	
 
+	void trellis::beam_viterbi(model* h, sequences* sqs){
+		hmm = h;
+		seqs = sqs;
+		seq_size		= seqs->getLength();
+		state_size		= hmm->state_size();
+		exDef_defined	= seqs->exDefDefined();
+		
+		beam_viterbi();
+	}
+	
+	
+	//!Viterbi algorithm with beam pruning for basic models
+	//!Only the states that are active (within the beam) in the previous column
+	//!are extended, using lists of the states each state transitions to.
+	//!After each column, cells with scores more than beam_threshold below the
+	//!column maximum are pruned, and if beam_width is set only the top beam_width
+	//!cells are kept.  The number of pruned cells is stored in pruned_cells.
+	void trellis::beam_viterbi(){
+		if (!hmm->isBasic()){
+			std::cerr << "Model isn't a simple/basic HMM.  Use complex algorithms\n";
+			return;
+		}
+		
+		TRELLIS_PHASE("beam_viterbi");
+		
+		//Initialize the traceback table
+		if (traceback_table != NULL){
+			delete traceback_table;
+		}
+		
+		traceback_table = new int_2D(seq_size,std::vector<int16_t> (state_size,-1));
+		scoring_previous = new (std::nothrow) std::vector<double> (state_size,-INFINITY);
+		scoring_current  = new (std::nothrow) std::vector<double> (state_size,-INFINITY);
+		
+		if (scoring_previous == NULL || scoring_current == NULL || traceback_table == NULL){
+			std::cerr << "Can't allocate Viterbi score and traceback table. OUT OF MEMORY" << std::endl;
+			exit(2);
+		}
+		
+		std::vector<std::vector<size_t> > to_states;
+		_get_to_states(to_states);
+		
+		std::vector<size_t> active_previous;
+		std::vector<size_t> active_current;
+		std::vector<size_t> reached;
+		std::vector<double> emissions(state_size,-INFINITY);
+		std::vector<bool>	touched(state_size,false);
+		
+		double  viterbi_temp(-INFINITY);
+		double  emission(-INFINITY);
+		bool	exDef_position(false);
+		ending_viterbi_tb = -1;
+		ending_viterbi_score = -INFINITY;
+		pruned_cells = 0;
+		
+		state* init = hmm->getInitial();
+		dynamic_bitset* initial_to = hmm->getInitialTo();
+		
+		//Calculate Viterbi from transitions from INIT (initial) state
+		for(size_t st = initial_to->find_first(); st != SIZE_MAX; st = initial_to->find_next(st)){
+			viterbi_temp = _emission(st, 0) + getTransition(init, st, 0);
+			
+			if (viterbi_temp > -INFINITY){
+				(*scoring_current)[st] = viterbi_temp;
+				active_current.push_back(st);
+			}
+		}
+		
+		_beam_prune(active_current, *scoring_current);
+		_count_cells(scoring_current);
+		
+		//Each position in the sequence
+		for(size_t position = 1; position < seq_size ; ++position ){
+			
+			//Swap current and previous viterbi scores
+			scoring_previous->assign(state_size,-INFINITY);
+			swap_ptr = scoring_previous;
+			scoring_previous = scoring_current;
+			scoring_current = swap_ptr;
+			
+			active_previous.swap(active_current);
+			active_current.clear();
+			
+			if (exDef_defined){
+				exDef_position = seqs->exDefDefined(position);
+			}
+			
+			//Extend each active state to the states it transitions to
+			for(size_t i = 0; i < active_previous.size(); ++i){
+				size_t st_previous = active_previous[i];
+				std::vector<size_t>& to = to_states[st_previous];
+				
+				for(size_t j = 0; j < to.size(); ++j){
+					size_t st_current = to[j];
+					
+					//Get emission of current state the first time it is reached
+					if (!touched[st_current]){
+						touched[st_current] = true;
+						reached.push_back(st_current);
+						emission = _emission(st_current, position);
+						
+						if (exDef_defined && exDef_position){
+							emission += seqs->getWeight(position, st_current);
+						}
+						
+						emissions[st_current] = emission;
+					}
+					
+					if (emissions[st_current] == -INFINITY){
+						continue;
+					}
+					
+					viterbi_temp = getTransition((*hmm)[st_previous], st_current , position) + emissions[st_current] + (*scoring_previous)[st_previous];
+					
+					if (viterbi_temp > (*scoring_current)[st_current]){
+						(*scoring_current)[st_current] = viterbi_temp;
+						(*traceback_table)[position][st_current] = st_previous;
+					}
+				}
+			}
+			
+			//Reset reached states and keep the states with a valid score
+			for(size_t i = 0; i < reached.size(); ++i){
+				touched[reached[i]] = false;
+				if ((*scoring_current)[reached[i]] != -INFINITY){
+					active_current.push_back(reached[i]);
+				}
+			}
+			reached.clear();
+			
+			_beam_prune(active_current, *scoring_current);
+			_count_cells(scoring_current);
+		}
+		
+		//Calculate ending viterbi score and traceback from END state
+		for(size_t i = 0; i < active_current.size(); ++i){
+			size_t st_previous = active_current[i];
+			viterbi_temp = (*scoring_current)[st_previous] + (*hmm)[st_previous]->getEndTrans();
+			
+			if (viterbi_temp > ending_viterbi_score){
+				ending_viterbi_score = viterbi_temp;
+				ending_viterbi_tb = st_previous;
+			}
+		}
+		
+		delete scoring_previous;
+		delete scoring_current;
+		scoring_previous = NULL;
+		scoring_current  = NULL;
+	}
+	
+	
+	//!Get the list of states that each state transitions to
+	void trellis::_get_to_states(std::vector<std::vector<size_t> >& to_states){
+		to_states.assign(state_size, std::vector<size_t>());
+		for(size_t st = 0; st < state_size; ++st){
+			dynamic_bitset* to = (*hmm)[st]->getTo();
+			for(size_t i = to->find_first(); i != SIZE_MAX; i = to->find_next(i)){
+				to_states[st].push_back(i);
+			}
+		}
+	}
+	
+	
+	//!Prune the active states using the beam threshold and beam width
+	//!Pruned cells are set to -INFINITY and the remaining states are sorted
+	//!\param active List of states with valid scores
+	//!\param scores Scores of the current column
+	void trellis::_beam_prune(std::vector<size_t>& active, std::vector<double>& scores){
+		if (active.empty()){
+			return;
+		}
+		
+		double max_score(-INFINITY);
+		for(size_t i = 0; i < active.size(); ++i){
+			if (scores[active[i]] > max_score){
+				max_score = scores[active[i]];
+			}
+		}
+		
+		size_t kept(0);
+		size_t total(active.size());
+		if (beam_threshold != INFINITY){
+			double cutoff = max_score - beam_threshold;
+			for(size_t i = 0; i < active.size(); ++i){
+				if (scores[active[i]] >= cutoff){
+					active[kept++] = active[i];
+				}
+				else{
+					scores[active[i]] = -INFINITY;
+				}
+			}
+			active.resize(kept);
+		}
+		
+		if (beam_width > 0 && active.size() > beam_width){
+			std::vector<std::pair<double,size_t> > ranked;
+			ranked.reserve(active.size());
+			for(size_t i = 0; i < active.size(); ++i){
+				ranked.push_back(std::make_pair(-scores[active[i]], active[i]));
+			}
+			
+			std::nth_element(ranked.begin(), ranked.begin() + beam_width, ranked.end());
+			
+			for(size_t i = beam_width; i < ranked.size(); ++i){
+				scores[ranked[i].second] = -INFINITY;
+			}
+			
+			active.clear();
+			for(size_t i = 0; i < beam_width; ++i){
+				active.push_back(ranked[i].second);
+			}
+		}
+		
+		std::sort(active.begin(), active.end());
+		pruned_cells += total - active.size();
+	}
+	
+	
+	//!Viterbi algorithm on a windowed sequence source
+	//!The scores at the start of each window are saved on the first pass.
+	//!The windows are then read again from the last to the first, and each
+	//!is recalculated from its saved scores to get the traceback pointers for
+	//!that window only.  Requires uncompressed sequence files.
+	//! \param h Model (basic models only)
+	//! \param window Window of the next sequence (opened with seqWindow::next)
+	//! \param [out] path Viterbi path
+	void trellis::stream_viterbi(model* h, seqWindow* window, traceback_path& path){
+		hmm = h;
+		seqs = window->getSeqs();
+		state_size		= hmm->state_size();
+		exDef_defined	= false;
+		seq_size		= 0;
+		ending_viterbi_tb = -1;
+		ending_viterbi_score = -INFINITY;
+		
+		if (!hmm->isBasic()){
+			std::cerr << "Model isn't a simple/basic HMM.  Windowed decoding requires a basic model\n";
+			return;
+		}
+		
+		if (!window->seekable()){
+			std::cerr << "Windowed Viterbi requires uncompressed sequence files" << std::endl;
+			return;
+		}
+		
+		TRELLIS_PHASE("stream_viterbi");
+		
+		scoring_previous = new (std::nothrow) std::vector<double> (state_size,-INFINITY);
+		scoring_current  = new (std::nothrow) std::vector<double> (state_size,-INFINITY);
+		
+		if (scoring_previous == NULL || scoring_current == NULL){
+			std::cerr << "Can't allocate Viterbi scores. OUT OF MEMORY" << std::endl;
+			exit(2);
+		}
+		
+		dynamic_bitset next_states(state_size);
+		dynamic_bitset current_states(state_size);
+		
+		//Checkpoints at the start of each window
+		std::vector<std::vector<streamPosition> > checkpoints;
+		std::vector<std::vector<double> > checkpoint_scores;
+		std::vector<dynamic_bitset> checkpoint_states;
+		std::vector<size_t> checkpoint_positions;
+		
+		std::vector<streamPosition> pos;
+		size_t position(0);
+		
+		while(true){
+			window->save(pos);
+			if (!window->fill()){
+				break;
+			}
+			
+			checkpoints.push_back(pos);
+			checkpoint_scores.push_back(*scoring_current);
+			checkpoint_states.push_back(next_states);
+			checkpoint_positions.push_back(position);
+			
+			size_t start = window->getStart();
+			size_t end = start + window->size();
+			
+			for(; position < end; ++position){
+				_stream_viterbi_position(position, position - start, current_states, next_states, NULL);
+				_count_cells(scoring_current);
+			}
+		}
+		seq_size = position;
+		
+		//End of the sequence, so the next sequence can be read after the traceback
+		std::vector<streamPosition> end_pos;
+		window->save(end_pos);
+		
+		//Calculate ending viterbi score and traceback from END state
+		double viterbi_temp;
+		for(size_t st_previous = 0; seq_size > 0 && st_previous < state_size ;++st_previous){
+			if ((*scoring_current)[st_previous] > -INFINITY){
+				viterbi_temp = (*scoring_current)[st_previous] + (*hmm)[st_previous]->getEndTrans();
+				
+				if (viterbi_temp > ending_viterbi_score){
+					ending_viterbi_score = viterbi_temp;
+					ending_viterbi_tb = st_previous;
+				}
+			}
+		}
+		
+		if (path.getModel() == NULL){
+			path.setModel(hmm);
+		}
+		
+		if (ending_viterbi_score != -INFINITY){
+			path.setScore(ending_viterbi_score);
+			path.push_back(ending_viterbi_tb);
+			TRELLIS_STATS(traceback_steps++);
+		}
+		
+		int16_t pointer = ending_viterbi_tb;
+		std::vector<int16_t> traceback;
+		
+		//Recalculate each window from the last to get the traceback
+		for(size_t k = checkpoints.size(); k > 0 && ending_viterbi_score != -INFINITY; --k){
+			size_t first = checkpoint_positions[k-1];
+			size_t last = (k < checkpoints.size()) ? checkpoint_positions[k] : seq_size;
+			
+			window->restore(checkpoints[k-1]);
+			window->fill();
+			*scoring_current = checkpoint_scores[k-1];
+			next_states = checkpoint_states[k-1];
+			traceback.assign((last - first) * state_size, -1);
+			
+			size_t start = window->getStart();
+			for(position = first; position < last; ++position){
+				_stream_viterbi_position(position, position - start, current_states, next_states, &traceback[(position - first) * state_size]);
+				_count_cells(scoring_current);
+			}
+			
+			for(position = last - 1; position >= first && position > 0; --position){
+				pointer = traceback[(position - first) * state_size + pointer];
+				
+				if (pointer == -1){
+					std::cerr << "No valid path at Position: " << position << std::endl;
+					k = 1;
+					break;
+				}
+				
+				path.push_back(pointer);
+				TRELLIS_STATS(traceback_steps++);
+			}
+		}
+		
+		window->restore(end_pos);
+		
+		delete scoring_previous;
+		delete scoring_current;
+		scoring_previous = NULL;
+		scoring_current  = NULL;
+	}
+	
+	
+	//!Viterbi decoding that stores the scores at every interval positions
+	//!instead of the traceback table.  Each interval is recalculated from the
+	//!last to the first to traceback the path, so only one interval of
+	//!traceback pointers is stored.  Takes about twice the time of
+	//!simple_viterbi.
+	//! \param [out] path Viterbi path
+	//! \param interval Positions between stored scores (0 for the square root of the length)
+	void trellis::checkpoint_viterbi(traceback_path& path, size_t interval){
+		if (!hmm->isBasic()){
+			std::cerr << "Model isn't a simple/basic HMM.  Use complex algorithms\n";
+			return;
+		}
+		
+		TRELLIS_PHASE("checkpoint_viterbi");
+		trellisTiles tile_scope(this, true);
+		
+		ending_viterbi_tb = -1;
+		ending_viterbi_score = -INFINITY;
+		
+		if (path.getModel() == NULL){
+			path.setModel(hmm);
+		}
+		
+		if (seq_size == 0){
+			return;
+		}
+		
+		if (interval == 0){
+			interval = checkpointInterval(seq_size);
+		}
+		
+		scoring_previous = new (std::nothrow) std::vector<double> (state_size,-INFINITY);
+		scoring_current  = new (std::nothrow) std::vector<double> (state_size,-INFINITY);
+		
+		if (scoring_previous == NULL || scoring_current == NULL){
+			std::cerr << "Can't allocate Viterbi scores. OUT OF MEMORY" << std::endl;
+			exit(2);
+		}
+		
+		dynamic_bitset next_states(state_size);
+		dynamic_bitset current_states(state_size);
+		
+		//Scores and next states before the first position of each interval
+		size_t intervals = (seq_size + interval - 1) / interval;
+		std::vector<std::vector<double> > checkpoint_scores;
+		std::vector<dynamic_bitset> checkpoint_states;
+		checkpoint_scores.reserve(intervals);
+		checkpoint_states.reserve(intervals);
+		
+		for(size_t position = 0; position < seq_size; ++position){
+			if (position % interval == 0){
+				checkpoint_scores.push_back(*scoring_current);
+				checkpoint_states.push_back(next_states);
+			}
+			
+			_stream_viterbi_position(position, position, current_states, next_states, NULL);
+			_count_cells(scoring_current);
+		}
+		
+		//Calculate ending viterbi score and traceback from END state
+		double viterbi_temp;
+		for(size_t st_previous = 0; st_previous < state_size ;++st_previous){
+			if ((*scoring_current)[st_previous] > -INFINITY){
+				viterbi_temp = (*scoring_current)[st_previous] + (*hmm)[st_previous]->getEndTrans();
+				
+				if (viterbi_temp > ending_viterbi_score){
+					ending_viterbi_score = viterbi_temp;
+					ending_viterbi_tb = st_previous;
+				}
+			}
+		}
+		
+		if (ending_viterbi_score != -INFINITY){
+			path.setScore(ending_viterbi_score);
+			path.push_back(ending_viterbi_tb);
+			TRELLIS_STATS(traceback_steps++);
+		}
+		
+		int16_t pointer = ending_viterbi_tb;
+		std::vector<int16_t> traceback;
+		TRELLIS_STATS(tableBytes(intervals * state_size * sizeof(double) + interval * state_size * sizeof(int16_t)));
+		
+		//Recalculate each interval from the last to get the traceback
+		for(size_t k = intervals; k > 0 && ending_viterbi_score != -INFINITY; --k){
+			size_t first = (k - 1) * interval;
+			size_t last = (k * interval < seq_size) ? k * interval : seq_size;
+			
+			*scoring_current = checkpoint_scores[k-1];
+			next_states = checkpoint_states[k-1];
+			traceback.assign((last - first) * state_size, -1);
+			
+			for(size_t position = first; position < last; ++position){
+				_stream_viterbi_position(position, position, current_states, next_states, &traceback[(position - first) * state_size]);
+				_count_cells(scoring_current);
+			}
+			
+			for(size_t position = last - 1; position >= first && position > 0; --position){
+				pointer = traceback[(position - first) * state_size + pointer];
+				
+				if (pointer == -1){
+					std::cerr << "No valid path at Position: " << position << std::endl;
+					k = 1;
+					break;
+				}
+				
+				path.push_back(pointer);
+				TRELLIS_STATS(traceback_steps++);
+			}
+		}
+		
+		delete scoring_previous;
+		delete scoring_current;
+		scoring_previous = NULL;
+		scoring_current  = NULL;
+	}
+	
+	
+	//!Get the default interval of checkpoint_viterbi for a sequence length
+	//!\return Square root of the length (rounded up)
+	size_t trellis::checkpointInterval(size_t length){
+		size_t interval = (size_t) ceil(sqrt((double) length));
+		while (interval * interval < length){
+			interval++;
+		}
+		return (interval > 0) ? interval : 1;
+	}
+	
+	
+	//Positions between the scores compared by parallel_viterbi, and the
+	//fewest positions in a chunk
+	static const size_t PARALLEL_STRIDE = 64;
+	static const size_t PARALLEL_MIN_CHUNK = 16384;
+	
+	//!Chunk of the sequence calculated by a thread of parallel_viterbi
+	struct viterbiChunk{
+		trellis* helper;		//Trellis of the thread
+		int_2D* table;			//Traceback table shared by the chunks
+		size_t first;
+		size_t last;			//Position after the chunk
+		std::vector<std::vector<double> > scores;	//Scores every PARALLEL_STRIDE positions
+		dynamic_bitset next_states;	//States after the last position
+		trellisStats stats;
+	};
+	
+	//!Chunk of the path traced back by a thread of parallel_traceback
+	struct tracebackChunk{
+		int_2D* table;
+		std::vector<int16_t>* states;	//State of each position
+		size_t first;
+		size_t last;
+		size_t traced;			//First position traced
+	};
+	
+	
+	//!Viterbi algorithm using threads on chunks of the sequence
+	//!Chunks after the first start from equal scores for every state, and
+	//!are recalculated from the scores of the previous chunk until the
+	//!pointers are identical and the scores exactly parallel to the first
+	//!calculation.  Paths through a chunk converge quickly, so only the start
+	//!of each chunk is calculated twice; the rest of its scores are summed
+	//!along the pointers.  Chunks that don't converge are recalculated to
+	//!their end.
+	//!Models that aren't basic, emissions that aren't thread-safe, stored
+	//!scores and short sequences use viterbi()
+	//! \param threads Number of threads (and chunks)
+	void trellis::parallel_viterbi(size_t threads){
+		size_t chunks = (threads < seq_size / PARALLEL_MIN_CHUNK) ? threads : seq_size / PARALLEL_MIN_CHUNK;
+		
+		bool safe = hmm->isBasic() && !store_values && chunks >= 2;
+		for(size_t i = 0; safe && i < state_size; ++i){
+			safe = emissionTiles::threadSafe((*hmm)[i]);
+		}
+		
+		if (!safe){
+			viterbi();
+			return;
+		}
+		
+		TRELLIS_PHASE("parallel_viterbi");
+		
+		if (traceback_table != NULL){
+			delete traceback_table;
+		}
+		
+		traceback_table = new (std::nothrow) int_2D(seq_size,std::vector<int16_t> (state_size,-1));
+		scoring_previous = new (std::nothrow) std::vector<double> (state_size,-INFINITY);
+		scoring_current  = new (std::nothrow) std::vector<double> (state_size,-INFINITY);
+		std::vector<viterbiChunk> chunk(chunks);
+		
+		if (scoring_previous == NULL || scoring_current == NULL || traceback_table == NULL){
+			std::cerr << "Can't allocate Viterbi score and traceback table. OUT OF MEMORY" << std::endl;
+			exit(2);
+		}
+		
+		ending_viterbi_tb = -1;
+		ending_viterbi_score = -INFINITY;
+		
+		for(size_t k = 0; k < chunks; ++k){
+			chunk[k].helper = new (std::nothrow) trellis(hmm, seqs);
+			if (chunk[k].helper == NULL){
+				std::cerr << "Can't allocate Viterbi chunks. OUT OF MEMORY" << std::endl;
+				exit(2);
+			}
+			if (stats != NULL){
+				chunk[k].helper->setStats(&chunk[k].stats);
+			}
+			chunk[k].table = traceback_table;
+			chunk[k].first = seq_size * k / chunks;
+			chunk[k].last = seq_size * (k + 1) / chunks;
+		}
+		
+		std::vector<pthread_t> workers(chunks);
+		for(size_t k = 1; k < chunks; ++k){
+			if (pthread_create(&workers[k], NULL, _viterbi_chunk_start, &chunk[k]) != 0){
+				std::cerr << "Unable to create Viterbi thread" << std::endl;
+				exit(2);
+			}
+		}
+		
+		chunk[0].helper->_viterbi_chunk(chunk[0]);
+		
+		for(size_t k = 1; k < chunks; ++k){
+			pthread_join(workers[k], NULL);
+		}
+		
+		//Fix each chunk from the real scores at the end of the previous chunk
+		std::vector<double> scores(chunk[0].scores.back());
+		dynamic_bitset next_states(chunk[0].next_states);
+		
+		for(size_t k = 1; k < chunks; ++k){
+			_viterbi_fix_chunk(chunk[k], scores, next_states);
+		}
+		
+		//Calculate ending viterbi score and traceback from END state
+		double viterbi_temp;
+		for(size_t st_previous = 0; st_previous < state_size ;++st_previous){
+			if (scores[st_previous] > -INFINITY){
+				viterbi_temp = scores[st_previous] + (*hmm)[st_previous]->getEndTrans();
+				
+				if (viterbi_temp > ending_viterbi_score){
+					ending_viterbi_score = viterbi_temp;
+					ending_viterbi_tb = st_previous;
+				}
+			}
+		}
+		
+		for(size_t k = 0; k < chunks; ++k){
+			if (stats != NULL){
+				stats->add(chunk[k].stats);
+			}
+			delete chunk[k].helper;
+		}
+		
+		delete scoring_previous;
+		delete scoring_current;
+		scoring_previous = NULL;
+		scoring_current  = NULL;
+	}
+	
+	
+	void* trellis::_viterbi_chunk_start(void* ptr){
+		viterbiChunk* chunk = static_cast<viterbiChunk*>(ptr);
+		chunk->helper->_viterbi_chunk(*chunk);
+		return NULL;
+	}
+	
+	
+	//!Calculate the traceback pointers of a chunk and keep its scores every
+	//!PARALLEL_STRIDE positions and at the last position
+	void trellis::_viterbi_chunk(viterbiChunk& chunk){
+		scoring_previous = new (std::nothrow) std::vector<double> (state_size,-INFINITY);
+		scoring_current  = new (std::nothrow) std::vector<double> (state_size,-INFINITY);
+		
+		if (scoring_previous == NULL || scoring_current == NULL){
+			std::cerr << "Can't allocate Viterbi scores. OUT OF MEMORY" << std::endl;
+			exit(2);
+		}
+		
+		dynamic_bitset next_states(state_size);
+		dynamic_bitset current_states(state_size);
+		
+		//Any previous state is possible at the start of the chunk
+		if (chunk.first > 0){
+			scoring_current->assign(state_size, 0);
+			for(size_t i = 0; i < state_size; ++i){
+				next_states.set(i);
+			}
+		}
+		
+		chunk.scores.reserve((chunk.last - chunk.first) / PARALLEL_STRIDE + 1);
+		
+		for(size_t position = chunk.first; position < chunk.last; ++position){
+			_stream_viterbi_position(position, position, current_states, next_states, &(*chunk.table)[position][0]);
+			_count_cells(scoring_current);
+			
+			if ((position - chunk.first + 1) % PARALLEL_STRIDE == 0 || position + 1 == chunk.last){
+				chunk.scores.push_back(*scoring_current);
+			}
+		}
+		
+		chunk.next_states = next_states;
+		
+		delete scoring_previous;
+		delete scoring_current;
+		scoring_previous = NULL;
+		scoring_current  = NULL;
+	}
+	
+	
+	//!Recalculate a chunk from the real scores before it until its traceback
+	//!pointers and scores have converged to those it was calculated with:
+	//!the pointers of a whole stride are identical and the scores differ by
+	//!exactly the same value for every state.  The rest of the chunk keeps
+	//!its pointers, and its scores are recalculated along them, so the scores
+	//!at the end of the chunk are those of simple_viterbi.
+	//! \param chunk Chunk calculated by _viterbi_chunk
+	//! \param [in,out] scores Scores before the chunk, set to the scores at its last position
+	//! \param [in,out] next_states States of the first position, set to the states after the chunk
+	//! \return true if the chunk converged before its end
+	bool trellis::_viterbi_fix_chunk(viterbiChunk& chunk, std::vector<double>& scores, dynamic_bitset& next_states){
+		dynamic_bitset current_states(state_size);
+		std::vector<int16_t> traceback(state_size);
+		*scoring_current = scores;
+		
+		bool converged(false);
+		bool same(true);	//Pointers of the stride are identical
+		
+		for(size_t position = chunk.first; position < chunk.last; ++position){
+			std::vector<int16_t>& row = (*chunk.table)[position];
+			
+			if (converged){
+				_viterbi_replay_position(position, &row[0]);
+				_count_cells(scoring_current);
+				continue;
+			}
+			
+			traceback.assign(state_size, -1);
+			_stream_viterbi_position(position, position, current_states, next_states, &traceback[0]);
+			_count_cells(scoring_current);
+			
+			if (traceback != row){
+				row = traceback;
+				same = false;
+			}
+			
+			if ((position - chunk.first + 1) % PARALLEL_STRIDE != 0 || position + 1 == chunk.last){
+				continue;
+			}
+			
+			std::vector<double>& first = chunk.scores[(position - chunk.first + 1) / PARALLEL_STRIDE - 1];
+			double offset(-INFINITY);
+			bool parallel = same;
+			
+			for(size_t i = 0; parallel && i < state_size; ++i){
+				if (((*scoring_current)[i] == -INFINITY) != (first[i] == -INFINITY)){
+					parallel = false;
+				}
+				else if (first[i] == -INFINITY){
+					continue;
+				}
+				else if (offset == -INFINITY){
+					offset = (*scoring_current)[i] - first[i];
+				}
+				else if ((*scoring_current)[i] - first[i] != offset){
+					parallel = false;
+				}
+			}
+			
+			converged = parallel && offset != -INFINITY;
+			same = true;
+		}
+		
+		scores = *scoring_current;
+		
+		if (converged){
+			next_states.reset();
+			for(size_t i = 0; i < state_size; ++i){
+				if (scores[i] != -INFINITY){
+					next_states |= (*(*hmm)[i]->getTo());
+				}
+			}
+		}
+		
+		return converged;
+	}
+	
+	
+	//!Calculate the Viterbi scores of a position into scoring_current from its
+	//!traceback pointers, with the same sums as _stream_viterbi_position
+	//! \param position Position in the sequence
+	//! \param traceback Traceback pointers for each state at the position
+	void trellis::_viterbi_replay_position(size_t position, int16_t* traceback){
+		scoring_previous->assign(state_size,-INFINITY);
+		swap_ptr = scoring_previous;
+		scoring_previous = scoring_current;
+		scoring_current = swap_ptr;
+		
+		bool exDef_position = exDef_defined && seqs->exDefDefined(position);
+		
+		for(size_t st_current = 0; st_current < state_size; ++st_current){
+			int16_t st_previous = traceback[st_current];
+			if (st_previous == -1 || (*scoring_previous)[st_previous] == -INFINITY){
+				continue;
+			}
+			
+			double emission = _emission(st_current, position);
+			
+			if (exDef_position){
+				emission += seqs->getWeight(position, st_current);
+			}
+			
+			(*scoring_current)[st_current] = getTransition((*hmm)[st_previous], st_current , position) + emission + (*scoring_previous)[st_previous];
+		}
+	}
+	
+	
+	//!Traceback the Viterbi path with threads on chunks of the sequence
+	//!Chunks before the last are traced back from a guessed state at the
+	//!same time, then fixed in order from the last chunk until they reach the
+	//!guessed path.
+	//! \param [out] path Viterbi path
+	//! \param threads Number of threads (and chunks)
+	void trellis::parallel_traceback(traceback_path& path, size_t threads){
+		size_t chunks = (threads < seq_size / PARALLEL_MIN_CHUNK) ? threads : seq_size / PARALLEL_MIN_CHUNK;
+		
+		if (chunks < 2 || traceback_table == NULL || ending_viterbi_score == -INFINITY){
+			traceback(path);
+			return;
+		}
+		
+		TRELLIS_PHASE("parallel_traceback");
+		
+		if (path.getModel() == NULL){
+			path.setModel(hmm);
+		}
+		
+		std::vector<int16_t> states(seq_size, -1);
+		std::vector<tracebackChunk> chunk(chunks);
+		std::vector<pthread_t> workers(chunks);
+		
+		for(size_t k = 0; k < chunks; ++k){
+			chunk[k].table = traceback_table;
+			chunk[k].states = &states;
+			chunk[k].first = seq_size * k / chunks;
+			chunk[k].last = seq_size * (k + 1) / chunks;
+			chunk[k].traced = chunk[k].last;
+			
+			//Guess the last state from the pointers of the next position
+			int16_t guess = ending_viterbi_tb;
+			if (k + 1 < chunks){
+				std::vector<int16_t>& next = (*traceback_table)[chunk[k].last];
+				for(size_t i = 0; i < state_size; ++i){
+					if (next[i] != -1){
+						guess = next[i];
+						break;
+					}
+				}
+			}
+			states[chunk[k].last - 1] = guess;
+		}
+		
+		for(size_t k = 1; k < chunks; ++k){
+			if (pthread_create(&workers[k], NULL, _traceback_chunk_start, &chunk[k]) != 0){
+				std::cerr << "Unable to create traceback thread" << std::endl;
+				exit(2);
+			}
+		}
+		
+		_traceback_chunk_start(&chunk[0]);
+		
+		for(size_t k = 1; k < chunks; ++k){
+			pthread_join(workers[k], NULL);
+		}
+		
+		//Fix each chunk from the real state at its last position
+		int16_t pointer = ending_viterbi_tb;
+		size_t position = seq_size - 1;
+		bool valid = true;
+		
+		for(size_t k = chunks; k > 0 && valid; --k){
+			tracebackChunk& ch = chunk[k-1];
+			
+			for(position = ch.last - 1; ; --position){
+				//The rest of the chunk was traced back from the same state
+				if (ch.traced == ch.first && states[position] == pointer){
+					position = ch.first;
+					break;
+				}
+				
+				states[position] = pointer;
+				if (position == ch.first){
+					break;
+				}
+				
+				pointer = (*traceback_table)[position][pointer];
+				if (pointer == -1){
+					std::cerr << "No valid path at Position: " << position << std::endl;
+					valid = false;
+					break;
+				}
+			}
+			
+			if (valid && position > 0){
+				pointer = (*traceback_table)[position][states[position]];
+				if (pointer == -1){
+					std::cerr << "No valid path at Position: " << position << std::endl;
+					valid = false;
+				}
+			}
+		}
+		
+		//Positions before an invalid pointer aren't part of the path
+		size_t end = (valid) ? 0 : position;
+		path.setScore(ending_viterbi_score);
+		for(size_t i = seq_size; i > end; --i){
+			path.push_back(states[i-1]);
+		}
+		TRELLIS_STATS(traceback_steps += seq_size - end);
+	}
+	
+	
+	//!Traceback a chunk from the guessed state at its last position
+	void* trellis::_traceback_chunk_start(void* ptr){
+		tracebackChunk* chunk = static_cast<tracebackChunk*>(ptr);
+		std::vector<int16_t>& states = *chunk->states;
+		int16_t pointer = states[chunk->last - 1];
+		chunk->traced = chunk->last - 1;
+		
+		for(size_t position = chunk->last - 1; position > chunk->first; --position){
+			pointer = (*chunk->table)[position][pointer];
+			if (pointer == -1){
+				break;
+			}
+			states[position - 1] = pointer;
+			chunk->traced = position - 1;
+		}
+		return NULL;
+	}
+	
+	
+	//!Calculate the Viterbi scores of one position of a window into scoring_current
+	//! \param position Position in the sequence
+	//! \param relative Position in the window
+	//! \param current_states States that can emit at the position
+	//! \param next_states States that can emit at the next position
+	//! \param traceback Traceback pointers for each state at the position (NULL if not needed)
+	void trellis::_stream_viterbi_position(size_t position, size_t relative, dynamic_bitset& current_states, dynamic_bitset& next_states, int16_t* traceback){
+		double  viterbi_temp(-INFINITY);
+		double  emission(-INFINITY);
+		
+		if (position == 0){
+			state* init = hmm->getInitial();
+			dynamic_bitset* initial_to = hmm->getInitialTo();
+			
+			for(size_t st = initial_to->find_first(); st != SIZE_MAX; st = initial_to->find_next(st)){
+				viterbi_temp = _emission(st, relative) + getTransition(init, st, relative);
+				
+				if (viterbi_temp > -INFINITY){
+					if ((*scoring_current)[st] < viterbi_temp){
+						(*scoring_current)[st] = viterbi_temp;
+					}
+					next_states |= (*(*hmm)[st]->getTo());
+				}
+			}
+			return;
+		}
+		
+		//Swap current and previous viterbi scores
+		scoring_previous->assign(state_size,-INFINITY);
+		swap_ptr = scoring_previous;
+		scoring_previous = scoring_current;
+		scoring_current = swap_ptr;
+		
+		current_states.reset();
+		current_states |= next_states;
+		next_states.reset();
+		
+		dynamic_bitset* from_trans(NULL);
+		
+		for (size_t st_current = current_states.find_first(); st_current != SIZE_MAX; st_current = current_states.find_next(st_current)){
+			
+			emission = _emission(st_current, relative);
+			
+			if (exDef_defined && seqs->exDefDefined(position)){
+				emission += seqs->getWeight(position, st_current);
+			}
+			
+			if (emission == -INFINITY){
+				continue;
+			}
+			
+			from_trans = (*hmm)[st_current]->getFrom();
+			
+			for (size_t st_previous = from_trans->find_first(); st_previous != SIZE_MAX; st_previous = from_trans->find_next(st_previous)){
+				
+				if ((*scoring_previous)[st_previous] != -INFINITY){
+					viterbi_temp = getTransition((*hmm)[st_previous], st_current , relative) + emission + (*scoring_previous)[st_previous];
+					
+					if (viterbi_temp > (*scoring_current)[st_current]){
+						(*scoring_current)[st_current] = viterbi_temp;
+						if (traceback != NULL){
+							traceback[st_current] = st_previous;
+						}
+					}
+					
+					next_states |= (*(*hmm)[st_current]->getTo());
+				}
+			}
+		}
+	}
+	
 }
 
@@ -0,0 +1,130 @@
+//
+//  main.cpp
+//  TestBaumWelch
+//
+//  Regression case for Baum-Welch training: the log-likelihood of the
+//  training sequence never decreases between iterations, whether the model
+//  uses the "END: 1" convention or an ending transition that is part of the
+//  state's distribution.
+//
+//  Returns non-zero if any case fails.  Build against the library:
+//  g++ -I../../src main.cpp ../../src/libstochhmm.a -lpthread -lz
+//
+
+#include <iostream>
+#include <string>
+#include "hmm.h"
+#include "sequences.h"
+#include "trainer.h"
+using namespace StochHMM;
+
+
+//Dice model of examples/Dice.hmm, with the ending transitions supplied
+std::string diceModel(const std::string& fairEnd, const std::string& loadedEnd){
+	return "#STOCHHMM MODEL FILE\n"
+	"MODEL INFORMATION\n"
+	"======================================================\n"
+	"MODEL_NAME:\tDICE\n"
+	"\n"
+	"TRACK SYMBOL DEFINITIONS\n"
+	"======================================================\n"
+	"DICE:\t1,2,3,4,5,6\n"
+	"\n"
+	"STATE DEFINITIONS\n"
+	"#############################################\n"
+	"STATE:\n"
+	"\tNAME:\tINIT\n"
+	"TRANSITION:\tSTANDARD:\tP(X)\n"
+	"\tFAIR:\t0.5\n"
+	"\tLOADED:\t0.5\n"
+	"#############################################\n"
+	"STATE:\n"
+	"\tNAME:\tFAIR\n"
+	"\tPATH_LABEL:\tF\n"
+	"TRANSITION:\tSTANDARD:\tP(X)\n"
+	"\tFAIR:\t0.94\n"
+	"\tLOADED:\t0.05\n"
+	"\tEND:\t" + fairEnd + "\n"
+	"EMISSION:\tDICE:\tP(X)\n"
+	"\tORDER:\t0\n"
+	"@1\t2\t3\t4\t5\t6\n"
+	"0.167\t0.167\t0.167\t0.167\t0.167\t0.167\n"
+	"#############################################\n"
+	"STATE:\n"
+	"\tNAME:\tLOADED\n"
+	"\tPATH_LABEL:\tL\n"
+	"TRANSITION:\tSTANDARD:\tP(X)\n"
+	"\tFAIR:\t0.1\n"
+	"\tLOADED:\t0.89\n"
+	"\tEND:\t" + loadedEnd + "\n"
+	"EMISSION:\tDICE:\tP(X)\n"
+	"\tORDER:\t0\n"
+	"@1\t2\t3\t4\t5\t6\n"
+	"0.1\t0.1\t0.1\t0.1\t0.1\t0.5\n"
+	"#############################################\n"
+	"//END\n";
+}
+
+
+//Rolls of examples/Dice.fa
+std::string diceRolls =
+"315116246446644245311321631164152133625144543631656626566666"
+"651166453132651245636664631636663162326455236266666625151631"
+"222555441666566563564324364131513465146353411126414626253356"
+"366163666466232534413661661163252562462255265252266435353336"
+"233121625364414432335163243633665562466662632666616";
+
+
+bool check(bool passed, const std::string& name){
+	std::cout << ((passed) ? "PASS\t" : "FAIL\t") << name << std::endl;
+	return passed;
+}
+
+
+bool testMonotonic(std::string text, const std::string& name){
+	model hmm;
+	if (!hmm.importFromString(text)){
+		return check(false, name);
+	}
+	
+	tracks* trks = hmm.getTracks();
+	sequences seqs(trks->size());
+	sequence* sq = new(std::nothrow) sequence(diceRolls, trks->getTrack("DICE"));
+	if (sq == NULL){
+		std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+		exit(1);
+	}
+	seqs.addSeq(sq);
+	
+	trainer train(&hmm, NULL);
+	train.addSequences(&seqs);
+	
+	bool passed = true;
+	double previous(-INFINITY);
+	for(size_t iter = 0; iter < 30; ++iter){
+		double likelihood = train.expectation();
+		
+		//Allow for rounding once the likelihood has converged
+		if (likelihood == -INFINITY || likelihood < previous - 1e-9){
+			std::cerr << name << " iteration " << iter + 1 << ": " << likelihood << " after " << previous << std::endl;
+			passed = false;
+		}
+		
+		train.maximization();
+		previous = likelihood;
+	}
+	
+	return check(passed, name);
+}
+
+
+int main(int argc, const char * argv[])
+{
+	//END: 1 isn't part of the state distributions
+	bool passed = testMonotonic(diceModel("1", "1"), "baum-welch likelihood increases (END: 1)");
+	
+	//Transitions including END sum to 1, so END is re-estimated
+	passed &= testMonotonic(diceModel("0.01", "0.01"), "baum-welch likelihood increases (normalized END)");
+	
+	return (passed) ? 0 : 1;
+}
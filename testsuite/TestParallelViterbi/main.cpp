@@ -0,0 +1,185 @@
+//
+//  main.cpp
+//  TestParallelViterbi
+//
+//  Regression case for trellis::parallel_viterbi and parallel_traceback:
+//  decoding with threads (-threads N) gives exactly the score and path of
+//  the sequential viterbi and traceback.
+//
+//  Returns non-zero if any case fails.  Build against the library:
+//  g++ -I../../src main.cpp ../../src/libstochhmm.a -lpthread -lz
+//
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "hmm.h"
+#include "sequences.h"
+#include "trellis.h"
+using namespace StochHMM;
+
+
+std::string diceModel =
+"#STOCHHMM MODEL FILE\n"
+"MODEL INFORMATION\n"
+"======================================================\n"
+"MODEL_NAME:\tDICE\n"
+"\n"
+"TRACK SYMBOL DEFINITIONS\n"
+"======================================================\n"
+"DICE:\t1,2,3,4,5,6\n"
+"\n"
+"STATE DEFINITIONS\n"
+"#############################################\n"
+"STATE:\n"
+"\tNAME:\tINIT\n"
+"TRANSITION:\tSTANDARD:\tP(X)\n"
+"\tFAIR:\t0.5\n"
+"\tLOADED:\t0.5\n"
+"#############################################\n"
+"STATE:\n"
+"\tNAME:\tFAIR\n"
+"\tPATH_LABEL:\tF\n"
+"TRANSITION:\tSTANDARD:\tP(X)\n"
+"\tFAIR:\t0.95\n"
+"\tLOADED:\t0.05\n"
+"\tEND:\t1\n"
+"EMISSION:\tDICE:\tP(X)\n"
+"\tORDER:\t0\n"
+"@1\t2\t3\t4\t5\t6\n"
+"0.167\t0.167\t0.167\t0.167\t0.167\t0.167\n"
+"#############################################\n"
+"STATE:\n"
+"\tNAME:\tLOADED\n"
+"\tPATH_LABEL:\tL\n"
+"TRANSITION:\tSTANDARD:\tP(X)\n"
+"\tFAIR:\t0.1\n"
+"\tLOADED:\t0.9\n"
+"\tEND:\t1\n"
+"EMISSION:\tDICE:\tP(X)\n"
+"\tORDER:\t0\n"
+"@1\t2\t3\t4\t5\t6\n"
+"0.1\t0.1\t0.1\t0.1\t0.1\t0.5\n"
+"#############################################\n"
+"//END\n";
+
+
+//Three states with second order emissions, so the scores of the chunks
+//take longer to become parallel
+std::string dnaModel(){
+	std::string states[3] = {"AT", "GC", "MIX"};
+	std::stringstream model;
+	model << "#STOCHHMM MODEL FILE\n"
+	"MODEL INFORMATION\n"
+	"======================================================\n"
+	"MODEL_NAME:\tDNA\n"
+	"\n"
+	"TRACK SYMBOL DEFINITIONS\n"
+	"======================================================\n"
+	"SEQ:\tA,C,G,T\n"
+	"\n"
+	"STATE DEFINITIONS\n"
+	"#############################################\n"
+	"STATE:\n"
+	"\tNAME:\tINIT\n"
+	"TRANSITION:\tSTANDARD:\tP(X)\n"
+	"\tAT:\t0.4\n"
+	"\tGC:\t0.3\n"
+	"\tMIX:\t0.3\n";
+
+	for(size_t i = 0; i < 3; ++i){
+		model << "#############################################\n"
+		"STATE:\n"
+		"\tNAME:\t" << states[i] << "\n"
+		"\tPATH_LABEL:\t" << states[i][0] << "\n"
+		"TRANSITION:\tSTANDARD:\tP(X)\n";
+		for(size_t j = 0; j < 3; ++j){
+			model << "\t" << states[j] << ":\t" << ((i == j) ? 0.98 : 0.01) << "\n";
+		}
+		model << "\tEND:\t1\n"
+		"EMISSION:\tSEQ:\tCOUNTS\n"
+		"\tORDER:\t2\n";
+
+		//Each context prefers different nucleotides in each state
+		for(size_t context = 0; context < 16; ++context){
+			for(size_t nt = 0; nt < 4; ++nt){
+				model << ((nt == (context + i) % 4) ? 12 : 3 + (nt + i + context / 4) % 5);
+				model << ((nt == 3) ? "\n" : "\t");
+			}
+		}
+	}
+	model << "#############################################\n"
+	"//END\n";
+	return model.str();
+}
+
+
+//Sequence of alternating stretches drawn with a fixed generator
+std::string makeSequence(const std::string& alphabet, size_t length, size_t bias){
+	std::string sq(length, alphabet[0]);
+	unsigned long random = 12345;
+	size_t favoured = 0;
+	for(size_t i = 0; i < length; ++i){
+		random = random * 1103515245 + 12345;
+		size_t value = (random >> 16) % 32768;
+		if (value % 500 == 0){
+			favoured = (favoured + 1) % alphabet.size();
+		}
+		sq[i] = alphabet[(value % bias == 0) ? favoured : (value / bias) % alphabet.size()];
+	}
+	return sq;
+}
+
+
+bool check(bool passed, const std::string& name){
+	std::cout << ((passed) ? "PASS\t" : "FAIL\t") << name << std::endl;
+	return passed;
+}
+
+
+bool testParallel(std::string text, std::string trackName, const std::string& alphabet, size_t bias, const std::string& name){
+	model hmm;
+	if (!hmm.importFromString(text)){
+		return check(false, name);
+	}
+
+	tracks* trks = hmm.getTracks();
+	sequences seqs(trks->size());
+	std::string letters = makeSequence(alphabet, 120000, bias);
+	sequence* sq = new(std::nothrow) sequence(letters, trks->getTrack(trackName));
+	if (sq == NULL){
+		std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+		exit(1);
+	}
+	seqs.addSeq(sq);
+
+	trellis sequential(&hmm, &seqs);
+	sequential.viterbi();
+	traceback_path expected(&hmm);
+	sequential.traceback(expected);
+
+	bool passed = expected.size() == letters.size();
+	for(size_t threads = 2; threads <= 7; ++threads){
+		trellis parallel(&hmm, &seqs);
+		parallel.parallel_viterbi(threads);
+		traceback_path path(&hmm);
+		parallel.parallel_traceback(path, threads);
+
+		//Scores are compared exactly, not within a tolerance
+		if (parallel.getViterbiScore() != sequential.getViterbiScore() || !(path == expected)){
+			std::cerr << name << " with " << threads << " threads differs from viterbi" << std::endl;
+			passed = false;
+		}
+	}
+
+	return check(passed, name);
+}
+
+
+int main(int argc, const char * argv[])
+{
+	bool passed = testParallel(diceModel, "DICE", "123456", 3, "parallel viterbi (dice)");
+	passed &= testParallel(dnaModel(), "SEQ", "ACGT", 2, "parallel viterbi (second order DNA)");
+
+	return (passed) ? 0 : 1;
+}
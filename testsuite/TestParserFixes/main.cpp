@@ -0,0 +1,228 @@
+//
+//  main.cpp
+//  TestParserFixes
+//
+//  Regression cases for the model parser:
+//  - templates::parse splits each template at its "TEMPLATE:" line and
+//    doesn't include that line in the template
+//  - model::_processTemplateState returns the expanded states to the parser
+//  - LEXICAL transitions build their emission table when they're parsed
+//
+//  Returns non-zero if any case fails.  Build against the library:
+//  g++ -I../../src main.cpp ../../src/libstochhmm.a -lpthread -lz
+//
+
+#include <iostream>
+#include <string>
+#include <map>
+#include "hmm.h"
+#include "modelTemplate.h"
+#include "sequences.h"
+#include "trellis.h"
+using namespace StochHMM;
+
+
+//Two templates; the second one ends the text without a trailing TEMPLATE
+std::string templateText =
+"TEMPLATE: FIRST\n"
+"STATE:\n"
+"\tNAME:\t((A))\n"
+"\tPATH_LABEL:\t<<LABEL>>\n"
+"TEMPLATE:\tSECOND\n"
+"STATE:\n"
+"\tNAME:\t((B))\n";
+
+
+std::string templateModel =
+"#STOCHHMM MODEL FILE\n"
+"MODEL INFORMATION\n"
+"======================================================\n"
+"MODEL_NAME:\tTEMPLATE TEST\n"
+"\n"
+"TRACK SYMBOL DEFINITIONS\n"
+"======================================================\n"
+"SEQ:\tA,C,G,T\n"
+"\n"
+"TEMPLATED STATES\n"
+"======================================================\n"
+"TEMPLATE: SIMPLE_STATE\n"
+"STATE:\n"
+"\tNAME:\t((S))\n"
+"\tPATH_LABEL:\t<<LABEL>>\n"
+"TRANSITION:\tSTANDARD:\tP(X)\n"
+"<<TRANSITIONS>>\n"
+"\tEND:\t1\n"
+"EMISSION:\tSEQ:\tP(X)\n"
+"\tORDER:\t0\n"
+"<<EMISSION>>\n"
+"\n"
+"STATE DEFINITIONS\n"
+"##################################\n"
+"STATE:\n"
+"\tNAME:\tINIT\n"
+"TRANSITION:\tSTANDARD:\tP(X)\n"
+"\tS0:\t0.5\n"
+"\tS1:\t0.5\n"
+"##################################\n"
+"STATE:\tTEMPLATE:\tSIMPLE_STATE\tIDENTIFIER:\t0\n"
+"\t<<LABEL>> = 0\n"
+"\t<<TRANSITIONS>> = S0:\t0.9\n"
+"\tS1:\t0.1\n"
+"\t<<EMISSION>> = 0.4\t0.1\t0.1\t0.4\n"
+"##################################\n"
+"STATE:\tTEMPLATE:\tSIMPLE_STATE\tIDENTIFIER:\t1\n"
+"\t<<LABEL>> = 1\n"
+"\t<<TRANSITIONS>> = S1:\t0.9\n"
+"\tS0:\t0.1\n"
+"\t<<EMISSION>> = 0.1\t0.4\t0.4\t0.1\n"
+"##################################\n"
+"//END\n";
+
+
+std::string lexicalModel =
+"#STOCHHMM MODEL FILE\n"
+"MODEL INFORMATION\n"
+"======================================================\n"
+"MODEL_NAME:\tLEXICAL TRANSITION TEST\n"
+"\n"
+"TRACK SYMBOL DEFINITIONS\n"
+"======================================================\n"
+"DICE:\t1,2,3,4,5,6\n"
+"\n"
+"STATE DEFINITIONS\n"
+"#############################################\n"
+"STATE:\n"
+"\tNAME:\tINIT\n"
+"TRANSITION:\tSTANDARD:\tP(X)\n"
+"\tFAIR:\t0.5\n"
+"\tLOADED:\t0.5\n"
+"#############################################\n"
+"STATE:\n"
+"\tNAME:\tFAIR\n"
+"\tPATH_LABEL:\tF\n"
+"TRANSITION:\tSTANDARD:\tP(X)\n"
+"\tFAIR:\t0.95\n"
+"\tEND:\t1\n"
+"TRANSITION:\tLEXICAL:\tP(X)\n"
+"\tLOADED:\tDICE\n"
+"\tORDER:\t0\n"
+"@1\t2\t3\t4\t5\t6\n"
+"0.01\t0.01\t0.01\t0.01\t0.01\t0.2\n"
+"EMISSION:\tDICE:\tP(X)\n"
+"\tORDER:\t0\n"
+"@1\t2\t3\t4\t5\t6\n"
+"0.167\t0.167\t0.167\t0.167\t0.167\t0.167\n"
+"#############################################\n"
+"STATE:\n"
+"\tNAME:\tLOADED\n"
+"\tPATH_LABEL:\tL\n"
+"TRANSITION:\tSTANDARD:\tP(X)\n"
+"\tFAIR:\t0.1\n"
+"\tLOADED:\t0.9\n"
+"\tEND:\t1\n"
+"EMISSION:\tDICE:\tP(X)\n"
+"\tORDER:\t0\n"
+"@1\t2\t3\t4\t5\t6\n"
+"0.1\t0.1\t0.1\t0.1\t0.1\t0.5\n"
+"#############################################\n"
+"//END\n";
+
+
+bool check(bool passed, const std::string& name){
+	std::cout << ((passed) ? "PASS\t" : "FAIL\t") << name << std::endl;
+	return passed;
+}
+
+
+//Each template is stored under its name without the TEMPLATE line
+bool testTemplateParse(){
+	templates tmpls;
+	if (!tmpls.parse(templateText)){
+		return check(false, "templates::parse");
+	}
+
+	std::map<std::string,std::string> values;
+	values["LABEL"] = "X";
+	std::string first = "FIRST";
+	std::string second = "SECOND";
+	std::string id = "1";
+
+	std::string filled_first = tmpls.getTemplate(first, id, values);
+	std::string filled_second = tmpls.getTemplate(second, id, values);
+
+	bool passed = filled_first.find("NAME:\tA1") != std::string::npos
+		&& filled_first.find("PATH_LABEL:\tX") != std::string::npos
+		&& filled_first.find("TEMPLATE") == std::string::npos
+		&& filled_first.find("B1") == std::string::npos
+		&& filled_second.find("NAME:\tB1") != std::string::npos
+		&& filled_second.find("TEMPLATE") == std::string::npos;
+
+	return check(passed, "templates::parse");
+}
+
+
+//Templated states are added to the model
+bool testTemplateExpansion(){
+	model hmm;
+	if (!hmm.importFromString(templateModel)){
+		return check(false, "templated state expansion");
+	}
+
+	bool passed = hmm.state_size() == 2
+		&& hmm.getState("S0") != NULL
+		&& hmm.getState("S1") != NULL
+		&& hmm.getState("S1")->getLabel() == "1";
+
+	return check(passed, "templated state expansion");
+}
+
+
+//The lexical transition table is built and used when decoding
+bool testLexicalTransition(){
+	model hmm;
+	if (!hmm.importFromString(lexicalModel)){
+		return check(false, "lexical transition table");
+	}
+
+	state* fair = hmm.getState("FAIR");
+	transition* lexical = NULL;
+	std::vector<transition*>* trans = fair->getTransitions();
+	for(size_t i = 0; i < trans->size(); ++i){
+		if ((*trans)[i] != NULL && (*trans)[i]->getTransitionType() == LEXICAL){
+			lexical = (*trans)[i];
+		}
+	}
+
+	if (lexical == NULL || lexical->getTables()->getEmissionTable() == NULL){
+		return check(false, "lexical transition table");
+	}
+
+	tracks* trks = hmm.getTracks();
+	sequences seqs(trks->size());
+	std::string dice = "1111166666666662111";
+	sequence* sq = new(std::nothrow) sequence(dice, trks->getTrack("DICE"));
+	if (sq == NULL){
+		std::cerr << "OUT OF MEMORY\nFile" << __FILE__ << "Line:\t"<< __LINE__ << std::endl;
+		exit(1);
+	}
+	seqs.addSeq(sq);
+
+	trellis trell(&hmm, &seqs);
+	trell.viterbi();
+
+	traceback_path path(&hmm);
+	trell.traceback(path);
+
+	bool passed = path.size() == dice.size() && trell.getViterbiScore() > -INFINITY;
+	return check(passed, "lexical transition table");
+}
+
+
+int main(int argc, const char * argv[])
+{
+	bool passed = testTemplateParse();
+	passed &= testTemplateExpansion();
+	passed &= testLexicalTransition();
+
+	return (passed) ? 0 : 1;
+}